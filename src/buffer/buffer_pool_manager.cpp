@@ -31,6 +31,7 @@ BufferPoolManager::~BufferPoolManager() {
  * TODO: Student Implement
  */
 Page *BufferPoolManager::FetchPage(page_id_t page_id) {
+  std::scoped_lock<std::recursive_mutex> lock(latch_);
 #ifdef ENABLE_BUFFER_DEBUG
   LOG(INFO)<<"fetch page of "<<page_id<<" "<<std::endl;
 #endif
@@ -60,7 +61,7 @@ Page *BufferPoolManager::FetchPage(page_id_t page_id) {
     auto page=pages_+ frame_id;
     // 2.     If R is dirty, write it back to the disk.
     if(page->IsDirty()){
-      disk_manager_->WritePage(page_id,page->GetData());
+      disk_manager_->WritePage(page->GetPageId(),page->GetData());
     }
     page_table_.erase(page->GetPageId());
     // 3.     Delete R from the page table and insert P.
@@ -81,6 +82,7 @@ Page *BufferPoolManager::FetchPage(page_id_t page_id) {
  * TODO: Student Implement
  */
 Page *BufferPoolManager::NewPage(page_id_t &page_id) {
+  std::scoped_lock<std::recursive_mutex> lock(latch_);
   // 0.   Make sure you call AllocatePage!
   frame_id_t frame_id;
   if(!free_list_.empty()){//have free list
@@ -96,9 +98,27 @@ Page *BufferPoolManager::NewPage(page_id_t &page_id) {
   else replacer_ -> Victim(&frame_id);
   page_id=AllocatePage();
 //  LOG(INFO)<<"allocate a page with logic_id:"<<page_id<<std::endl;
+  // an optimistic reader may have fetched the page after it was freed, that frame still caches the id and must
+  // become the new page, otherwise two frames would hold the same page
+  auto stale = page_table_.find(page_id);
+  if (stale != page_table_.end()) {
+    if (pages_[frame_id].GetPageId() == INVALID_PAGE_ID) {
+      free_list_.push_front(frame_id);
+    } else {
+      replacer_->Unpin(frame_id);
+    }
+    frame_id = stale->second;
+    auto page = pages_ + frame_id;
+    page->ResetMemory();
+    page->ResetDirty();
+    page->Pin();
+    replacer_->Pin(frame_id);
+    return page;
+  }
   auto page=pages_+ frame_id;
+  // the victim is written back under its own page id
   if(page->IsDirty()){
-    disk_manager_->WritePage(page_id,page->GetData());
+    disk_manager_->WritePage(page->GetPageId(),page->GetData());
   }
   page_table_.erase(page->GetPageId());
   // 3.   Update P's metadata, zero out memory and add P to the page table.
@@ -119,31 +139,61 @@ Page *BufferPoolManager::NewPage(page_id_t &page_id) {
  * TODO: Student Implement
  */
 bool BufferPoolManager::DeletePage(page_id_t page_id) {
+  std::scoped_lock<std::recursive_mutex> lock(latch_);
   // 0.   Make sure you call DeallocatePage!
   // 1.   Search the page table for the requested page (P).
   // 1.   If P does not exist, return true.
-  if(page_table_.find(page_id)!=page_table_.end()){
+  auto iter = page_table_.find(page_id);
+  if(iter==page_table_.end()){
     DeallocatePage(page_id);
     return true;
   }
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
-  frame_id_t frame_id=page_table_[page_id];
+  frame_id_t frame_id=iter->second;
   auto page=pages_+frame_id;
   if(page->GetPinCount()!=0){
     return false;
   }
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
   DeallocatePage(page_id);
-  page_table_.erase(page_id);
+  page_table_.erase(iter);
+  replacer_->Pin(frame_id);  // the frame is no longer a victim candidate
   page->ResetAll();
   free_list_.push_front(frame_id);
   return true;
 }
 
+bool BufferPoolManager::DeletePages(const std::vector<page_id_t> &page_ids) {
+  std::scoped_lock<std::recursive_mutex> lock(latch_);
+  std::vector<page_id_t> freed_page_ids;
+  freed_page_ids.reserve(page_ids.size());
+  bool all_deleted = true;
+  for (auto page_id : page_ids) {
+    auto iter = page_table_.find(page_id);
+    if (iter != page_table_.end()) {
+      frame_id_t frame_id = iter->second;
+      auto page = pages_ + frame_id;
+      if (page->GetPinCount() != 0) {
+        all_deleted = false;
+        continue;
+      }
+      // 页面即将被释放，脏数据不必写回
+      page_table_.erase(iter);
+      replacer_->Pin(frame_id);
+      page->ResetAll();
+      free_list_.push_front(frame_id);
+    }
+    freed_page_ids.push_back(page_id);
+  }
+  disk_manager_->DeAllocatePages(std::move(freed_page_ids));
+  return all_deleted;
+}
+
 /**
  * TODO: Student Implement
  */
 bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
+  std::scoped_lock<std::recursive_mutex> lock(latch_);
 #ifdef ENABLE_BUFFER_DEBUG
   LOG(INFO)<<"unpin page "<<page_id<<endl;
 #endif
@@ -172,6 +222,7 @@ bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
  * TODO: Student Implement
  */
 bool BufferPoolManager::FlushPage(page_id_t page_id) {
+  std::scoped_lock<std::recursive_mutex> lock(latch_);
   if(page_table_.find(page_id)==page_table_.end()){
     LOG(INFO)<<"reflush "<<page_id<<std::endl;
     return true;
@@ -194,11 +245,13 @@ void BufferPoolManager::DeallocatePage(__attribute__((unused)) page_id_t page_id
 }
 
 bool BufferPoolManager::IsPageFree(page_id_t page_id) {
+  std::scoped_lock<std::recursive_mutex> lock(latch_);
   return disk_manager_->IsPageFree(page_id);
 }
 
 // Only used for debug
 bool BufferPoolManager::CheckAllUnpinned() {
+  std::scoped_lock<std::recursive_mutex> lock(latch_);
   bool res = true;
   for (size_t i = 0; i < pool_size_; i++) {
     if (pages_[i].pin_count_ != 0) {
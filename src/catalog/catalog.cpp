@@ -95,8 +95,12 @@ CatalogManager::CatalogManager(BufferPoolManager *buffer_pool_manager, LockManag
           TableMetadata* table_meta;
           auto table_page = buffer_pool_manager->FetchPage(page_id);
           TableMetadata::DeserializeFrom(table_page->GetData(),table_meta);//new TableMetadata in it
-          auto table_heap =  TableHeap::Create(buffer_pool_manager,table_meta->GetFirstPageId(),table_meta->GetFreeSpaceMapPageId(),table_meta->GetSchema(),
-                                              log_manager,lock_manager);
+          auto table_heap =  TableHeap::Create(buffer_pool_manager,table_meta->GetFirstPageId(),table_meta->GetFreeSpaceMapPageId(),
+                                              table_meta->GetHeapDirectoryPageId(),table_meta->GetSchema(),
+                                              log_manager,lock_manager,table_meta->GetLayout());
+          if(table_meta->GetHeapDirectoryPageId()==INVALID_PAGE_ID){
+              UpgradeTableMetadata(table_meta,table_heap,table_page);
+          }
           auto table_info = TableInfo::Create();
           table_info->Init(table_meta,table_heap);
           tables_[table_id] = table_info;
@@ -130,18 +134,24 @@ CatalogManager::~CatalogManager() {
 /**
  * TODO: Student Implement
  */
-dberr_t CatalogManager::CreateTable(const string &table_name, TableSchema *schema, Txn *txn, TableInfo *&table_info) {
+dberr_t CatalogManager::CreateTable(const string &table_name, TableSchema *schema, Txn *txn, TableInfo *&table_info,
+                                    TableLayout layout) {
   if(table_names_.find(table_name)!=table_names_.end()){
     LOG(INFO)<<"Duplicated table name"<<endl;
     return DB_TABLE_ALREADY_EXIST;
   }
+  if(layout!=TableLayout::kRow&&TablePage::GetPaxCapacity(schema,layout==TableLayout::kCompressed)==0){
+    LOG(WARNING)<<"A row of table "<<table_name<<" does not fit in a PAX page"<<endl;
+    return DB_FAILED;
+  }
   auto table_id = catalog_meta_->GetNextTableId();
   table_names_[table_name]=table_id;//get id
 
   auto deep_copied_schema = Schema::DeepCopySchema(schema);
 //  initialize table info
-  auto table_heap = TableHeap::Create(buffer_pool_manager_,deep_copied_schema,txn,log_manager_,lock_manager_);
-  auto table_meta = TableMetadata::Create(table_id,table_name,table_heap->GetFirstPageId(),table_heap->GetFreeSpaceMapPageId(),deep_copied_schema);
+  auto table_heap = TableHeap::Create(buffer_pool_manager_,deep_copied_schema,txn,log_manager_,lock_manager_,layout);
+  auto table_meta = TableMetadata::Create(table_id,table_name,table_heap->GetFirstPageId(),table_heap->GetFreeSpaceMapPageId(),
+                                          table_heap->GetHeapDirectoryPageId(),deep_copied_schema,layout);
   table_info = TableInfo::Create();
   table_info->Init(table_meta,table_heap);
   tables_[table_id] = table_info;
@@ -262,12 +272,23 @@ dberr_t CatalogManager::CreateIndex(const std::string &table_name, const string
 
   //create id
   auto index_id = catalog_meta_->GetNextIndexId();
-  index_names_[table_name][index_name]=index_id;
 
-  //init info and map it
+  //init info
   auto index_meta = IndexMetadata::Create(index_id,index_name,table_id,key_map);
   index_info = IndexInfo::Create();
   index_info->Init(index_meta,table_info,buffer_pool_manager_);
+
+  //backfill the rows already in the table
+  auto load_info = index_info->Backfill(txn);
+  if(load_info!=DB_SUCCESS){
+    LOG(WARNING)<<"Failed to build index on existing rows"<<endl;
+    delete index_info;
+    index_info=nullptr;
+    return load_info;
+  }
+
+  //map it
+  index_names_[table_name][index_name]=index_id;
   indexes_[index_id]=index_info;
 
   //create page
@@ -332,9 +353,47 @@ dberr_t CatalogManager::DropTable(const string &table_name) {
   }
   auto table_id = table_names_[table_name];
   auto table_info = tables_[table_id];
+  //drop the indexes of the table together with it
+  auto index_iter = index_names_.find(table_name);
+  if(index_iter!=index_names_.end()){
+    for(auto &[index_name,index_id]:index_iter->second){
+      auto index_info = indexes_[index_id];
+      index_info->GetIndex()->Destroy();
+      delete index_info;
+      indexes_.erase(index_id);
+      catalog_meta_->DeleteIndexMetaPage(buffer_pool_manager_,index_id);
+    }
+    index_names_.erase(index_iter);
+  }
+  //free all pages of the table heap in one batch
+  table_info->GetTableHeap()->DeleteTable();
+  auto meta_iter = catalog_meta_->table_meta_pages_.find(table_id);
+  if(meta_iter!=catalog_meta_->table_meta_pages_.end()){
+    buffer_pool_manager_->DeletePage(meta_iter->second);
+    catalog_meta_->table_meta_pages_.erase(meta_iter);
+  }
   delete table_info;
   table_names_.erase(table_name);
   tables_.erase(table_id);
+  return FlushCatalogMetaPage();
+}
+
+dberr_t CatalogManager::TruncateTable(const string &table_name, Txn *txn) {
+  if(table_names_.find(table_name)==table_names_.end()){
+    LOG(INFO)<<"Try to truncate a not existed table"<<endl;
+    return DB_TABLE_NOT_EXIST;
+  }
+  auto table_info = tables_[table_names_[table_name]];
+  if(!table_info->GetTableHeap()->Truncate(txn)){
+    return DB_FAILED;
+  }
+  //the indexes become empty trees, a new root is created by the next insert
+  auto index_iter = index_names_.find(table_name);
+  if(index_iter!=index_names_.end()){
+    for(auto &[index_name,index_id]:index_iter->second){
+      indexes_[index_id]->GetIndex()->Destroy();
+    }
+  }
   return DB_SUCCESS;
 }
 
@@ -398,6 +457,17 @@ dberr_t CatalogManager::FlushCatalogMetaPage() const {
   return DB_SUCCESS;
 }
 
+/**
+ * Metadata without a heap directory comes from an older format. The TableHeap has rebuilt the directory from the page
+ * chain, it is recorded so that the next load finds it.
+ */
+void CatalogManager::UpgradeTableMetadata(TableMetadata *table_meta, TableHeap *table_heap, Page *table_page) {
+  table_meta->SetHeapDirectoryPageId(table_heap->GetHeapDirectoryPageId());
+  table_meta->SerializeTo(table_page->GetData());
+  // 与读取元数据时的 FetchPage 配对，写回新格式
+  buffer_pool_manager_->UnpinPage(table_page->GetPageId(), true);
+}
+
 /**
  * TODO: Student Implement
  */
@@ -409,8 +479,12 @@ dberr_t CatalogManager::LoadTable(const table_id_t table_id, const page_id_t pag
   TableMetadata* table_meta;
   auto table_page = buffer_pool_manager_->FetchPage(page_id);
   TableMetadata::DeserializeFrom(table_page->GetData(),table_meta);//new TableMetadata in it
-  auto table_heap =  TableHeap::Create(buffer_pool_manager_,table_meta->GetFirstPageId(),table_meta->GetFreeSpaceMapPageId(),table_meta->GetSchema(),
-                                      log_manager_,lock_manager_);
+  auto table_heap =  TableHeap::Create(buffer_pool_manager_,table_meta->GetFirstPageId(),table_meta->GetFreeSpaceMapPageId(),
+                                              table_meta->GetHeapDirectoryPageId(),table_meta->GetSchema(),
+                                      log_manager_,lock_manager_,table_meta->GetLayout());
+  if(table_meta->GetHeapDirectoryPageId()==INVALID_PAGE_ID){
+    UpgradeTableMetadata(table_meta,table_heap,table_page);
+  }
   auto table_info = TableInfo::Create();
   table_info->Init(table_meta,table_heap);
   tables_[table_id] = table_info;
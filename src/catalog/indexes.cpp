@@ -1,5 +1,7 @@
 #include "catalog/indexes.h"
 
+#include <algorithm>
+
 IndexMetadata::IndexMetadata(const index_id_t index_id, const std::string &index_name, const table_id_t table_id,
                              const std::vector<uint32_t> &key_map)
     : index_id_(index_id), index_name_(index_name), table_id_(table_id), key_map_(key_map) {}
@@ -105,28 +107,56 @@ uint32_t IndexMetadata::DeserializeFrom(char *buf, IndexMetadata *&index_meta) {
 }
 
 Index *IndexInfo::CreateIndex(BufferPoolManager *buffer_pool_manager, const string &index_type) {
-  size_t max_size = 0;
-  for (auto col : key_schema_->GetColumns()) {
-    max_size += col->GetLength();
+  if (index_type != "bptree") {
+    return nullptr;
+  }
+  index_id_t index_id = meta_data_->index_id_;
+  // 单个非空 INT 列直接用原生 int32 作为 4 字节的 key
+  if (key_schema_->GetColumnCount() == 1 && key_schema_->GetColumn(0)->GetType() == TypeId::kTypeInt &&
+      !key_schema_->GetColumn(0)->IsNullable()) {
+    return new BPlusTreeIndex<4, IntKeyComparator>(index_id, key_schema_, 4, buffer_pool_manager);
   }
+  // keys are stored normalized, see KeyManager
+  size_t max_size = KeyManager::GetNormalizedSize(key_schema_);
+  if (max_size <= 16) {
+    return new BPlusTreeIndex<16, FixedKeyComparator<16>>(index_id, key_schema_, 16, buffer_pool_manager);
+  } else if (max_size <= 32) {
+    return new BPlusTreeIndex<32, FixedKeyComparator<32>>(index_id, key_schema_, 32, buffer_pool_manager);
+  } else if (max_size <= 64) {
+    return new BPlusTreeIndex<64, FixedKeyComparator<64>>(index_id, key_schema_, 64, buffer_pool_manager);
+  } else if (max_size <= 128) {
+    return new BPlusTreeIndex<128, FixedKeyComparator<128>>(index_id, key_schema_, 128, buffer_pool_manager);
+  } else if (max_size <= 256) {
+    return new BPlusTreeIndex<256, FixedKeyComparator<256>>(index_id, key_schema_, 256, buffer_pool_manager);
+  }
+  LOG(ERROR) << "GenericKey size is too large";
+  return nullptr;
+}
 
-  if (index_type == "bptree") {
-    if (max_size <= 8)
-      max_size = 16;
-    else if (max_size <= 24)
-      max_size = 32;
-    else if (max_size <= 56)
-      max_size = 64;
-    else if (max_size <= 120)
-      max_size = 128;
-    else if (max_size <= 248)
-      max_size = 256;
-    else {
-      LOG(ERROR) << "GenericKey size is too large";
-      return nullptr;
-    }
-  } else {
-    return nullptr;
+dberr_t IndexInfo::Backfill(Txn *txn, IndexBuildProgress *progress, uint32_t max_threads) {
+  auto table_heap = table_info->GetTableHeap();
+  uint32_t page_count = table_heap->GetPageCount();
+  uint32_t workers = std::max(1u, std::min(max_threads, page_count / INDEX_BUILD_PAGES_PER_THREAD));
+  std::vector<IndexEntrySource> sources;
+  for (uint32_t i = 0; i < workers; i++) {
+    // 每个worker扫描连续的一段页，最后一段扫到表尾
+    uint32_t begin_page = static_cast<uint64_t>(page_count) * i / workers;
+    uint32_t end_page = i + 1 == workers ? UINT32_MAX : static_cast<uint64_t>(page_count) * (i + 1) / workers;
+    // 按页批量读取，索引列直接从页面中读取，CHAR不拷贝，key只在下一次调用前使用
+    sources.emplace_back([this, iter = table_heap->Begin(txn, begin_page, end_page), end = table_heap->End(),
+                          cursor = size_t{0}](Row &key, RowId &row_id) mutable {
+      while (iter != end && cursor == iter.GetPageRows().size()) {
+        iter.NextPage();
+        cursor = 0;
+      }
+      if (iter == end) {
+        return false;
+      }
+      const RowView &view = iter.GetPageRows()[cursor++];
+      view.ToRow(meta_data_->key_map_, &key, false);
+      row_id = view.GetRowId();
+      return true;
+    });
   }
-  return new BPlusTreeIndex(meta_data_->index_id_, key_schema_, max_size, buffer_pool_manager);
+  return index_->BulkLoad(sources, txn, progress);
 }
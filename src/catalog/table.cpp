@@ -7,6 +7,9 @@ uint32_t TableMetadata::SerializeTo(char *buf) const {
   // magic num
   MACH_WRITE_UINT32(buf, TABLE_METADATA_MAGIC_NUM);
   buf += 4;
+  // version
+  MACH_WRITE_UINT32(buf, TABLE_METADATA_VERSION);
+  buf += 4;
   // table id
   MACH_WRITE_TO(table_id_t, buf, table_id_);
   buf += 4;
@@ -21,6 +24,12 @@ uint32_t TableMetadata::SerializeTo(char *buf) const {
   // freespace map root page id
   MACH_WRITE_TO(page_id_t, buf, freespace_map_page_id_);
   buf += 4;
+  // heap directory root page id
+  MACH_WRITE_TO(page_id_t, buf, heap_directory_page_id_);
+  buf += 4;
+  // page layout
+  MACH_WRITE_TO(TableLayout, buf, layout_);
+  buf += 4;
   // table schema
   buf += schema_->SerializeTo(buf);
   ASSERT(buf - p == ofs, "Unexpected serialize size.");
@@ -35,6 +44,8 @@ uint32_t TableMetadata::GetSerializedSize() const {
 //  ASSERT(ofs <= PAGE_SIZE, "Failed to serialize table info.");
   // magic num
 //  MACH_WRITE_UINT32(buf, TABLE_METADATA_MAGIC_NUM);
+  ofs += 4;
+  // version
   ofs += 4;
   // table id
 //  MACH_WRITE_TO(table_id_t, buf, table_id_);
@@ -49,6 +60,10 @@ uint32_t TableMetadata::GetSerializedSize() const {
   ofs += 4;
   // freespace map root page id
 //  MACH_WRITE_TO(page_id_t, buf, freespace_map_page_id_);
+  ofs += 4;
+  // heap directory root page id
+  ofs += 4;
+  // page layout
   ofs += 4;
   // table schema
   ofs += schema_->GetSerializedSize();
@@ -68,7 +83,15 @@ uint32_t TableMetadata::DeserializeFrom(char *buf, TableMetadata *&table_meta) {
   // magic num
   uint32_t magic_num = MACH_READ_UINT32(buf);
   buf += 4;
-  ASSERT(magic_num == TABLE_METADATA_MAGIC_NUM, "Failed to deserialize table info.");
+  ASSERT(magic_num == TABLE_METADATA_MAGIC_NUM || magic_num == TABLE_METADATA_LEGACY_MAGIC_NUM,
+         "Failed to deserialize table info.");
+  // version
+  uint32_t version = 0;
+  if (magic_num == TABLE_METADATA_MAGIC_NUM) {
+    version = MACH_READ_UINT32(buf);
+    buf += 4;
+  }
+  ASSERT(version <= TABLE_METADATA_VERSION, "Table info of a newer version.");
   // table id
   table_id_t table_id = MACH_READ_FROM(table_id_t, buf);
   buf += 4;
@@ -83,11 +106,24 @@ uint32_t TableMetadata::DeserializeFrom(char *buf, TableMetadata *&table_meta) {
   // table heap root page id
   page_id_t freespace_map_page_id = MACH_READ_FROM(page_id_t, buf);
   buf += 4;
+  // heap directory root page id, rebuilt from the page chain by the TableHeap if missing
+  page_id_t heap_directory_page_id = INVALID_PAGE_ID;
+  if (version >= VERSION_HEAP_DIRECTORY) {
+    heap_directory_page_id = MACH_READ_FROM(page_id_t, buf);
+    buf += 4;
+  }
+  // page layout, tables stored before there was a choice of layout are row tables
+  TableLayout layout = TableLayout::kRow;
+  if (version >= VERSION_LAYOUT) {
+    layout = MACH_READ_FROM(TableLayout, buf);
+    buf += 4;
+  }
   // table schema
   TableSchema *schema = nullptr;
   buf += TableSchema::DeserializeFrom(buf, schema);
   // allocate space for table metadata
-  table_meta = new TableMetadata(table_id, table_name, root_page_id, freespace_map_page_id, schema);
+  table_meta = new TableMetadata(table_id, table_name, root_page_id, freespace_map_page_id, heap_directory_page_id, schema,
+                                 layout);
   return buf - p;
 }
 
@@ -97,10 +133,14 @@ uint32_t TableMetadata::DeserializeFrom(char *buf, TableMetadata *&table_meta) {
  * @param heap Memory heap passed by TableInfo
  */
 TableMetadata *TableMetadata::Create(table_id_t table_id, std::string table_name, page_id_t root_page_id,page_id_t freespace_map_page_id,
-                                     TableSchema *schema) {
+                                     page_id_t heap_directory_page_id, TableSchema *schema, TableLayout layout) {
   // allocate space for table metadata
-  return new TableMetadata(table_id, table_name, root_page_id,freespace_map_page_id, schema);
+  return new TableMetadata(table_id, table_name, root_page_id,freespace_map_page_id, heap_directory_page_id, schema,
+                           layout);
 }
 
-TableMetadata::TableMetadata(table_id_t table_id, std::string table_name, page_id_t root_page_id,page_id_t freespace_map_page_id,TableSchema *schema)
-    : table_id_(table_id), table_name_(table_name), root_page_id_(root_page_id), schema_(schema),freespace_map_page_id_(freespace_map_page_id) {}
+TableMetadata::TableMetadata(table_id_t table_id, std::string table_name, page_id_t root_page_id,page_id_t freespace_map_page_id,
+                             page_id_t heap_directory_page_id, TableSchema *schema, TableLayout layout)
+    : table_id_(table_id), table_name_(table_name), root_page_id_(root_page_id),
+      freespace_map_page_id_(freespace_map_page_id), heap_directory_page_id_(heap_directory_page_id), layout_(layout),
+      schema_(schema) {}
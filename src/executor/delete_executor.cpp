@@ -20,6 +20,8 @@ bool DeleteExecutor::Next([[maybe_unused]] Row *row, RowId *rid) {
     if (!table_info_->GetTableHeap()->MarkDelete(*rid, txn_)) {
       return false;
     }
+    // 语句自动提交，直接回收该行占用的空间和slot
+    table_info_->GetTableHeap()->ApplyDelete(*rid, txn_);
     Row key_row;
     for (auto info : index_info_) {  // 更新索引
       row->GetKeyFromRow(table_info_->GetSchema(), info->GetIndexKeySchema(), key_row);
@@ -43,6 +43,9 @@ ExecuteEngine::ExecuteEngine() {
   }
 #endif
   closedir(dir);
+#ifdef ENABLE_BACKGROUND_VACUUM
+  vacuum_thread_ = std::thread(&ExecuteEngine::BackgroundVacuum, this);
+#endif
 }
 
 std::unique_ptr<AbstractExecutor> ExecuteEngine::CreateExecutor(ExecuteContext *exec_ctx,
@@ -92,7 +95,9 @@ dberr_t ExecuteEngine::ExecutePlan(const AbstractPlanNodeRef &plan, std::vector<
     Row row{};
     while (executor->Next(&row, &rid)) {
       if (result_set != nullptr) {
-        result_set->push_back(row);
+        // 结果集比执行器活得久，行中的字符串放到查询的arena中
+        row.CopyCharsInto(exec_ctx->GetArena());
+        result_set->push_back(std::move(row));
       }
     }
   } catch (const exception &ex) {
@@ -109,6 +114,7 @@ dberr_t ExecuteEngine::Execute(pSyntaxNode ast) {
   if (ast == nullptr) {
     return DB_FAILED;
   }
+  std::lock_guard<std::recursive_mutex> guard(latch_);
   auto start_time = std::chrono::system_clock::now();
   unique_ptr<ExecuteContext> context(nullptr);
   if (!current_db_.empty()) context = dbs_[current_db_]->MakeExecuteContext(nullptr);
@@ -143,6 +149,10 @@ dberr_t ExecuteEngine::Execute(pSyntaxNode ast) {
       return ExecuteExecfile(ast, context.get());
     case kNodeQuit:
       return ExecuteQuit(ast, context.get());
+    case kNodeVacuum:
+      return ExecuteVacuum(ast, context.get());
+    case kNodeTruncateTable:
+      return ExecuteTruncateTable(ast, context.get());
     default:
       break;
   }
@@ -409,10 +419,24 @@ dberr_t ExecuteEngine::ExecuteCreateTable(pSyntaxNode ast, ExecuteContext *conte
     }
   }
 
+  //处理 WITH (layout = row|pax|compressed)
+  TableLayout layout = TableLayout::kRow;
+  auto option = ast->child_->next_->next_;
+  if(option!=nullptr){
+    string value = option->child_->val_;
+    if(string(option->val_)!="layout"||(value!="row"&&value!="pax"&&value!="compressed")){
+      cout<<"Unknown table option "<<option->val_<<" = "<<value<<endl;
+      for(auto column : columns) delete column;
+      return DB_FAILED;
+    }
+    if(value=="pax")layout = TableLayout::kPax;
+    if(value=="compressed")layout = TableLayout::kCompressed;
+  }
+
   auto schema = new Schema(columns,true); 
   //TODO:txn here.
   TableInfo* table_info;
-  auto exe_info = catalog_manager->CreateTable(table_name,schema,nullptr,table_info);
+  auto exe_info = catalog_manager->CreateTable(table_name,schema,nullptr,table_info,layout);
   if(exe_info==DB_SUCCESS){
     cout<<"Successfully create table"<<endl;
 #ifndef CREATE_INDEX_ON_UNIQUE
@@ -670,3 +694,83 @@ dberr_t ExecuteEngine::ExecuteQuit(pSyntaxNode ast, ExecuteContext *context) {
  }
  return DB_QUIT;
 }
+
+dberr_t ExecuteEngine::ExecuteVacuum(pSyntaxNode ast, ExecuteContext *context) {
+#ifdef ENABLE_EXECUTE_DEBUG
+  LOG(INFO) << "ExecuteVacuum" << std::endl;
+#endif
+  if (current_db_.empty()) {
+    cout << "No database selected" << endl;
+    return DB_FAILED;
+  }
+  auto catalog_manager = dbs_[current_db_]->catalog_mgr_;
+  TableInfo *table_info = nullptr;
+  if (catalog_manager->GetTable(ast->child_->val_, table_info) != DB_SUCCESS) {
+    return DB_TABLE_NOT_EXIST;
+  }
+  uint32_t freed_pages = 0;
+  auto exe_info = VacuumTable(catalog_manager, table_info, context->GetTransaction(), &freed_pages);
+  if (exe_info == DB_SUCCESS) {
+    cout << "Successfully vacuum table, " << freed_pages << " pages freed" << endl;
+  }
+  return exe_info;
+}
+
+dberr_t ExecuteEngine::ExecuteTruncateTable(pSyntaxNode ast, ExecuteContext *context) {
+#ifdef ENABLE_EXECUTE_DEBUG
+  LOG(INFO) << "ExecuteTruncateTable" << std::endl;
+#endif
+  if (current_db_.empty()) {
+    cout << "No database selected" << endl;
+    return DB_FAILED;
+  }
+  auto catalog_manager = dbs_[current_db_]->catalog_mgr_;
+  auto exe_info = catalog_manager->TruncateTable(ast->child_->val_, context->GetTransaction());
+  if (exe_info == DB_SUCCESS) {
+    cout << "Successfully truncate table" << endl;
+  }
+  return exe_info;
+}
+
+dberr_t ExecuteEngine::VacuumTable(CatalogManager *catalog, TableInfo *table_info, Txn *txn, uint32_t *freed_pages) {
+  std::vector<std::pair<RowId, RowId>> moved_rows;
+  auto table_heap = table_info->GetTableHeap();
+  uint32_t freed = table_heap->Vacuum(true, &moved_rows, txn);
+  if (freed_pages != nullptr) {
+    *freed_pages = freed;
+  }
+  // 被移动的行在索引中的row id需要更新
+  std::vector<IndexInfo *> indexes;
+  catalog->GetTableIndexes(table_info->GetTableName(), indexes);
+  for (auto &moved_row : moved_rows) {
+    Row row(moved_row.second);
+    if (!table_heap->GetTuple(&row, txn)) {
+      LOG(ERROR) << "Moved row " << moved_row.second.Get() << " is missing" << std::endl;
+      return DB_FAILED;
+    }
+    Row key_row;
+    for (auto info : indexes) {
+      row.GetKeyFromRow(table_info->GetSchema(), info->GetIndexKeySchema(), key_row);
+      info->GetIndex()->RemoveEntry(key_row, moved_row.first, txn);
+      info->GetIndex()->InsertEntry(key_row, moved_row.second, txn);
+    }
+  }
+#ifdef ENABLE_EXECUTE_DEBUG
+  LOG(INFO) << "Vacuum " << table_info->GetTableName() << ": " << freed << " pages freed, " << moved_rows.size()
+            << " rows moved" << std::endl;
+#endif
+  return DB_SUCCESS;
+}
+
+void ExecuteEngine::BackgroundVacuum() {
+  std::unique_lock<std::recursive_mutex> lock(latch_);
+  while (!vacuum_cv_.wait_for(lock, std::chrono::seconds(BACKGROUND_VACUUM_INTERVAL), [this] { return stop_vacuum_; })) {
+    for (auto &db : dbs_) {
+      std::vector<TableInfo *> tables;
+      db.second->catalog_mgr_->GetTables(tables);
+      for (auto table_info : tables) {
+        VacuumTable(db.second->catalog_mgr_, table_info, nullptr);
+      }
+    }
+  }
+}
@@ -41,7 +41,7 @@ void IndexScanExecutor::TupleTransfer(const Schema *table_schema, const Schema *
     auto idx = column->GetTableInd();
     dest_row.emplace_back(*row->GetField(idx));
   }
-  *output_row = Row(dest_row);
+  *output_row = Row(std::move(dest_row));
 }
 
 vector<RowId> IndexScanExecutor::IndexScan(AbstractExpressionRef predicate) {
@@ -80,19 +80,19 @@ bool IndexScanExecutor::Next(Row *row, RowId *rid) {
   auto predicate = plan_->GetPredicate();
   auto table_schema = table_info_->GetSchema();
   while (cursor_ < result_.size()) {
-    auto p_row = new Row(result_[cursor_]);
-    table_info_->GetTableHeap()->GetTuple(p_row, nullptr);
+    Row table_row(result_[cursor_]);
+    table_info_->GetTableHeap()->GetTuple(&table_row, nullptr);
     if (plan_->need_filter_) {
-      if (!predicate->Evaluate(p_row).CompareEquals(Field(kTypeInt, 1))) {
+      if (!CompareKernels::IsTrue(predicate->Evaluate(&table_row))) {
         cursor_++;
         continue;
       }
     }
     *rid = result_[cursor_];
     if (!is_schema_same_) {
-      TupleTransfer(table_schema, plan_->OutputSchema(), p_row, row);
+      TupleTransfer(table_schema, plan_->OutputSchema(), &table_row, row);
     } else {
-      *row = *p_row;
+      *row = std::move(table_row);
     }
     cursor_++;
     return true;
@@ -4,39 +4,113 @@
 
 #include "executor/executors/insert_executor.h"
 
+#include <unordered_set>
+
 InsertExecutor::InsertExecutor(ExecuteContext *exec_ctx, const InsertPlanNode *plan,
                                std::unique_ptr<AbstractExecutor> &&child_executor)
     : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {}
 
+InsertExecutor::~InsertExecutor() {
+  if (table_info_ != nullptr) {
+    table_info_->GetTableHeap()->ReleaseInsertPage();
+  }
+}
+
 void InsertExecutor::Init() {
   child_executor_->Init();
   exec_ctx_->GetCatalog()->GetTable(plan_->GetTableName(), table_info_);
   schema_ = table_info_->GetSchema();
   exec_ctx_->GetCatalog()->GetTableIndexes(table_info_->GetTableName(), index_info_);
+  // 先取出子节点的所有行，行数足够多时走批量插入
+  Row insert_row;
+  RowId insert_rid;
+  batch_rows_.clear();
+  batch_cursor_ = 0;
+  while (child_executor_->Next(&insert_row, &insert_rid)) {
+    insert_row.CopyCharsInto(exec_ctx_->GetArena());
+    batch_rows_.emplace_back(insert_row);
+  }
+  batch_mode_ = batch_rows_.size() >= BATCH_INSERT_THRESHOLD;
+  if (!batch_mode_) {
+    return;
+  }
+  // 与逐行插入一致：遇到重复键时只插入它之前的行，批内的重复键也要检查
+  std::vector<std::unordered_set<std::string>> batch_keys(index_info_.size());
+  size_t valid_count = 0;
+  for (; valid_count < batch_rows_.size(); valid_count++) {
+    bool duplicate = false;
+    for (size_t i = 0; i < index_info_.size() && !duplicate; i++) {
+      Row key_row;
+      batch_rows_[valid_count].GetKeyFromRow(schema_, index_info_[i]->GetIndexKeySchema(), key_row);
+      if (key_row.GetFields().empty()) {
+        continue;
+      }
+      std::vector<RowId> result;
+      std::string key(key_row.GetSerializedSize(index_info_[i]->GetIndexKeySchema()), '\0');
+      key_row.SerializeTo(key.data(), index_info_[i]->GetIndexKeySchema());
+      duplicate = index_info_[i]->GetIndex()->ScanKey(key_row, result, exec_ctx_->GetTransaction()) == DB_SUCCESS ||
+                  !batch_keys[i].insert(std::move(key)).second;
+    }
+    if (duplicate) {
+      std::cout << "key already exists" << std::endl;
+      break;
+    }
+  }
+  batch_rows_.resize(valid_count);
+  for (auto &batch_row : batch_rows_) {
+    batch_row.SetRowId(RowId());
+  }
+  auto table_heap = table_info_->GetTableHeap();
+  if (!table_heap->InsertTuples(batch_rows_, exec_ctx_->GetTransaction())) {
+    // 中途失败时前面的行已经写入页面，但还没有索引项，撤销这些行，整条语句不生效
+    for (auto &written_row : batch_rows_) {
+      if (written_row.GetRowId().GetPageId() == INVALID_PAGE_ID) {
+        break;
+      }
+      if (table_heap->MarkDelete(written_row.GetRowId(), exec_ctx_->GetTransaction())) {
+        table_heap->ApplyDelete(written_row.GetRowId(), exec_ctx_->GetTransaction());
+      }
+    }
+    batch_rows_.clear();
+    return;
+  }
+  for (auto &inserted_row : batch_rows_) {
+    Row key_row;
+    for (auto info : index_info_) {  // 更新索引
+      inserted_row.GetKeyFromRow(schema_, info->GetIndexKeySchema(), key_row);
+      info->GetIndex()->InsertEntry(key_row, inserted_row.GetRowId(), exec_ctx_->GetTransaction());
+    }
+  }
 }
 
 bool InsertExecutor::Next([[maybe_unused]] Row *row, RowId *rid) {
-    Row insert_row;
-    RowId insert_rid;
-    if (child_executor_->Next(&insert_row, &insert_rid)) {
-        for (auto info: index_info_) {
-            Row key_row;
-            insert_row.GetKeyFromRow(table_info_->GetSchema(), info->GetIndexKeySchema(), key_row);
-            std::vector<RowId> result;
-            if (!key_row.GetFields().empty() &&
-                info->GetIndex()->ScanKey(key_row, result, exec_ctx_->GetTransaction()) == DB_SUCCESS) {
-                std::cout << "key already exists" << std::endl;
-                return false;
-            }
-        }
-        if (table_info_->GetTableHeap()->InsertTuple(insert_row, exec_ctx_->GetTransaction())) {
-            Row key_row;
-            for (auto info: index_info_) {  // 更新索引
-                insert_row.GetKeyFromRow(schema_, info->GetIndexKeySchema(), key_row);
-                info->GetIndex()->InsertEntry(key_row, insert_row.GetRowId(), exec_ctx_->GetTransaction());
-            }
-            return true;
-        }
+  if (batch_cursor_ >= batch_rows_.size()) {
+    return false;
+  }
+  // 批量插入已在Init中完成，这里只逐行返回结果
+  if (batch_mode_) {
+    batch_cursor_++;
+    return true;
+  }
+  Row &insert_row = batch_rows_[batch_cursor_++];
+  for (auto info : index_info_) {
+    Row key_row;
+    insert_row.GetKeyFromRow(table_info_->GetSchema(), info->GetIndexKeySchema(), key_row);
+    std::vector<RowId> result;
+    if (!key_row.GetFields().empty() &&
+        info->GetIndex()->ScanKey(key_row, result, exec_ctx_->GetTransaction()) == DB_SUCCESS) {
+      std::cout << "key already exists" << std::endl;
+      batch_cursor_ = batch_rows_.size();
+      return false;
+    }
+  }
+  if (table_info_->GetTableHeap()->InsertTuple(insert_row, exec_ctx_->GetTransaction())) {
+    Row key_row;
+    for (auto info : index_info_) {  // 更新索引
+      insert_row.GetKeyFromRow(schema_, info->GetIndexKeySchema(), key_row);
+      info->GetIndex()->InsertEntry(key_row, insert_row.GetRowId(), exec_ctx_->GetTransaction());
+    }
+    return true;
   }
   return false;
-}
\ No newline at end of file
+}
@@ -3,6 +3,11 @@
 //
 #include "executor/executors/seq_scan_executor.h"
 
+#include "planner/expressions/column_value_expression.h"
+#include "planner/expressions/comparison_expression.h"
+#include "planner/expressions/constant_value_expression.h"
+#include "planner/expressions/logic_expression.h"
+
 SeqScanExecutor::SeqScanExecutor(ExecuteContext *exec_ctx, const SeqScanPlanNode *plan)
     : AbstractExecutor(exec_ctx),
       plan_(plan),
@@ -26,44 +31,157 @@ bool SeqScanExecutor::SchemaEqual(const Schema *table_schema, const Schema *outp
   return true;
 }
 
-void SeqScanExecutor::TupleTransfer(const Schema *table_schema, const Schema *output_schema, const Row *row,
-                                    Row *output_row) {
-  const auto &output_columns = output_schema->GetColumns();
-  std::vector<Field> dest_row;
-  dest_row.reserve(output_columns.size());
-  for (const auto column : output_columns) {
-    auto idx = column->GetTableInd();
-    dest_row.emplace_back(*row->GetField(idx));
+bool SeqScanExecutor::PageMayMatch(page_id_t page_id, AbstractExpression *predicate) const {
+  switch (predicate->GetType()) {
+    case ExpressionType::LogicExpression: {
+      auto logic = dynamic_cast<LogicExpression *>(predicate);
+      bool lhs = PageMayMatch(page_id, logic->GetChildAt(0).get());
+      if (logic->logic_type_ == LogicType::And) {
+        return lhs && PageMayMatch(page_id, logic->GetChildAt(1).get());
+      }
+      return lhs || PageMayMatch(page_id, logic->GetChildAt(1).get());
+    }
+    case ExpressionType::ComparisonExpression: {
+      auto comparison = dynamic_cast<ComparisonExpression *>(predicate);
+      auto lhs = comparison->GetChildAt(0).get();
+      auto rhs = comparison->GetChildAt(1).get();
+      std::string comp_type = comparison->GetComparisonType();
+      // 常量在左边时交换两边，= 和 <> 不变
+      if (lhs->GetType() == ExpressionType::ConstantExpression && rhs->GetType() == ExpressionType::ColumnExpression) {
+        std::swap(lhs, rhs);
+        if (comp_type == "<") {
+          comp_type = ">";
+        } else if (comp_type == "<=") {
+          comp_type = ">=";
+        } else if (comp_type == ">") {
+          comp_type = "<";
+        } else if (comp_type == ">=") {
+          comp_type = "<=";
+        }
+      }
+      if (lhs->GetType() != ExpressionType::ColumnExpression || rhs->GetType() != ExpressionType::ConstantExpression) {
+        return true;
+      }
+      auto column = dynamic_cast<ColumnValueExpression *>(lhs);
+      auto constant = dynamic_cast<ConstantValueExpression *>(rhs);
+      return table_info_->GetTableHeap()->GetZoneMap()->MayMatch(page_id, column->GetColIdx(), comp_type,
+                                                                  constant->val_);
+    }
+    default:
+      return true;
+  }
+}
+
+void SeqScanExecutor::CollectDictionaryProbes(AbstractExpression *predicate) {
+  if (predicate->GetType() == ExpressionType::LogicExpression) {
+    auto logic = dynamic_cast<LogicExpression *>(predicate);
+    if (logic->logic_type_ == LogicType::And) {
+      CollectDictionaryProbes(logic->GetChildAt(0).get());
+      CollectDictionaryProbes(logic->GetChildAt(1).get());
+    }
+    return;
+  }
+  if (predicate->GetType() != ExpressionType::ComparisonExpression) {
+    return;
+  }
+  auto comparison = dynamic_cast<ComparisonExpression *>(predicate);
+  auto lhs = comparison->GetChildAt(0).get();
+  auto rhs = comparison->GetChildAt(1).get();
+  if (lhs->GetType() == ExpressionType::ConstantExpression) {
+    std::swap(lhs, rhs);
+  }
+  if (comparison->GetComparisonType() != "=" || lhs->GetType() != ExpressionType::ColumnExpression ||
+      rhs->GetType() != ExpressionType::ConstantExpression) {
+    return;
+  }
+  auto column = dynamic_cast<ColumnValueExpression *>(lhs);
+  auto constant = dynamic_cast<ConstantValueExpression *>(rhs);
+  if (table_info_->GetSchema()->GetColumn(column->GetColIdx())->GetType() != TypeId::kTypeChar ||
+      constant->val_.GetTypeId() != TypeId::kTypeChar || constant->val_.IsNull()) {
+    return;
+  }
+  probes_.emplace_back(column->GetColIdx(), constant->val_);
+}
+
+bool SeqScanExecutor::ProbePage() {
+  for (auto &probe : probes_) {
+    probe.active = iterator_.FindDictionaryEntry(probe.column_id, probe.value, &probe.entry);
+    if (probe.active && probe.entry == nullptr) {
+      return false;
+    }
   }
-  *output_row = Row(dest_row);
+  return true;
 }
 
 void SeqScanExecutor::Init() {
   exec_ctx_->GetCatalog()->GetTable(plan_->GetTableName(), table_info_);
-  auto first_row = table_info_->GetTableHeap()->Begin(nullptr);
-  iterator_ = (table_info_->GetTableHeap()->Begin(exec_ctx_->GetTransaction()));
+  auto table_heap = table_info_->GetTableHeap();
+#ifdef USE_ZONE_MAP
+  if (plan_->GetPredicate() != nullptr) {
+    // 根据页面摘要跳过不可能满足谓词的页
+    iterator_ = table_heap->Begin(exec_ctx_->GetTransaction(), [this](page_id_t page_id) {
+      return PageMayMatch(page_id, plan_->GetPredicate().get());
+    });
+  } else {
+    iterator_ = table_heap->Begin(exec_ctx_->GetTransaction());
+  }
+#else
+  iterator_ = table_heap->Begin(exec_ctx_->GetTransaction());
+#endif
   schema_ = plan_->OutputSchema();
   is_schema_same_ = SchemaEqual(table_info_->GetSchema(), schema_);
+  output_columns_.clear();
+  for (const auto column : schema_->GetColumns()) {
+    output_columns_.push_back(column->GetTableInd());
+  }
+  advance_ = false;
+  probes_.clear();
+  probe_page_id_ = INVALID_PAGE_ID;
+  if (plan_->GetPredicate() != nullptr && table_heap->GetLayout() == TableLayout::kCompressed) {
+    CollectDictionaryProbes(plan_->GetPredicate().get());
+  }
 }
 
 bool SeqScanExecutor::Next(Row *row, RowId *rid) {
   auto predicate = plan_->GetPredicate();
-  auto table_schema = table_info_->GetSchema();
-  while (iterator_ != table_info_->GetTableHeap()->End()) {
-    auto p_row = &(*iterator_);
+  auto end = table_info_->GetTableHeap()->End();
+  // 上层算子可能刚修改或删除了上次返回的行，此时才移动迭代器，保证视图读到的是最新的页面内容
+  if (advance_) {
+    ++iterator_;
+  }
+  advance_ = true;
+  // 上一次输出的行已被上层算子用完
+  arena_.Rewind();
+  while (iterator_ != end) {
+    // 谓词直接在页面中的数据上求值，只有输出的行才会被物化
+    const RowView &view = iterator_.GetRowView();
+    // 压缩页中的等值条件先比较字典项，字典中没有该值的页整页跳过
+    if (!probes_.empty()) {
+      if (view.GetRowId().GetPageId() != probe_page_id_) {
+        probe_page_id_ = view.GetRowId().GetPageId();
+        if (!ProbePage()) {
+          iterator_.NextPage();
+          continue;
+        }
+      }
+      if (!MatchesProbes(view)) {
+        ++iterator_;
+        continue;
+      }
+    }
     if (predicate != nullptr) {
-      if (!predicate->Evaluate(p_row).CompareEquals(Field(kTypeInt, 1))) {
-        iterator_++;
+      if (!CompareKernels::IsTrue(predicate->EvaluateView(&view))) {
+        ++iterator_;
         continue;
       }
     }
-    *rid = iterator_->GetRowId();
+    *rid = view.GetRowId();
+    // 输出行的字符串放在arena中，不再逐个分配
     if (!is_schema_same_) {
-      TupleTransfer(table_schema, schema_, p_row, row);
+      view.ToRow(output_columns_, row, true, &arena_);
     } else {
-      *row = *p_row;
+      view.ToRow(row, &arena_);
     }
-    iterator_++;
     return true;
   }
   return false;
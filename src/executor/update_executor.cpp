@@ -4,30 +4,65 @@
 
 #include "executor/executors/update_executor.h"
 
+#include <algorithm>
+
 UpdateExecutor::UpdateExecutor(ExecuteContext *exec_ctx, const UpdatePlanNode *plan,
                                std::unique_ptr<AbstractExecutor> &&child_executor)
     : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {}
 
+UpdateExecutor::~UpdateExecutor() {
+  if (table_info_ != nullptr) {
+    table_info_->GetTableHeap()->ReleaseInsertPage();
+  }
+}
+
 void UpdateExecutor::Init() {
   child_executor_->Init();
   exec_ctx_->GetCatalog()->GetTable(plan_->GetTableName(), table_info_);
   exec_ctx_->GetCatalog()->GetTableIndexes(table_info_->GetTableName(), index_info_);
+#ifdef USE_HOT_UPDATE
+  // 更新不涉及键列的索引不需要维护，行原地更新后rid不变
+  const auto &update_attrs = plan_->GetUpdateAttr();
+  index_info_.erase(std::remove_if(index_info_.begin(), index_info_.end(),
+                                   [&update_attrs](IndexInfo *info) {
+                                     for (auto column : info->GetKeyMapping()) {
+                                       if (update_attrs.count(column) != 0) {
+                                         return false;
+                                       }
+                                     }
+                                     return true;
+                                   }),
+                    index_info_.end());
+#endif
   txn_ = exec_ctx_->GetTransaction();
 }
 
 bool UpdateExecutor::Next([[maybe_unused]] Row *row, RowId *rid) {
   Row src_row;
   RowId src_rid;
-  if (child_executor_->Next(&src_row, &src_rid)) {
+  while (child_executor_->Next(&src_row, &src_rid)) {
+    // 迁移到后面页中的行会被扫描再次读到，不能更新两次
+    if (relocated_rids_.count(src_rid) != 0) {
+      continue;
+    }
     Row dest_row = GenerateUpdatedTuple(src_row);
-    if (!table_info_->GetTableHeap()->UpdateTuple(dest_row, src_rid, txn_)) {
+    bool relocated = false;
+    if (!table_info_->GetTableHeap()->UpdateTuple(dest_row, src_rid, txn_, &relocated)) {
       return false;
     }
+    if (relocated) {
+      relocated_rids_.insert(src_rid);
+    }
     Row src_key_row;
     Row dest_key_row;
     for (auto info : index_info_) {  // 更新索引
       src_row.GetKeyFromRow(table_info_->GetSchema(), info->GetIndexKeySchema(), src_key_row);
       dest_row.GetKeyFromRow(table_info_->GetSchema(), info->GetIndexKeySchema(), dest_key_row);
+#ifdef USE_HOT_UPDATE
+      if (SameKey(src_key_row, dest_key_row)) {
+        continue;
+      }
+#endif
       info->GetIndex()->RemoveEntry(src_key_row, src_rid, txn_);
       info->GetIndex()->InsertEntry(dest_key_row, src_rid, txn_);
     }
@@ -49,5 +84,19 @@ Row UpdateExecutor::GenerateUpdatedTuple(const Row &src_row) {
       values.emplace_back(expr->Evaluate(&src_row));
     }
   }
-  return Row{values};
-}
\ No newline at end of file
+  return Row(std::move(values));
+}
+bool UpdateExecutor::SameKey(const Row &src_key_row, const Row &dest_key_row) {
+  for (uint32_t i = 0; i < src_key_row.GetFieldCount(); i++) {
+    const Field *src = src_key_row.GetField(i);
+    const Field *dest = dest_key_row.GetField(i);
+    if (src->IsNull() || dest->IsNull()) {
+      if (src->IsNull() != dest->IsNull()) {
+        return false;
+      }
+    } else if (src->CompareEquals(*dest) != CmpBool::kTrue) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -18,7 +18,7 @@ bool ValuesExecutor::Next(Row *row, RowId *rid) {
     for (auto expr : exprs) {
       values.emplace_back(expr->Evaluate(nullptr));
     }
-    *row = Row{values};
+    *row = Row(std::move(values));
     cursor_++;
     return true;
   }
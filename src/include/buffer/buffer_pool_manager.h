@@ -4,6 +4,7 @@
 #include <list>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/lru_replacer.h"
 #include "page/disk_file_meta_page.h"
@@ -28,6 +29,13 @@ class BufferPoolManager {
 
   bool DeletePage(page_id_t page_id);
 
+  /**
+   * Delete the given pages at once, e.g. all pages of a dropped table. Their frames are dropped without being
+   * written back and the pages are freed on disk in one batch.
+   * @return false if some page is pinned, such pages are kept
+   */
+  bool DeletePages(const std::vector<page_id_t> &page_ids);
+
   bool IsPageFree(page_id_t page_id);
 
   bool CheckAllUnpinned();
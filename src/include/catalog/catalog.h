@@ -76,7 +76,8 @@ class CatalogManager {
 
   ~CatalogManager();
 
-  dberr_t CreateTable(const std::string &table_name, TableSchema *schema, Txn *txn, TableInfo *&table_info);
+  dberr_t CreateTable(const std::string &table_name, TableSchema *schema, Txn *txn, TableInfo *&table_info,
+                      TableLayout layout = TableLayout::kRow);
 
   dberr_t GetTable(const std::string &table_name, TableInfo *&table_info);
 
@@ -92,6 +93,11 @@ class CatalogManager {
 
   dberr_t DropTable(const std::string &table_name);
 
+  /**
+   * Remove all rows of a table and empty its indexes, the pages are freed in batches.
+   */
+  dberr_t TruncateTable(const std::string &table_name, Txn *txn);
+
   dberr_t DropIndex(const std::string &table_name, const std::string &index_name);
 
   dberr_t DropAllIndexes(const string &index_name, uint32_t& drop_tot);//drop indexes in all table
@@ -104,6 +110,9 @@ class CatalogManager {
 
   dberr_t LoadTable(const table_id_t table_id, const page_id_t page_id);
 
+  // write back the metadata of a table stored in an older format, with the heap directory its TableHeap rebuilt
+  void UpgradeTableMetadata(TableMetadata *table_meta, TableHeap *table_heap, Page *table_page);
+
   dberr_t LoadIndex(const index_id_t index_id, const page_id_t page_id);
 
   dberr_t GetTable(const table_id_t table_id, TableInfo *&table_info);
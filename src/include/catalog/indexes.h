@@ -67,29 +67,29 @@ class IndexInfo {
     // Step1: init index metadata and table info
     meta_data_=meta_data;
     this->table_info=table_info;
-    auto table_heap = table_info->GetTableHeap();
     // Step2: mapping index key to key schema
     key_schema_=Schema::ShallowCopySchema(table_info->GetSchema(),meta_data->GetKeyMapping());
     // Step3: call CreateIndex to create the index
     index_= CreateIndex(buffer_pool_manager,"bptree");
-    //todo:Transaction
-    for(auto iter=table_heap->Begin(nullptr);iter!=table_heap->End();iter++){
-      vector<Field>index_fields;
-      for(auto i : meta_data->key_map_){
-        index_fields.push_back(*(iter->GetField(i)));
-      }
-      Row row(index_fields);
-      index_->InsertEntry(row,iter->GetRowId(), nullptr);
-    }
 //    ASSERT(false, "Not Implemented yet.");
   }
 
+  /**
+   * Fill a newly created index with the rows already in the table, the entries are sorted and the tree is built
+   * bottom-up instead of inserted one by one. Like Insert, a duplicated key keeps the first row of the table.
+   * The pages of the table are split into contiguous ranges scanned by up to max_threads workers, one per
+   * INDEX_BUILD_PAGES_PER_THREAD pages. progress, if given, is updated as the build goes.
+   */
+  dberr_t Backfill(Txn *txn, IndexBuildProgress *progress = nullptr, uint32_t max_threads = INDEX_BUILD_THREADS);
+
   inline Index *GetIndex() { return index_; }
 
   std::string GetIndexName() { return meta_data_->GetIndexName(); }
 
   IndexSchema *GetIndexKeySchema() { return key_schema_; }
 
+  inline const std::vector<uint32_t> &GetKeyMapping() const { return meta_data_->GetKeyMapping(); }
+
  private:
   explicit IndexInfo() : meta_data_{nullptr}, index_{nullptr}, key_schema_{nullptr} {}
 
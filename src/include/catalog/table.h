@@ -23,7 +23,8 @@ class TableMetadata {
    * will create new table schema and owned by mem heap
    */
   static TableMetadata *Create(table_id_t table_id, std::string table_name, page_id_t root_page_id,page_id_t freespace_map_page_id,
-                               TableSchema *schema);
+                               page_id_t heap_directory_page_id, TableSchema *schema,
+                               TableLayout layout = TableLayout::kRow);
 
   inline table_id_t GetTableId() const { return table_id_; }
 
@@ -33,19 +34,37 @@ class TableMetadata {
 
   inline page_id_t GetFreeSpaceMapPageId() const {return freespace_map_page_id_; }
 
+  inline page_id_t GetHeapDirectoryPageId() const { return heap_directory_page_id_; }
+
   inline Schema *GetSchema() const { return schema_; }
 
+  inline TableLayout GetLayout() const { return layout_; }
+
+  // a record of an older version has no heap directory, the one rebuilt by the TableHeap is set here
+  inline void SetHeapDirectoryPageId(page_id_t heap_directory_page_id) {
+    heap_directory_page_id_ = heap_directory_page_id;
+  }
+
  private:
   TableMetadata() = delete;
 
-  TableMetadata(table_id_t table_id, std::string table_name, page_id_t root_page_id,page_id_t freespace_map_page_id, TableSchema *schema);
+  TableMetadata(table_id_t table_id, std::string table_name, page_id_t root_page_id,page_id_t freespace_map_page_id,
+                page_id_t heap_directory_page_id, TableSchema *schema, TableLayout layout);
 
  private:
-  static constexpr uint32_t TABLE_METADATA_MAGIC_NUM = 344528;
+  // records written before the format had a version carry the legacy magic num and count as version 0
+  static constexpr uint32_t TABLE_METADATA_LEGACY_MAGIC_NUM = 344528;
+  static constexpr uint32_t TABLE_METADATA_MAGIC_NUM = 344529;
+  // the version follows the magic num, a field added to the format is only read from the version that has it
+  static constexpr uint32_t TABLE_METADATA_VERSION = 2;
+  static constexpr uint32_t VERSION_HEAP_DIRECTORY = 1;
+  static constexpr uint32_t VERSION_LAYOUT = 2;
   table_id_t table_id_;
   std::string table_name_;
   page_id_t root_page_id_;
   page_id_t freespace_map_page_id_;
+  page_id_t heap_directory_page_id_;
+  TableLayout layout_;
   Schema *schema_;
 };
 
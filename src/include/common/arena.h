@@ -0,0 +1,93 @@
+#ifndef MINISQL_ARENA_H
+#define MINISQL_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+/**
+ * Bump allocator for memory that lives as long as one query, e.g. the CHAR values of the rows a scan outputs.
+ * Memory is cut from blocks of ARENA_BLOCK_SIZE bytes and only given back all at once, by Reset or on destruction.
+ */
+class Arena {
+ public:
+  Arena() = default;
+
+  ~Arena() = default;
+
+  DISALLOW_COPY_AND_MOVE(Arena);
+
+  /**
+   * @return size bytes that stay valid until Reset, a large request gets a block of its own. Never nullptr, an
+   * empty CHAR value taken from the arena still has data
+   */
+  char *Allocate(size_t size) {
+    if (size > remaining_ || cur_ == nullptr) {
+      if (size > ARENA_BLOCK_SIZE / 4) {
+        // 大块单独分配，当前块剩余的空间留给后面的小块
+        blocks_.emplace_back(new char[size]);
+        memory_usage_ += size;
+        return blocks_.back().get();
+      }
+      blocks_.emplace_back(new char[ARENA_BLOCK_SIZE]);
+      memory_usage_ += ARENA_BLOCK_SIZE;
+      block_ = cur_ = blocks_.back().get();
+      remaining_ = ARENA_BLOCK_SIZE;
+    }
+    char *result = cur_;
+    cur_ += size;
+    remaining_ -= size;
+    return result;
+  }
+
+  /**
+   * Give all memory back, everything allocated before becomes invalid.
+   */
+  void Reset() {
+    blocks_.clear();
+    block_ = cur_ = nullptr;
+    remaining_ = 0;
+    memory_usage_ = 0;
+  }
+
+  /**
+   * Like Reset, but the block in use is kept and filled again from its start.
+   */
+  void Rewind() {
+    if (block_ == nullptr) {
+      Reset();
+      return;
+    }
+    if (blocks_.size() > 1) {
+      std::unique_ptr<char[]> block;
+      for (auto &iter : blocks_) {
+        if (iter.get() == block_) {
+          block = std::move(iter);
+          break;
+        }
+      }
+      blocks_.clear();
+      blocks_.push_back(std::move(block));
+    }
+    cur_ = block_;
+    remaining_ = ARENA_BLOCK_SIZE;
+    memory_usage_ = ARENA_BLOCK_SIZE;
+  }
+
+  /**
+   * @return bytes taken from the heap
+   */
+  size_t GetMemoryUsage() const { return memory_usage_; }
+
+ private:
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  char *block_{nullptr};  // start of the block small requests are taken from
+  char *cur_{nullptr};
+  size_t remaining_{0};
+  size_t memory_usage_{0};
+};
+
+#endif  // MINISQL_ARENA_H
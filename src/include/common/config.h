@@ -18,6 +18,21 @@
 
 #define USE_FREESPACE_MAP
 
+//comment it to stop keeping per-page min/max summaries that let scans skip pages
+#define USE_ZONE_MAP
+
+//comment it to maintain every index of a table on each update, even if no key column is assigned
+#define USE_HOT_UPDATE
+
+//comment it to take read latches on the way down for B+ tree point lookups instead of optimistic lock coupling
+#define USE_OPTIMISTIC_LOCK_COUPLING
+
+//comment it to search the int keys of B+ tree pages with scalar compares only
+#define USE_SIMD_KEY_SEARCH
+
+//uncomment it to vacuum all tables in a background thread
+//#define ENABLE_BACKGROUND_VACUUM
+
 static constexpr int INVALID_PAGE_ID = -1;   // invalid page id
 static constexpr int INVALID_FRAME_ID = -1;  // invalid recovery id
 static constexpr int INVALID_TXN_ID = -1;    // invalid recovery id
@@ -31,7 +46,21 @@ static constexpr int PAGE_SIZE = 4096;                  // size of a data page i
 static constexpr int DEFAULT_BUFFER_POOL_SIZE = 20480;  // default size of buffer pool
 
 static constexpr uint32_t FIELD_NULL_LEN = UINT32_MAX;
-static constexpr uint32_t VARCHAR_MAX_LEN = PAGE_SIZE / 2;  // max length of varchar
+static constexpr uint32_t VARCHAR_MAX_LEN = PAGE_SIZE * 16;  // max length of varchar
+static constexpr uint32_t TOAST_THRESHOLD = PAGE_SIZE / 4;   // longer varchars are moved to overflow pages
+static constexpr uint32_t PAX_DICTIONARY_SIZE = 32;         // distinct values of a CHAR column in a compressed page
+static constexpr int BACKGROUND_VACUUM_INTERVAL = 60;       // seconds between two background vacuum passes
+static constexpr uint32_t ARENA_BLOCK_SIZE = 64 * 1024;     // bytes an arena takes from the heap at a time
+static constexpr int OPTIMISTIC_MAX_RESTARTS = 16;           // optimistic descents before falling back to latching
+static constexpr uint32_t BULK_LOAD_SORT_MEMORY = 4 * 1024 * 1024;  // bytes of index entries sorted before a spill
+static constexpr int BULK_LOAD_MERGE_FAN_IN = 64;                  // spilled runs merged at once by an index build
+static constexpr double BULK_LOAD_FILL_FACTOR = 0.9;               // share of a B+ tree page filled by an index build
+static constexpr uint32_t INDEX_BUILD_THREADS = 4;                  // workers scanning the table in an index build
+static constexpr uint32_t INDEX_BUILD_PAGES_PER_THREAD = 64;        // table pages needed for each extra build worker
+static constexpr bool INDEX_COMPRESS_INTERNAL = true;   // shortest separators, prefix compressed, in B+ tree internal pages
+static constexpr bool INDEX_COMPRESS_LEAF = false;      // prefix compressed keys in B+ tree leaves
+static constexpr int CACHE_LINE_SIZE = 64;              // bytes of a CPU cache line
+static constexpr int INDEX_SIMD_SEARCH_WIDTH = 64;      // int keys left to SIMD compares by the binary search of a page
 
 // static std::string DB_META_FILE = "minisql.meta.db";
 
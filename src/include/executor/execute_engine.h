@@ -1,8 +1,11 @@
 #ifndef MINISQL_EXECUTE_ENGINE_H
 #define MINISQL_EXECUTE_ENGINE_H
 
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 #include "common/dberr.h"
@@ -25,6 +28,14 @@ class ExecuteEngine {
   ExecuteEngine();
 
   ~ExecuteEngine() {
+#ifdef ENABLE_BACKGROUND_VACUUM
+    {
+      std::lock_guard<std::recursive_mutex> guard(latch_);
+      stop_vacuum_ = true;
+    }
+    vacuum_cv_.notify_all();
+    vacuum_thread_.join();
+#endif
     for (auto it : dbs_) {
       delete it.second;
     }
@@ -73,9 +84,27 @@ class ExecuteEngine {
 
   dberr_t ExecuteQuit(pSyntaxNode ast, ExecuteContext *context);
 
+  dberr_t ExecuteVacuum(pSyntaxNode ast, ExecuteContext *context);
+
+  dberr_t ExecuteTruncateTable(pSyntaxNode ast, ExecuteContext *context);
+
+  /**
+   * Vacuum one table and move the index entries of relocated rows to their new row ids.
+   */
+  dberr_t VacuumTable(CatalogManager *catalog, TableInfo *table_info, Txn *txn, uint32_t *freed_pages = nullptr);
+
+  /**
+   * Body of the background vacuum thread, vacuums every table of every opened database periodically.
+   */
+  void BackgroundVacuum();
+
  private:
   std::unordered_map<std::string, DBStorageEngine *> dbs_; /** all opened databases */
   std::string current_db_;                                 /** current database */
+  std::recursive_mutex latch_;                             /** statements and background vacuum never overlap */
+  std::condition_variable_any vacuum_cv_;
+  std::thread vacuum_thread_;
+  bool stop_vacuum_{false};
 };
 
 #endif  // MINISQL_EXECUTE_ENGINE_H
@@ -25,7 +25,10 @@ class InsertExecutor : public AbstractExecutor {
   InsertExecutor(ExecuteContext *exec_ctx, const InsertPlanNode *plan,
                  std::unique_ptr<AbstractExecutor> &&child_executor);
 
-  /** Initialize the insert */
+  /** Give the insert page claimed by this statement back to the table, so that other sessions can fill it */
+  ~InsertExecutor() override;
+
+  /** Initialize the insert, pulling all rows from the child when it produces many of them */
   void Init() override;
 
   /**
@@ -48,6 +51,12 @@ class InsertExecutor : public AbstractExecutor {
   TableInfo *table_info_{};
   const Schema *schema_{};
   std::vector<IndexInfo *> index_info_;
+  /** Rows pulled from the child, inserted with TableHeap::InsertTuples when there are enough of them */
+  std::vector<Row> batch_rows_;
+  size_t batch_cursor_{0};
+  bool batch_mode_{false};
+  /** Minimum number of child rows for which the batch insert path is used */
+  static constexpr size_t BATCH_INSERT_THRESHOLD = 16;
 };
 
 #endif  // MINISQL_INSERT_EXECUTOR_H
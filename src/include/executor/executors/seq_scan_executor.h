@@ -27,7 +27,8 @@ class SeqScanExecutor : public AbstractExecutor {
   void Init() override;
 
   /**
-   * Yield the next row from the sequential scan.
+   * Yield the next row from the sequential scan. Its CHAR values stay valid until the next call, a consumer
+   * that keeps the row longer copies them (Row::CopyCharsInto).
    * @param[out] row The next row produced by the scan
    * @param[out] rid The next row RID produced by the scan
    * @return `true` if a row was produced, `false` if there are no more rows
@@ -39,15 +40,50 @@ class SeqScanExecutor : public AbstractExecutor {
 
   bool SchemaEqual(const Schema *table_schema, const Schema *output_schema);
 
-  void TupleTransfer(const Schema *table_schema, const Schema *output_schema, const Row *row, Row *output_row);
+  /**
+   * @return false if the zones of the page show that no row of it can satisfy predicate
+   */
+  bool PageMayMatch(page_id_t page_id, AbstractExpression *predicate) const;
 
  private:
+  /** A conjunct column = constant of the predicate, compared by dictionary entry in compressed pages. */
+  struct DictionaryProbe {
+    DictionaryProbe(uint32_t column_id, const Field &value) : column_id(column_id), value(value) {}
+
+    uint32_t column_id;
+    Field value;
+    bool active{false};          // whether the column is dictionary encoded in the current page
+    const char *entry{nullptr};  // the dictionary entry of value in the current page, nullptr if it has none
+  };
+
+  void CollectDictionaryProbes(AbstractExpression *predicate);
+
+  /**
+   * Look the probes up in the dictionaries of the page of the current tuple.
+   * @return false if no tuple of the page can satisfy the predicate
+   */
+  bool ProbePage();
+
+  bool MatchesProbes(const RowView &view) const {
+    for (auto &probe : probes_) {
+      if (probe.active && (view.IsNull(probe.column_id) || view.GetFieldData(probe.column_id) != probe.entry)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   /** The sequential scan plan node to be executed */
   const SeqScanPlanNode *plan_;
   TableInfo *table_info_{};
   TableIterator iterator_;
   const Schema *schema_{};
   bool is_schema_same_;
+  std::vector<uint32_t> output_columns_;  // table column index of each output column
+  bool advance_{false};                   // whether the iterator still points at the last emitted row
+  std::vector<DictionaryProbe> probes_;
+  page_id_t probe_page_id_{INVALID_PAGE_ID};  // page the probes were looked up in
+  Arena arena_;                               // CHAR values of the row last output, rewound for each row
 };
 
 #endif  // MINISQL_SEQ_SCAN_EXECUTOR_H
@@ -5,6 +5,8 @@
 #ifndef MINISQL_UPDATE_EXECUTOR_H
 #define MINISQL_UPDATE_EXECUTOR_H
 
+#include <unordered_set>
+
 #include "executor/execute_context.h"
 #include "executor/executors/abstract_executor.h"
 #include "executor/plans/update_plan.h"
@@ -26,6 +28,9 @@ class UpdateExecutor : public AbstractExecutor {
   UpdateExecutor(ExecuteContext *exec_ctx, const UpdatePlanNode *plan,
                  std::unique_ptr<AbstractExecutor> &&child_executor);
 
+  /** Give the page claimed for relocated rows back to the table */
+  ~UpdateExecutor() override;
+
   /** Initialize the update */
   void Init() override;
 
@@ -51,12 +56,20 @@ class UpdateExecutor : public AbstractExecutor {
    */
   Row GenerateUpdatedTuple(const Row &src_row);
 
+  /**
+   * @return whether the two key rows hold the same values, the index entry of an updated row is kept then
+   */
+  static bool SameKey(const Row &src_key_row, const Row &dest_key_row);
+
   /** The update plan node to be executed */
   const UpdatePlanNode *plan_;
   /** Metadata identifying the table that should be updated */
-  TableInfo *table_info_;
+  TableInfo *table_info_{};
   Txn *txn_;
+  /** Indexes that may need maintenance, with USE_HOT_UPDATE only the ones with an assigned key column */
   std::vector<IndexInfo *> index_info_;
+  /** Rows moved to another page by this update, the child scan may yield them once more */
+  std::unordered_set<RowId> relocated_rids_;
   /** The child executor to obtain value from */
   std::unique_ptr<AbstractExecutor> child_executor_;
 };
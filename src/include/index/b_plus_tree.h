@@ -1,11 +1,14 @@
 #ifndef MINISQL_B_PLUS_TREE_H
 #define MINISQL_B_PLUS_TREE_H
 
+#include <atomic>
 #include <queue>
 #include <string>
 #include <vector>
 
+#include "common/rwlatch.h"
 #include "concurrency/txn.h"
+#include "index/external_sort.h"
 #include "index/index_iterator.h"
 #include "page/b_plus_tree_internal_page.h"
 #include "page/b_plus_tree_leaf_page.h"
@@ -20,14 +23,28 @@
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ * (5) Concurrent access by latch crabbing: readers hold read latches hand over hand on the way down, writers
+ *     write-latch the path and release the ancestors as soon as a node is known not to split or merge
+ * (6) Point lookups and Begin(key) descend by optimistic lock coupling: internal pages are read against their
+ *     version instead of being latched, and the descent restarts if a page changed underneath
+ * (7) Templated on the key width and comparator, see INDEX_TEMPLATE_ARGUMENTS. KeyManager still encodes and decodes
+ *     keys, the comparator only orders them in the search loops
+ * (8) An empty tree can be bulk loaded bottom-up from sorted entries, writing every page once
+ * (9) Keys ordered by memcmp can be compressed: internal pages store the shortest separators between their children
+ *     and both kinds of pages may factor out the prefix their keys share, see BPlusTreePage. Native int keys are
+ *     never compressed
  */
+#define BPLUSTREE_TYPE BPlusTree<KeySize, KeyComparator>
+
+template <int KeySize = 0, typename KeyComparator = KeyManager>
 class BPlusTree {
-  using InternalPage = BPlusTreeInternalPage;
-  using LeafPage = BPlusTreeLeafPage;
+  using InternalPage = B_PLUS_TREE_INTERNAL_PAGE_TYPE;
+  using LeafPage = B_PLUS_TREE_LEAF_PAGE_TYPE;
 
  public:
-  explicit BPlusTree(index_id_t index_id, BufferPoolManager *buffer_pool_manager, const KeyManager &comparator,
-                     int leaf_max_size = UNDEFINED_SIZE, int internal_max_size = UNDEFINED_SIZE);
+  explicit BPlusTree(index_id_t index_id, BufferPoolManager *buffer_pool_manager, const KeyManager &KM,
+                     int leaf_max_size = UNDEFINED_SIZE, int internal_max_size = UNDEFINED_SIZE,
+                     bool compress_internal = INDEX_COMPRESS_INTERNAL, bool compress_leaf = INDEX_COMPRESS_LEAF);
 
   // Returns true if this B+ tree has no keys and values.
   bool IsEmpty() const;
@@ -41,19 +58,25 @@ class BPlusTree {
   // return the value associated with a given key
   bool GetValue(const GenericKey *key, std::vector<RowId> &result, Txn *transaction = nullptr);
 
-  IndexIterator Begin();
+  // build an empty tree bottom-up from the sorted entries of sorter, leaves and internal pages are filled up to
+  // fill_factor of their max size, only the rightmost page of each level may be less full. loaded, if given, counts
+  // the entries written so far. Fails if the tree is not empty
+  bool BulkLoad(EXTERNAL_SORTER_TYPE &sorter, double fill_factor = BULK_LOAD_FILL_FACTOR,
+                std::atomic<uint64_t> *loaded = nullptr);
+
+  INDEXITERATOR_TYPE Begin();
 
-  IndexIterator Begin(const GenericKey *key);
+  INDEXITERATOR_TYPE Begin(const GenericKey *key);
 
-  IndexIterator End();
+  INDEXITERATOR_TYPE End();
 
-  // expose for test purpose
+  // expose for test purpose, the leaf is returned pinned and read-latched
   Page *FindLeafPage(const GenericKey *key, page_id_t page_id = INVALID_PAGE_ID, bool leftMost = false);
 
   // used to check whether all pages are unpinned
   bool Check();
 
-  // destroy the b plus tree
+  // destroy the subtree rooted at current_page_id, or the whole tree by default, its pages are freed in one batch
   void Destroy(page_id_t current_page_id = INVALID_PAGE_ID);
 
   void PrintTree(std::ofstream &out, Schema *schema) {
@@ -68,33 +91,89 @@ class BPlusTree {
   }
 
  private:
+  enum class Operation { kInsert, kRemove };
+
+  /**
+   * Latches held by one Insert/Remove: root_latch_ while the root may still change, the write-latched and pinned
+   * pages from the highest unsafe node down to the leaf, and the pages to delete once they are released.
+   */
+  struct WriteContext {
+    bool root_latched{false};
+    std::vector<Page *> pages;
+    std::vector<page_id_t> deleted_page_ids;
+  };
+
+  /**
+   * One level of a bulk load. Its nodes are filled from left to right and only the rightmost one is kept pinned.
+   */
+  struct BuildLevel {
+    Page *page{nullptr};
+    page_id_t page_id{INVALID_PAGE_ID};
+  };
+
+  // entries a node of max_size takes in a bulk load, at least min_size
+  static int FillSize(int max_size, double fill_factor, int min_size);
+
+  // start the next node of levels[level], key separating it from the previous one is added to the level above,
+  // which is created when the level gets its second node
+  void BuildOpenNode(std::vector<BuildLevel> &levels, size_t level, const GenericKey *key, double fill_factor);
+
+  // append child to the rightmost node of internal levels[level], return the page id of that node
+  page_id_t BuildAppendChild(std::vector<BuildLevel> &levels, size_t level, const GenericKey *key, page_id_t child,
+                             double fill_factor);
+
+  // the key stored in the parent for right, whose left sibling ends with left_key
+  void Separator(const GenericKey *left_key, const GenericKey *right_key, GenericKey *separator) const;
+
+  // descend without latching internal pages, the leaf is returned pinned and read-latched like FindLeafPage
+  Page *FindLeafPageOptimistic(const GenericKey *key);
+
+  // descend with write latches, releasing the ancestors whenever the node just latched is safe for op
+  Page *FindLeafPageForWrite(const GenericKey *key, Operation op, WriteContext &ctx);
+
+  bool IsSafe(BPlusTreePage *node, Operation op, bool is_root) const;
+
+  // unlatch and unpin the ancestors kept in ctx, they are not modified
+  void ReleaseAncestors(WriteContext &ctx);
+
+  // unlatch and unpin every page kept in ctx, then delete the pages emptied by merges
+  void ReleaseWriteContext(WriteContext &ctx);
+
   void StartNewTree(GenericKey *key, const RowId &value);
 
-  bool InsertIntoLeaf(GenericKey *key, const RowId &value, Txn *transaction = nullptr);
+  bool InsertIntoLeaf(GenericKey *key, const RowId &value, WriteContext &ctx);
 
   void InsertIntoParent(BPlusTreePage *old_node, GenericKey *key, BPlusTreePage *new_node, Txn *transaction = nullptr);
 
   LeafPage *Split(LeafPage *node, Txn *transaction);
 
-  InternalPage *Split(InternalPage *node, Txn *transaction);
+  // the first key of the new page, which goes to the parent, is stored to middle_key
+  InternalPage *Split(InternalPage *node, GenericKey *middle_key, Txn *transaction);
 
   template <typename N>
-  bool CoalesceOrRedistribute(N *&node, Txn *transaction = nullptr);
+  void CoalesceOrRedistribute(N *node, WriteContext &ctx);
+
+  void Coalesce(InternalPage *neighbor_node, InternalPage *node, InternalPage *parent, int index, WriteContext &ctx);
 
-  bool Coalesce(InternalPage *&neighbor_node, InternalPage *&node, InternalPage *&parent, int index,
-                Txn *transaction = nullptr);
+  void Coalesce(LeafPage *neighbor_node, LeafPage *node, InternalPage *parent, int index, WriteContext &ctx);
 
-  bool Coalesce(LeafPage *&neighbor_node, LeafPage *&node, InternalPage *&parent, int index,
-                Txn *transaction = nullptr);
+  // whether left and right fit in one page, index is the one of right in parent
+  bool CanCoalesce(LeafPage *left, LeafPage *right, InternalPage *parent, int index) const;
 
-  void Redistribute(LeafPage *neighbor_node, LeafPage *node, int index);
+  bool CanCoalesce(InternalPage *left, InternalPage *right, InternalPage *parent, int index) const;
 
-  void Redistribute(InternalPage *neighbor_node, InternalPage *node, int index);
+  // false if the parent has no room for the new separator, nothing is moved then
+  bool Redistribute(LeafPage *neighbor_node, LeafPage *node, InternalPage *parent, int index);
 
-  bool AdjustRoot(BPlusTreePage *node);
+  bool Redistribute(InternalPage *neighbor_node, InternalPage *node, InternalPage *parent, int index);
+
+  void AdjustRoot(BPlusTreePage *node, WriteContext &ctx);
 
   void UpdateRootPageId(int insert_record = 0);
 
+  // collect the ids of all pages of the subtree rooted at current_page_id
+  void CollectPages(page_id_t current_page_id, std::vector<page_id_t> *page_ids);
+
   /* Debug Routines for FREE!! */
   void ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstream &out, Schema *schema) const;
 
@@ -102,11 +181,16 @@ class BPlusTree {
 
   // member variable
   index_id_t index_id_;
-  page_id_t root_page_id_{INVALID_PAGE_ID};
+  // protects root_page_id_, readers hold it until the root is latched, writers until the root is safe
+  ReaderWriterLatch root_latch_;
+  std::atomic<page_id_t> root_page_id_{INVALID_PAGE_ID};
   BufferPoolManager *buffer_pool_manager_;
   KeyManager processor_;
+  KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
+  bool compress_internal_;
+  bool compress_leaf_;
 };
 
 #endif  // MINISQL_B_PLUS_TREE_H
@@ -5,6 +5,12 @@
 #include "index/generic_key.h"
 #include "index/index.h"
 
+/**
+ * Index over a BPlusTree, instantiated per key width by IndexInfo::CreateIndex.
+ */
+#define BPLUSTREE_INDEX_TYPE BPlusTreeIndex<KeySize, KeyComparator>
+
+template <int KeySize = 0, typename KeyComparator = KeyManager>
 class BPlusTreeIndex : public Index {
  public:
   BPlusTreeIndex(index_id_t index_id, IndexSchema *key_schema, size_t key_size, BufferPoolManager *buffer_pool_manager);
@@ -17,17 +23,22 @@ class BPlusTreeIndex : public Index {
 
   dberr_t Destroy() override;
 
-  IndexIterator GetBeginIterator();
+  // every source fills a sorter of its own, the sorted runs are merged and the tree is built bottom-up
+  dberr_t BulkLoad(const std::vector<IndexEntrySource> &sources, Txn *txn,
+                   IndexBuildProgress *progress = nullptr) override;
+
+  INDEXITERATOR_TYPE GetBeginIterator();
 
-  IndexIterator GetBeginIterator(GenericKey *key);
+  INDEXITERATOR_TYPE GetBeginIterator(GenericKey *key);
 
-  IndexIterator GetEndIterator();
+  INDEXITERATOR_TYPE GetEndIterator();
 
  protected:
+  BufferPoolManager *buffer_pool_manager_;
   // comparator for key
   KeyManager processor_;
   // container
-  BPlusTree container_;
+  BPLUSTREE_TYPE container_;
 };
 
 #endif  // MINISQL_B_PLUS_TREE_INDEX_H
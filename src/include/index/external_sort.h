@@ -0,0 +1,130 @@
+#ifndef MINISQL_EXTERNAL_SORT_H
+#define MINISQL_EXTERNAL_SORT_H
+
+#include <memory>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/macros.h"
+#include "common/rowid.h"
+#include "index/generic_key.h"
+#include "page/b_plus_tree_page.h"
+
+/**
+ * Sorts the (key, row id) entries of an index build by key, keeping only the first entry added for each key.
+ * Entries are collected in a buffer of memory_limit bytes. A full buffer is sorted and spilled as a run to temporary
+ * pages of the buffer pool, and Finish merges the runs, BULK_LOAD_MERGE_FAN_IN at a time, so that Next returns the
+ * entries in order. When everything fits in the buffer nothing is spilled. Temporary pages are freed as soon as
+ * their run is consumed.
+ * A parallel build fills one sorter per worker thread and has one of them Absorb the others, in the order their
+ * entries were produced, before Finish.
+ */
+#define EXTERNAL_SORTER_TYPE ExternalSorter<KeySize, KeyComparator>
+
+template <int KeySize = 0, typename KeyComparator = KeyManager>
+class ExternalSorter {
+ public:
+  ExternalSorter(BufferPoolManager *buffer_pool_manager, const KeyManager &KM,
+                 uint32_t memory_limit = BULK_LOAD_SORT_MEMORY);
+
+  DISALLOW_COPY_AND_MOVE(ExternalSorter);
+
+  ~ExternalSorter();
+
+  void Add(const GenericKey *key, const RowId &value);
+
+  // sort and spill the buffered entries if some were spilled already, so that a worker sorts its own entries
+  void Seal();
+
+  // take over the entries of other, they count as added after the entries of this sorter. other is left empty
+  void Absorb(ExternalSorter &other);
+
+  // no more Add after this, GetSize is exact from now on
+  void Finish();
+
+  // the next entry in key order, key is valid until the next call
+  bool Next(GenericKey *&key, RowId &value);
+
+  // number of entries added, or returned by Next once finished
+  uint64_t GetSize() const { return size_; }
+
+  // number of runs spilled to temporary pages
+  size_t GetSpilledRuns() const { return spilled_runs_; }
+
+ private:
+  struct Run {
+    std::vector<page_id_t> page_ids;
+    uint64_t size{0};
+  };
+
+  struct RunReader {
+    Run run;
+    size_t page_index{0};
+    Page *page{nullptr};
+    int slot{0};
+    uint64_t remaining{0};
+    // free the pages of the run once it is read
+    bool consume{true};
+  };
+
+  struct RunWriter {
+    Run run;
+    Page *page{nullptr};
+    int slot{0};
+  };
+
+  inline int KeyWidth() const { return KeySize > 0 ? KeySize : key_size_; }
+
+  inline const GenericKey *KeyOf(const char *entry) const { return reinterpret_cast<const GenericKey *>(entry); }
+
+  // sort the buffered entries by key
+  void SortBuffer();
+
+  // write the sorted buffer as a run and empty it
+  void SpillBuffer();
+
+  void Append(RunWriter &writer, const char *entry);
+
+  void Close(RunWriter &writer);
+
+  // start merging runs, the current readers must be exhausted
+  void OpenReaders(std::vector<Run> runs, bool consume);
+
+  // copy the smallest entry of the readers to dest, ties go to the run added first
+  bool PopMerged(char *dest);
+
+  // like PopMerged, but skip the entries with the same key as the last one returned
+  bool PopUnique(char *dest);
+
+  // whether the current entry of reader a is greater than the one of reader b
+  bool ReaderGreater(int a, int b) const;
+
+  // move reader to its next entry, freeing the run once it is consumed
+  void Advance(RunReader &reader);
+
+  void FreeRun(RunReader &reader);
+
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+  int key_size_;
+  int entry_size_;
+  int entries_per_page_;
+  size_t buffer_capacity_;
+  uint64_t size_{0};
+  size_t spilled_runs_{0};
+  bool finished_{false};
+  // entries added since the last spill, and their order after SortBuffer
+  std::unique_ptr<char[]> buffer_;
+  size_t buffered_{0};
+  std::vector<const char *> sorted_;
+  size_t sorted_index_{0};
+  std::vector<Run> runs_;
+  // merge state, heap_ holds the indexes of non exhausted readers
+  std::vector<RunReader> readers_;
+  std::vector<int> heap_;
+  std::unique_ptr<char[]> current_;
+  std::unique_ptr<char[]> last_;
+  bool has_last_{false};
+};
+
+#endif  // MINISQL_EXTERNAL_SORT_H
@@ -11,6 +11,16 @@ class GenericKey {
   char data[0];
 };
 
+/**
+ * Index keys are stored in a normalized, binary-comparable form so that comparing two keys is a single memcmp.
+ * Each key column takes one prefix byte (0 for NULL, 1 otherwise, so NULL sorts first) followed by:
+ *   INT   4 bytes big-endian with the sign bit flipped
+ *   FLOAT 4 bytes big-endian of the IEEE bits, sign bit flipped for positives and all bits flipped for negatives
+ *   CHAR  the column length in bytes, zero padded
+ * A NULL column keeps its slot, zero filled. Decoding is only needed to display a key.
+ * A key of a single NOT NULL INT column with key_size 4 is the exception: it is stored as a native int32 and
+ * compared as one, see IntKeyComparator.
+ */
 class KeyManager {
  public: /**/
   [[nodiscard]] inline GenericKey *InitKey() const {
@@ -18,58 +28,183 @@ class KeyManager {
   }
 
   inline void SerializeFromKey(GenericKey *key_buf, const Row &key, Schema *schema) const {
-    // initialize to 0
-    [[maybe_unused]] uint32_t size = key.GetSerializedSize(schema);
     ASSERT(key.GetFieldCount() == schema->GetColumnCount(), "field nums not match.");
-    ASSERT(size <= (uint32_t)key_size_, "Index key size exceed max key size.");
+    if (IsIntKey()) {
+      ASSERT(!key.GetField(0)->IsNull(), "Int key can not be null.");
+      memcpy(key_buf->data, &key.GetField(0)->value_.integer_, sizeof(int32_t));
+      return;
+    }
+    ASSERT(normalized_size_ <= (uint32_t)key_size_, "Index key size exceed max key size.");
+    // initialize to 0
     memset(key_buf->data, 0, key_size_);
-    key.SerializeTo(key_buf->data, schema);
+    char *buf = key_buf->data;
+    for (uint32_t i = 0; i < schema->GetColumnCount(); i++) {
+      const Field *field = key.GetField(i);
+      uint32_t width = GetNormalizedWidth(schema->GetColumn(i));
+      if (!field->IsNull()) {
+        buf[0] = 1;
+        switch (field->GetTypeId()) {
+          case TypeId::kTypeInt:
+            WriteBigEndian(buf + 1, static_cast<uint32_t>(field->value_.integer_) ^ SIGN_BIT);
+            break;
+          case TypeId::kTypeFloat: {
+            // -0.0 和 0.0 相等，统一编码为 0.0
+            float value = field->value_.float_ == 0.0f ? 0.0f : field->value_.float_;
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            WriteBigEndian(buf + 1, (bits & SIGN_BIT) ? ~bits : bits ^ SIGN_BIT);
+            break;
+          }
+          case TypeId::kTypeChar:
+            ASSERT(field->len_ <= width - 1, "Index key size exceed column length.");
+            memcpy(buf + 1, field->value_.chars_, std::min(field->len_, width - 1));
+            break;
+          default:
+            ASSERT(false, "Unsupported key type.");
+        }
+      }
+      buf += width;
+    }
   }
 
   inline void DeserializeToKey(const GenericKey *key_buf, Row &key, Schema *schema) const {
-    [[maybe_unused]] uint32_t ofs = key.DeserializeFrom(const_cast<char *>(key_buf->data), schema);
-    ASSERT(ofs <= (uint32_t)key_size_, "Index key size exceed max key size.");
+    const char *buf = key_buf->data;
+    std::vector<Field> fields;
+    if (IsIntKey()) {
+      int32_t value;
+      memcpy(&value, buf, sizeof(value));
+      fields.emplace_back(TypeId::kTypeInt, value);
+      key = Row(std::move(fields));
+      return;
+    }
+    fields.reserve(schema->GetColumnCount());
+    for (uint32_t i = 0; i < schema->GetColumnCount(); i++) {
+      const Column *column = schema->GetColumn(i);
+      uint32_t width = GetNormalizedWidth(column);
+      if (buf[0] == 0) {
+        fields.emplace_back(column->GetType());
+      } else {
+        switch (column->GetType()) {
+          case TypeId::kTypeInt:
+            fields.emplace_back(TypeId::kTypeInt, static_cast<int32_t>(ReadBigEndian(buf + 1) ^ SIGN_BIT));
+            break;
+          case TypeId::kTypeFloat: {
+            uint32_t bits = ReadBigEndian(buf + 1);
+            bits = (bits & SIGN_BIT) ? bits ^ SIGN_BIT : ~bits;
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            fields.emplace_back(TypeId::kTypeFloat, value);
+            break;
+          }
+          case TypeId::kTypeChar: {
+            // 去掉补齐用的 0
+            uint32_t len = width - 1;
+            while (len > 0 && buf[len] == 0) len--;
+            fields.emplace_back(TypeId::kTypeChar, const_cast<char *>(buf + 1), len, true);
+            break;
+          }
+          default:
+            ASSERT(false, "Unsupported key type.");
+        }
+      }
+      buf += width;
+    }
+    key = Row(std::move(fields));
   }
 
   // compare
   //l<h -> -1 ; l>h -> +1 ; l==h -> 0
   [[nodiscard]] inline int CompareKeys(const GenericKey *lhs, const GenericKey *rhs) const {
-    //    ASSERT(malloc_usable_size((void *)&lhs) == malloc_usable_size((void *)&rhs), "key size not match.");
-    uint32_t column_count = key_schema_->GetColumnCount();
-    Row lhs_key(INVALID_ROWID);
-    Row rhs_key(INVALID_ROWID);
-    DeserializeToKey(lhs, lhs_key, key_schema_);
-    DeserializeToKey(rhs, rhs_key, key_schema_);
-
-    for (uint32_t i = 0; i < column_count; i++) {
-      Field *lhs_value = lhs_key.GetField(i);
-      Field *rhs_value = rhs_key.GetField(i);
-
-      if (lhs_value->CompareLessThan(*rhs_value) == CmpBool::kTrue) {
-        return -1;
-      }
-
-      if (lhs_value->CompareGreaterThan(*rhs_value) == CmpBool::kTrue) {
-        return 1;
-      }
+    if (IsIntKey()) {
+      int32_t l, r;
+      memcpy(&l, lhs->data, sizeof(l));
+      memcpy(&r, rhs->data, sizeof(r));
+      return l < r ? -1 : (l > r ? 1 : 0);
     }
-    // equals
-    return 0;
+    int ret = memcmp(lhs->data, rhs->data, normalized_size_);
+    return ret < 0 ? -1 : (ret > 0 ? 1 : 0);
   }
 
   inline int GetKeySize() const { return key_size_; }
 
+  // whether keys are native int32, only for a single NOT NULL INT column with key_size 4
+  inline bool IsIntKey() const { return key_size_ == sizeof(int32_t); }
+
+  /**
+   * @return the bytes a key of key_schema takes in normalized form
+   */
+  static uint32_t GetNormalizedSize(const Schema *key_schema) {
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < key_schema->GetColumnCount(); i++) {
+      size += GetNormalizedWidth(key_schema->GetColumn(i));
+    }
+    return size;
+  }
+
   KeyManager(const KeyManager &other) {
     this->key_schema_ = other.key_schema_;
     this->key_size_ = other.key_size_;
+    this->normalized_size_ = other.normalized_size_;
   }
 
   // constructor
-  KeyManager(Schema *key_schema, size_t key_size) : key_size_(key_size), key_schema_(key_schema) {}
+  KeyManager(Schema *key_schema, size_t key_size)
+      : key_size_(key_size), key_schema_(key_schema), normalized_size_(GetNormalizedSize(key_schema)) {}
 
  private:
+  static constexpr uint32_t SIGN_BIT = 0x80000000u;
+
+  static uint32_t GetNormalizedWidth(const Column *column) {
+    return 1 + (column->GetType() == TypeId::kTypeChar ? column->GetLength() : sizeof(uint32_t));
+  }
+
+  static void WriteBigEndian(char *buf, uint32_t value) {
+    buf[0] = static_cast<char>(value >> 24);
+    buf[1] = static_cast<char>(value >> 16);
+    buf[2] = static_cast<char>(value >> 8);
+    buf[3] = static_cast<char>(value);
+  }
+
+  static uint32_t ReadBigEndian(const char *buf) {
+    auto *bytes = reinterpret_cast<const uint8_t *>(buf);
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+  }
+
   int key_size_;
   Schema *key_schema_;
+  // bytes compared by CompareKeys, the rest of the key_size_ buffer is padding
+  uint32_t normalized_size_;
+};
+
+/**
+ * Compares keys of a fixed width in normalized form. Keys are zero padded to KeySize, so a memcmp of the constant
+ * width orders them like KeyManager::CompareKeys and can be inlined into the search loops.
+ */
+template <int KeySize>
+class FixedKeyComparator {
+ public:
+  explicit FixedKeyComparator(const KeyManager &) {}
+
+  [[nodiscard]] inline int CompareKeys(const GenericKey *lhs, const GenericKey *rhs) const {
+    int ret = memcmp(lhs, rhs, KeySize);
+    return ret < 0 ? -1 : (ret > 0 ? 1 : 0);
+  }
+};
+
+/**
+ * Compares 4-byte keys holding a native int32, see KeyManager::IsIntKey.
+ */
+class IntKeyComparator {
+ public:
+  explicit IntKeyComparator(const KeyManager &) {}
+
+  [[nodiscard]] inline int CompareKeys(const GenericKey *lhs, const GenericKey *rhs) const {
+    int32_t l, r;
+    memcpy(&l, lhs, sizeof(l));
+    memcpy(&r, rhs, sizeof(r));
+    return l < r ? -1 : (l > r ? 1 : 0);
+  }
 };
 
 #endif  // MINISQL_GENERIC_KEY_H
@@ -1,12 +1,38 @@
 #ifndef MINISQL_INDEX_H
 #define MINISQL_INDEX_H
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include "common/dberr.h"
 #include "concurrency/txn.h"
 #include "record/row.h"
 
+// produces the (key, row id) pairs of an index build until it returns false, key is used until the next call only
+using IndexEntrySource = std::function<bool(Row &key, RowId &row_id)>;
+
+/**
+ * Progress of an index build. The counters are updated while the build runs and may be polled from another thread,
+ * workers is filled in once the sources are exhausted.
+ */
+struct IndexBuildProgress {
+  enum class Phase { kScan, kMerge, kLoad, kDone };
+
+  struct Worker {
+    uint64_t rows{0};
+    double seconds{0};
+  };
+
+  std::atomic<Phase> phase{Phase::kScan};
+  std::atomic<uint64_t> rows_scanned{0};
+  // entries to load, known once the sorted runs are merged
+  std::atomic<uint64_t> entries_total{0};
+  std::atomic<uint64_t> entries_loaded{0};
+  std::vector<Worker> workers;
+};
+
 class Index {
  public:
   explicit Index(index_id_t index_id, IndexSchema *key_schema) : index_id_(index_id), key_schema_(key_schema) {}
@@ -21,6 +47,13 @@ class Index {
 
   virtual dberr_t Destroy() = 0;
 
+  /**
+   * Fill an empty index with the pairs produced by sources, each source is consumed by a thread of its own.
+   * Of the pairs with the same key, the first one of the earliest source is kept.
+   */
+  virtual dberr_t BulkLoad(const std::vector<IndexEntrySource> &sources, Txn *txn,
+                           IndexBuildProgress *progress = nullptr) = 0;
+
  protected:
   index_id_t index_id_;
   IndexSchema *key_schema_;
@@ -1,16 +1,32 @@
 #ifndef MINISQL_INDEX_ITERATOR_H
 #define MINISQL_INDEX_ITERATOR_H
 
+#include <memory>
+
 #include "page/b_plus_tree_leaf_page.h"
 
+/**
+ * Forward iterator over the leaves of a B+ tree.
+ * The current leaf stays pinned but is only read-latched inside the constructor and operator++, so an open
+ * iterator never blocks writers. The current item is copied out under the latch, and the iterator steps to the
+ * next leaf by pinning it before releasing the current one, which never holds two latches at once.
+ */
+#define INDEXITERATOR_TYPE IndexIterator<KeySize, KeyComparator>
+
+template <int KeySize = 0, typename KeyComparator = KeyManager>
 class IndexIterator {
-  using LeafPage = BPlusTreeLeafPage;
+  using LeafPage = B_PLUS_TREE_LEAF_PAGE_TYPE;
 
  public:
   // you may define your own constructor based on your member variables
   explicit IndexIterator();
 
-  explicit IndexIterator(page_id_t page_id, BufferPoolManager *bpm, int index = 0);
+  // takes over a pinned and read-latched leaf, the latch is released before returning
+  explicit IndexIterator(Page *leaf, BufferPoolManager *bpm, int index = 0);
+
+  IndexIterator(IndexIterator &&other) noexcept;
+
+  DISALLOW_COPY(IndexIterator);
 
   ~IndexIterator();
 
@@ -27,11 +43,16 @@ class IndexIterator {
   bool operator!=(const IndexIterator &itr) const;
 
  private:
+  // with the current leaf read-latched, skip to the first valid item at or after item_index, copy it out and
+  // release the latch
+  void Settle();
+
   page_id_t current_page_id{INVALID_PAGE_ID};
-  LeafPage *page{nullptr};
+  Page *page{nullptr};
   int item_index{0};
   BufferPoolManager *buffer_pool_manager{nullptr};
-  // add your own private member variables here
+  std::unique_ptr<char[]> key;
+  RowId value;
 };
 
 #endif  // MINISQL_INDEX_ITERATOR_H
@@ -4,11 +4,12 @@
 #include <string.h>
 
 #include <queue>
+#include <type_traits>
 
 #include "index/generic_key.h"
 #include "page/b_plus_tree_page.h"
 
-#define INTERNAL_PAGE_HEADER_SIZE 28
+#define INTERNAL_PAGE_HEADER_SIZE 40
 /**
  * Store n indexed keys and n+1 child pointers (page_id) within internal page.
  * Pointer PAGE_ID(i) points to a subtree in which all keys K satisfy:
@@ -17,20 +18,44 @@
  * the first key always remains invalid. That is to say, any search/lookup
  * should ignore the first key.
  *
- * Internal page format (keys are stored in increasing order):
- *  --------------------------------------------------------------------------
- * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
- *  --------------------------------------------------------------------------
+ * Internal page format (keys are stored in increasing order, see BPlusTreePage for the prefix and the slots):
+ *  ---------------------------------------------------------------------------------------
+ * | HEADER | PREFIX | SLOT(0)+PAGE_ID(0) | SLOT(1)+PAGE_ID(1) | ... | SLOT(n)+PAGE_ID(n) |
+ *  ---------------------------------------------------------------------------------------
+ * The first slot holds no key. Keys are copied out by KeyAt, and the methods that add a key return whether it fits.
+ * Pages of int keys keep the keys apart from the values, the keys starting at a cache line of the frame:
+ *  ---------------------------------------------------------------------------------------
+ * | HEADER | PAD | KEY(0) | ... | KEY(kIntCapacity - 1) | PAGE_ID(0) | ... | PAGE_ID(kIntCapacity - 1) |
+ *  ---------------------------------------------------------------------------------------
  */
+#define B_PLUS_TREE_INTERNAL_PAGE_TYPE BPlusTreeInternalPage<KeySize, KeyComparator>
+
+template <int KeySize = 0, typename KeyComparator = KeyManager>
 class BPlusTreeInternalPage : public BPlusTreePage {
  public:
   // must call initialize method after "create" a new node
   void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int key_size = UNDEFINED_SIZE,
-            int max_size = UNDEFINED_SIZE);
+            int max_size = UNDEFINED_SIZE, bool compressed = false);
+
+  // width of a key, a constant unless KeySize is 0
+  inline int KeyWidth() const { return KeySize > 0 ? KeySize : GetKeySize(); }
+
+  // int keys are searched with SIMD compares, see BPlusTreePage::SearchIntKeys. Their pages are never compressed
+  static constexpr bool kIntKeys = std::is_same_v<KeyComparator, IntKeyComparator>;
 
-  GenericKey *KeyAt(int index);
+  // offset in data_ of the key array of an int page, which starts at a cache line of the frame
+  static constexpr int kKeysOffset =
+      (CACHE_LINE_SIZE - INTERNAL_PAGE_HEADER_SIZE % CACHE_LINE_SIZE) % CACHE_LINE_SIZE;
 
-  void SetKeyAt(int index, GenericKey *key);
+  // entries a page of int keys holds
+  static constexpr int kIntCapacity =
+      (PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE - kKeysOffset) / static_cast<int>(sizeof(int32_t) + sizeof(page_id_t));
+
+  // copy the key at index to key
+  void KeyAt(int index, GenericKey *key) const;
+
+  // false if the page has no room for key, it is left unchanged then
+  bool SetKeyAt(int index, const GenericKey *key);
 
   int ValueIndex(const page_id_t &value) const;
 
@@ -38,24 +63,34 @@ class BPlusTreeInternalPage : public BPlusTreePage {
 
   void SetValueAt(int index, page_id_t value);
 
-  void *PairPtrAt(int index);
+  page_id_t Lookup(const GenericKey *key, const KeyComparator &KP) const;
 
-  void PairCopy(void *dest, void *src, int pair_num = 1);
+  // max size the page would have with key appended
+  int MaxSizeWith(const GenericKey *key) const;
 
-  page_id_t Lookup(const GenericKey *key, const KeyManager &KP);
+  // bytes in use, header included
+  int64_t UsedBytes() const;
 
   void PopulateNewRoot(const page_id_t &old_value, GenericKey *new_key, const page_id_t &new_value);
 
+  // @return new size, -1 if the page has no room for new_key
   int InsertNodeAfter(const page_id_t &old_value, GenericKey *new_key, const page_id_t &new_value);
 
+  // append a child, key is ignored for the first one. false if the page has no room for key
+  bool Append(const GenericKey *key, page_id_t value);
+
   void Remove(int index);
 
   page_id_t RemoveAndReturnOnlyChild();
 
+  // whether this page and its right sibling fit in one page, middle_key being the key of the sibling in the parent
+  bool CanMerge(const BPlusTreeInternalPage *right, const GenericKey *middle_key) const;
+
   // Split and Merge utility methods
   void MoveAllTo(BPlusTreeInternalPage *recipient, GenericKey *middle_key, BufferPoolManager *buffer_pool_manager);
 
-  void MoveHalfTo(BPlusTreeInternalPage *recipient, BufferPoolManager *buffer_pool_manager);
+  // the first key of the moved half is stored to middle_key, it goes to the parent
+  void MoveHalfTo(BPlusTreeInternalPage *recipient, GenericKey *middle_key, BufferPoolManager *buffer_pool_manager);
 
   void MoveFirstToEndOf(BPlusTreeInternalPage *recipient, GenericKey *middle_key,
                         BufferPoolManager *buffer_pool_manager);
@@ -64,14 +99,61 @@ class BPlusTreeInternalPage : public BPlusTreePage {
                          BufferPoolManager *buffer_pool_manager);
 
  private:
-  void CopyNFrom(void *src, int size, BufferPoolManager *buffer_pool_manager);
+  // the value array of an int page follows its key array
+  static constexpr int kValuesOffset = kKeysOffset + kIntCapacity * static_cast<int>(sizeof(int32_t));
+
+  inline int SlotSize() const { return GetSlotWidth() + static_cast<int>(sizeof(page_id_t)); }
+
+  inline char *SlotAt(int index) { return data_ + GetPrefixSize() + index * SlotSize(); }
+
+  inline const char *SlotAt(int index) const { return data_ + GetPrefixSize() + index * SlotSize(); }
+
+  // the slot bytes of the key at index, and its value
+  inline char *KeySlot(int index) {
+    return kIntKeys ? data_ + kKeysOffset + index * static_cast<int>(sizeof(int32_t)) : SlotAt(index);
+  }
+
+  inline const char *KeySlot(int index) const {
+    return kIntKeys ? data_ + kKeysOffset + index * static_cast<int>(sizeof(int32_t)) : SlotAt(index);
+  }
+
+  inline char *ValueSlot(int index) {
+    return kIntKeys ? data_ + kValuesOffset + index * static_cast<int>(sizeof(page_id_t))
+                    : SlotAt(index) + GetSlotWidth();
+  }
+
+  inline const char *ValueSlot(int index) const {
+    return kIntKeys ? data_ + kValuesOffset + index * static_cast<int>(sizeof(page_id_t))
+                    : SlotAt(index) + GetSlotWidth();
+  }
+
+  // move count entries from index from to index to
+  void MoveSlots(int to, int from, int count);
+
+  // entries that fit with the given layout
+  int Capacity(int prefix_size, int slot_width) const;
+
+  int MaxSizeFor(int prefix_size, int slot_width) const;
+
+  // whether key can be stored in a slot of the current layout
+  bool LayoutFits(const char *key) const;
+
+  // bytes key has in common with the key at index
+  int CommonPrefixAt(int index, const char *key) const;
+
+  // copy the entries to buf with full width keys, each taking KeyWidth() + sizeof(page_id_t) bytes
+  void Unpack(char *buf) const;
+
+  // replace the entries by the size full width entries of buf, in the best layout for their keys. The first key is
+  // ignored. false if they do not fit, the page is left unchanged then
+  bool Pack(const char *buf, int size);
 
-  void CopyLastFrom(GenericKey *key, page_id_t value, BufferPoolManager *buffer_pool_manager);
+  // insert at index going through the full width entries when the key does not fit the layout
+  bool InsertAt(int index, const GenericKey *key, page_id_t value);
 
-  void CopyFirstFrom(page_id_t value, BufferPoolManager *buffer_pool_manager);
+  void Adopt(page_id_t child, BufferPoolManager *buffer_pool_manager);
 
   char data_[PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE];
 };
 
-using InternalPage = BPlusTreeInternalPage;
 #endif  // MINISQL_B_PLUS_TREE_INTERNAL_PAGE_H
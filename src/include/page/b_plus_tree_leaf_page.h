@@ -8,61 +8,83 @@
  * see include/common/rid.h for detailed implementation) together within leaf
  * page. Only support unique key.
 
- * Leaf page format (keys are stored in order):
- *  ----------------------------------------------------------------------
- * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
- *  ----------------------------------------------------------------------
+ * Leaf page format (keys are stored in order, see BPlusTreePage for the prefix and the slots):
+ *  ---------------------------------------------------------------------------
+ * | HEADER | PREFIX | SLOT(1) + RID(1) | SLOT(2) + RID(2) | ... | SLOT(n) + RID(n)
+ *  ---------------------------------------------------------------------------
+ * Pages of int keys keep the keys apart from the values, the keys starting at a cache line of the frame:
+ *  ---------------------------------------------------------------------------
+ * | HEADER | PAD | KEY(1) | ... | KEY(kIntCapacity) | RID(1) | ... | RID(kIntCapacity)
+ *  ---------------------------------------------------------------------------
  *
- *  Header format (size in byte, 24 bytes in total):
+ *  Header format (size in byte, 44 bytes in total):
  *  ---------------------------------------------------------------------
- * | PageType (4) | CurrentSize (4) | MaxSize (4) | ParentPageId (4) |
+ * | BPlusTreePage header (40) | NextPageId (4) |
  *  ---------------------------------------------------------------------
- *  ------------------------------
- * | PageId (4) | NextPageId (4)
- *  ------------------------------
+ * Keys are copied out by KeyAt, and the methods that add a key return whether it fits.
  */
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include "index/generic_key.h"
 #include "page/b_plus_tree_page.h"
 
-#define LEAF_PAGE_HEADER_SIZE 32
+#define LEAF_PAGE_HEADER_SIZE 44
 
+#define B_PLUS_TREE_LEAF_PAGE_TYPE BPlusTreeLeafPage<KeySize, KeyComparator>
+
+template <int KeySize = 0, typename KeyComparator = KeyManager>
 class BPlusTreeLeafPage : public BPlusTreePage {
  public:
   // After creating a new leaf page from buffer pool, must call initialize
   // method to set default values
   void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int key_size = UNDEFINED_SIZE,
-            int max_size = UNDEFINED_SIZE);
+            int max_size = UNDEFINED_SIZE, bool compressed = false);
 
   // helper methods
+  // width of a key, a constant unless KeySize is 0
+  inline int KeyWidth() const { return KeySize > 0 ? KeySize : GetKeySize(); }
+
+  // int keys are searched with SIMD compares, see BPlusTreePage::SearchIntKeys. Their pages are never compressed
+  static constexpr bool kIntKeys = std::is_same_v<KeyComparator, IntKeyComparator>;
+
+  // offset in data_ of the key array of an int page, which starts at a cache line of the frame
+  static constexpr int kKeysOffset = (CACHE_LINE_SIZE - LEAF_PAGE_HEADER_SIZE % CACHE_LINE_SIZE) % CACHE_LINE_SIZE;
+
+  // entries a page of int keys holds
+  static constexpr int kIntCapacity =
+      (PAGE_SIZE - LEAF_PAGE_HEADER_SIZE - kKeysOffset) / static_cast<int>(sizeof(int32_t) + sizeof(RowId));
+
   page_id_t GetNextPageId() const;
 
   void SetNextPageId(page_id_t next_page_id);
 
-  GenericKey *KeyAt(int index);
-
-  void SetKeyAt(int index, GenericKey *key);
+  // copy the key at index to key
+  void KeyAt(int index, GenericKey *key) const;
 
   RowId ValueAt(int index) const;
 
   void SetValueAt(int index, RowId value);
 
-  int KeyIndex(const GenericKey *key, const KeyManager &comparator);
+  int KeyIndex(const GenericKey *key, const KeyComparator &comparator) const;
 
-  void *PairPtrAt(int index);
+  // max size the page would have with key appended
+  int MaxSizeWith(const GenericKey *key) const;
 
-  void PairCopy(void *dest, void *src, int pair_num = 1);
+  // insert and delete methods
+  // @return page size after insertion, -1 if the page has no room for key
+  int Insert(GenericKey *key, const RowId &value, const KeyComparator &comparator);
 
-  std::pair<GenericKey *, RowId> GetItem(int index);
+  // append an entry with the greatest key, false if the page has no room for key
+  bool Append(const GenericKey *key, const RowId &value);
 
-  // insert and delete methods
-  int Insert(GenericKey *key, const RowId &value, const KeyManager &comparator);
+  bool Lookup(const GenericKey *key, RowId &value, const KeyComparator &comparator) const;
 
-  bool Lookup(const GenericKey *key, RowId &value, const KeyManager &comparator);
+  int RemoveAndDeleteRecord(const GenericKey *key, const KeyComparator &comparator);
 
-  int RemoveAndDeleteRecord(const GenericKey *key, const KeyManager &comparator);
+  // whether this page and its right sibling fit in one page
+  bool CanMerge(const BPlusTreeLeafPage *right) const;
 
   // Split and Merge utility methods
   void MoveHalfTo(BPlusTreeLeafPage *recipient);
@@ -74,16 +96,64 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   void MoveLastToFrontOf(BPlusTreeLeafPage *recipient);
 
  private:
-  void CopyNFrom(void *src, int size);
+  // the value array of an int page follows its key array
+  static constexpr int kValuesOffset = kKeysOffset + kIntCapacity * static_cast<int>(sizeof(int32_t));
+
+  inline int SlotSize() const { return GetSlotWidth() + static_cast<int>(sizeof(RowId)); }
+
+  inline char *SlotAt(int index) { return data_ + GetPrefixSize() + index * SlotSize(); }
+
+  inline const char *SlotAt(int index) const { return data_ + GetPrefixSize() + index * SlotSize(); }
+
+  // the slot bytes of the key at index, and its value
+  inline char *KeySlot(int index) {
+    return kIntKeys ? data_ + kKeysOffset + index * static_cast<int>(sizeof(int32_t)) : SlotAt(index);
+  }
+
+  inline const char *KeySlot(int index) const {
+    return kIntKeys ? data_ + kKeysOffset + index * static_cast<int>(sizeof(int32_t)) : SlotAt(index);
+  }
+
+  inline char *ValueSlot(int index) {
+    return kIntKeys ? data_ + kValuesOffset + index * static_cast<int>(sizeof(RowId)) : SlotAt(index) + GetSlotWidth();
+  }
+
+  inline const char *ValueSlot(int index) const {
+    return kIntKeys ? data_ + kValuesOffset + index * static_cast<int>(sizeof(RowId)) : SlotAt(index) + GetSlotWidth();
+  }
+
+  // move count entries from index from to index to
+  void MoveSlots(int to, int from, int count);
+
+  // entries that fit with the given layout
+  int Capacity(int prefix_size, int slot_width) const;
+
+  int MaxSizeFor(int prefix_size, int slot_width) const;
+
+  // whether key can be stored in a slot of the current layout
+  bool LayoutFits(const char *key) const;
+
+  // bytes key has in common with the key at index
+  int CommonPrefixAt(int index, const char *key) const;
+
+  // index of the first key not less than key, found tells whether it equals key
+  int Search(const GenericKey *key, const KeyComparator &comparator, bool *found) const;
+
+  // copy the entries to buf with full width keys, each taking KeyWidth() + sizeof(RowId) bytes
+  void Unpack(char *buf) const;
+
+  // replace the entries by the size full width entries of buf, in the best layout for their keys. false if they do
+  // not fit, the page is left unchanged then
+  bool Pack(const char *buf, int size);
 
-  void CopyLastFrom(GenericKey *key, const RowId value);
+  // insert at index going through the full width entries when the key does not fit the layout
+  bool InsertAt(int index, const GenericKey *key, const RowId &value);
 
-  void CopyFirstFrom(GenericKey *key, const RowId value);
+  void RemoveAt(int index);
 
   page_id_t next_page_id_{INVALID_PAGE_ID};
 
   char data_[PAGE_SIZE - LEAF_PAGE_HEADER_SIZE];
 };
 
-using LeafPage = BPlusTreeLeafPage;
 #endif  // MINISQL_B_PLUS_TREE_LEAF_PAGE_H
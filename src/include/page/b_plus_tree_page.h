@@ -8,22 +8,39 @@
 
 #include "buffer/buffer_pool_manager.h"
 
+class GenericKey;
+
 // define page type enum
 enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
 
 #define UNDEFINED_SIZE 0
+
+/**
+ * Index classes are templated on the key width and the comparator. KeySize 0 takes the width from the page header
+ * at runtime, a non-zero KeySize makes every offset a compile-time constant.
+ */
+#define INDEX_TEMPLATE_ARGUMENTS template <int KeySize, typename KeyComparator>
 /**
  * Both internal and leaf page are inherited from this page.
  *
  * It actually serves as a header part for each B+ tree page and
  * contains information shared by both leaf page and internal page.
  *
- * Header format (size in byte, 28 bytes in total):
+ * Header format (size in byte, 40 bytes in total):
  * ----------------------------------------------------------------------------
  * | PageType (4) | KeySize (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  * ----------------------------------------------------------------------------
- * | ParentPageId (4) | PageId(4) |
+ * | ParentPageId (4) | PageId(4) | FixedMaxSize (4) | PrefixSize (2) | SlotWidth (2) |
+ * ----------------------------------------------------------------------------
+ * | Compressed (4) |
  * ----------------------------------------------------------------------------
+ *
+ * Keys are stored as a prefix shared by the page followed by one slot per entry holding the next SlotWidth bytes
+ * of the key, the rest of a key being zero padding. An uncompressed page has no prefix and full width slots. A
+ * compressed page, only used for keys ordered by memcmp, picks the longest common prefix and the shortest slots
+ * of its keys, so it holds more entries as its keys are shorter or share more bytes. FixedMaxSize is the max size
+ * with full width slots: an insert below it never splits the page and the min size is half of it. MaxSize follows
+ * the layout of a compressed page, up to twice FixedMaxSize so that the two halves of a split both take any key.
  */
 class BPlusTreePage {
  public:
@@ -49,6 +66,20 @@ class BPlusTreePage {
 
   int GetMinSize() const;
 
+  int GetFixedMaxSize() const;
+
+  void SetFixedMaxSize(int max_size);
+
+  bool IsCompressed() const;
+
+  void SetCompressed(bool compressed);
+
+  int GetPrefixSize() const;
+
+  int GetSlotWidth() const;
+
+  void SetLayout(int prefix_size, int slot_width);
+
   page_id_t GetParentPageId() const;
 
   void SetParentPageId(page_id_t parent_page_id);
@@ -59,6 +90,19 @@ class BPlusTreePage {
 
   void SetLSN(lsn_t lsn = INVALID_LSN);
 
+  // bytes lhs and rhs have in common at their start, up to size
+  static int CommonPrefix(const char *lhs, const char *rhs, int size);
+
+  // bytes of key before its zero padding
+  static int KeyLength(const char *key, int key_size);
+
+  // the shortest key above left and not above right in memcmp order, zero padded to key_size
+  static void ShortestSeparator(const GenericKey *left, const GenericKey *right, int key_size, GenericKey *separator);
+
+  // index of the first of the size sorted int32 keys at keys that is not less than key, or greater than key if upper.
+  // The last INDEX_SIMD_SEARCH_WIDTH keys are compared at once with AVX2 or SSE2 when the CPU has them
+  static int SearchIntKeys(const char *keys, int size, int32_t key, bool upper);
+
  private:
   // member variable, attributes that both internal and leaf page share
   [[maybe_unused]] IndexPageType page_type_;
@@ -68,6 +112,10 @@ class BPlusTreePage {
   [[maybe_unused]] int max_size_;
   [[maybe_unused]] page_id_t parent_page_id_;
   [[maybe_unused]] page_id_t page_id_;
+  [[maybe_unused]] int fixed_max_size_;
+  [[maybe_unused]] uint16_t prefix_size_;
+  [[maybe_unused]] uint16_t slot_width_;
+  [[maybe_unused]] uint32_t compressed_;
 };
 
 #endif  // MINISQL_B_PLUS_TREE_PAGE_H
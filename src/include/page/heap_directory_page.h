@@ -0,0 +1,60 @@
+#ifndef MINISQL_HEAP_DIRECTORY_PAGE_H
+#define MINISQL_HEAP_DIRECTORY_PAGE_H
+
+/**
+ * Basic heap directory page format:
+ *  ---------------------------------------------------------
+ *  | HEADER | page_id1(4) | page_id2(4) | ... |
+ *  ---------------------------------------------------------
+ *
+ *  Header format (size in bytes):
+ *  ---------------------------------------------------------------
+ *  | PageId (4)| LSN (4) | NextPageId (4)| EntryCount(4) |
+ *  ---------------------------------------------------------------
+ *
+ *  Entries are the ids of the table pages in page chain order.
+ **/
+#include <cstring>
+
+#include "common/macros.h"
+#include "concurrency/txn.h"
+#include "page/page.h"
+#include "recovery/log_manager.h"
+
+class HeapDirectoryPage : public Page {
+ public:
+  void Init(page_id_t page_id, LogManager *log_mgr, Txn *txn);
+
+  /**
+   * Append a table page id to the end of this directory page.
+   * @return false if the directory page is full
+   */
+  bool Append(page_id_t page_id);
+
+  inline page_id_t GetNextPageId() { return *reinterpret_cast<page_id_t *>(GetData() + OFFSET_NEXT_PAGE_ID); }
+  inline void SetNextPageId(page_id_t next_page_id) {
+    memcpy(GetData() + OFFSET_NEXT_PAGE_ID, &next_page_id, sizeof(page_id_t));
+  }
+  inline uint32_t GetEntryCount() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_ENTRY_COUNT); }
+  inline void SetEntryCount(uint32_t entry_count) {
+    memcpy(GetData() + OFFSET_ENTRY_COUNT, &entry_count, sizeof(uint32_t));
+  }
+  inline page_id_t GetEntry(uint32_t index) {
+    return *reinterpret_cast<page_id_t *>(GetData() + SIZE_HEAP_DIRECTORY_PAGE_HEADER + SIZE_ENTRY * index);
+  }
+  inline void SetEntry(uint32_t index, page_id_t page_id) {
+    memcpy(GetData() + SIZE_HEAP_DIRECTORY_PAGE_HEADER + SIZE_ENTRY * index, &page_id, SIZE_ENTRY);
+  }
+
+ private:
+  static_assert(sizeof(page_id_t) == 4);
+  static constexpr size_t SIZE_HEAP_DIRECTORY_PAGE_HEADER = 16;
+  static constexpr size_t SIZE_ENTRY = sizeof(page_id_t);
+  static constexpr size_t OFFSET_NEXT_PAGE_ID = 8;
+  static constexpr size_t OFFSET_ENTRY_COUNT = 12;
+
+ public:
+  static constexpr size_t SIZE_MAX_ENTRY = (PAGE_SIZE - SIZE_HEAP_DIRECTORY_PAGE_HEADER) / SIZE_ENTRY;
+};
+
+#endif  // MINISQL_HEAP_DIRECTORY_PAGE_H
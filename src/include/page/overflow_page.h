@@ -0,0 +1,46 @@
+#ifndef MINISQL_OVERFLOW_PAGE_H
+#define MINISQL_OVERFLOW_PAGE_H
+
+/**
+ * Basic overflow page format:
+ *  ---------------------------------------------------------
+ *  | HEADER | ... DATA (DataSize) ... |
+ *  ---------------------------------------------------------
+ *
+ *  Header format (size in bytes):
+ *  ---------------------------------------------------------------
+ *  | PageId (4)| LSN (4) | NextPageId (4)| DataSize(4) |
+ *  ---------------------------------------------------------------
+ *
+ *  A CHAR value too long to be kept in its tuple is split over a chain of overflow pages.
+ **/
+#include <cstring>
+
+#include "common/macros.h"
+#include "concurrency/txn.h"
+#include "page/page.h"
+#include "recovery/log_manager.h"
+
+class OverflowPage : public Page {
+ public:
+  void Init(page_id_t page_id, LogManager *log_mgr, Txn *txn);
+
+  inline page_id_t GetNextPageId() { return *reinterpret_cast<page_id_t *>(GetData() + OFFSET_NEXT_PAGE_ID); }
+  inline void SetNextPageId(page_id_t next_page_id) {
+    memcpy(GetData() + OFFSET_NEXT_PAGE_ID, &next_page_id, sizeof(page_id_t));
+  }
+  inline uint32_t GetDataSize() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_DATA_SIZE); }
+  inline void SetDataSize(uint32_t data_size) { memcpy(GetData() + OFFSET_DATA_SIZE, &data_size, sizeof(uint32_t)); }
+  inline char *GetPayload() { return GetData() + SIZE_OVERFLOW_PAGE_HEADER; }
+
+ private:
+  static_assert(sizeof(page_id_t) == 4);
+  static constexpr size_t SIZE_OVERFLOW_PAGE_HEADER = 16;
+  static constexpr size_t OFFSET_NEXT_PAGE_ID = 8;
+  static constexpr size_t OFFSET_DATA_SIZE = 12;
+
+ public:
+  static constexpr size_t SIZE_MAX_DATA = PAGE_SIZE - SIZE_OVERFLOW_PAGE_HEADER;
+};
+
+#endif  // MINISQL_OVERFLOW_PAGE_H
@@ -1,6 +1,7 @@
 #ifndef MINISQL_PAGE_H
 #define MINISQL_PAGE_H
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
 #include <shared_mutex>
@@ -41,11 +42,24 @@ class Page {
   inline bool IsDirty() { return is_dirty_; }
   inline void SetDirty(){is_dirty_= true; }
   inline void ResetDirty(){is_dirty_ = false; }
-    /** Acquire the page write latch. */
-  inline void WLatch() { rwlatch_.WLock(); }
+    /** Acquire the page write latch, the version stays odd until it is released. */
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.fetch_add(1, std::memory_order_acq_rel);
+  }
 
   /** Release the page write latch. */
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
+  inline void WUnlatch() {
+    version_.fetch_add(1, std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
+
+  /**
+   * @return the version of the page content for optimistic readers, it changes on every write latch and is odd while
+   * a writer holds the latch. A reader that sees the same even version before and after reading the data has read a
+   * consistent page without latching it.
+   */
+  inline uint64_t GetVersion() const { return version_.load(std::memory_order_acquire); }
 
   /** Acquire the page read latch. */
   inline void RLatch() { rwlatch_.RLock(); }
@@ -81,8 +95,8 @@ class Page {
  private:
   /** Zeroes out the data that is held within the page. */
   inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }
-  /** The actual data that is stored within a page. */
-  char data_[PAGE_SIZE]{};
+  /** The actual data that is stored within a page, cache line aligned so that B+ tree pages can align their keys. */
+  alignas(CACHE_LINE_SIZE) char data_[PAGE_SIZE]{};
   /** The ID of this page. */
   page_id_t page_id_ = INVALID_PAGE_ID;
   /** The pin count of this page. */
@@ -91,6 +105,8 @@ class Page {
   bool is_dirty_ = false;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
+  /** Version for optimistic readers, never reset so that it only grows while the frame is reused. */
+  std::atomic<uint64_t> version_{0};
 };
 
 #endif  // MINISQL_PAGE_H
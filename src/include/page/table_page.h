@@ -15,6 +15,39 @@
  *  ----------------------------------------------------------------
  *  | TupleCount (4) | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
  *  ----------------------------------------------------------------
+ *
+ *  A tuple that outgrows its page on update moves to another page and leaves a forwarding record in its slot, so
+ *  its row id stays valid. Both are told apart from a serialized row by the magic number they start with:
+ *  --------------------------------------------        -------------------------------------------------------
+ *  | FORWARD_MAGIC (4) | Target RowId (8) |           | RELOCATED_MAGIC (4) | Home RowId (8) | Row ...      |
+ *  --------------------------------------------        -------------------------------------------------------
+ *  The relocated tuple keeps the row id it is reached by, scans report it under that id and skip the forwarding
+ *  record. Only row pages relocate tuples.
+ *
+ * PAX page format (tables created WITH (layout = pax)):
+ *  -------------------------------------------------------------------------------
+ *  | HEADER | SLOTS (capacity) | COLUMN_0 MINIPAGE | COLUMN_1 MINIPAGE | ...      |
+ *  -------------------------------------------------------------------------------
+ *  The slot array is sized for the page capacity up front and each column keeps its values contiguously in slot
+ *  order, INT/FLOAT take 4 bytes and CHAR takes 4 bytes of length plus the column length. A slot holds the null
+ *  bitmap of its tuple instead of an offset, and the largest serialized row of the schema as its size, so delete
+ *  marks, free space and vacuum work the same for both formats. Tuples never move. The free space pointer field
+ *  holds PAX_LAYOUT_FLAG | row size << 16 | capacity.
+ *
+ * Compressed PAX page format (tables created WITH (layout = compressed)):
+ *  ------------------------------------------------------------------------------------------------
+ *  | HEADER | SLOTS (capacity) | DIRECTORY | COLUMN_0 MINIPAGE | ... | CHAR COLUMN DICTIONARIES ... |
+ *  ------------------------------------------------------------------------------------------------
+ *  Directory format (size in bytes):
+ *  ---------------------------------------------------------------------------------------------
+ *  | Flags (4) | ColumnCount (4) | Column_0 state (4) | ... | Column_0 base (4) | ... |
+ *  ---------------------------------------------------------------------------------------------
+ *  An INT value is stored as its 2-byte difference to the base of its column in this page, which is the first
+ *  value inserted. A CHAR value is stored as a 1-byte code into a dictionary of PAX_DICTIONARY_SIZE values of its
+ *  column in this page, unless such a dictionary takes more than a quarter of the page. The column state is the
+ *  number of dictionary entries, or whether the base is set. A row whose values can not be encoded seals the page,
+ *  it takes no more inserts until it is empty again, then its dictionaries and bases are reset. The free space
+ *  pointer field holds PAX_ENCODED_FLAG in addition.
  **/
 
 #include <cstring>
@@ -25,12 +58,47 @@
 #include "concurrency/txn.h"
 #include "page/page.h"
 #include "record/row.h"
+#include "record/row_view.h"
 #include "recovery/log_manager.h"
 
+/**
+ * Storage layout of the pages of a table, row-major by default, kCompressed is PAX with encoded columns.
+ */
+enum class TableLayout : uint32_t { kRow = 0, kPax, kCompressed };
+
 class TablePage : public Page {
  public:
   void Init(page_id_t page_id, page_id_t prev_id, LogManager *log_mgr, Txn *txn);
 
+  /**
+   * Init a page in the PAX format, its minipages are laid out for schema.
+   * @param encoded Whether INT and CHAR columns are encoded, see the compressed PAX page format
+   */
+  void InitPax(page_id_t page_id, page_id_t prev_id, Schema *schema, LogManager *log_mgr, Txn *txn,
+               bool encoded = false);
+
+  /**
+   * @return the number of tuples a PAX page holds for schema, 0 if a tuple of the schema does not fit
+   */
+  static uint32_t GetPaxCapacity(Schema *schema, bool encoded = false);
+
+  /**
+   * @return whether row can be stored in a PAX page of schema, i.e. no CHAR value exceeds its column length
+   */
+  static bool FitsPaxLayout(const Row &row, Schema *schema);
+
+  bool IsPaxPage() { return (GetFreeSpacePointer() & PAX_LAYOUT_FLAG) != 0; }
+
+  bool IsEncodedPaxPage() { return IsPaxPage() && (GetFreeSpacePointer() & PAX_ENCODED_FLAG) != 0; }
+
+  /**
+   * Look value up in the dictionary of column column_id of this page. Views of tuples of this page hold value in
+   * that column iff their field data is *entry, so predicates can compare entries instead of values.
+   * @param entry Set to the dictionary entry of value, nullptr if no tuple of this page holds value
+   * @return false if the column is not dictionary encoded in this page
+   */
+  bool FindDictionaryEntry(Schema *schema, uint32_t column_id, const Field &value, const char **entry);
+
   page_id_t GetTablePageId() { return *reinterpret_cast<page_id_t *>(GetData()); }
 
   page_id_t GetPrevPageId() { return *reinterpret_cast<page_id_t *>(GetData() + OFFSET_PREV_PAGE_ID); }
@@ -54,10 +122,74 @@ class TablePage : public Page {
 
   void ApplyDelete(const RowId &rid, Txn *txn, LogManager *log_manager);
 
+  /**
+   * Replace the tuple in slot_num by a forwarding record to target, or point its forwarding record at target.
+   * The record is smaller than any tuple, so this only fails if the slot holds no live tuple.
+   */
+  bool SetForward(uint32_t slot_num, const RowId &target);
+
+  /**
+   * @param target Set to the row id the forwarding record in slot_num points at
+   * @return whether slot_num holds a forwarding record, marked deleted or not
+   */
+  bool GetForward(uint32_t slot_num, RowId *target);
+
+  /**
+   * Insert row as the relocated tuple of home_rid, the row id of the new tuple is wrapped in row.
+   */
+  bool InsertRelocatedTuple(Row &row, const RowId &home_rid, Schema *schema);
+
+  /**
+   * @param home_rid Set to the row id the relocated tuple in slot_num is reached by
+   * @return whether slot_num holds a relocated tuple
+   */
+  bool GetHomeRowId(uint32_t slot_num, RowId *home_rid);
+
+  /**
+   * Turn the relocated tuple in slot_num into an ordinary tuple reached by its own row id.
+   */
+  void ClearHomeRowId(uint32_t slot_num);
+
   void RollbackDelete(const RowId &rid, Txn *txn, LogManager *log_manager);
 
   bool GetTuple(Row *row, Schema *schema, Txn *txn, LockManager *lock_manager);
 
+  /**
+   * Read the tuple in the slot of row's id even if it is marked deleted, e.g. to release its external values.
+   * @return false if the slot is empty
+   */
+  bool GetTupleIgnoreMark(Row *row, Schema *schema);
+
+  /**
+   * Point view at the tuple in slot_num without copying it, the page must stay pinned while the view is used.
+   * @param toast_store Where the view reads external values from
+   * @return false if the slot holds no tuple
+   */
+  bool GetTupleView(uint32_t slot_num, Schema *schema, RowView *view, const ToastStore *toast_store = nullptr);
+
+  /**
+   * Decode every visible tuple from begin_slot on in one pass, views is cleared first and reused to avoid
+   * allocations. The page must stay pinned while the views are used.
+   * @return the number of visible tuples
+   */
+  uint32_t GetTupleViews(Schema *schema, std::vector<RowView> *views, uint32_t begin_slot = 0,
+                         const ToastStore *toast_store = nullptr);
+
+  /**
+   * @return whether view still points at the bytes of its tuple, i.e. the tuple is neither deleted nor moved
+   */
+  bool IsViewCurrent(const RowView &view) {
+    uint32_t slot_num = view.GetSlotNum();
+    if (slot_num >= GetTupleCount() || IsDeleted(GetTupleSize(slot_num))) {
+      return false;
+    }
+    // PAX元组不会移动，视图指向slot本身
+    if (IsPaxPage()) {
+      return GetData() + OFFSET_TUPLE_OFFSET + SIZE_TUPLE * slot_num == view.GetData();
+    }
+    return GetData() + GetRowOffsetAtSlot(slot_num) == view.GetData();
+  }
+
   bool GetFirstTupleRid(RowId *first_rid);
 
   bool GetNextTupleRid(const RowId &cur_rid, RowId *next_rid);
@@ -70,11 +202,25 @@ class TablePage : public Page {
       return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_TUPLE_SIZE + SIZE_TUPLE * slot_num);
     }
 
+    /**
+     * @return the largest tuple that can be inserted, counting the holes left by deleted tuples,
+     * which are reclaimed by compacting the page when the contiguous free space is too small
+     */
     uint32_t GetFreeSpace() {
-      //todo:return the max space of a consecutive block
-      return GetFreeSpacePointer() - SIZE_TABLE_PAGE_HEADER - SIZE_TUPLE * GetTupleCount() - SIZE_TUPLE;
+      if (IsPaxPage()) {
+        return GetPaxFreeSpace();
+      }
+      // 剩余空间不足一个slot时返回0，避免无符号数下溢
+      uint32_t remaining = GetFreeSpaceRemaining() + GetFragmentedSpace();
+      return remaining > SIZE_TUPLE ? remaining - SIZE_TUPLE : 0;
     }
 
+    /**
+     * Move all tuples to the end of the page so that the holes between them become contiguous free space.
+     * Slot numbers do not change, so row ids stay valid.
+     */
+    void Compact();
+
    private:
   uint32_t GetFreeSpacePointer() { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_FREE_SPACE); }
 
@@ -88,10 +234,103 @@ class TablePage : public Page {
     return GetFreeSpacePointer() - SIZE_TABLE_PAGE_HEADER - SIZE_TUPLE * GetTupleCount();
   }
 
+  // bytes between the free space pointer and the page end that no tuple occupies
+  uint32_t GetFragmentedSpace();
+
+  uint32_t GetPaxSlotCapacity() { return GetFreeSpacePointer() & 0xFFFF; }
+
+  uint32_t GetPaxRowSize() { return (GetFreeSpacePointer() & ~(PAX_LAYOUT_FLAG | PAX_ENCODED_FLAG)) >> 16; }
+
+  // every free slot counts as one largest row plus its slot entry
+  uint32_t GetPaxFreeSpace();
+
+  // start of the minipage of every column, and of the dictionary of every dictionary encoded column
+  void GetPaxColumnOffsets(Schema *schema, uint32_t *offsets, uint32_t *dictionaries = nullptr);
+
+  bool InsertPaxTuple(Row &row, Schema *schema);
+
+  bool UpdatePaxTuple(Row &new_row, Row *old_row, Schema *schema);
+
+  void ReadPaxTuple(uint32_t slot_num, Schema *schema, Row *row);
+
+  void WritePaxTuple(uint32_t slot_num, const Row &row, Schema *schema);
+
+  void ResetPaxView(uint32_t slot_num, Schema *schema, const uint32_t *offsets, const uint32_t *dictionaries,
+                    RowView *view);
+
+  static uint32_t GetPaxStride(const Column *column);
+
+  // bytes a value of column takes in its minipage of a compressed page
+  static uint32_t GetPaxEncodedStride(const Column *column);
+
+  static bool IsDictionaryColumn(const Column *column) {
+    return column->GetType() == TypeId::kTypeChar && GetPaxStride(column) * PAX_DICTIONARY_SIZE <= PAGE_SIZE / 4;
+  }
+
+  uint32_t GetPaxColumnStride(const Column *column) {
+    return IsEncodedPaxPage() ? GetPaxEncodedStride(column) : GetPaxStride(column);
+  }
+
+  char *GetPaxDirectory() { return GetData() + SIZE_TABLE_PAGE_HEADER + SIZE_TUPLE * GetPaxSlotCapacity(); }
+
+  uint32_t GetPaxColumnState(uint32_t column_id) {
+    return MACH_READ_UINT32(GetPaxDirectory() + SIZE_PAX_DIRECTORY_HEADER + sizeof(uint32_t) * column_id);
+  }
+
+  void SetPaxColumnState(uint32_t column_id, uint32_t state) {
+    MACH_WRITE_UINT32(GetPaxDirectory() + SIZE_PAX_DIRECTORY_HEADER + sizeof(uint32_t) * column_id, state);
+  }
+
+  // bases of the INT columns, indexed by column id
+  char *GetPaxColumnBases() {
+    char *directory = GetPaxDirectory();
+    return directory + SIZE_PAX_DIRECTORY_HEADER + sizeof(uint32_t) * MACH_READ_UINT32(directory + sizeof(uint32_t));
+  }
+
+  bool IsPaxPageSealed() { return (MACH_READ_UINT32(GetPaxDirectory()) & PAX_SEALED_FLAG) != 0; }
+
+  // clear the dictionaries, the bases and the seal of an empty compressed page
+  void ResetPaxDirectory();
+
+  /**
+   * @return whether the values of row can be encoded in this page without replacing any existing entry
+   */
+  bool CanEncodePaxTuple(const Row &row, Schema *schema);
+
+  // index of value in the dictionary of stride-byte entries, -1 if absent
+  static int32_t FindDictionaryCode(const char *dictionary, uint32_t count, uint32_t stride, const Field &value);
+
   uint32_t GetTupleOffsetAtSlot(uint32_t slot_num) {
     return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_TUPLE_OFFSET + SIZE_TUPLE * slot_num);
   }
 
+  // the magic number the tuple in a non-empty slot of a row page starts with
+  uint32_t GetTupleMagic(uint32_t slot_num) { return MACH_READ_UINT32(GetData() + GetTupleOffsetAtSlot(slot_num)); }
+
+  bool IsForward(uint32_t slot_num) {
+    return !IsPaxPage() && GetTupleSize(slot_num) != 0 && GetTupleMagic(slot_num) == FORWARD_MAGIC_NUM;
+  }
+
+  // offset of the serialized row in slot_num, past the home row id of a relocated tuple
+  uint32_t GetRowOffsetAtSlot(uint32_t slot_num) {
+    uint32_t tuple_offset = GetTupleOffsetAtSlot(slot_num);
+    return MACH_READ_UINT32(GetData() + tuple_offset) == RELOCATED_MAGIC_NUM ? tuple_offset + SIZE_RELOCATED_HEADER
+                                                                            : tuple_offset;
+  }
+
+  // point view at the row in slot_num of a row page, a relocated tuple is viewed under its home row id
+  void ResetRowView(uint32_t slot_num, Schema *schema, RowView *view, const ToastStore *toast_store);
+
+  // insert into a row page, the tuple starts with the home row id if home_rid is given
+  bool InsertRowTuple(Row &row, Schema *schema, const RowId *home_rid);
+
+  /**
+   * Resize the live tuple in slot_num to new_size bytes, the page is compacted if needed. The tuple stays aligned
+   * to its end, so its last bytes are kept, e.g. the row of a relocated tuple shrunk by its header.
+   * @return false if the page has no room for the tuple to grow
+   */
+  bool ResizeTuple(uint32_t slot_num, uint32_t new_size);
+
   void SetTupleOffsetAtSlot(uint32_t slot_num, uint32_t offset) {
     memcpy(GetData() + OFFSET_TUPLE_OFFSET + SIZE_TUPLE * slot_num, &offset, sizeof(uint32_t));
   }
@@ -115,9 +354,17 @@ class TablePage : public Page {
   static constexpr size_t OFFSET_TUPLE_COUNT = 20;
   static constexpr size_t OFFSET_TUPLE_OFFSET = 24;
   static constexpr size_t OFFSET_TUPLE_SIZE = 28;
+  static constexpr uint32_t PAX_LAYOUT_FLAG = 1U << 31;  // a row page never has its free space pointer this high
+  static constexpr uint32_t PAX_ENCODED_FLAG = 1U << 30;  // the row size of a PAX page is far below this
+  static constexpr uint32_t PAX_SEALED_FLAG = 1U;
+  static constexpr size_t SIZE_PAX_DIRECTORY_HEADER = 8;
+  static constexpr uint32_t FORWARD_MAGIC_NUM = 0x46574452;  // differs from the magic number of a row
+  static constexpr uint32_t RELOCATED_MAGIC_NUM = 0x524C4354;
+  static constexpr size_t SIZE_FORWARD = sizeof(uint32_t) + sizeof(int64_t);
 
  public:
   static constexpr size_t SIZE_MAX_ROW = PAGE_SIZE - SIZE_TABLE_PAGE_HEADER - SIZE_TUPLE;
+  static constexpr size_t SIZE_RELOCATED_HEADER = sizeof(uint32_t) + sizeof(int64_t);
 };
 
 #endif
\ No newline at end of file
@@ -8,56 +8,78 @@
 #include <utility>
 
 #include "abstract_expression.h"
+#include "column_value_expression.h"
+#include "constant_value_expression.h"
+#include "record/compare_kernel.h"
 #include "record/schema.h"
 
 /**
  * ComparisonExpression represents two expressions being compared.
+ * The comparison is resolved into a kernel for the operand type and operator when the plan is built.
  */
 class ComparisonExpression : public AbstractExpression {
  public:
   /** Creates a new comparison expression representing (left comp_type right). */
   ComparisonExpression(AbstractExpressionRef left, AbstractExpressionRef right, string comp_type)
       : AbstractExpression({std::move(left), std::move(right)}, TypeId::kTypeInt, ExpressionType::ComparisonExpression),
-        comp_type_{std::move(comp_type)} {}
+        comp_type_{std::move(comp_type)},
+        op_{CompareKernels::ParseOp(comp_type_)} {
+    TypeId type_id = GetChildAt(0)->GetReturnType();
+    if (op_ != CompareOp::kIsNull && op_ != CompareOp::kIsNotNull && type_id != GetChildAt(1)->GetReturnType()) {
+      throw std::logic_error("Not comparable.");
+    }
+    kernel_ = CompareKernels::Get(type_id, op_);
+    if (kernel_ == nullptr) {
+      throw std::logic_error("Unsupported comparison type");
+    }
+    // "列 op 常量"时直接取列值和常量比较，省去每行的虚调用和字段复制
+    if (GetChildAt(0)->GetType() == ExpressionType::ColumnExpression &&
+        GetChildAt(1)->GetType() == ExpressionType::ConstantExpression) {
+      auto column = dynamic_cast<ColumnValueExpression *>(GetChildAt(0).get());
+      if (column->GetRowIdx() == 0) {
+        col_idx_ = column->GetColIdx();
+        constant_ = &dynamic_cast<ConstantValueExpression *>(GetChildAt(1).get())->val_;
+      }
+    }
+  }
 
   /** e.g. evaluate the result of id = 1 */
   Field Evaluate(const Row *row) const override {
+    if (constant_ != nullptr) {
+      return CompareKernels::ToField(kernel_(*row->GetField(col_idx_), *constant_));
+    }
     Field lhs = GetChildAt(0)->Evaluate(row);
     Field rhs = GetChildAt(1)->Evaluate(row);
-    return Field(kTypeInt, PerformComparison(lhs, rhs));
+    return CompareKernels::ToField(kernel_(lhs, rhs));
+  }
+
+  Field EvaluateView(const RowView *row) const override {
+    if (constant_ != nullptr) {
+      return CompareKernels::ToField(kernel_(row->GetField(col_idx_), *constant_));
+    }
+    Field lhs = GetChildAt(0)->EvaluateView(row);
+    Field rhs = GetChildAt(1)->EvaluateView(row);
+    return CompareKernels::ToField(kernel_(lhs, rhs));
   }
 
   Field EvaluateJoin(const Row *left_row, const Row *right_row) const override {
     Field lhs = GetChildAt(0)->EvaluateJoin(left_row, right_row);
     Field rhs = GetChildAt(1)->EvaluateJoin(left_row, right_row);
-    return Field(kTypeInt, PerformComparison(lhs, rhs));
+    return CompareKernels::ToField(kernel_(lhs, rhs));
   }
 
   std::string GetComparisonType() { return comp_type_; }
 
- private:
-  CmpBool PerformComparison(const Field &lhs, const Field &rhs) const {
-    if (comp_type_ == "=")
-      return lhs.CompareEquals(rhs);
-    else if (comp_type_ == "<>")
-      return lhs.CompareNotEquals(rhs);
-    else if (comp_type_ == "<")
-      return lhs.CompareLessThan(rhs);
-    else if (comp_type_ == "<=")
-      return lhs.CompareLessThanEquals(rhs);
-    else if (comp_type_ == ">")
-      return lhs.CompareGreaterThan(rhs);
-    else if (comp_type_ == ">=")
-      return lhs.CompareGreaterThanEquals(rhs);
-    else if (comp_type_ == "is")
-      return GetCmpBool(lhs.IsNull());
-    else if (comp_type_ == "not")
-      return GetCmpBool(!lhs.IsNull());
-    else
-      throw std::logic_error("Unsupported comparison type");
-  }
+  CompareOp GetCompareOp() const { return op_; }
 
+ private:
   std::string comp_type_;
+  CompareOp op_;
+  /** comparison specialized for the operand type and op_ */
+  CompareKernel kernel_{nullptr};
+  /** set when the left side is a column of the input row and the right side a constant */
+  uint32_t col_idx_{0};
+  const Field *constant_{nullptr};
 };
 
 #endif  // MINISQL_COMPARISON_EXPRESSION_H
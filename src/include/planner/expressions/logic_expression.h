@@ -6,6 +6,7 @@
 #define MINISQL_LOGIC_EXPRESSION_H
 
 #include "abstract_expression.h"
+#include "record/compare_kernel.h"
 
 /** ArithmeticType represents the type of logic operation that we want to perform. */
 enum class LogicType { And, Or };
@@ -28,13 +29,19 @@ class LogicExpression : public AbstractExpression {
   Field Evaluate(const Row *row) const override {
     Field lhs = GetChildAt(0)->Evaluate(row);
     Field rhs = GetChildAt(1)->Evaluate(row);
-    return Field(kTypeInt, PerformComputation(lhs, rhs));
+    return CompareKernels::ToField(PerformComputation(lhs, rhs));
+  }
+
+  Field EvaluateView(const RowView *row) const override {
+    Field lhs = GetChildAt(0)->EvaluateView(row);
+    Field rhs = GetChildAt(1)->EvaluateView(row);
+    return CompareKernels::ToField(PerformComputation(lhs, rhs));
   }
 
   Field EvaluateJoin(const Row *left_row, const Row *right_row) const override {
     Field lhs = GetChildAt(0)->EvaluateJoin(left_row, right_row);
     Field rhs = GetChildAt(1)->EvaluateJoin(left_row, right_row);
-    return Field(kTypeInt, PerformComputation(lhs, rhs));
+    return CompareKernels::ToField(PerformComputation(lhs, rhs));
   }
 
   static LogicType Char2Type(char *val) {
@@ -49,19 +56,9 @@ class LogicExpression : public AbstractExpression {
   LogicType logic_type_;
 
  private:
-  CmpBool GetFieldAsCmpBool(const Field &val) const {
-    if (val.IsNull()) {
-      return CmpBool::kNull;
-    }
-    if (val.CompareEquals(Field(kTypeInt, 1))) {
-      return CmpBool::kTrue;
-    }
-    return CmpBool::kFalse;
-  }
-
   CmpBool PerformComputation(const Field &lhs, const Field &rhs) const {
-    auto l = GetFieldAsCmpBool(lhs);
-    auto r = GetFieldAsCmpBool(rhs);
+    auto l = CompareKernels::ToCmpBool(lhs);
+    auto r = CompareKernels::ToCmpBool(rhs);
     switch (logic_type_) {
       case LogicType::And:
         if (l == CmpBool::kFalse || r == CmpBool::kFalse) {
@@ -0,0 +1,98 @@
+#ifndef MINISQL_COMPARE_KERNEL_H
+#define MINISQL_COMPARE_KERNEL_H
+
+#include <functional>
+#include <string>
+
+#include "record/field.h"
+
+/**
+ * Comparison operators of a predicate, parsed from "=", "<>", "<", "<=", ">", ">=", "is", "not".
+ */
+enum class CompareOp { kEqual = 0, kNotEqual, kLessThan, kLessThanEquals, kGreaterThan, kGreaterThanEquals, kIsNull, kIsNotNull };
+
+/**
+ * A comparison specialized for one type and one operator, NULL on either side gives kNull.
+ */
+using CompareKernel = CmpBool (*)(const Field &lhs, const Field &rhs);
+
+/**
+ * Type- and operator-specialized comparisons, picked once when a plan is built so that evaluating a predicate
+ * on a row is a direct compare of int, float or bytes instead of a string match plus a virtual Type call.
+ */
+class CompareKernels {
+ public:
+  /**
+   * @throw std::logic_error if comp_type is not a comparison operator
+   */
+  static CompareOp ParseOp(const std::string &comp_type);
+
+  /**
+   * @return the kernel comparing two fields of type_id with op
+   */
+  static CompareKernel Get(TypeId type_id, CompareOp op);
+
+  /**
+   * @return whether a boolean field, as produced by comparison and logic expressions, holds true
+   */
+  inline static bool IsTrue(const Field &val) { return !val.is_null_ && val.value_.integer_ != 0; }
+
+  /**
+   * @return the boolean field of a comparison result, kNull gives a NULL field
+   */
+  inline static Field ToField(CmpBool result) {
+    return result == CmpBool::kNull ? Field(TypeId::kTypeInt) : Field(TypeId::kTypeInt, static_cast<int32_t>(result));
+  }
+
+  /**
+   * @return kNull if val is NULL, otherwise whether val holds true
+   */
+  inline static CmpBool ToCmpBool(const Field &val) {
+    return val.is_null_ ? CmpBool::kNull : GetCmpBool(val.value_.integer_ != 0);
+  }
+
+ private:
+  template <template <typename> class Cmp>
+  static CmpBool CompareInt(const Field &lhs, const Field &rhs) {
+    if (lhs.is_null_ || rhs.is_null_) {
+      return CmpBool::kNull;
+    }
+    return GetCmpBool(Cmp<int32_t>()(lhs.value_.integer_, rhs.value_.integer_));
+  }
+
+  template <template <typename> class Cmp>
+  static CmpBool CompareFloat(const Field &lhs, const Field &rhs) {
+    if (lhs.is_null_ || rhs.is_null_) {
+      return CmpBool::kNull;
+    }
+    return GetCmpBool(Cmp<float>()(lhs.value_.float_, rhs.value_.float_));
+  }
+
+  template <template <typename> class Cmp>
+  static CmpBool CompareChar(const Field &lhs, const Field &rhs) {
+    if (lhs.is_null_ || rhs.is_null_) {
+      return CmpBool::kNull;
+    }
+    return GetCmpBool(Cmp<int>()(CompareStrings(lhs.value_.chars_, lhs.len_, rhs.value_.chars_, rhs.len_), 0));
+  }
+
+  static CmpBool IsNull(const Field &lhs, const Field &) { return GetCmpBool(lhs.is_null_); }
+
+  static CmpBool IsNotNull(const Field &lhs, const Field &) { return GetCmpBool(!lhs.is_null_); }
+
+  template <template <typename> class Cmp>
+  static CompareKernel GetForType(TypeId type_id) {
+    switch (type_id) {
+      case TypeId::kTypeInt:
+        return &CompareInt<Cmp>;
+      case TypeId::kTypeFloat:
+        return &CompareFloat<Cmp>;
+      case TypeId::kTypeChar:
+        return &CompareChar<Cmp>;
+      default:
+        return nullptr;
+    }
+  }
+};
+
+#endif  // MINISQL_COMPARE_KERNEL_H
@@ -4,6 +4,7 @@
 #include <cstring>
 #include <string>
 
+#include "common/arena.h"
 #include "common/config.h"
 #include "common/macros.h"
 #include "record/type_id.h"
@@ -18,6 +19,14 @@ class Field {
 
   friend class TypeFloat;
 
+  friend class ZoneMap;
+
+  friend class TablePage;
+
+  friend class CompareKernels;
+
+  friend class KeyManager;
+
  public:
   explicit Field(const TypeId type) : type_id_(type), len_(FIELD_NULL_LEN), is_null_(true) {}
 
@@ -61,6 +70,13 @@ class Field {
     }
   }
 
+  // char, the value is copied into arena and lives as long as it
+  explicit Field(TypeId type, const char *data, uint32_t len, Arena *arena) : type_id_(type), len_(len) {
+    ASSERT(type == TypeId::kTypeChar && data != nullptr, "Invalid type.");
+    value_.chars_ = arena->Allocate(len);
+    memcpy(value_.chars_, data, len);
+  }
+
   // copy constructor
   explicit Field(const Field &other) {
     type_id_ = other.type_id_;
@@ -75,12 +91,27 @@ class Field {
     }
   }
 
+  // move constructor, other keeps its value but no longer owns it
+  Field(Field &&other) noexcept
+      : value_(other.value_),
+        type_id_(other.type_id_),
+        len_(other.len_),
+        is_null_(other.is_null_),
+        manage_data_(other.manage_data_) {
+    other.manage_data_ = false;
+  }
+
   // copy
   Field &operator=(Field &other) {
     Swap(*this, other);
     return *this;
   }
 
+  Field &operator=(Field &&other) noexcept {
+    Swap(*this, other);
+    return *this;
+  }
+
   inline bool IsNull() const { return is_null_; }
 
   inline uint32_t GetLength() const { return Type::GetInstance(type_id_)->GetLength(*this); }
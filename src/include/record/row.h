@@ -1,6 +1,7 @@
 #ifndef MINISQL_ROW_H
 #define MINISQL_ROW_H
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -10,16 +11,27 @@
 #include "record/schema.h"
 
 /**
- *  Row format:
- * -------------------------------------------
- * | Header | Field-1 | ... | Field-N |
+ *  Row format (v2):
+ * --------------------------------------------------------------------------
+ * | Header | Fixed-width values | CHAR offset table | CHAR values |
+ * --------------------------------------------------------------------------
+ *  Header format, padded to 4 bytes:
+ * --------------------------------------------------------------------------
+ * | Magic Num | Version (1 byte) | Field Nums (2 bytes) | Null bitmap (1 bit per field) |
+ * --------------------------------------------------------------------------
+ *  INT and FLOAT values sit at offsets fixed by the schema, NULL ones included, so any field is located in O(1)
+ *  (see Schema::GetRowOffset). The offset table holds for every CHAR column where its value ends, relative to the
+ *  start of the row, the value starts where the one of the previous CHAR column ends.
+ *
+ *  Rows of format v1, written before the version byte existed, are still read:
  * -------------------------------------------
- *  Header format:
- * --------------------------------------------
- * | Field Nums | Null bitmap |
+ * | Magic Num | Field Nums | Null bitmap (32 bits) | Field-1 | ... | Field-N |
  * -------------------------------------------
+ *  with every CHAR value prefixed by its length. The version byte overlaps the low byte of Field Nums there,
+ *  which is at most 32, hence ROW_FORMAT_V2 is above that.
  *
- *
+ *  In memory the fields are kept in one array, INT and FLOAT values inline. A CHAR value is owned by its field
+ *  unless it was copied into an arena, which then has to outlive the row.
  */
 class Row {
  public:
@@ -29,21 +41,23 @@ class Row {
    */
   Row(std::vector<Field> &fields) {
     // deep copy
+    fields_.reserve(fields.size());
     for (auto &field : fields) {
-      fields_.push_back(new Field(field));
+      fields_.emplace_back(field);
     }
   }
 
+  /**
+   * Row that takes the fields over without copying them
+   */
+  explicit Row(std::vector<Field> &&fields) : fields_(std::move(fields)) {}
+
   void destroy() {
-    if (!fields_.empty()) {
-      for (auto field : fields_) {
-        delete field;
-      }
-      fields_.clear();
-    }
+    fields_.clear();
+    external_.clear();
   }
 
-  ~Row() { destroy(); };
+  ~Row() = default;
 
   /**
    * Row used for deserialize
@@ -58,22 +72,45 @@ class Row {
   /**
    * Row copy function, deep copy
    */
-  Row(const Row &other) {
-    destroy();
-    rid_ = other.rid_;
+  Row(const Row &other) : rid_(other.rid_), external_(other.external_) {
+    fields_.reserve(other.fields_.size());
     for (auto &field : other.fields_) {
-      fields_.push_back(new Field(*field));
+      fields_.emplace_back(field);
     }
   }
 
+  /**
+   * Move constructor, other is left empty
+   */
+  Row(Row &&other) noexcept
+      : rid_(other.rid_), fields_(std::move(other.fields_)), external_(std::move(other.external_)) {
+    other.fields_.clear();
+    other.external_.clear();
+  }
+
   /**
    * Assign operator, deep copy
    */
   Row &operator=(const Row &other) {
-    destroy();
-    rid_ = other.rid_;
-    for (auto &field : other.fields_) {
-      fields_.push_back(new Field(*field));
+    if (this != &other) {
+      destroy();
+      rid_ = other.rid_;
+      external_ = other.external_;
+      fields_.reserve(other.fields_.size());
+      for (auto &field : other.fields_) {
+        fields_.emplace_back(field);
+      }
+    }
+    return *this;
+  }
+
+  Row &operator=(Row &&other) noexcept {
+    if (this != &other) {
+      rid_ = other.rid_;
+      fields_ = std::move(other.fields_);
+      external_ = std::move(other.external_);
+      other.fields_.clear();
+      other.external_.clear();
     }
     return *this;
   }
@@ -86,31 +123,70 @@ class Row {
   uint32_t DeserializeFrom(char *buf, Schema *schema);
 
   /**
-   * For empty row, return 0
-   * For non-empty row with null fields, eg: |null|null|null|, return header size only
+   * A row whose fields are all NULL, eg: |null|null|null|, still takes the header, the fixed-width values and the
+   * CHAR offset table (Schema::GetRowVarDataOffset)
    * @return
    */
   uint32_t GetSerializedSize(Schema *schema) const;
 
   void GetKeyFromRow(const Schema *schema, const Schema *key_schema, Row &key_row);
 
+  /**
+   * Copy the CHAR values into arena, the row then stays valid as long as the arena does, whatever storage the
+   * values were in before.
+   */
+  void CopyCharsInto(Arena *arena);
+
   inline const RowId GetRowId() const { return rid_; }
 
   inline void SetRowId(RowId rid) { rid_ = rid; }
 
-  inline std::vector<Field *> &GetFields() { return fields_; }
+  inline std::vector<Field> &GetFields() { return fields_; }
 
   inline Field *GetField(uint32_t idx) const {
     ASSERT(idx < fields_.size(), "Failed to access field");
-    return fields_[idx];
+    return const_cast<Field *>(&fields_[idx]);
   }
 
   inline size_t GetFieldCount() const { return fields_.size(); }
 
+  /**
+   * @return whether the idx-th field is a pointer to a value kept in overflow pages instead of the value,
+   * the field then holds the first overflow page id and the value length (see ToastStore)
+   */
+  inline bool IsExternal(uint32_t idx) const { return idx < external_.size() && external_[idx]; }
+
+  inline bool HasExternal() const { return std::find(external_.begin(), external_.end(), true) != external_.end(); }
+
+  inline void SetExternal(uint32_t idx, bool external) {
+    if (idx >= external_.size()) {
+      if (!external) {
+        return;
+      }
+      external_.resize(idx + 1, false);
+    }
+    external_[idx] = external;
+  }
+
+  /**
+   * @return whether the serialized row at buf is of format v2, otherwise it is of format v1
+   */
+  inline static bool IsFormatV2(const char *buf) { return MACH_READ_FROM(uint8_t, buf + sizeof(uint32_t)) == ROW_FORMAT_V2; }
+
+  // set in the CHAR offset table entry (v2) or the length (v1) of a field that is a pointer to an overflow value
+  static constexpr uint32_t EXTERNAL_FLAG = 1u << 31;
+  static constexpr uint32_t SIZE_EXTERNAL_POINTER = sizeof(page_id_t) + sizeof(uint32_t);
+  static constexpr uint8_t ROW_FORMAT_V2 = 0x82;
+  // a row of format v1 has no more fields than its 32-bit null bitmap
+  static constexpr uint32_t MAX_FIELD_COUNT_V1 = 32;
+
  private:
+  uint32_t DeserializeFromV1(char *buf, Schema *schema);
+
     static const uint32_t ROW_MAGIC_NUM = 0x12345678;
     RowId rid_{};
-  std::vector<Field *> fields_; /** Make sure that all field ptr are destructed*/
+  std::vector<Field> fields_; /** Stored contiguously, CHAR values may live in an arena (see RowView::ToRow) */
+  std::vector<bool> external_; /** empty unless a field was moved to overflow pages */
 };
 
 #endif  // MINISQL_ROW_H
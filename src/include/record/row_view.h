@@ -0,0 +1,152 @@
+#ifndef MINISQL_ROW_VIEW_H
+#define MINISQL_ROW_VIEW_H
+
+#include <vector>
+
+#include "common/macros.h"
+#include "common/rowid.h"
+#include "record/field.h"
+#include "record/row.h"
+#include "record/schema.h"
+
+class ToastStore;
+
+/**
+ * Non-owning view of a serialized row (see the Row format), e.g. a tuple in a pinned TablePage, or of a tuple
+ * spread over the column minipages of a PAX page.
+ * Fields are read straight from the bytes, CHAR fields point into them instead of being copied.
+ * A view is only valid while the bytes it points to are pinned and unchanged, use ToRow to keep a row longer.
+ */
+class RowView {
+ public:
+  static constexpr uint32_t MAX_FIELD_COUNT = 32;  // of a row of format v1 or a PAX page, limited by the null bitmap
+
+  RowView() = default;
+
+  /**
+   * Point the view at the serialized row at data. A row of format v2 is not parsed, fields are found at the offsets
+   * of the schema, for a row of format v1 the offsets of all fields are computed once here.
+   * @param toast_store Where values moved out of the row are read from when their field is accessed
+   */
+  void Reset(const char *data, Schema *schema, RowId rid, const ToastStore *toast_store = nullptr);
+
+  /**
+   * Point the view at a tuple whose fields are stored apart, fields[i] points at the serialized value of column i.
+   * Nothing is decoded here. data only identifies the tuple, the serialized size of such a view is 0.
+   * @param packed_bitmap INT fields stored as a 2-byte difference to the 4-byte base at bases + 4 * i
+   */
+  void Reset(const char *data, Schema *schema, RowId rid, uint32_t null_bitmap, const char *const *fields,
+             uint32_t packed_bitmap = 0, const char *bases = nullptr);
+
+  inline bool IsValid() const { return data_ != nullptr; }
+
+  inline const RowId GetRowId() const { return rid_; }
+
+  /**
+   * Report the viewed tuple under rid, e.g. the row id a relocated tuple is reached by. GetSlotNum is unchanged.
+   */
+  inline void SetRowId(const RowId &rid) { rid_ = rid; }
+
+  /**
+   * @return the slot of the viewed tuple in its page, set by Reset
+   */
+  inline uint32_t GetSlotNum() const { return slot_num_; }
+
+  inline uint32_t GetFieldCount() const { return field_count_; }
+
+  inline bool IsNull(uint32_t idx) const {
+    if (null_bytes_ != nullptr) {
+      return (null_bytes_[idx / 8] & (1u << (idx % 8))) != 0;
+    }
+    return (null_bitmap_ & (1u << idx)) != 0;
+  }
+
+  /**
+   * @return whether the value of the idx-th field is kept in overflow pages, reading it costs page accesses
+   */
+  inline bool IsExternal(uint32_t idx) const {
+    if (null_bytes_ != nullptr) {
+      return schema_->GetColumn(idx)->GetType() == TypeId::kTypeChar &&
+             (MACH_READ_UINT32(data_ + schema_->GetRowOffset(idx)) & Row::EXTERNAL_FLAG) != 0;
+    }
+    return (external_bitmap_ & (1u << idx)) != 0;
+  }
+
+  inline uint32_t GetSerializedSize() const { return size_; }
+
+  /**
+   * @return where the value of the idx-th field is read from, e.g. its entry in the dictionary of a compressed page
+   */
+  inline const char *GetFieldData(uint32_t idx) const {
+    return null_bytes_ != nullptr ? data_ + schema_->GetRowOffset(idx) : fields_[idx];
+  }
+
+  inline const char *GetData() const { return data_; }
+
+  /**
+   * @return the idx-th field, a CHAR field points into the viewed bytes unless its value is external
+   */
+  Field GetField(uint32_t idx) const;
+
+  /**
+   * Materialize all fields into row, the row owns its data afterwards.
+   * @param arena If given, CHAR values are copied into it instead of buffers of their own, row must not outlive it
+   */
+  void ToRow(Row *row, Arena *arena = nullptr) const;
+
+  /**
+   * Materialize the given columns into row, e.g. the projection of a scan or the key of an index.
+   * @param copy_data If false, CHAR fields of row point into the viewed bytes and row must not outlive the view
+   * @param arena Where copied CHAR values go, see above
+   */
+  void ToRow(const std::vector<uint32_t> &column_ids, Row *row, bool copy_data = true, Arena *arena = nullptr) const;
+
+ private:
+  void AppendField(uint32_t idx, bool copy_data, Arena *arena, std::vector<Field> *fields) const;
+
+  inline int32_t ReadInt(uint32_t idx) const {
+    if ((packed_bitmap_ & (1u << idx)) != 0) {
+      return MACH_READ_INT32(bases_ + sizeof(int32_t) * idx) + MACH_READ_FROM(int16_t, fields_[idx]);
+    }
+    return MACH_READ_INT32(GetFieldData(idx));
+  }
+
+  // bytes of a CHAR value, len is SIZE_EXTERNAL_POINTER for an external one
+  inline const char *GetCharData(uint32_t idx, uint32_t *len) const {
+    if (null_bytes_ == nullptr) {
+      *len = MACH_READ_UINT32(fields_[idx]);
+      if (*len & Row::EXTERNAL_FLAG) {
+        *len = Row::SIZE_EXTERNAL_POINTER;
+      }
+      return fields_[idx] + sizeof(uint32_t);
+    }
+    // 值从前一个CHAR列的结尾开始
+    uint32_t offset = schema_->GetRowOffset(idx);
+    uint32_t start = offset == schema_->GetRowVarTableOffset()
+                         ? schema_->GetRowVarDataOffset()
+                         : MACH_READ_UINT32(data_ + offset - sizeof(uint32_t)) & ~Row::EXTERNAL_FLAG;
+    *len = (MACH_READ_UINT32(data_ + offset) & ~Row::EXTERNAL_FLAG) - start;
+    return data_ + start;
+  }
+
+  // read an external value into a new buffer owned by the caller
+  char *FetchExternal(uint32_t idx, uint32_t *len) const;
+
+  static constexpr uint32_t SIZE_ROW_HEADER = sizeof(uint32_t) * 3;
+
+  const char *data_{nullptr};
+  Schema *schema_{nullptr};
+  RowId rid_{};
+  uint32_t slot_num_{0};
+  uint32_t field_count_{0};
+  const uint8_t *null_bytes_{nullptr};  // null bitmap of a row of format v2, such a row has no fields_
+  uint32_t null_bitmap_{0};
+  uint32_t external_bitmap_{0};
+  const ToastStore *toast_store_{nullptr};
+  uint32_t size_{0};
+  uint32_t packed_bitmap_{0};
+  const char *bases_{nullptr};
+  const char *fields_[MAX_FIELD_COUNT]{};
+};
+
+#endif  // MINISQL_ROW_VIEW_H
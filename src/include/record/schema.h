@@ -13,7 +13,9 @@
 class Schema {
  public:
   explicit Schema(const std::vector<Column *> columns, bool is_manage_ = true)
-      : columns_(std::move(columns)), is_manage_(is_manage_) {}
+      : columns_(std::move(columns)), is_manage_(is_manage_) {
+    InitRowLayout();
+  }
 
   ~Schema() {
     if (is_manage_) {
@@ -39,6 +41,28 @@ class Schema {
 
   inline uint32_t GetColumnCount() const { return static_cast<uint32_t>(columns_.size()); }
 
+  /**
+   * Layout of a serialized row of this schema (see Row), computed once so that a field is found without parsing
+   * the fields before it.
+   * @return offset of the value of a fixed-width column, or of the offset table entry of a CHAR column
+   */
+  inline uint32_t GetRowOffset(uint32_t column_index) const { return row_offsets_[column_index]; }
+
+  /**
+   * @return size of the row header, the fixed-width values start here
+   */
+  inline uint32_t GetRowHeaderSize() const { return row_header_size_; }
+
+  /**
+   * @return offset of the offset table of the CHAR columns
+   */
+  inline uint32_t GetRowVarTableOffset() const { return row_var_table_offset_; }
+
+  /**
+   * @return offset of the first CHAR value, i.e. the size of a row without CHAR values
+   */
+  inline uint32_t GetRowVarDataOffset() const { return row_var_data_offset_; }
+
   /**
    * Shallow copy schema, only used in index
    *
@@ -81,9 +105,15 @@ class Schema {
   static uint32_t DeserializeFrom(char *buf, Schema *&schema);
 
  private:
+  void InitRowLayout();
+
   static constexpr uint32_t SCHEMA_MAGIC_NUM = 200715;
   std::vector<Column *> columns_;
   bool is_manage_ = false; /** if false, don't need to delete pointer to column */
+  std::vector<uint32_t> row_offsets_;
+  uint32_t row_header_size_{0};
+  uint32_t row_var_table_offset_{0};
+  uint32_t row_var_data_offset_{0};
 };
 
 using IndexSchema = Schema;
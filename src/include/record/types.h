@@ -1,8 +1,11 @@
 #ifndef MINISQL_TYPES_H
 #define MINISQL_TYPES_H
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <exception>
 
 #include "common/config.h"
@@ -16,6 +19,21 @@ inline CmpBool GetCmpBool(bool boolean) {
   return boolean ? CmpBool::kTrue : CmpBool::kFalse;
 }
 
+/**
+ * @return <0, 0 or >0 like memcmp, a string sorts before the longer strings it is a prefix of
+ */
+inline int CompareStrings(const char *str1, int len1, const char *str2, int len2) {
+  assert(str1 != nullptr);
+  assert(len1 >= 0);
+  assert(str2 != nullptr);
+  assert(len2 >= 0);
+  int ret = memcmp(str1, str2, static_cast<size_t>(std::min(len1, len2)));
+  if (ret == 0 && len1 != len2) {
+    ret = len1 - len2;
+  }
+  return ret;
+}
+
 class Type {
  public:
   explicit Type(TypeId type_id) : type_id_(type_id) {}
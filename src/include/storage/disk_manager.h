@@ -6,6 +6,7 @@
 #include <iostream>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "common/config.h"
 #include "common/macros.h"
@@ -53,6 +54,11 @@ class DiskManager {
    */
   void DeAllocatePage(page_id_t logical_page_id);
 
+  /**
+   * Free all the given pages, every bitmap page involved is read and written once.
+   */
+  void DeAllocatePages(std::vector<page_id_t> logical_page_ids);
+
   /**
    * Return whether specific logical_page_id is free
    */
@@ -3,6 +3,9 @@
 //
 // Created by cactus on 6/11/24.
 //
+#include <unordered_set>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
 #include "page/header_page.h"
@@ -18,6 +21,23 @@ class FreeSpaceMap{
   page_id_t GetBegin(uint32_t need_space);
   page_id_t GetNext(uint32_t need_space);
   page_id_t SetFreeSpace(page_id_t page_id,uint32_t free_space);
+  // forget a page that was removed from the table, the last pair takes its place
+  bool RemovePair(page_id_t page_id);
+
+  /**
+   * Claim a page with at least need_space free bytes that is not claimed yet, so that concurrent
+   * inserting sessions are handed different pages.
+   * @return the claimed page id, INVALID_PAGE_ID if no unclaimed page has enough space
+   */
+  page_id_t Claim(uint32_t need_space);
+  // claim a page directly, e.g. a page just appended by the caller
+  inline void ClaimPage(page_id_t page_id) { claimed_pages_.insert(page_id); }
+  // give a claimed page back to other sessions
+  inline void Release(page_id_t page_id) { claimed_pages_.erase(page_id); }
+  // empty the map, its pages after the first one are appended to freed_page_ids for the caller to delete
+  void Reset(std::vector<page_id_t> *freed_page_ids);
+  // collect the ids of all pages of the map
+  void GetMapPageIds(std::vector<page_id_t> *map_page_ids);
   inline page_id_t GetFirstPageId(){ return first_page_id; }
   inline page_id_t GetLastPageId(){ return last_page_id; }
 
@@ -42,5 +62,8 @@ class FreeSpaceMap{
   //iterator
   freespace_map_id_t internal_index;
   page_id_t page_index;
+
+  //pages currently used as insert target by some session
+  std::unordered_set<page_id_t> claimed_pages_;
 };
 #endif  // MINISQL_FREESPACE_MAP_H
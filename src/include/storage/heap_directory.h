@@ -0,0 +1,65 @@
+#ifndef MINISQL_HEAP_DIRECTORY_H
+#define MINISQL_HEAP_DIRECTORY_H
+
+#include <unordered_set>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "page/heap_directory_page.h"
+
+/**
+ * Persistent list of the page ids of a table heap, in page chain order. It is stored in a chain of
+ * HeapDirectoryPage like the freespace map, and every directory page except the last one is full, so the
+ * i-th table page is found with one directory page access.
+ * Not thread safe, the owning TableHeap serializes access with its latch.
+ */
+class HeapDirectory {
+ public:
+  /**
+   * Create a new directory if first_page_id is INVALID_PAGE_ID, otherwise load the existing one.
+   */
+  HeapDirectory(page_id_t first_page_id, BufferPoolManager *buffer_pool_manager);
+
+  /**
+   * Append a table page id to the end of the directory.
+   */
+  bool Append(page_id_t page_id);
+
+  /**
+   * Remove the given table page ids, the remaining ones keep their order. Empty directory pages at the end
+   * of the chain are deleted.
+   */
+  bool RemovePages(const std::unordered_set<page_id_t> &page_ids);
+
+  /**
+   * @return the id of the index-th table page, INVALID_PAGE_ID if index is out of range
+   */
+  page_id_t GetPageId(uint32_t index);
+
+  /**
+   * Collect the ids of table pages in [begin, end) into page_ids.
+   */
+  void GetPageIds(uint32_t begin, uint32_t end, std::vector<page_id_t> *page_ids);
+
+  /**
+   * Empty the directory. Its pages after the first one are not deleted here but appended to freed_page_ids,
+   * so that the caller can give them back together with the table pages.
+   */
+  void Reset(std::vector<page_id_t> *freed_page_ids);
+
+  /**
+   * @return the ids of the directory pages themselves
+   */
+  inline const std::vector<page_id_t> &GetDirectoryPageIds() const { return dir_page_ids_; }
+
+  inline uint32_t GetPageCount() const { return page_count_; }
+
+  inline page_id_t GetFirstPageId() const { return dir_page_ids_.front(); }
+
+ private:
+  BufferPoolManager *buffer_pool_manager_;
+  std::vector<page_id_t> dir_page_ids_;  // directory page chain, cached to find the page of an index directly
+  uint32_t page_count_{0};
+};
+
+#endif  // MINISQL_HEAP_DIRECTORY_H
@@ -1,6 +1,10 @@
 #ifndef MINISQL_TABLE_HEAP_H
 #define MINISQL_TABLE_HEAP_H
 
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
 #include "page/header_page.h"
@@ -8,19 +12,24 @@
 #include "recovery/log_manager.h"
 #include "storage/table_iterator.h"
 #include "storage/freespace_map.h"
+#include "storage/heap_directory.h"
+#include "storage/toast_store.h"
+#include "storage/zone_map.h"
 
 class TableHeap {
   friend class TableIterator;
 
  public:
   static TableHeap *Create(BufferPoolManager *buffer_pool_manager, Schema *schema, Txn *txn, LogManager *log_manager,
-                           LockManager *lock_manager) {
-    return new TableHeap(buffer_pool_manager, schema, txn, log_manager, lock_manager);
+                           LockManager *lock_manager, TableLayout layout = TableLayout::kRow) {
+    return new TableHeap(buffer_pool_manager, schema, txn, log_manager, lock_manager, layout);
   }
 
-  static TableHeap *Create(BufferPoolManager *buffer_pool_manager, page_id_t first_page_id,page_id_t freespace_map_page_id, Schema *schema,
-                           LogManager *log_manager, LockManager *lock_manager) {
-    return new TableHeap(buffer_pool_manager, first_page_id, freespace_map_page_id, schema, log_manager, lock_manager);
+  static TableHeap *Create(BufferPoolManager *buffer_pool_manager, page_id_t first_page_id,page_id_t freespace_map_page_id,
+                           page_id_t heap_directory_page_id, Schema *schema, LogManager *log_manager,
+                           LockManager *lock_manager, TableLayout layout = TableLayout::kRow) {
+    return new TableHeap(buffer_pool_manager, first_page_id, freespace_map_page_id, heap_directory_page_id, schema,
+                         log_manager, lock_manager, layout);
   }
 
     // 获取 TablePage
@@ -33,16 +42,55 @@ class TableHeap {
         buffer_pool_manager_->UnpinPage(page_id, is_dirty);
     }
 
-  ~TableHeap() {}
+  ~TableHeap() {
+    delete freespace_map_;
+    delete heap_directory_;
+    delete zone_map_;
+    delete toast_store_;
+  }
 
   /**
    * Insert a tuple into the table. If the tuple is too large (>= page_size), return false.
+   * CHAR values longer than TOAST_THRESHOLD are moved to overflow pages first and the tuple points at them.
+   * Each session (thread) keeps inserting into its own claimed page until the page is full, so concurrent
+   * inserts do not contend on the same page.
    * @param[in/out] row Tuple Row to insert, the rid of the inserted tuple is wrapped in object row
    * @param[in] txn The recovery performing the insert
    * @return true iff the insert is successful
    */
   bool InsertTuple(Row &row, Txn *txn);
 
+  /**
+   * Insert a batch of tuples. Pages are filled in sequence: each target page is pinned once, receives as many
+   * rows as fit, and gets a single free space update before it is released. Rows that do not fit in any existing
+   * page go to freshly appended pages, which are linked to the tail of the heap one after another.
+   * @param[in/out] rows Rows to insert, the rid of each inserted tuple is wrapped in its row
+   * @param[in] txn The recovery performing the insert
+   * @return true iff all rows are inserted; if any row is too large, nothing is inserted. If no page can be
+   * fetched or appended midway, the rows before that point stay inserted and only their rids are set
+   */
+  bool InsertTuples(std::vector<Row> &rows, Txn *txn);
+
+  /**
+   * Give the insert page of the calling session back, so that other sessions can fill it. The insert and update
+   * executors call this when the statement ends.
+   */
+  void ReleaseInsertPage();
+
+  /**
+   * Give storage of a table back: empty pages are unlinked from the page chain and deleted, and if merge_pages
+   * is set, the tuples of a page are moved into its predecessor when they all fit there. The first page and
+   * pages that are the insert target of some session are kept.
+   * If moved_rows is given, relocated tuples are first made ordinary tuples under the row id of their current
+   * place and their forwarding records are deleted. Pages with forwarding records or relocated tuples are not merged.
+   * Must not run concurrently with scans of this table.
+   * @param[in] merge_pages Whether sparse neighbouring pages are merged
+   * @param[out] moved_rows Old and new row id of every moved tuple, indexes on the table have to be updated with them
+   * @param[in] txn Txn performing the vacuum
+   * @return the number of pages given back
+   */
+  uint32_t Vacuum(bool merge_pages, std::vector<std::pair<RowId, RowId>> *moved_rows, Txn *txn);
+
   /**
    * Mark the tuple as deleted. The actual delete will occur when ApplyDelete is called.
    * @param[in] rid Resource id of the tuple of delete
@@ -52,13 +100,15 @@ class TableHeap {
   bool MarkDelete(const RowId &rid, Txn *txn);
 
   /**
-   * if the new tuple is too large to fit in the old page, return false (will delete and insert)
+   * If the new tuple is too large to fit in the old page, it moves to a page with enough space and a forwarding
+   * record to it is left at rid, so rid stays valid and indexes need no update. Readers follow the record in one hop.
    * @param[in] row Tuple of new row
    * @param[in] rid Rid of the old tuple
    * @param[in] txn Txn performing the update
+   * @param[out] relocated Whether the tuple moved, a scan of the table may reach it again under rid
    * @return true is update is successful.
    */
-  bool UpdateTuple(Row &row, const RowId &rid, Txn *txn);
+  bool UpdateTuple(Row &row, const RowId &rid, Txn *txn, bool *relocated = nullptr);
 
   /**
    * Called on Commit/Abort to actually delete a tuple or rollback an insert.
@@ -75,7 +125,7 @@ class TableHeap {
   void RollbackDelete(const RowId &rid, Txn *txn);
 
   /**
-   * Read a tuple from the table.
+   * Read a tuple from the table, external values are read back from their overflow pages.
    * @param[in/out] row Output variable for the tuple, row id of the tuple is wrapped in row
    * @param[in] txn recovery performing the read
    * @return true if the read was successful (i.e. the tuple exists)
@@ -95,15 +145,36 @@ class TableHeap {
   }
 
   /**
-   * Free table heap and release storage in disk file
+   * Free table heap and release storage in disk file. The page ids are collected from the heap directory and the
+   * freespace map and given back in one batch, cached pages are dropped without being written back.
+   * The heap must not be used afterwards except for being deleted.
    */
-  void DeleteTable(page_id_t page_id = INVALID_PAGE_ID);
+  void DeleteTable();
+
+  /**
+   * Remove all tuples. Every page except the first one is freed in one batch like DeleteTable, the first page is
+   * reinitialized so that the table keeps its page ids in the catalog.
+   */
+  bool Truncate(Txn *txn);
 
   /**
    * @return the begin iterator of this table
    */
   TableIterator Begin(Txn *txn);
 
+  /**
+   * @return the begin iterator of a scan that only visits the pages accepted by page_filter, e.g. the pages whose
+   * zones may match a predicate. Pages are taken from the heap directory, rejected ones are not fetched. The
+   * zones of a table opened from disk are built before the first such scan.
+   */
+  TableIterator Begin(Txn *txn, PageFilter page_filter);
+
+  /**
+   * @return the begin iterator of a scan over pages [begin_page, end_page) of the heap directory, e.g. one partition
+   * of a parallel scan
+   */
+  TableIterator Begin(Txn *txn, uint32_t begin_page, uint32_t end_page);
+
   /**
    * @return the end iterator of this table
    */
@@ -114,44 +185,214 @@ class TableHeap {
    */
   inline page_id_t GetFirstPageId() const { return first_page_id_; }
   inline page_id_t GetFreeSpaceMapPageId()const {return freespace_map_->GetFirstPageId(); }
+  inline page_id_t GetHeapDirectoryPageId() const { return heap_directory_->GetFirstPageId(); }
+
+  /**
+   * @return the per-page column summaries used to skip pages in scans
+   */
+  inline const ZoneMap *GetZoneMap() const { return zone_map_; }
+
+  inline TableLayout GetLayout() const { return layout_; }
+
+  /**
+   * @return the number of pages of this table, read from the heap directory without walking the page chain
+   */
+  uint32_t GetPageCount();
+
+  /**
+   * @return the id of the index-th page in page chain order, INVALID_PAGE_ID if index is out of range
+   */
+  page_id_t GetPageId(uint32_t index);
+
+  /**
+   * Collect the ids of pages [begin, end) in page chain order, e.g. one partition of a parallel scan.
+   */
+  void GetPageIds(uint32_t begin, uint32_t end, std::vector<page_id_t> *page_ids);
+
+  /**
+   * Estimate the number of live tuples by counting them in at most sample_pages evenly spaced pages.
+   */
+  uint32_t EstimateTupleCount(uint32_t sample_pages);
  private:
+  /**
+   * @return the insert page of the calling session, a page is claimed for it if it has none
+   */
+  page_id_t GetInsertPage(uint32_t need_space, Txn *txn);
+
+  /**
+   * Release the full insert page of the calling session and claim another one with enough space.
+   */
+  page_id_t SwitchInsertPage(page_id_t full_page_id, uint32_t need_space, Txn *txn);
+
+  /**
+   * Claim a page no other session inserts into, append a new one if there is none. latch_ must be held.
+   */
+  page_id_t ClaimInsertPage(uint32_t need_space, Txn *txn);
+
+  /**
+   * Zones are kept in memory only, a table opened from disk has none. Summarize the rows of every page once,
+   * so that scans can skip pages of it as well.
+   */
+  void BuildZoneMap();
+
+  /**
+   * Append an empty page to the tail of the page chain. latch_ must be held.
+   */
+  page_id_t AppendPage(Txn *txn);
+
+  /**
+   * @return the id of the last page in the page chain. latch_ must be held.
+   */
+  page_id_t GetLastPageId();
+
+  void UpdateFreeSpace(page_id_t page_id, uint32_t free_space);
+
+  /**
+   * Move the tuple reached by home_rid, now stored at cur_rid, to a page with space for stored and point the
+   * forwarding record at home_rid to it. row is the untoasted value of stored.
+   */
+  bool RelocateTuple(Row &stored, const Row &row, const RowId &home_rid, const RowId &cur_rid, Txn *txn);
+
+  /**
+   * Turn every relocated tuple into an ordinary tuple and delete its forwarding record, (home, current) row ids are
+   * appended to moved_rows and folded_rows maps the current row id to its entry. latch_ must be held.
+   */
+  void FoldForwards(std::vector<std::pair<RowId, RowId>> *moved_rows, std::unordered_map<int64_t, size_t> *folded_rows,
+                    Txn *txn);
+
+  /**
+   * Move the CHAR values longer than TOAST_THRESHOLD of row to overflow pages, stored becomes a copy of row that
+   * points at them. Only rows of the row layout are toasted.
+   * @return false if row has no such value, stored is untouched then
+   */
+  bool ToastRow(const Row &row, Row *stored);
+
+  /**
+   * Replace the external fields of row by their values.
+   */
+  void DetoastRow(Row *row) const;
+
+  /**
+   * Free the overflow pages of the external fields of a tuple read from a page.
+   */
+  void FreeExternalValues(const Row &row);
+
+  /**
+   * Collect the overflow pages of all tuples of the given pages, including the ones marked deleted.
+   */
+  void CollectExternalPages(const std::vector<page_id_t> &page_ids, std::vector<page_id_t> *external_page_ids);
+
+  /**
+   * Fill the empty heap directory with the pages of the page chain, for a table stored before it had one.
+   */
+  void RebuildHeapDirectory();
+
+  /**
+   * Init a new page in the layout of this table.
+   */
+  void InitPage(TablePage *page, page_id_t page_id, page_id_t prev_id, Txn *txn) {
+    if (layout_ != TableLayout::kRow) {
+      page->InitPax(page_id, prev_id, schema_, log_manager_, txn, layout_ == TableLayout::kCompressed);
+    } else {
+      page->Init(page_id, prev_id, log_manager_, txn);
+    }
+  }
+
+  /**
+   * @return whether tuples of this table can have external values
+   */
+  bool HasCharColumn() const {
+    if (layout_ != TableLayout::kRow) {
+      return false;
+    }
+    for (auto column : schema_->GetColumns()) {
+      if (column->GetType() == TypeId::kTypeChar) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @return whether row fits in an empty page of this table
+   */
+  bool RowFits(const Row &row) const {
+    if (layout_ != TableLayout::kRow) {
+      return TablePage::FitsPaxLayout(row, schema_);
+    }
+    return row.GetSerializedSize(schema_) <= TablePage::SIZE_MAX_ROW;
+  }
+
+
   /**
    * create table heap and initialize first page
    */
   explicit TableHeap(BufferPoolManager *buffer_pool_manager, Schema *schema, Txn *txn, LogManager *log_manager,
-                     LockManager *lock_manager)
+                     LockManager *lock_manager, TableLayout layout)
       : buffer_pool_manager_(buffer_pool_manager),
         schema_(schema),
+        layout_(layout),
         log_manager_(log_manager),
         lock_manager_(lock_manager) {
 //    ASSERT(false, "Not implemented yet.");
       TablePage* true_page = reinterpret_cast<TablePage*>(buffer_pool_manager->NewPage(first_page_id_));//初始化新获得数据页
-      true_page->Init(first_page_id_ ,INVALID_PAGE_ID,log_manager_, nullptr);
+      InitPage(true_page, first_page_id_, INVALID_PAGE_ID, txn);
 
       page_id_t freespace_map_page_id;
       FreeSpaceMapPage* freespace_map_page = reinterpret_cast<FreeSpaceMapPage*>(buffer_pool_manager->NewPage(freespace_map_page_id));
       freespace_map_ = new FreeSpaceMap(freespace_map_page->GetPageId(),buffer_pool_manager);
       freespace_map_->SetNewPair(first_page_id_,true_page->GetFreeSpace());
+      heap_directory_ = new HeapDirectory(INVALID_PAGE_ID, buffer_pool_manager);
+      heap_directory_->Append(first_page_id_);
+      zone_map_ = new ZoneMap(schema_);
+#ifdef USE_ZONE_MAP
+      zone_map_->AddPage(first_page_id_);
+#endif
+      zone_map_built_ = true;
+      toast_store_ = new ToastStore(buffer_pool_manager);
+      may_toast_ = HasCharColumn();
+      last_page_id_ = first_page_id_;
 
       buffer_pool_manager->UnpinPage(first_page_id_,true);
       buffer_pool_manager->UnpinPage(freespace_map_page->GetPageId(),true);
   };
 
-  explicit TableHeap(BufferPoolManager *buffer_pool_manager, page_id_t first_page_id,page_id_t freespace_map_page_id, Schema *schema,
-                     LogManager *log_manager, LockManager *lock_manager)
+  explicit TableHeap(BufferPoolManager *buffer_pool_manager, page_id_t first_page_id,page_id_t freespace_map_page_id,
+                     page_id_t heap_directory_page_id, Schema *schema, LogManager *log_manager,
+                     LockManager *lock_manager, TableLayout layout)
       : buffer_pool_manager_(buffer_pool_manager),
         first_page_id_(first_page_id),
         schema_(schema),
+        layout_(layout),
         log_manager_(log_manager),
         lock_manager_(lock_manager) {
     freespace_map_ = new FreeSpaceMap(freespace_map_page_id,buffer_pool_manager);
+    heap_directory_ = new HeapDirectory(heap_directory_page_id, buffer_pool_manager);
+    if (heap_directory_page_id == INVALID_PAGE_ID) {
+      // 旧格式的表没有目录，按页链重建
+      RebuildHeapDirectory();
+    }
+    // 已有的页还没有摘要，第一次按摘要跳页的扫描前再建立
+    zone_map_ = new ZoneMap(schema_);
+    toast_store_ = new ToastStore(buffer_pool_manager);
+    may_toast_ = HasCharColumn();
   }
 
  private:
   BufferPoolManager *buffer_pool_manager_;
   page_id_t first_page_id_;
   Schema *schema_;
+  TableLayout layout_;
   FreeSpaceMap* freespace_map_;
+  HeapDirectory *heap_directory_{nullptr};
+  ZoneMap *zone_map_{nullptr};
+  std::mutex zone_map_latch_;  // held while the zones of a table opened from disk are built
+  bool zone_map_built_{false};
+  ToastStore *toast_store_{nullptr};
+  bool may_toast_{false};  // whether tuples may point at overflow pages, which are freed with them
+  std::mutex latch_;  // protects freespace_map_, heap_directory_, insert_pages_ and the tail of the page chain
+  std::unordered_map<std::thread::id, page_id_t> insert_pages_;  // current insert page of each session
+  page_id_t last_page_id_{INVALID_PAGE_ID};
   [[maybe_unused]] LogManager *log_manager_;
   [[maybe_unused]] LockManager *lock_manager_;
 };
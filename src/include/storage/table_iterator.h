@@ -1,19 +1,45 @@
 #ifndef MINISQL_TABLE_ITERATOR_H
 #define MINISQL_TABLE_ITERATOR_H
 
+#include <functional>
+#include <vector>
+
 #include "common/rowid.h"
 #include "concurrency/txn.h"
 #include "record/row.h"
+#include "record/row_view.h"
 #include "page/table_page.h" // 确保包含 table_page.h
 
 
 class TableHeap;
 
+// decides whether a scan visits a page, pages it rejects are neither fetched nor decoded
+using PageFilter = std::function<bool(page_id_t)>;
+
+/**
+ * Page-at-a-time iterator over a table heap.
+ *
+ * When the iterator enters a page it pins it once and decodes all visible tuples into a reusable buffer of views,
+ * the following tuples of the page are served from that buffer without touching the buffer pool again.
+ *
+ * Pin ownership: an iterator that is not at the end owns exactly one pin, on the page of its current tuple. The pin
+ * is released when the iterator moves to another page, reaches the end or is destroyed. Copies and assigned
+ * iterators take a pin of their own. Views and rows handed out by an iterator are only valid until it moves to
+ * another page.
+ */
 class TableIterator {
 public:
  // you may define your own constructor based on your member variables
  explicit TableIterator(TableHeap *table_heap, RowId rid, Txn *txn);
 
+ /**
+  * Iterator starting at the first tuple of the page_index-th page in the heap directory, following pages are
+  * taken from the directory as well and skipped unless page_filter accepts them. The scan ends before the
+  * page_end-th page.
+  */
+ explicit TableIterator(TableHeap *table_heap, uint32_t page_index, Txn *txn, PageFilter page_filter,
+                        uint32_t page_end = UINT32_MAX);
+
 // explicit
  TableIterator(const TableIterator &other);
 
@@ -33,16 +59,58 @@ public:
 
   TableIterator operator++(int);
 
+  /**
+   * @return a view of the current tuple in the pinned page, unlike operator* it does not materialize a Row
+   */
+  inline const RowView &GetRowView() const { return views_[cursor_]; }
+
+  /**
+   * Batch access: the visible tuples of the current page, decoded when the iterator entered the page.
+   * Meant to be used together with NextPage(), the page must not be modified while the views are used.
+   */
+  inline const std::vector<RowView> &GetPageRows() const { return views_; }
+
+  /**
+   * Move to the first visible tuple of the next non-empty page.
+   */
+  TableIterator &NextPage();
+
+  /**
+   * Look value up in the dictionary of a column in the current page, see TablePage::FindDictionaryEntry.
+   * @return false if the column is not dictionary encoded in the current page
+   */
+  bool FindDictionaryEntry(uint32_t column_id, const Field &value, const char **entry);
+
 private:
   // add your own private member variables here
 
     RowId rid_;              // 当前记录的 RowId
     TableHeap *table_heap_;  // 指向关联的 TableHeap 对象的指针
     Txn *txn_;               // 当前事务的指针
-    TablePage *page_;        // 当前页面的指针
-    Row *row_;               // 当前行的指针
+    TablePage *page_;        // 当前页面的指针，迭代器持有它的一个pin
+    Row *row_;               // 当前行的指针，只在解引用时从视图物化
+    std::vector<RowView> views_;  // 当前页面中可见元组的视图，换页时复用
+    size_t cursor_{0};            // 当前元组在views_中的下标
+    bool row_valid_{false};       // row_是否已经是当前行
+    PageFilter page_filter_;      // 为空时不过滤
+    bool use_directory_{false};   // 按heap directory的顺序取页，否则沿页链表扫描
+    uint32_t page_index_{0};      // 使用heap directory时当前页的下标
+    uint32_t page_end_{UINT32_MAX};  // 使用heap directory时扫描到这一页之前为止
+
+    /**
+     * Decode the visible tuples of page_ from begin_slot on into views_, move on to the following pages while
+     * there is none, and position the iterator at the first one.
+     */
+    void LoadPage(uint32_t begin_slot);
 
     void MoveToNextTuple();
+
+    /**
+     * @return the id of the page to visit after page_, which must still be pinned
+     */
+    page_id_t GetNextPageId();
+
+    void SetEnd();
 };
 
 #endif  // MINISQL_TABLE_ITERATOR_H
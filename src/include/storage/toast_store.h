@@ -0,0 +1,43 @@
+#ifndef MINISQL_TOAST_STORE_H
+#define MINISQL_TOAST_STORE_H
+
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "page/overflow_page.h"
+
+/**
+ * Out-of-line storage of long CHAR values. A value is written to a chain of OverflowPage and its tuple only keeps
+ * a pointer to the first page (see Row::IsExternal), values are read back when a field is accessed.
+ * A chain is only written once and freed when its tuple goes away, so no latch is needed.
+ */
+class ToastStore {
+ public:
+  explicit ToastStore(BufferPoolManager *buffer_pool_manager) : buffer_pool_manager_(buffer_pool_manager) {}
+
+  /**
+   * Write len bytes of data to a new chain of overflow pages.
+   * @return the id of the first page of the chain, INVALID_PAGE_ID if no page can be allocated
+   */
+  page_id_t Store(const char *data, uint32_t len);
+
+  /**
+   * Read the value stored in the chain starting at first_page_id into data, which must hold len bytes.
+   */
+  bool Fetch(page_id_t first_page_id, uint32_t len, char *data) const;
+
+  /**
+   * Give all pages of the chain starting at first_page_id back.
+   */
+  void Free(page_id_t first_page_id);
+
+  /**
+   * Collect the ids of the pages of the chain starting at first_page_id without freeing them.
+   */
+  void GetPageIds(page_id_t first_page_id, std::vector<page_id_t> *page_ids) const;
+
+ private:
+  BufferPoolManager *buffer_pool_manager_;
+};
+
+#endif  // MINISQL_TOAST_STORE_H
@@ -0,0 +1,71 @@
+#ifndef MINISQL_ZONE_MAP_H
+#define MINISQL_ZONE_MAP_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+#include "record/field.h"
+#include "record/row.h"
+#include "record/schema.h"
+
+/**
+ * Per-page column summaries of a table heap, kept next to the freespace map, so that scans can skip pages whose
+ * rows cannot satisfy a comparison.
+ *
+ * A zone covers every row added to its page since the page was empty: the row count, the number of nulls and
+ * the min/max of INT and FLOAT columns. Zones only widen on insert and update and are reset when the page
+ * becomes empty, so they may be loose but never exclude a row that is on the page. Zones live in memory only:
+ * a heap opened from disk summarizes its pages before the first scan that skips pages, pages without a zone are
+ * never skipped.
+ */
+class ZoneMap {
+ public:
+  explicit ZoneMap(Schema *schema) : schema_(schema) {}
+
+  /**
+   * Start tracking an empty page.
+   */
+  void AddPage(page_id_t page_id);
+
+  void RemovePage(page_id_t page_id);
+
+  /**
+   * The page became empty, its zone starts over.
+   */
+  void ResetPage(page_id_t page_id);
+
+  /**
+   * Widen the zone of the page with the values of row, call it before the row is written to the page.
+   */
+  void AddRow(page_id_t page_id, const Row &row);
+
+  /**
+   * @return false if no row of the page can satisfy "column comp_type value", comp_type as in ComparisonExpression
+   */
+  bool MayMatch(page_id_t page_id, uint32_t column, const std::string &comp_type, const Field &value) const;
+
+ private:
+  struct ColumnZone {
+    double min_{0};
+    double max_{0};
+    uint32_t null_count_{0};
+  };
+
+  struct PageZone {
+    uint32_t row_count_{0};
+    std::vector<ColumnZone> columns_;
+  };
+
+  static bool HasRange(TypeId type) { return type == TypeId::kTypeInt || type == TypeId::kTypeFloat; }
+
+  static double GetValue(const Field &field);
+
+  Schema *schema_;
+  mutable std::mutex latch_;
+  std::unordered_map<page_id_t, PageZone> zones_;
+};
+
+#endif  // MINISQL_ZONE_MAP_H
@@ -1,6 +1,8 @@
 #include "index/b_plus_tree.h"
 
+#include <algorithm>
 #include <string>
+#include <thread>
 
 #include "glog/logging.h"
 #include "index/basic_comparator.h"
@@ -10,11 +12,22 @@
 /**
  * TODO: Student Implement
  */
-BPlusTree::BPlusTree(index_id_t index_id, BufferPoolManager *buffer_pool_manager, const KeyManager &KM,
-                     int leaf_max_size, int internal_max_size)
-    : index_id_(index_id), buffer_pool_manager_(buffer_pool_manager), processor_(KM) {
+INDEX_TEMPLATE_ARGUMENTS
+BPLUSTREE_TYPE::BPlusTree(index_id_t index_id, BufferPoolManager *buffer_pool_manager, const KeyManager &KM,
+                          int leaf_max_size, int internal_max_size, bool compress_internal, bool compress_leaf)
+    : index_id_(index_id),
+      buffer_pool_manager_(buffer_pool_manager),
+      processor_(KM),
+      comparator_(KM),
+      compress_internal_(compress_internal && !KM.IsIntKey()),
+      compress_leaf_(compress_leaf && !KM.IsIntKey()) {
+  ASSERT(KeySize == 0 || KeySize == KM.GetKeySize(), "Key size does not match the tree.");
   auto leaf_max_size_cal = ((PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / (sizeof(RowId) + KM.GetKeySize()) - 1);
   auto internal_max_size_cal = ((PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (sizeof(RowId) + KM.GetKeySize()) - 1);
+  if constexpr (LeafPage::kIntKeys) {
+    // 对齐 int key 数组的填充占去了一项
+    leaf_max_size_cal = std::min<size_t>(leaf_max_size_cal, LeafPage::kIntCapacity - 1);
+  }
   if (leaf_max_size != UNDEFINED_SIZE)
     leaf_max_size_ = leaf_max_size;
   else
@@ -27,40 +40,60 @@ BPlusTree::BPlusTree(index_id_t index_id, BufferPoolManager *buffer_pool_manager
 
   auto page = buffer_pool_manager_->FetchPage(INDEX_ROOTS_PAGE_ID);
   auto root_page = reinterpret_cast<IndexRootsPage *>(page->GetData());
-  root_page->GetRootId(index_id, &root_page_id_);
+  page_id_t root_page_id = INVALID_PAGE_ID;
+  root_page->GetRootId(index_id, &root_page_id);
+  root_page_id_ = root_page_id;
   buffer_pool_manager_->UnpinPage(INDEX_ROOTS_PAGE_ID, true);
 }
 
-void BPlusTree::Destroy(page_id_t current_page_id) {
-  if (current_page_id == INVALID_PAGE_ID) {
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Destroy(page_id_t current_page_id) {
+  root_latch_.WLock();
+  bool whole_tree = current_page_id == INVALID_PAGE_ID;
+  if (whole_tree) {
     current_page_id = root_page_id_;
   }
   if (current_page_id == INVALID_PAGE_ID) {
+    root_latch_.WUnlock();
     return;
   }
+  // 先收集子树的所有页，再一次性释放
+  std::vector<page_id_t> page_ids;
+  CollectPages(current_page_id, &page_ids);
+  buffer_pool_manager_->DeletePages(page_ids);
+  if (whole_tree) {
+    root_page_id_ = INVALID_PAGE_ID;
+    Page *page = buffer_pool_manager_->FetchPage(INDEX_ROOTS_PAGE_ID);
+    if (page != nullptr) {
+      reinterpret_cast<IndexRootsPage *>(page->GetData())->Delete(index_id_);
+      buffer_pool_manager_->UnpinPage(INDEX_ROOTS_PAGE_ID, true);
+    }
+  }
+  root_latch_.WUnlock();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::CollectPages(page_id_t current_page_id, std::vector<page_id_t> *page_ids) {
   Page *page = buffer_pool_manager_->FetchPage(current_page_id);
   if (page == nullptr) {
     return;
   }
+  page_ids->push_back(current_page_id);
   BPlusTreePage *tree_page = reinterpret_cast<BPlusTreePage *>(page->GetData());
-  if (tree_page->IsLeafPage()) {
-    buffer_pool_manager_->UnpinPage(current_page_id, false);
-    buffer_pool_manager_->DeletePage(current_page_id);
-
-  } else {
+  if (!tree_page->IsLeafPage()) {
     InternalPage *internal_page = reinterpret_cast<InternalPage *>(tree_page);
     for (int i = 0; i < internal_page->GetSize(); ++i) {
-      Destroy(internal_page->ValueAt(i));
+      CollectPages(internal_page->ValueAt(i), page_ids);
     }
-    buffer_pool_manager_->UnpinPage(current_page_id, false);
-    buffer_pool_manager_->DeletePage(current_page_id);
   }
+  buffer_pool_manager_->UnpinPage(current_page_id, false);
 }
 
 /*
  * Helper function to decide whether current b+tree is empty
  */
-bool BPlusTree::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID; }
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID; }
 
 /*****************************************************************************
  * SEARCH
@@ -70,28 +103,98 @@ bool BPlusTree::IsEmpty() const { return root_page_id_ == INVALID_PAGE_ID; }
  * This method is used for point query
  * @return : true means key exists
  */
-bool BPlusTree::GetValue(const GenericKey *key, std::vector<RowId> &result, Txn *transaction) {
-  if (IsEmpty()) {
-    return false;
-  }
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::GetValue(const GenericKey *key, std::vector<RowId> &result, Txn *transaction) {
+#ifdef USE_OPTIMISTIC_LOCK_COUPLING
+  Page *page = FindLeafPageOptimistic(key);
+#else
   Page *page = FindLeafPage(key);
-#ifdef ENABLE_INDEX_DEBUG
-  // cout << "PageId: " << page->GetPageId() << endl;
-  cout << endl;
 #endif
   if (page == nullptr) {
     return false;
   }
   LeafPage *leaf = reinterpret_cast<LeafPage *>(page->GetData());
   RowId value;
-  bool found = leaf->Lookup(key, value, processor_);
+  bool found = leaf->Lookup(key, value, comparator_);
   if (found) {
     result.push_back(value);
   }
+  page->RUnlatch();
   buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
   return found;
 }
 
+/*****************************************************************************
+ * LATCH CRABBING
+ *****************************************************************************/
+/*
+ * A node is safe when the operation cannot propagate above it: an insert does not split it and a remove does not
+ * make it underflow. The root only shrinks the tree when a leaf root becomes empty or an internal root is left
+ * with a single child. A compressed page may need full width slots for the inserted key, so it is only safe below
+ * its fixed max size.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::IsSafe(BPlusTreePage *node, Operation op, bool is_root) const {
+  if (op == Operation::kInsert) {
+    return node->GetSize() < node->GetFixedMaxSize();
+  }
+  if (is_root) {
+    return node->GetSize() > (node->IsLeafPage() ? 1 : 2);
+  }
+  return node->GetSize() > node->GetMinSize();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageForWrite(const GenericKey *key, Operation op, WriteContext &ctx) {
+  page_id_t page_id = root_page_id_;
+  bool is_root = true;
+  while (true) {
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    page->WLatch();
+    auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    if (IsSafe(node, op, is_root)) {
+      ReleaseAncestors(ctx);
+    }
+    ctx.pages.push_back(page);
+    if (node->IsLeafPage()) {
+      return page;
+    }
+    page_id = reinterpret_cast<InternalPage *>(node)->Lookup(key, comparator_);
+    is_root = false;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleaseAncestors(WriteContext &ctx) {
+  if (ctx.root_latched) {
+    root_latch_.WUnlock();
+    ctx.root_latched = false;
+  }
+  for (Page *page : ctx.pages) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  }
+  ctx.pages.clear();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ReleaseWriteContext(WriteContext &ctx) {
+  if (ctx.root_latched) {
+    root_latch_.WUnlock();
+    ctx.root_latched = false;
+  }
+  for (Page *page : ctx.pages) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
+  }
+  ctx.pages.clear();
+  // 合并掉的页已经从父节点摘除，释放latch之后别的线程无法再到达它们
+  for (page_id_t page_id : ctx.deleted_page_ids) {
+    buffer_pool_manager_->DeletePage(page_id);
+  }
+  ctx.deleted_page_ids.clear();
+}
+
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
@@ -102,12 +205,19 @@ bool BPlusTree::GetValue(const GenericKey *key, std::vector<RowId> &result, Txn
  * @return: since we only support unique key, if user try to insert duplicate
  * keys return false, otherwise return true.
  */
-bool BPlusTree::Insert(GenericKey *key, const RowId &value, Txn *transaction) {
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::Insert(GenericKey *key, const RowId &value, Txn *transaction) {
+  WriteContext ctx;
+  root_latch_.WLock();
+  ctx.root_latched = true;
   if (IsEmpty()) {
     StartNewTree(key, value);
+    ReleaseWriteContext(ctx);
     return true;
   }
-  return InsertIntoLeaf(key, value, transaction);
+  bool inserted = InsertIntoLeaf(key, value, ctx);
+  ReleaseWriteContext(ctx);
+  return inserted;
 }
 
 /*
@@ -116,7 +226,8 @@ bool BPlusTree::Insert(GenericKey *key, const RowId &value, Txn *transaction) {
  * an "out of memory" exception if returned value is nullptr), then update b+
  * tree's root page id and insert entry directly into leaf page.
  */
-void BPlusTree::StartNewTree(GenericKey *key, const RowId &value) {
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::StartNewTree(GenericKey *key, const RowId &value) {
   page_id_t page_id;
   Page *root_page = buffer_pool_manager_->NewPage(page_id);
   if (root_page == nullptr) {
@@ -126,8 +237,8 @@ void BPlusTree::StartNewTree(GenericKey *key, const RowId &value) {
   UpdateRootPageId(1);
 
   LeafPage *root = reinterpret_cast<LeafPage *>(root_page->GetData());
-  root->Init(page_id, INVALID_PAGE_ID, processor_.GetKeySize(), leaf_max_size_);
-  root->Insert(key, value, processor_);
+  root->Init(page_id, INVALID_PAGE_ID, processor_.GetKeySize(), leaf_max_size_, compress_leaf_);
+  root->Insert(key, value, comparator_);
   buffer_pool_manager_->UnpinPage(page_id, true);
 }
 
@@ -136,40 +247,67 @@ void BPlusTree::StartNewTree(GenericKey *key, const RowId &value) {
  * User needs to first find the right leaf page as insertion target, then look
  * through leaf page to see whether insert key exist or not. If exist, return
  * immediately, otherwise insert entry. Remember to deal with split if necessary.
+ * The pages that may change are write-latched in ctx and released by the caller.
+ * A compressed leaf may have no room for a key that widens its slots, it is split first then, and each half holds
+ * at most its fixed max size so the key fits in either.
  * @return: since we only support unique key, if user try to insert duplicate
  * keys return false, otherwise return true.
  */
-
-bool BPlusTree::InsertIntoLeaf(GenericKey *key, const RowId &value, Txn *transaction) {
-  Page *page = FindLeafPage(key);
-  if (page == nullptr) {
-    return false;
-  }
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::InsertIntoLeaf(GenericKey *key, const RowId &value, WriteContext &ctx) {
+  Page *page = FindLeafPageForWrite(key, Operation::kInsert, ctx);
   LeafPage *leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
   RowId temp_value;  // Use a temporary non-const variable
-  if (leaf_page->Lookup(key, temp_value, processor_)) {
-    buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), false);
+  if (leaf_page->Lookup(key, temp_value, comparator_)) {
     return false;
   }
-  leaf_page->Insert(key, value, processor_);
-  buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), true);
-  if (leaf_page->GetSize() > leaf_max_size_) {
-    LeafPage *new_leaf_page = Split(leaf_page, transaction);
+  int size = leaf_page->Insert(key, value, comparator_);
+  if (size == -1 || size > leaf_page->GetMaxSize()) {
+    LeafPage *new_leaf_page = Split(leaf_page, nullptr);
+    int width = processor_.GetKeySize();
+    std::vector<char> keys(3 * width);
+    auto *left_key = reinterpret_cast<GenericKey *>(keys.data());
+    auto *right_key = reinterpret_cast<GenericKey *>(keys.data() + width);
+    auto *separator = reinterpret_cast<GenericKey *>(keys.data() + 2 * width);
+    if (size == -1) {
+      new_leaf_page->KeyAt(0, right_key);
+      LeafPage *target = comparator_.CompareKeys(key, right_key) < 0 ? leaf_page : new_leaf_page;
+      size = target->Insert(key, value, comparator_);
+      ASSERT(size != -1, "Split leaf overflows.");
+    }
     // new_leaf_page is at the right of the leaf_page
-    InsertIntoParent(leaf_page, new_leaf_page->KeyAt(0), new_leaf_page, transaction);
+    leaf_page->KeyAt(leaf_page->GetSize() - 1, left_key);
+    new_leaf_page->KeyAt(0, right_key);
+    Separator(left_key, right_key, separator);
+    InsertIntoParent(leaf_page, separator, new_leaf_page, nullptr);
+    buffer_pool_manager_->UnpinPage(new_leaf_page->GetPageId(), true);
   }
   return true;
 }
 
+/*
+ * With compressed internal pages the separator is right_key cut after its first byte differing from left_key.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Separator(const GenericKey *left_key, const GenericKey *right_key, GenericKey *separator) const {
+  if (compress_internal_) {
+    BPlusTreePage::ShortestSeparator(left_key, right_key, processor_.GetKeySize(), separator);
+  } else {
+    memcpy(separator, right_key, processor_.GetKeySize());
+  }
+}
+
 /*
  * Split input page and return newly created page.
  * Using template N to represent either internal page or leaf page.
  * User needs to first ask for new page from buffer pool manager(NOTICE: throw
  * an "out of memory" exception if returned value is nullptr), then move half
  * of key & value pairs from input page to newly created page
+ * The new page is returned pinned, it is unreachable by other threads until its parent is released.
  */
-// the returned node is left to node
-BPlusTreeInternalPage *BPlusTree::Split(InternalPage *node, Txn *transaction) {
+// the returned node is right to node
+INDEX_TEMPLATE_ARGUMENTS
+B_PLUS_TREE_INTERNAL_PAGE_TYPE *BPLUSTREE_TYPE::Split(InternalPage *node, GenericKey *middle_key, Txn *transaction) {
   // allocate a new page
   page_id_t page_id;
   Page *page = buffer_pool_manager_->NewPage(page_id);
@@ -177,17 +315,16 @@ BPlusTreeInternalPage *BPlusTree::Split(InternalPage *node, Txn *transaction) {
     throw std::runtime_error("out of memory");
   }
   InternalPage *new_node = reinterpret_cast<InternalPage *>(page->GetData());
-  new_node->Init(page_id, node->GetParentPageId(), node->GetKeySize(), node->GetMaxSize());
+  new_node->Init(page_id, node->GetParentPageId(), node->GetKeySize(), node->GetFixedMaxSize(), node->IsCompressed());
 
   // move half of key & value pairs from input page to newly created page
-  node->MoveHalfTo(new_node, buffer_pool_manager_);
-  buffer_pool_manager_->UnpinPage(new_node->GetPageId(), true);
-
+  node->MoveHalfTo(new_node, middle_key, buffer_pool_manager_);
   return new_node;
 }
 
-// the returned node is left to node
-BPlusTreeLeafPage *BPlusTree::Split(LeafPage *node, Txn *transaction) {
+// the returned node is right to node
+INDEX_TEMPLATE_ARGUMENTS
+B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::Split(LeafPage *node, Txn *transaction) {
   // allocate a new page
   page_id_t page_id;
   Page *page = buffer_pool_manager_->NewPage(page_id);
@@ -195,7 +332,7 @@ BPlusTreeLeafPage *BPlusTree::Split(LeafPage *node, Txn *transaction) {
     throw std::runtime_error("out of memory");
   }
   LeafPage *new_node = reinterpret_cast<LeafPage *>(page->GetData());
-  new_node->Init(page_id, node->GetParentPageId(), node->GetKeySize(), node->GetMaxSize());
+  new_node->Init(page_id, node->GetParentPageId(), node->GetKeySize(), node->GetFixedMaxSize(), node->IsCompressed());
 
   // move half of key & value pairs from input page to newly created page
   node->MoveHalfTo(new_node);
@@ -203,8 +340,6 @@ BPlusTreeLeafPage *BPlusTree::Split(LeafPage *node, Txn *transaction) {
 
   // for leaf page, we need to update its next page id
   node->SetNextPageId(new_node->GetPageId());
-  buffer_pool_manager_->UnpinPage(new_node->GetPageId(), true);
-
   return new_node;
 }
 
@@ -216,33 +351,23 @@ BPlusTreeLeafPage *BPlusTree::Split(LeafPage *node, Txn *transaction) {
  * User needs to first find the parent page of old_node, parent node must be
  * adjusted to take info of new_node into account. Remember to deal with split
  * recursively if necessary.
+ * old_node was unsafe, so its parent (or root_latch_ if it is the root) is still write-latched by this thread.
+ * Like a leaf, a compressed parent with no room for key is split first and key goes to the half holding old_node.
  */
 // old_node is left to new_node
-void BPlusTree::InsertIntoParent(BPlusTreePage *old_node, GenericKey *key, BPlusTreePage *new_node, Txn *transaction) {
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, GenericKey *key, BPlusTreePage *new_node,
+                                      Txn *transaction) {
   // if the old_node is root, create a new root, the number of layers increments by 1
   if (old_node->IsRootPage()) {
-    // std::cout << "old_node->IsRootPage()" << std::endl;
     page_id_t page_id;
     Page *page = buffer_pool_manager_->NewPage(page_id);
     if (page == nullptr) {
       throw std::runtime_error("out of memory");
     }
     InternalPage *root = reinterpret_cast<InternalPage *>(page->GetData());
-    root->Init(page_id, INVALID_PAGE_ID, old_node->GetKeySize(), internal_max_size_);
-    if (old_node->IsLeafPage())  // if old_node is a leaf page
-    {
-      BPlusTreeLeafPage *leaf_old = reinterpret_cast<BPlusTreeLeafPage *>(old_node);
-      root->SetKeyAt(0, leaf_old->KeyAt(0));
-    } else  // old_node is an internal page
-    {
-      BPlusTreeInternalPage *internal_old = reinterpret_cast<BPlusTreeInternalPage *>(old_node);
-      root->SetKeyAt(0, internal_old->KeyAt(0));
-    }
-    // set the key and value of the new root
-    root->SetValueAt(0, old_node->GetPageId());
-    root->SetKeyAt(1, key);
-    root->SetValueAt(1, new_node->GetPageId());
-    root->SetSize(2);
+    root->Init(page_id, INVALID_PAGE_ID, old_node->GetKeySize(), internal_max_size_, compress_internal_);
+    root->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
 
     old_node->SetParentPageId(root->GetPageId());
     new_node->SetParentPageId(root->GetPageId());
@@ -251,24 +376,139 @@ void BPlusTree::InsertIntoParent(BPlusTreePage *old_node, GenericKey *key, BPlus
 
     buffer_pool_manager_->UnpinPage(root->GetPageId(), true);
     return;
-  } else {
-    // the case that the parent is not the root
-    page_id_t parent_id = old_node->GetParentPageId();
-    Page *page = buffer_pool_manager_->FetchPage(parent_id);
-    InternalPage *parent = reinterpret_cast<InternalPage *>(page->GetData());
-    parent->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
-    if (parent->GetSize() > parent->GetMaxSize()) {  // if the parent node is full
-      // std::cout << "parent->GetSize() > parent->GetMaxSize()" << std::endl;
-      // std::cout << "root_page_id: " << root_page_id_ << std::endl;
-      InternalPage *new_parent = Split(parent, transaction);
-      GenericKey *new_key = new GenericKey();
-      new_key = new_parent->KeyAt(0);
-      InsertIntoParent(parent, new_key, new_parent, transaction);
-      // std::cout << "InsertIntoParent(parent, new_key, new_parent, transaction)" << std::endl;
-      // std::cout << "root_page_id: " << root_page_id_ << std::endl;
+  }
+  // the parent is latched in the write context, fetching it here only pins it again
+  page_id_t parent_id = old_node->GetParentPageId();
+  Page *page = buffer_pool_manager_->FetchPage(parent_id);
+  InternalPage *parent = reinterpret_cast<InternalPage *>(page->GetData());
+  int size = parent->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
+  if (size == -1 || size > parent->GetMaxSize()) {  // if the parent node is full
+    std::vector<char> middle_key(processor_.GetKeySize());
+    auto *middle = reinterpret_cast<GenericKey *>(middle_key.data());
+    InternalPage *new_parent = Split(parent, middle, transaction);
+    if (size == -1) {
+      InternalPage *target = parent->ValueIndex(old_node->GetPageId()) != -1 ? parent : new_parent;
+      size = target->InsertNodeAfter(old_node->GetPageId(), key, new_node->GetPageId());
+      ASSERT(size != -1, "Split internal page overflows.");
+      new_node->SetParentPageId(target->GetPageId());
+    }
+    InsertIntoParent(parent, middle, new_parent, transaction);
+    buffer_pool_manager_->UnpinPage(new_parent->GetPageId(), true);
+  }
+  buffer_pool_manager_->UnpinPage(parent_id, true);
+}
+
+/*****************************************************************************
+ * BULK LOAD
+ *****************************************************************************/
+/*
+ * Build the tree bottom-up from entries sorted by key. A leaf is appended to until it holds fill_factor of the max
+ * size it would have with the next key, then the next leaf is allocated, linked and added with its separator to the
+ * rightmost node of the level above, which fills up the same way. A level gets a level above once it needs a second
+ * node. Each page is written once and only the rightmost page of a level may be less than half full, which the
+ * remove path copes with. Pages are not latched, the tree is unreachable until the root is published at the end.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::BulkLoad(EXTERNAL_SORTER_TYPE &sorter, double fill_factor, std::atomic<uint64_t> *loaded) {
+  root_latch_.WLock();
+  if (!IsEmpty()) {
+    root_latch_.WUnlock();
+    return false;
+  }
+  if (sorter.GetSize() == 0) {
+    root_latch_.WUnlock();
+    return true;
+  }
+  std::vector<BuildLevel> levels(1);
+  int width = processor_.GetKeySize();
+  std::vector<char> keys(2 * width);
+  auto *last_key = reinterpret_cast<GenericKey *>(keys.data());
+  auto *separator = reinterpret_cast<GenericKey *>(keys.data() + width);
+  // sorter 已经去掉重复的key
+  GenericKey *key;
+  RowId value;
+  uint64_t count = 0;
+  for (; sorter.Next(key, value); count++) {
+    auto *leaf = levels[0].page == nullptr ? nullptr : reinterpret_cast<LeafPage *>(levels[0].page->GetData());
+    if (leaf == nullptr || leaf->GetSize() >= FillSize(leaf->MaxSizeWith(key), fill_factor, 1)) {
+      // 每写满一个叶子更新一次进度
+      if (loaded != nullptr) {
+        loaded->store(count, std::memory_order_relaxed);
+      }
+      if (leaf != nullptr) {
+        Separator(last_key, key, separator);
+      }
+      BuildOpenNode(levels, 0, separator, fill_factor);
+      leaf = reinterpret_cast<LeafPage *>(levels[0].page->GetData());
+    }
+    bool appended = leaf->Append(key, value);
+    ASSERT(appended, "Bulk load overflows a leaf.");
+    memcpy(last_key, key, width);
+  }
+  for (auto &level : levels) {
+    buffer_pool_manager_->UnpinPage(level.page_id, true);
+    level.page = nullptr;
+  }
+  if (loaded != nullptr) {
+    loaded->store(count, std::memory_order_relaxed);
+  }
+  root_page_id_ = levels.back().page_id;
+  UpdateRootPageId(1);
+  root_latch_.WUnlock();
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int BPLUSTREE_TYPE::FillSize(int max_size, double fill_factor, int min_size) {
+  return std::max(min_size, std::min(static_cast<int>(max_size * fill_factor), max_size));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BuildOpenNode(std::vector<BuildLevel> &levels, size_t level, const GenericKey *key,
+                                   double fill_factor) {
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(page_id);
+  if (page == nullptr) {
+    throw std::runtime_error("out of memory");
+  }
+  page_id_t parent_id = INVALID_PAGE_ID;
+  if (levels[level].page != nullptr) {
+    if (level + 1 == levels.size()) {
+      // 这一层有了第二个节点，在上面加一层，它的第一个孩子是当前节点
+      levels.emplace_back();
+      BuildOpenNode(levels, level + 1, nullptr, fill_factor);
+      page_id_t top_id = BuildAppendChild(levels, level + 1, nullptr, levels[level].page_id, fill_factor);
+      reinterpret_cast<BPlusTreePage *>(levels[level].page->GetData())->SetParentPageId(top_id);
+    }
+    parent_id = BuildAppendChild(levels, level + 1, key, page_id, fill_factor);
+    if (level == 0) {
+      reinterpret_cast<LeafPage *>(levels[level].page->GetData())->SetNextPageId(page_id);
     }
-    buffer_pool_manager_->UnpinPage(parent_id, true);
+    buffer_pool_manager_->UnpinPage(levels[level].page_id, true);
+  }
+  if (level == 0) {
+    reinterpret_cast<LeafPage *>(page->GetData())
+        ->Init(page_id, parent_id, processor_.GetKeySize(), leaf_max_size_, compress_leaf_);
+  } else {
+    reinterpret_cast<InternalPage *>(page->GetData())
+        ->Init(page_id, parent_id, processor_.GetKeySize(), internal_max_size_, compress_internal_);
+  }
+  levels[level].page = page;
+  levels[level].page_id = page_id;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t BPLUSTREE_TYPE::BuildAppendChild(std::vector<BuildLevel> &levels, size_t level, const GenericKey *key,
+                                           page_id_t child, double fill_factor) {
+  auto *node = reinterpret_cast<InternalPage *>(levels[level].page->GetData());
+  if (node->GetSize() > 0 && node->GetSize() >= FillSize(node->MaxSizeWith(key), fill_factor, 2)) {
+    // child 成为新节点的第一个孩子，key 作为新节点的分隔 key 加到上一层
+    BuildOpenNode(levels, level, key, fill_factor);
+    node = reinterpret_cast<InternalPage *>(levels[level].page->GetData());
   }
+  bool appended = node->Append(key, child);
+  ASSERT(appended, "Bulk load overflows an internal page.");
+  return levels[level].page_id;
 }
 
 /*****************************************************************************
@@ -281,59 +521,37 @@ void BPlusTree::InsertIntoParent(BPlusTreePage *old_node, GenericKey *key, BPlus
  * delete entry from leaf page. Remember to deal with redistribute or merge if
  * necessary.
  */
-void BPlusTree::Remove(const GenericKey *key, Txn *transaction) {
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Remove(const GenericKey *key, Txn *transaction) {
+  WriteContext ctx;
+  root_latch_.WLock();
+  ctx.root_latched = true;
   if (IsEmpty()) {
+    ReleaseWriteContext(ctx);
     return;
   }
-  // std::cout << "root_page_id: " << root_page_id_ << std::endl;
-  Page *page = FindLeafPage(key);
-  if (page == nullptr) {
-    return;
-  }
+  Page *page = FindLeafPageForWrite(key, Operation::kRemove, ctx);
   LeafPage *leaf = reinterpret_cast<LeafPage *>(page->GetData());
-  leaf->RemoveAndDeleteRecord(key, processor_);
-  if (!leaf->IsRootPage())  // update its parent if necessarily
-  {
-    InternalPage *parent =
-        reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(leaf->GetParentPageId())->GetData());
-    for (int i = 0; i < parent->GetSize(); i++) {
-      if (parent->ValueAt(i) == leaf->GetPageId()) {
-        parent->SetKeyAt(i, leaf->KeyAt(0));
-        if (i == 0 && !parent->IsRootPage())  // if parent is not root and it's updated
-        {
-          InternalPage *grandParent =
-              reinterpret_cast<InternalPage *>(buffer_pool_manager_->FetchPage(parent->GetParentPageId())->GetData());
-          for (int j = 0; j < grandParent->GetSize(); j++) {
-            if (grandParent->ValueAt(j) == parent->GetPageId()) {
-              grandParent->SetKeyAt(j, parent->KeyAt(0));
-              break;
-            }
-          }
-          buffer_pool_manager_->UnpinPage(grandParent->GetPageId(), true);
-        }
-        break;
-      }
-    }
-    buffer_pool_manager_->UnpinPage(parent->GetPageId(), true);
+  if (leaf->RemoveAndDeleteRecord(key, comparator_) != -1 && leaf->GetSize() < leaf->GetMinSize()) {
+    CoalesceOrRedistribute(leaf, ctx);
   }
-  if (leaf->GetSize() < leaf->GetMinSize()) {  // if the leaf's size is less than minimum
-    // std::cout << "<" << endl;
-    CoalesceOrRedistribute(leaf, transaction);
-  }
-  buffer_pool_manager_->UnpinPage(leaf->GetPageId(), true);
+  ReleaseWriteContext(ctx);
 }
 
-/* todo
+/*
  * User needs to first find the sibling of input page. If sibling's size + input
  * page's size > page's max size, then redistribute. Otherwise, merge.
  * Using template N to represent either internal page or leaf page.
- * @return: true means target leaf page should be deleted, false means no
- * deletion happens
+ * node and its parent are write-latched in ctx, the sibling is latched here. A merge always empties the right one of
+ * the two pages and queues it in ctx for deletion. If the parent has no room for the separator a redistribution
+ * needs, node is left underfull.
  */
+INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-bool BPlusTree::CoalesceOrRedistribute(N *&node, Txn *transaction) {
-  if (node->IsRootPage()) {  // if parent is root
-    return AdjustRoot(node);
+void BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, WriteContext &ctx) {
+  if (node->IsRootPage()) {
+    AdjustRoot(node, ctx);
+    return;
   }
   // get the parent page of node
   page_id_t parent_id = node->GetParentPageId();
@@ -347,22 +565,37 @@ bool BPlusTree::CoalesceOrRedistribute(N *&node, Txn *transaction) {
   // if node's index is 0, then sibling's index is 1
   // if node's index is >= 1, then sibling's index is 1 less than node's index
   int sibling_index = (index == 0) ? 1 : index - 1;
-  N *sibling = reinterpret_cast<N *>(buffer_pool_manager_->FetchPage(parent->ValueAt(sibling_index))->GetData());
-  bool should_delete = false;
+  Page *sibling_page = buffer_pool_manager_->FetchPage(parent->ValueAt(sibling_index));
+  sibling_page->WLatch();
+  N *sibling = reinterpret_cast<N *>(sibling_page->GetData());
 
-  if (node->GetSize() + sibling->GetSize() <
-      node->GetMaxSize()) {  // the sum of node's and sibling's size is smaller than page's max size, need to coalesce
-    if (index == 0) {        // node is to the left of sibling
-      should_delete = Coalesce(node, sibling, parent, index, transaction);
+  // the two pages fit in one, need to coalesce
+  if (index == 0 ? CanCoalesce(node, sibling, parent, 1) : CanCoalesce(sibling, node, parent, index)) {
+    if (index == 0) {  // node is to the left of sibling
+      Coalesce(node, sibling, parent, index, ctx);
     } else {  // sibling is to the left of node
-      should_delete = Coalesce(sibling, node, parent, sibling_index, transaction);
+      Coalesce(sibling, node, parent, sibling_index, ctx);
     }
   } else {
-    Redistribute(sibling, node, index);
+    Redistribute(sibling, node, parent, index);
   }
+  sibling_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(sibling->GetPageId(), true);
   buffer_pool_manager_->UnpinPage(parent_id, true);
-  return should_delete;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::CanCoalesce(LeafPage *left, LeafPage *right, [[maybe_unused]] InternalPage *parent,
+                                 [[maybe_unused]] int index) const {
+  return left->CanMerge(right);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::CanCoalesce(InternalPage *left, InternalPage *right, InternalPage *parent, int index) const {
+  std::vector<char> middle_key(processor_.GetKeySize());
+  auto *middle = reinterpret_cast<GenericKey *>(middle_key.data());
+  parent->KeyAt(index, middle);
+  return left->CanMerge(right, middle);
 }
 
 /*
@@ -374,52 +607,42 @@ bool BPlusTree::CoalesceOrRedistribute(N *&node, Txn *transaction) {
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
  * @param   parent             parent page of input "node"
- * @return  true means parent node should be deleted, false means no deletion happened
  */
 // move all the key & value pairs from node to neighbor_node, delete node
 // index is the index of the neighbor_node
 // neighbor_node is to the left of node
-bool BPlusTree::Coalesce(LeafPage *&neighbor_node, LeafPage *&node, InternalPage *&parent, int index,
-                         Txn *transaction) {
-  // std::cout << "neighbor_node: " << neighbor_node->GetPageId() << std::endl;
-  // std::cout << "node: " << node->GetPageId() << std::endl;
-  // std::cout << "index: " << index << std::endl;
-  // std::cout << "neighbor_node_page_id_: " << parent->ValueAt(index) << std::endl;
-  // std::cout << "node_page_id_: " << parent->ValueAt(index + 1) << std::endl;
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Coalesce(LeafPage *neighbor_node, LeafPage *node, InternalPage *parent, int index,
+                              WriteContext &ctx) {
   node->MoveAllTo(neighbor_node);
-  buffer_pool_manager_->UnpinPage(node->GetPageId(), false);
-  buffer_pool_manager_->DeletePage(node->GetPageId());
-  parent->Remove(index);
-  // Page *page = buffer_pool_manager_->FetchPage(parent->ValueAt(index - 1));
-  // BPlusTreeLeafPage *new_r = reinterpret_cast<BPlusTreeLeafPage *>(page->GetData());
-  // parent->SetKeyAt(index - 1, new_r->KeyAt(0));
+  ctx.deleted_page_ids.push_back(node->GetPageId());
+  parent->Remove(index + 1);
   if (parent->GetSize() < parent->GetMinSize()) {  // if the parent's size is smaller than minimum
-    return CoalesceOrRedistribute(parent, transaction);
+    CoalesceOrRedistribute(parent, ctx);
   }
-
-  return false;
 }
 
 // move all the key & value pairs from node to neighbor_node, delete node
 // index is the index of the neighbor_node
 // neighbor_node is to the left of node
-bool BPlusTree::Coalesce(InternalPage *&neighbor_node, InternalPage *&node, InternalPage *&parent, int index,
-                         Txn *transaction) {
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::Coalesce(InternalPage *neighbor_node, InternalPage *node, InternalPage *parent, int index,
+                              WriteContext &ctx) {
 #ifdef ENABLE_INDEX_DEBUG
   std::cout << "Internal Coalesce" << std::endl;
   std::cout << "neighbor_node: " << neighbor_node->GetPageId() << std::endl;
   std::cout << "node: " << node->GetPageId() << std::endl;
   std::cout << "index: " << index << std::endl;
 #endif
-  node->MoveAllTo(neighbor_node, parent->KeyAt(index + 1), buffer_pool_manager_);
-  buffer_pool_manager_->UnpinPage(node->GetPageId(), false);
-  buffer_pool_manager_->DeletePage(node->GetPageId());
-  parent->Remove(index);
-
+  std::vector<char> middle_key(processor_.GetKeySize());
+  auto *middle = reinterpret_cast<GenericKey *>(middle_key.data());
+  parent->KeyAt(index + 1, middle);
+  node->MoveAllTo(neighbor_node, middle, buffer_pool_manager_);
+  ctx.deleted_page_ids.push_back(node->GetPageId());
+  parent->Remove(index + 1);
   if (parent->GetSize() < parent->GetMinSize()) {
-    return CoalesceOrRedistribute(parent, transaction);
+    CoalesceOrRedistribute(parent, ctx);
   }
-  return false;
 }
 
 /*
@@ -434,42 +657,65 @@ bool BPlusTree::Coalesce(InternalPage *&neighbor_node, InternalPage *&node, Inte
 // "index" is the index of "node"
 // node has fewer keys than the minimum size
 // allocate one pair from neighbor_node to node
-void BPlusTree::Redistribute(LeafPage *neighbor_node, LeafPage *node, int index) {
-  // fetch the parent page of neighbor_node and node
-  page_id_t parent_id = node->GetParentPageId();
-  Page *page = buffer_pool_manager_->FetchPage(parent_id);
-  InternalPage *parent = reinterpret_cast<InternalPage *>(page->GetData());
-
+// the separator is set in the parent first, nothing moves if it does not fit
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::Redistribute(LeafPage *neighbor_node, LeafPage *node, InternalPage *parent, int index) {
+  int size = neighbor_node->GetSize();
+  if (size < 2) {
+    return false;
+  }
+  int width = processor_.GetKeySize();
+  std::vector<char> keys(3 * width);
+  auto *left_key = reinterpret_cast<GenericKey *>(keys.data());
+  auto *right_key = reinterpret_cast<GenericKey *>(keys.data() + width);
+  auto *separator = reinterpret_cast<GenericKey *>(keys.data() + 2 * width);
   if (index == 0) {  // node is to the left of neighbor_node
+    neighbor_node->KeyAt(0, left_key);
+    neighbor_node->KeyAt(1, right_key);
+    Separator(left_key, right_key, separator);
+    if (!parent->SetKeyAt(1, separator)) {
+      return false;
+    }
     neighbor_node->MoveFirstToEndOf(node);
-    parent->SetKeyAt(1, neighbor_node->KeyAt(0));
   } else {  // neighbor_node is to the left of node
+    neighbor_node->KeyAt(size - 2, left_key);
+    neighbor_node->KeyAt(size - 1, right_key);
+    Separator(left_key, right_key, separator);
+    if (!parent->SetKeyAt(index, separator)) {
+      return false;
+    }
     neighbor_node->MoveLastToFrontOf(node);
-    parent->SetKeyAt(index, node->KeyAt(0));
   }
-
-  buffer_pool_manager_->UnpinPage(parent_id, false);
+  return true;
 }
 
 // "index" is the index of "node"
 // the redistribution process for internal page
 // allocate one pair from neighbor_node to node
-void BPlusTree::Redistribute(InternalPage *neighbor_node, InternalPage *node, int index) {
-  // fetch the parent page of neighbor_node and node
-  page_id_t parent_id = node->GetParentPageId();
-  Page *page = buffer_pool_manager_->FetchPage(parent_id);
-  InternalPage *parent = reinterpret_cast<InternalPage *>(page->GetData());
-
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::Redistribute(InternalPage *neighbor_node, InternalPage *node, InternalPage *parent, int index) {
+  int size = neighbor_node->GetSize();
+  if (size < 2) {
+    return false;
+  }
+  int width = processor_.GetKeySize();
+  std::vector<char> keys(2 * width);
+  auto *middle = reinterpret_cast<GenericKey *>(keys.data());
+  auto *separator = reinterpret_cast<GenericKey *>(keys.data() + width);
+  // the key of parent moves down to node, and the key next to the moved child moves up
+  int parent_index = index == 0 ? 1 : index;
+  parent->KeyAt(parent_index, middle);
+  neighbor_node->KeyAt(index == 0 ? 1 : size - 1, separator);
+  // update the key of parent
+  if (!parent->SetKeyAt(parent_index, separator)) {
+    return false;
+  }
   if (index == 0) {
-    neighbor_node->MoveFirstToEndOf(node, parent->KeyAt(1), buffer_pool_manager_);
-    // update the key of parent
-    parent->SetKeyAt(1, neighbor_node->KeyAt(0));
+    neighbor_node->MoveFirstToEndOf(node, middle, buffer_pool_manager_);
   } else {
-    neighbor_node->MoveLastToFrontOf(node, parent->KeyAt(index), buffer_pool_manager_);
-    parent->SetKeyAt(index, node->KeyAt(0));
+    neighbor_node->MoveLastToFrontOf(node, middle, buffer_pool_manager_);
   }
-
-  buffer_pool_manager_->UnpinPage(parent_id, false);
+  return true;
 }
 
 /*
@@ -479,37 +725,27 @@ void BPlusTree::Redistribute(InternalPage *neighbor_node, InternalPage *node, in
  * case 1: when you delete the last element in root page, but root page still
  * has one last child
  * case 2: when you delete the last element in whole b+ tree
- * @return : true means root page should be deleted, false means no deletion
- * happened
+ * The old root is queued in ctx for deletion. root_latch_ is still held since the root was not safe.
  */
 // to delete the root page, decrement the number of layers by 1
-bool BPlusTree::AdjustRoot(BPlusTreePage *old_root_node) {
-  if (old_root_node->GetSize() > 1) {
-    return false;
-  }
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node, WriteContext &ctx) {
   if (old_root_node->IsLeafPage()) {
+    if (old_root_node->GetSize() > 0) {
+      return;
+    }
     root_page_id_ = INVALID_PAGE_ID;
   } else {
-    InternalPage *root = reinterpret_cast<InternalPage *>(old_root_node);
-    root_page_id_ = root->ValueAt(0);
-    Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
-    BPlusTreePage *new_r = reinterpret_cast<BPlusTreePage *>(page->GetData());
-    if (new_r->IsLeafPage() && new_r->GetSize() == 0) {
-      root_page_id_ = root->ValueAt(1);
-    } else if (!(new_r->IsLeafPage()) && new_r->GetSize() == 0) {
-      root_page_id_ = root->ValueAt(1);
-    } else {
-      ;
-    }
-    page = buffer_pool_manager_->FetchPage(root_page_id_);
-    if (page != nullptr) {
-      BPlusTreePage *new_root = reinterpret_cast<BPlusTreePage *>(page->GetData());
-      new_root->SetParentPageId(INVALID_PAGE_ID);
-      buffer_pool_manager_->UnpinPage(root_page_id_, true);
+    if (old_root_node->GetSize() > 1) {
+      return;
     }
+    root_page_id_ = reinterpret_cast<InternalPage *>(old_root_node)->RemoveAndReturnOnlyChild();
+    Page *page = buffer_pool_manager_->FetchPage(root_page_id_);
+    reinterpret_cast<BPlusTreePage *>(page->GetData())->SetParentPageId(INVALID_PAGE_ID);
+    buffer_pool_manager_->UnpinPage(root_page_id_, true);
   }
-  buffer_pool_manager_->DeletePage(old_root_node->GetPageId());
-  return true;
+  UpdateRootPageId();
+  ctx.deleted_page_ids.push_back(old_root_node->GetPageId());
 }
 
 /*****************************************************************************
@@ -520,15 +756,16 @@ bool BPlusTree::AdjustRoot(BPlusTreePage *old_root_node) {
  * index iterator
  * @return : index iterator
  */
-IndexIterator BPlusTree::Begin() {
-  Page *page = FindLeafPage(nullptr, root_page_id_, true);
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
+  Page *page = FindLeafPage(nullptr, INVALID_PAGE_ID, true);
   if (page == nullptr) {
 #ifdef ENABLE_INDEX_DEBUG
     LOG(INFO) << "get a null begin iterator" << endl;
 #endif
     return End();
   }
-  return IndexIterator(page->GetPageId(), buffer_pool_manager_, 0);
+  return INDEXITERATOR_TYPE(page, buffer_pool_manager_, 0);
 }
 
 /*
@@ -536,15 +773,17 @@ IndexIterator BPlusTree::Begin() {
  * first, then construct index iterator
  * @return : index iterator
  */
-IndexIterator BPlusTree::Begin(const GenericKey *key) {
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const GenericKey *key) {
+#ifdef USE_OPTIMISTIC_LOCK_COUPLING
+  Page *page = FindLeafPageOptimistic(key);
+#else
   Page *page = FindLeafPage(key);
+#endif
   if (page == nullptr) return End();
   auto leaf_page = reinterpret_cast<LeafPage *>(page->GetData());
-  int index = leaf_page->KeyIndex(key, processor_);
-  if (index == leaf_page->GetSize())
-    return End();
-  else
-    return IndexIterator(page->GetPageId(), buffer_pool_manager_, index);
+  // 若key比叶子中所有key都大，迭代器会移动到下一个叶子的第一项
+  return INDEXITERATOR_TYPE(page, buffer_pool_manager_, leaf_page->KeyIndex(key, comparator_));
 }
 
 /*
@@ -552,7 +791,8 @@ IndexIterator BPlusTree::Begin(const GenericKey *key) {
  * of the key/value pair in the leaf node
  * @return : index iterator
  */
-IndexIterator BPlusTree::End() { return IndexIterator(INVALID_PAGE_ID, buffer_pool_manager_, 0); }
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_TYPE::End() { return INDEXITERATOR_TYPE(); }
 
 /*****************************************************************************
  * UTILITIES AND DEBUG
@@ -560,27 +800,104 @@ IndexIterator BPlusTree::End() { return IndexIterator(INVALID_PAGE_ID, buffer_po
 /*
  * Find leaf page containing particular key, if leftMost flag == true, find
  * the left most leaf page
- * Note: the leaf page is pinned, you need to unpin it after use.
+ * Read latches are taken hand over hand: a child is latched before its parent is released.
+ * Note: the leaf page is pinned and read-latched, you need to unlatch and unpin it after use.
  */
-Page *BPlusTree::FindLeafPage(const GenericKey *key, page_id_t page_id, bool leftMost) {
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPage(const GenericKey *key, page_id_t page_id, bool leftMost) {
+  root_latch_.RLock();
   if (IsEmpty()) {
+    root_latch_.RUnlock();
     return nullptr;
   }
   if (page_id == INVALID_PAGE_ID) {
     page_id = root_page_id_;
   }
   Page *page = buffer_pool_manager_->FetchPage(page_id);
+  page->RLatch();
+  root_latch_.RUnlock();
   BPlusTreePage *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
   while (!node->IsLeafPage()) {
     InternalPage *internal = reinterpret_cast<InternalPage *>(node);
-    page_id = leftMost ? internal->ValueAt(0) : internal->Lookup(key, processor_);
+    page_id = leftMost ? internal->ValueAt(0) : internal->Lookup(key, comparator_);
+    Page *child = buffer_pool_manager_->FetchPage(page_id);
+    child->RLatch();
+    page->RUnlatch();
     buffer_pool_manager_->UnpinPage(node->GetPageId(), false);
-    page = buffer_pool_manager_->FetchPage(page_id);
+    page = child;
     node = reinterpret_cast<BPlusTreePage *>(page->GetData());
   }
   return page;
 }
 
+/*
+ * Optimistic lock coupling. For every page on the way down: pin it, read its version, check that the page it was
+ * reached from is unchanged (its parent's version, or root_page_id_ for the root), and only then look at its data.
+ * An internal page is copied and the copy is searched only if the version did not move while copying, so a torn
+ * page is never interpreted. Internal pages are never latched, the leaf is read-latched and checked against the
+ * version read before. A conflict unpins everything and restarts from the root, and after OPTIMISTIC_MAX_RESTARTS
+ * conflicts the lookup falls back to FindLeafPage.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafPageOptimistic(const GenericKey *key) {
+  alignas(CACHE_LINE_SIZE) char snapshot[PAGE_SIZE];
+  for (int attempt = 0; attempt < OPTIMISTIC_MAX_RESTARTS; attempt++) {
+    page_id_t page_id = root_page_id_;
+    if (page_id == INVALID_PAGE_ID) {
+      return nullptr;
+    }
+    Page *parent = nullptr;
+    uint64_t parent_version = 0;
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    while (page != nullptr) {
+      uint64_t version = page->GetVersion();
+      // the page may have been split, merged or even freed since its id was read
+      bool valid = parent == nullptr ? root_page_id_ == page_id : parent->GetVersion() == parent_version;
+      if (!valid || (version & 1) != 0) {
+        break;
+      }
+      auto *node = reinterpret_cast<BPlusTreePage *>(page->GetData());
+      if (node->IsLeafPage()) {
+        page->RLatch();
+        if (page->GetVersion() != version) {
+          page->RUnlatch();
+          break;
+        }
+        if (parent != nullptr) {
+          buffer_pool_manager_->UnpinPage(parent->GetPageId(), false);
+        }
+        return page;
+      }
+      // the header may be torn, check the bytes to copy before trusting them
+      int size = node->GetSize();
+      int64_t used = reinterpret_cast<InternalPage *>(node)->UsedBytes();
+      if (size < 0 || size > node->GetMaxSize() + 1 || used > PAGE_SIZE) {
+        break;
+      }
+      memcpy(snapshot, page->GetData(), used);
+      if (page->GetVersion() != version) {
+        break;
+      }
+      if (parent != nullptr) {
+        buffer_pool_manager_->UnpinPage(parent->GetPageId(), false);
+      }
+      parent = page;
+      parent_version = version;
+      page_id = reinterpret_cast<InternalPage *>(snapshot)->Lookup(key, comparator_);
+      page = buffer_pool_manager_->FetchPage(page_id);
+    }
+    // conflict, release what is pinned and start over
+    if (page != nullptr) {
+      buffer_pool_manager_->UnpinPage(page_id, false);
+    }
+    if (parent != nullptr) {
+      buffer_pool_manager_->UnpinPage(parent->GetPageId(), false);
+    }
+    std::this_thread::yield();
+  }
+  return FindLeafPage(key);
+}
+
 /*
  * Update/Insert root page id in header page(where page_id = 0, header_page is
  * defined under include/page/header_page.h)
@@ -588,12 +905,18 @@ Page *BPlusTree::FindLeafPage(const GenericKey *key, page_id_t page_id, bool lef
  * @parameter: insert_record      default value is false. When set to true,
  * insert a record <index_name, current_page_id> into header page instead of
  * updating it.
+ * An empty tree drops its record, so a later StartNewTree inserts it again.
  */
-void BPlusTree::UpdateRootPageId(int insert_record) {
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
   Page *page = buffer_pool_manager_->FetchPage(INDEX_ROOTS_PAGE_ID);
   IndexRootsPage *root_page = reinterpret_cast<IndexRootsPage *>(page->GetData());
-  if (insert_record) {
-    root_page->Insert(index_id_, root_page_id_);
+  if (root_page_id_ == INVALID_PAGE_ID) {
+    root_page->Delete(index_id_);
+  } else if (insert_record) {
+    if (!root_page->Insert(index_id_, root_page_id_)) {
+      root_page->Update(index_id_, root_page_id_);
+    }
   } else {
     root_page->Update(index_id_, root_page_id_);
   }
@@ -603,7 +926,8 @@ void BPlusTree::UpdateRootPageId(int insert_record) {
 /**
  * This method is used for debug only, You don't need to modify
  */
-void BPlusTree::ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstream &out, Schema *schema) const {
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstream &out, Schema *schema) const {
   std::string leaf_prefix("LEAF_");
   std::string internal_prefix("INT_");
   if (page->IsLeafPage()) {
@@ -620,9 +944,11 @@ void BPlusTree::ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstre
     out << "<TR><TD COLSPAN=\"" << leaf->GetSize() << "\">" << "max_size=" << leaf->GetMaxSize()
         << ",min_size=" << leaf->GetMinSize() << ",size=" << leaf->GetSize() << "</TD></TR>\n";
     out << "<TR>";
+    std::vector<char> key(processor_.GetKeySize());
     for (int i = 0; i < leaf->GetSize(); i++) {
       Row ans;
-      processor_.DeserializeToKey(leaf->KeyAt(i), ans, schema);
+      leaf->KeyAt(i, reinterpret_cast<GenericKey *>(key.data()));
+      processor_.DeserializeToKey(reinterpret_cast<GenericKey *>(key.data()), ans, schema);
       out << "<TD>" << "Field: " << ans.GetField(0)->toString() << " PageId: " << leaf->ValueAt(i).GetPageId()
           << " SlotNum: " << leaf->ValueAt(i).GetSlotNum() << "</TD>\n";
     }
@@ -654,11 +980,13 @@ void BPlusTree::ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstre
     out << "<TR><TD COLSPAN=\"" << inner->GetSize() << "\">" << "max_size=" << inner->GetMaxSize()
         << ",min_size=" << inner->GetMinSize() << ",size=" << inner->GetSize() << "</TD></TR>\n";
     out << "<TR>";
+    std::vector<char> key(processor_.GetKeySize());
     for (int i = 0; i < inner->GetSize(); i++) {
       out << "<TD PORT=\"p" << inner->ValueAt(i) << "\">";
       if (i > 0) {
         Row ans;
-        processor_.DeserializeToKey(inner->KeyAt(i), ans, schema);
+        inner->KeyAt(i, reinterpret_cast<GenericKey *>(key.data()));
+        processor_.DeserializeToKey(reinterpret_cast<GenericKey *>(key.data()), ans, schema);
         out << ans.GetField(0)->toString();
       } else {
         out << " ";
@@ -693,13 +1021,14 @@ void BPlusTree::ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::ofstre
 /**
  * This function is for debug only, you don't need to modify
  */
-void BPlusTree::ToString(BPlusTreePage *page, BufferPoolManager *bpm) const {
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::ToString(BPlusTreePage *page, BufferPoolManager *bpm) const {
   if (page->IsLeafPage()) {
     auto *leaf = reinterpret_cast<LeafPage *>(page);
     std::cout << "Leaf Page: " << leaf->GetPageId() << " parent: " << leaf->GetParentPageId()
               << " next: " << leaf->GetNextPageId() << std::endl;
     for (int i = 0; i < leaf->GetSize(); i++) {
-      std::cout << leaf->KeyAt(i) << ",";
+      std::cout << leaf->ValueAt(i).GetPageId() << "/" << leaf->ValueAt(i).GetSlotNum() << ",";
     }
     std::cout << std::endl;
     std::cout << std::endl;
@@ -707,7 +1036,7 @@ void BPlusTree::ToString(BPlusTreePage *page, BufferPoolManager *bpm) const {
     auto *internal = reinterpret_cast<InternalPage *>(page);
     std::cout << "Internal Page: " << internal->GetPageId() << " parent: " << internal->GetParentPageId() << std::endl;
     for (int i = 0; i < internal->GetSize(); i++) {
-      std::cout << internal->KeyAt(i) << ": " << internal->ValueAt(i) << ",";
+      std::cout << internal->ValueAt(i) << ",";
     }
     std::cout << std::endl;
     std::cout << std::endl;
@@ -718,10 +1047,19 @@ void BPlusTree::ToString(BPlusTreePage *page, BufferPoolManager *bpm) const {
   }
 }
 
-bool BPlusTree::Check() {
+INDEX_TEMPLATE_ARGUMENTS
+bool BPLUSTREE_TYPE::Check() {
   bool all_unpinned = buffer_pool_manager_->CheckAllUnpinned();
   if (!all_unpinned) {
     LOG(ERROR) << "problem in page unpin" << endl;
   }
   return all_unpinned;
 }
+
+template class BPlusTree<0, KeyManager>;
+template class BPlusTree<4, IntKeyComparator>;
+template class BPlusTree<16, FixedKeyComparator<16>>;
+template class BPlusTree<32, FixedKeyComparator<32>>;
+template class BPlusTree<64, FixedKeyComparator<64>>;
+template class BPlusTree<128, FixedKeyComparator<128>>;
+template class BPlusTree<256, FixedKeyComparator<256>>;
@@ -1,21 +1,29 @@
 #include "index/b_plus_tree_index.h"
 
+#include <chrono>
+#include <exception>
+#include <thread>
+
 #include "index/generic_key.h"
 #include "utils/tree_file_mgr.h"
 #include "page/b_plus_tree_leaf_page.h"
-BPlusTreeIndex::BPlusTreeIndex(index_id_t index_id, IndexSchema *key_schema, size_t key_size,
-                               BufferPoolManager *buffer_pool_manager)
+
+INDEX_TEMPLATE_ARGUMENTS
+BPLUSTREE_INDEX_TYPE::BPlusTreeIndex(index_id_t index_id, IndexSchema *key_schema, size_t key_size,
+                                     BufferPoolManager *buffer_pool_manager)
     : Index(index_id, key_schema),
+      buffer_pool_manager_(buffer_pool_manager),
       processor_(key_schema_, key_size),
       container_(index_id, buffer_pool_manager, processor_) {}
 
-dberr_t BPlusTreeIndex::InsertEntry(const Row &key, RowId row_id, Txn *txn) {
+INDEX_TEMPLATE_ARGUMENTS
+dberr_t BPLUSTREE_INDEX_TYPE::InsertEntry(const Row &key, RowId row_id, Txn *txn) {
   // ASSERT(row_id.Get() != INVALID_ROWID.Get(), "Invalid row id for index insert.");
   GenericKey *index_key = processor_.InitKey();
   processor_.SerializeFromKey(index_key, key, key_schema_);
 
   bool status = container_.Insert(index_key, row_id, txn);
-  delete index_key;
+  free(index_key);
   //  TreeFileManagers mgr("tree_");
   //  static int i = 0;
   //  if (i % 10 == 0) container_.PrintTree(mgr[i]);
@@ -27,16 +35,18 @@ dberr_t BPlusTreeIndex::InsertEntry(const Row &key, RowId row_id, Txn *txn) {
   return DB_SUCCESS;
 }
 
-dberr_t BPlusTreeIndex::RemoveEntry(const Row &key, RowId row_id, Txn *txn) {
+INDEX_TEMPLATE_ARGUMENTS
+dberr_t BPLUSTREE_INDEX_TYPE::RemoveEntry(const Row &key, RowId row_id, Txn *txn) {
   GenericKey *index_key = processor_.InitKey();
   processor_.SerializeFromKey(index_key, key, key_schema_);
 
   container_.Remove(index_key, txn);
-  delete index_key;
+  free(index_key);
   return DB_SUCCESS;
 }
 
-dberr_t BPlusTreeIndex::ScanKey(const Row &key, vector<RowId> &result, Txn *txn, string compare_operator) {
+INDEX_TEMPLATE_ARGUMENTS
+dberr_t BPLUSTREE_INDEX_TYPE::ScanKey(const Row &key, vector<RowId> &result, Txn *txn, string compare_operator) {
   GenericKey *index_key = processor_.InitKey();
   processor_.SerializeFromKey(index_key, key, key_schema_);
   auto end_iter = GetEndIterator();
@@ -72,26 +82,124 @@ dberr_t BPlusTreeIndex::ScanKey(const Row &key, vector<RowId> &result, Txn *txn,
     if (container_.GetValue(index_key, temp, txn))
       result.erase(find(result.begin(), result.end(), temp[0]));
   }
-  delete index_key;
+  free(index_key);
   if (!result.empty())
     return DB_SUCCESS;
   else
     return DB_KEY_NOT_FOUND;
 }
 
-dberr_t BPlusTreeIndex::Destroy() {
+INDEX_TEMPLATE_ARGUMENTS
+dberr_t BPLUSTREE_INDEX_TYPE::Destroy() {
   container_.Destroy();
   return DB_SUCCESS;
 }
 
-IndexIterator BPlusTreeIndex::GetBeginIterator() {
+INDEX_TEMPLATE_ARGUMENTS
+dberr_t BPLUSTREE_INDEX_TYPE::BulkLoad(const std::vector<IndexEntrySource> &sources, [[maybe_unused]] Txn *txn,
+                                       IndexBuildProgress *progress) {
+  if (sources.empty()) {
+    return container_.IsEmpty() ? DB_SUCCESS : DB_FAILED;
+  }
+  // 每个数据源由一个线程扫描，各自排序生成run，排序内存平分
+  std::vector<std::unique_ptr<EXTERNAL_SORTER_TYPE>> sorters;
+  for (size_t i = 0; i < sources.size(); i++) {
+    sorters.emplace_back(new EXTERNAL_SORTER_TYPE(buffer_pool_manager_, processor_,
+                                                  BULK_LOAD_SORT_MEMORY / sources.size()));
+  }
+  std::vector<IndexBuildProgress::Worker> workers(sources.size());
+  std::vector<std::exception_ptr> errors(sources.size());
+  auto scan = [&](size_t i) {
+    auto start = std::chrono::steady_clock::now();
+    GenericKey *index_key = processor_.InitKey();
+    try {
+      Row key;
+      RowId row_id;
+      uint64_t reported = 0;
+      while (sources[i](key, row_id)) {
+        processor_.SerializeFromKey(index_key, key, key_schema_);
+        sorters[i]->Add(index_key, row_id);
+        workers[i].rows++;
+        // 进度按批更新，避免每行都争用同一个计数器
+        if (progress != nullptr && workers[i].rows - reported == 1024) {
+          progress->rows_scanned.fetch_add(1024, std::memory_order_relaxed);
+          reported = workers[i].rows;
+        }
+      }
+      if (progress != nullptr) {
+        progress->rows_scanned.fetch_add(workers[i].rows - reported, std::memory_order_relaxed);
+      }
+      sorters[i]->Seal();
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+    free(index_key);
+    workers[i].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  };
+  if (sources.size() == 1) {
+    scan(0);
+  } else {
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < sources.size(); i++) {
+      threads.emplace_back(scan, i);
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+  for (auto &error : errors) {
+    if (error != nullptr) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // 按数据源的顺序收集所有run，key相同时先扫描到的行在前。未溢出的worker缓冲合起来也放得进排序内存
+  std::unique_ptr<EXTERNAL_SORTER_TYPE> sorter;
+  if (sorters.size() == 1) {
+    sorter = std::move(sorters[0]);
+  } else {
+    sorter.reset(new EXTERNAL_SORTER_TYPE(buffer_pool_manager_, processor_));
+    for (auto &worker : sorters) {
+      sorter->Absorb(*worker);
+      worker.reset();
+    }
+  }
+  if (progress != nullptr) {
+    progress->workers = workers;
+    progress->phase = IndexBuildProgress::Phase::kMerge;
+  }
+  sorter->Finish();
+  if (progress != nullptr) {
+    progress->entries_total = sorter->GetSize();
+    progress->phase = IndexBuildProgress::Phase::kLoad;
+  }
+  bool loaded =
+      container_.BulkLoad(*sorter, BULK_LOAD_FILL_FACTOR, progress == nullptr ? nullptr : &progress->entries_loaded);
+  if (progress != nullptr) {
+    progress->phase = IndexBuildProgress::Phase::kDone;
+  }
+  return loaded ? DB_SUCCESS : DB_FAILED;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator() {
   return container_.Begin();
 }
 
-IndexIterator BPlusTreeIndex::GetBeginIterator(GenericKey *key) {
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetBeginIterator(GenericKey *key) {
   return container_.Begin(key);
 }
 
-IndexIterator BPlusTreeIndex::GetEndIterator() {
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE BPLUSTREE_INDEX_TYPE::GetEndIterator() {
   return container_.End();
-}
\ No newline at end of file
+}
+
+template class BPlusTreeIndex<0, KeyManager>;
+template class BPlusTreeIndex<4, IntKeyComparator>;
+template class BPlusTreeIndex<16, FixedKeyComparator<16>>;
+template class BPlusTreeIndex<32, FixedKeyComparator<32>>;
+template class BPlusTreeIndex<64, FixedKeyComparator<64>>;
+template class BPlusTreeIndex<128, FixedKeyComparator<128>>;
+template class BPlusTreeIndex<256, FixedKeyComparator<256>>;
@@ -0,0 +1,289 @@
+#include "index/external_sort.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNAL_SORTER_TYPE::ExternalSorter(BufferPoolManager *buffer_pool_manager, const KeyManager &KM,
+                                     uint32_t memory_limit)
+    : buffer_pool_manager_(buffer_pool_manager), comparator_(KM), key_size_(KM.GetKeySize()) {
+  entry_size_ = KeyWidth() + sizeof(RowId);
+  entries_per_page_ = PAGE_SIZE / entry_size_;
+  buffer_capacity_ = std::max<size_t>(memory_limit / entry_size_, entries_per_page_);
+  buffer_.reset(new char[buffer_capacity_ * entry_size_]);
+  current_.reset(new char[entry_size_]);
+  last_.reset(new char[entry_size_]);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNAL_SORTER_TYPE::~ExternalSorter() {
+  for (auto &reader : readers_) {
+    FreeRun(reader);
+  }
+  for (auto &run : runs_) {
+    buffer_pool_manager_->DeletePages(run.page_ids);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::Add(const GenericKey *key, const RowId &value) {
+  ASSERT(!finished_, "Add after Finish.");
+  if (buffered_ == buffer_capacity_) {
+    SpillBuffer();
+  }
+  char *entry = buffer_.get() + buffered_ * entry_size_;
+  memcpy(entry, key, KeyWidth());
+  memcpy(entry + KeyWidth(), &value, sizeof(RowId));
+  buffered_++;
+  size_++;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::Seal() {
+  if (!runs_.empty() && buffered_ > 0) {
+    SpillBuffer();
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::Absorb(ExternalSorter &other) {
+  ASSERT(!finished_ && !other.finished_, "Absorb after Finish.");
+  if (!other.runs_.empty()) {
+    // 缓冲中的条目比other的run早，先写出去以保持先后顺序
+    if (buffered_ > 0) {
+      SpillBuffer();
+    }
+    runs_.insert(runs_.end(), std::make_move_iterator(other.runs_.begin()),
+                 std::make_move_iterator(other.runs_.end()));
+    other.runs_.clear();
+  }
+  size_t copied = 0;
+  while (copied < other.buffered_) {
+    if (buffered_ == buffer_capacity_) {
+      SpillBuffer();
+    }
+    size_t count = std::min(buffer_capacity_ - buffered_, other.buffered_ - copied);
+    memcpy(buffer_.get() + buffered_ * entry_size_, other.buffer_.get() + copied * entry_size_, count * entry_size_);
+    buffered_ += count;
+    copied += count;
+  }
+  size_ += other.size_;
+  spilled_runs_ += other.spilled_runs_;
+  other.buffered_ = 0;
+  other.size_ = 0;
+  other.spilled_runs_ = 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::SortBuffer() {
+  sorted_.resize(buffered_);
+  for (size_t i = 0; i < buffered_; i++) {
+    sorted_[i] = buffer_.get() + i * entry_size_;
+  }
+  std::stable_sort(sorted_.begin(), sorted_.end(), [this](const char *a, const char *b) {
+    return comparator_.CompareKeys(KeyOf(a), KeyOf(b)) < 0;
+  });
+  sorted_index_ = 0;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::SpillBuffer() {
+  SortBuffer();
+  RunWriter writer;
+  for (auto entry : sorted_) {
+    Append(writer, entry);
+  }
+  Close(writer);
+  runs_.push_back(std::move(writer.run));
+  spilled_runs_++;
+  buffered_ = 0;
+  sorted_.clear();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::Append(RunWriter &writer, const char *entry) {
+  if (writer.page == nullptr || writer.slot == entries_per_page_) {
+    Close(writer);
+    page_id_t page_id;
+    writer.page = buffer_pool_manager_->NewPage(page_id);
+    if (writer.page == nullptr) {
+      throw std::runtime_error("out of memory");
+    }
+    writer.run.page_ids.push_back(page_id);
+    writer.slot = 0;
+  }
+  memcpy(writer.page->GetData() + writer.slot * entry_size_, entry, entry_size_);
+  writer.slot++;
+  writer.run.size++;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::Close(RunWriter &writer) {
+  if (writer.page != nullptr) {
+    buffer_pool_manager_->UnpinPage(writer.page->GetPageId(), true);
+    writer.page = nullptr;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::Finish() {
+  finished_ = true;
+  if (runs_.empty()) {
+    // 全部在内存中，稳定排序后去掉重复的key，保留最先加入的
+    SortBuffer();
+    sorted_.erase(std::unique(sorted_.begin(), sorted_.end(),
+                              [this](const char *a, const char *b) {
+                                return comparator_.CompareKeys(KeyOf(a), KeyOf(b)) == 0;
+                              }),
+                  sorted_.end());
+    size_ = sorted_.size();
+    return;
+  }
+  if (buffered_ > 0) {
+    SpillBuffer();
+  }
+  // 归并路数过多时先把相邻的run合并，保持加入的先后顺序
+  while (runs_.size() > static_cast<size_t>(BULK_LOAD_MERGE_FAN_IN)) {
+    std::vector<Run> merged;
+    for (size_t begin = 0; begin < runs_.size(); begin += BULK_LOAD_MERGE_FAN_IN) {
+      size_t end = std::min(runs_.size(), begin + BULK_LOAD_MERGE_FAN_IN);
+      OpenReaders(std::vector<Run>(std::make_move_iterator(runs_.begin() + begin),
+                                   std::make_move_iterator(runs_.begin() + end)),
+                  true);
+      RunWriter writer;
+      while (PopMerged(current_.get())) {
+        Append(writer, current_.get());
+      }
+      Close(writer);
+      merged.push_back(std::move(writer.run));
+    }
+    runs_ = std::move(merged);
+  }
+  // 先只读地归并一遍，数出去重后的条数，再打开真正输出的归并
+  OpenReaders(runs_, false);
+  size_ = 0;
+  has_last_ = false;
+  while (PopUnique(current_.get())) {
+    size_++;
+  }
+  OpenReaders(std::move(runs_), true);
+  runs_.clear();
+  has_last_ = false;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNAL_SORTER_TYPE::Next(GenericKey *&key, RowId &value) {
+  ASSERT(finished_, "Next before Finish.");
+  const char *entry;
+  if (readers_.empty()) {
+    if (sorted_index_ == sorted_.size()) {
+      return false;
+    }
+    entry = sorted_[sorted_index_++];
+  } else {
+    if (!PopUnique(current_.get())) {
+      return false;
+    }
+    entry = current_.get();
+  }
+  key = reinterpret_cast<GenericKey *>(const_cast<char *>(entry));
+  memcpy(&value, entry + KeyWidth(), sizeof(RowId));
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNAL_SORTER_TYPE::PopUnique(char *dest) {
+  while (PopMerged(dest)) {
+    if (!has_last_ || comparator_.CompareKeys(KeyOf(dest), KeyOf(last_.get())) != 0) {
+      memcpy(last_.get(), dest, KeyWidth());
+      has_last_ = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::OpenReaders(std::vector<Run> runs, bool consume) {
+  readers_.clear();
+  heap_.clear();
+  readers_.resize(runs.size());
+  for (size_t i = 0; i < runs.size(); i++) {
+    RunReader &reader = readers_[i];
+    reader.run = std::move(runs[i]);
+    reader.remaining = reader.run.size;
+    reader.consume = consume;
+    if (reader.remaining == 0) {
+      FreeRun(reader);
+      continue;
+    }
+    reader.page = buffer_pool_manager_->FetchPage(reader.run.page_ids[0]);
+    heap_.push_back(static_cast<int>(i));
+  }
+  std::make_heap(heap_.begin(), heap_.end(), [this](int a, int b) { return ReaderGreater(a, b); });
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNAL_SORTER_TYPE::PopMerged(char *dest) {
+  if (heap_.empty()) {
+    return false;
+  }
+  // 小根堆，堆顶是最小的key
+  auto greater = [this](int a, int b) { return ReaderGreater(a, b); };
+  std::pop_heap(heap_.begin(), heap_.end(), greater);
+  int index = heap_.back();
+  RunReader &reader = readers_[index];
+  memcpy(dest, reader.page->GetData() + reader.slot * entry_size_, entry_size_);
+  Advance(reader);
+  if (reader.remaining == 0) {
+    heap_.pop_back();
+  } else {
+    std::push_heap(heap_.begin(), heap_.end(), greater);
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNAL_SORTER_TYPE::ReaderGreater(int a, int b) const {
+  const char *ea = readers_[a].page->GetData() + readers_[a].slot * entry_size_;
+  const char *eb = readers_[b].page->GetData() + readers_[b].slot * entry_size_;
+  int cmp = comparator_.CompareKeys(KeyOf(ea), KeyOf(eb));
+  // key 相同时先加入的run在前
+  return cmp > 0 || (cmp == 0 && a > b);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::Advance(RunReader &reader) {
+  reader.slot++;
+  reader.remaining--;
+  if (reader.remaining == 0) {
+    FreeRun(reader);
+    return;
+  }
+  if (reader.slot == entries_per_page_) {
+    buffer_pool_manager_->UnpinPage(reader.page->GetPageId(), false);
+    reader.page_index++;
+    reader.page = buffer_pool_manager_->FetchPage(reader.run.page_ids[reader.page_index]);
+    reader.slot = 0;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNAL_SORTER_TYPE::FreeRun(RunReader &reader) {
+  if (reader.page != nullptr) {
+    buffer_pool_manager_->UnpinPage(reader.page->GetPageId(), false);
+    reader.page = nullptr;
+  }
+  if (reader.consume) {
+    buffer_pool_manager_->DeletePages(reader.run.page_ids);
+  }
+  reader.run.page_ids.clear();
+}
+
+template class ExternalSorter<0, KeyManager>;
+template class ExternalSorter<4, IntKeyComparator>;
+template class ExternalSorter<16, FixedKeyComparator<16>>;
+template class ExternalSorter<32, FixedKeyComparator<32>>;
+template class ExternalSorter<64, FixedKeyComparator<64>>;
+template class ExternalSorter<128, FixedKeyComparator<128>>;
+template class ExternalSorter<256, FixedKeyComparator<256>>;
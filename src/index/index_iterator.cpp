@@ -1,41 +1,93 @@
 #include "index/index_iterator.h"
 
+#include <cstring>
+
 #include "index/basic_comparator.h"
 #include "index/generic_key.h"
 
-IndexIterator::IndexIterator() = default;
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator() = default;
 
-IndexIterator::IndexIterator(page_id_t page_id, BufferPoolManager *bpm, int index)
-    : current_page_id(page_id), item_index(index), buffer_pool_manager(bpm) {
-  if(current_page_id!=INVALID_PAGE_ID)page = reinterpret_cast<LeafPage *>(buffer_pool_manager->FetchPage(current_page_id)->GetData());
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(Page *leaf, BufferPoolManager *bpm, int index)
+    : current_page_id(leaf->GetPageId()), page(leaf), item_index(index), buffer_pool_manager(bpm) {
+  key.reset(new char[reinterpret_cast<LeafPage *>(page->GetData())->KeyWidth()]);
+  Settle();
 }
 
-IndexIterator::~IndexIterator() {
-  if (current_page_id != INVALID_PAGE_ID) buffer_pool_manager->UnpinPage(current_page_id, false);
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(IndexIterator &&other) noexcept
+    : current_page_id(other.current_page_id),
+      page(other.page),
+      item_index(other.item_index),
+      buffer_pool_manager(other.buffer_pool_manager),
+      key(std::move(other.key)),
+      value(other.value) {
+  other.current_page_id = INVALID_PAGE_ID;
+  other.page = nullptr;
 }
 
-std::pair<GenericKey *, RowId> IndexIterator::operator*() { return page->GetItem(item_index); }
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::~IndexIterator() {
+  if (current_page_id != INVALID_PAGE_ID) buffer_pool_manager->UnpinPage(current_page_id, false);
+}
 
-IndexIterator &IndexIterator::operator++() {
-  item_index++;
-  if (item_index >= page->GetSize()) {
-    page_id_t next_page_id = page->GetNextPageId();
-    buffer_pool_manager->UnpinPage(current_page_id, false);
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::Settle() {
+  auto *leaf = reinterpret_cast<LeafPage *>(page->GetData());
+  // 叶子可能已被并发写者清空(合并后保留了next指针)，一直向右找到有效项
+  while (item_index >= leaf->GetSize()) {
+    page_id_t next_page_id = leaf->GetNextPageId();
     if (next_page_id == INVALID_PAGE_ID) {
+      page->RUnlatch();
+      buffer_pool_manager->UnpinPage(current_page_id, false);
       current_page_id = INVALID_PAGE_ID;
       page = nullptr;
       item_index = 0;
-    } else {
-      current_page_id = next_page_id;
-      page = reinterpret_cast<LeafPage *>(buffer_pool_manager->FetchPage(current_page_id)->GetData());
-      item_index = 0;
+      return;
     }
+    Page *next_page = buffer_pool_manager->FetchPage(next_page_id);
+    page->RUnlatch();
+    buffer_pool_manager->UnpinPage(current_page_id, false);
+    next_page->RLatch();
+    current_page_id = next_page_id;
+    page = next_page;
+    item_index = 0;
+    leaf = reinterpret_cast<LeafPage *>(page->GetData());
   }
+  leaf->KeyAt(item_index, reinterpret_cast<GenericKey *>(key.get()));
+  value = leaf->ValueAt(item_index);
+  page->RUnlatch();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+std::pair<GenericKey *, RowId> INDEXITERATOR_TYPE::operator*() {
+  return {reinterpret_cast<GenericKey *>(key.get()), value};
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE &INDEXITERATOR_TYPE::operator++() {
+  if (current_page_id == INVALID_PAGE_ID) {
+    return *this;
+  }
+  page->RLatch();
+  item_index++;
+  Settle();
   return *this;
 }
 
-bool IndexIterator::operator==(const IndexIterator &itr) const {
+INDEX_TEMPLATE_ARGUMENTS
+bool INDEXITERATOR_TYPE::operator==(const IndexIterator &itr) const {
   return current_page_id == itr.current_page_id && item_index == itr.item_index;
 }
 
-bool IndexIterator::operator!=(const IndexIterator &itr) const { return !(*this == itr); }
+INDEX_TEMPLATE_ARGUMENTS
+bool INDEXITERATOR_TYPE::operator!=(const IndexIterator &itr) const { return !(*this == itr); }
+
+template class IndexIterator<0, KeyManager>;
+template class IndexIterator<4, IntKeyComparator>;
+template class IndexIterator<16, FixedKeyComparator<16>>;
+template class IndexIterator<32, FixedKeyComparator<32>>;
+template class IndexIterator<64, FixedKeyComparator<64>>;
+template class IndexIterator<128, FixedKeyComparator<128>>;
+template class IndexIterator<256, FixedKeyComparator<256>>;
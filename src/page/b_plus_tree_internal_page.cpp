@@ -1,11 +1,12 @@
 #include "page/b_plus_tree_internal_page.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "index/generic_key.h"
 
-#define pairs_off (data_)
-#define pair_size (GetKeySize() + sizeof(page_id_t))
-#define key_off 0
-#define val_off GetKeySize()
+// an entry with a full width key, the form used to move entries between layouts
+#define entry_size (KeyWidth() + sizeof(page_id_t))
 
 /**
  * TODO: Student Implement
@@ -18,46 +19,228 @@
  * Including set page type, set current size, set page id, set parent id and set
  * max page size
  */
-void InternalPage::Init(page_id_t page_id, page_id_t parent_id, int key_size, int max_size) {
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int key_size, int max_size,
+                                          bool compressed) {
   SetPageId(page_id);
   SetParentPageId(parent_id);
   SetKeySize(key_size);
-  SetMaxSize(max_size);
+  SetFixedMaxSize(max_size);
+  ASSERT(!kIntKeys || (!compressed && max_size < kIntCapacity), "Int page overflows.");
+  SetCompressed(compressed);
+  SetLayout(0, compressed ? 0 : KeyWidth());
+  SetMaxSize(MaxSizeFor(GetPrefixSize(), GetSlotWidth()));
   SetSize(0);
   SetPageType(IndexPageType::INTERNAL_PAGE);
 }
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::Capacity(int prefix_size, int slot_width) const {
+  if (kIntKeys) {
+    return kIntCapacity;
+  }
+  return (static_cast<int>(sizeof(data_)) - prefix_size) / (slot_width + static_cast<int>(sizeof(page_id_t)));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::MaxSizeFor(int prefix_size, int slot_width) const {
+  if (!IsCompressed()) {
+    return GetFixedMaxSize();
+  }
+  // 留一个位置给分裂前的溢出项，且不超过定长时的两倍减二，分裂出的两半都还能放下任意 key
+  return std::max(GetFixedMaxSize(), std::min(Capacity(prefix_size, slot_width) - 1, 2 * GetFixedMaxSize() - 2));
+}
+
 /*
  * Helper method to get/set the key associated with input "index"(a.k.a
  * array offset)
  */
-GenericKey *InternalPage::KeyAt(int index) {
-  return reinterpret_cast<GenericKey *>(pairs_off + index * pair_size + key_off);
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index, GenericKey *key) const {
+  auto *dest = reinterpret_cast<char *>(key);
+  int prefix_size = GetPrefixSize();
+  int slot_width = GetSlotWidth();
+  memcpy(dest, data_, prefix_size);
+  memcpy(dest + prefix_size, KeySlot(index), slot_width);
+  memset(dest + prefix_size + slot_width, 0, KeyWidth() - prefix_size - slot_width);
 }
 
-void InternalPage::SetKeyAt(int index, GenericKey *key) {
-  memcpy(pairs_off + index * pair_size + key_off, key, GetKeySize());
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const GenericKey *key) {
+  auto *src = reinterpret_cast<const char *>(key);
+  if (LayoutFits(src)) {
+    memcpy(KeySlot(index), src + GetPrefixSize(), GetSlotWidth());
+    return true;
+  }
+  std::vector<char> buf(GetSize() * entry_size);
+  Unpack(buf.data());
+  memcpy(buf.data() + index * entry_size, src, KeyWidth());
+  return Pack(buf.data(), GetSize());
 }
 
-page_id_t InternalPage::ValueAt(int index) const {
-  return *reinterpret_cast<const page_id_t *>(pairs_off + index * pair_size + val_off);
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const {
+  page_id_t value;
+  memcpy(&value, ValueSlot(index), sizeof(page_id_t));
+  return value;
 }
 
-void InternalPage::SetValueAt(int index, page_id_t value) {
-  *reinterpret_cast<page_id_t *>(pairs_off + index * pair_size + val_off) = value;
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetValueAt(int index, page_id_t value) {
+  memcpy(ValueSlot(index), &value, sizeof(page_id_t));
 }
 
-int InternalPage::ValueIndex(const page_id_t &value) const {
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const page_id_t &value) const {
   for (int i = 0; i < GetSize(); ++i) {
     if (ValueAt(i) == value) return i;
   }
   return -1;
 }
 
-void *InternalPage::PairPtrAt(int index) { return KeyAt(index); }
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveSlots(int to, int from, int count) {
+  if (count <= 0) {
+    return;
+  }
+  if (kIntKeys) {
+    memmove(KeySlot(to), KeySlot(from), count * sizeof(int32_t));
+    memmove(ValueSlot(to), ValueSlot(from), count * sizeof(page_id_t));
+  } else {
+    memmove(SlotAt(to), SlotAt(from), count * SlotSize());
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::LayoutFits(const char *key) const {
+  if (!IsCompressed()) {
+    return true;
+  }
+  int prefix_size = GetPrefixSize();
+  return memcmp(key, data_, prefix_size) == 0 && KeyLength(key, KeyWidth()) <= prefix_size + GetSlotWidth();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::CommonPrefixAt(int index, const char *key) const {
+  int prefix_size = GetPrefixSize();
+  int length = CommonPrefix(data_, key, prefix_size);
+  if (length < prefix_size) {
+    return length;
+  }
+  length += CommonPrefix(KeySlot(index), key + prefix_size, GetSlotWidth());
+  if (length < prefix_size + GetSlotWidth()) {
+    return length;
+  }
+  // 槽之后的字节都是 0
+  while (length < KeyWidth() && key[length] == 0) length++;
+  return length;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::MaxSizeWith(const GenericKey *key) const {
+  if (!IsCompressed()) {
+    return GetMaxSize();
+  }
+  auto *src = reinterpret_cast<const char *>(key);
+  int max_length = KeyLength(src, KeyWidth());
+  if (GetSize() <= 1) {
+    return MaxSizeFor(max_length, 0);
+  }
+  // key 排在最后，公共前缀是它和第一个 key 的公共前缀
+  max_length = std::max(max_length, GetPrefixSize() + GetSlotWidth());
+  int prefix_size = std::min(CommonPrefixAt(1, src), max_length);
+  return MaxSizeFor(prefix_size, max_length - prefix_size);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int64_t B_PLUS_TREE_INTERNAL_PAGE_TYPE::UsedBytes() const {
+  if (kIntKeys) {
+    return INTERNAL_PAGE_HEADER_SIZE + kValuesOffset + static_cast<int64_t>(GetSize()) * sizeof(page_id_t);
+  }
+  return INTERNAL_PAGE_HEADER_SIZE + GetPrefixSize() + static_cast<int64_t>(GetSize()) * SlotSize();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Unpack(char *buf) const {
+  if (!IsCompressed() && !kIntKeys) {
+    memcpy(buf, data_, GetSize() * entry_size);
+    return;
+  }
+  for (int i = 0; i < GetSize(); i++) {
+    char *entry = buf + i * entry_size;
+    KeyAt(i, reinterpret_cast<GenericKey *>(entry));
+    memcpy(entry + KeyWidth(), ValueSlot(i), sizeof(page_id_t));
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::Pack(const char *buf, int size) {
+  int width = KeyWidth();
+  int prefix_size = 0;
+  int slot_width = width;
+  if (IsCompressed()) {
+    // key 有序，公共前缀就是第一个和最后一个 key 的公共前缀
+    int max_length = 0;
+    for (int i = 1; i < size; i++) {
+      max_length = std::max(max_length, KeyLength(buf + i * entry_size, width));
+    }
+    if (size > 1) {
+      prefix_size = std::min(CommonPrefix(buf + entry_size, buf + (size - 1) * entry_size, width), max_length);
+    }
+    slot_width = max_length - prefix_size;
+  }
+  if (size > Capacity(prefix_size, slot_width)) {
+    return false;
+  }
+  SetLayout(prefix_size, slot_width);
+  if (size > 1) {
+    memcpy(data_, buf + entry_size, prefix_size);
+  }
+  for (int i = 0; i < size; i++) {
+    const char *entry = buf + i * entry_size;
+    char *slot = KeySlot(i);
+    if (i == 0 && IsCompressed()) {
+      memset(slot, 0, slot_width);
+    } else {
+      memcpy(slot, entry + prefix_size, slot_width);
+    }
+    memcpy(ValueSlot(i), entry + width, sizeof(page_id_t));
+  }
+  SetSize(size);
+  SetMaxSize(MaxSizeFor(prefix_size, slot_width));
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertAt(int index, const GenericKey *key, page_id_t value) {
+  auto *src = reinterpret_cast<const char *>(key);
+  int size = GetSize();
+  if (LayoutFits(src) && size < Capacity(GetPrefixSize(), GetSlotWidth())) {
+    MoveSlots(index + 1, index, size - index);
+    memcpy(KeySlot(index), src + GetPrefixSize(), GetSlotWidth());
+    SetValueAt(index, value);
+    IncreaseSize(1);
+    return true;
+  }
+  // 布局放不下这个 key，展开成定长的项后重新选择布局
+  std::vector<char> buf((size + 1) * entry_size);
+  Unpack(buf.data());
+  char *entry = buf.data() + index * entry_size;
+  memmove(entry + entry_size, entry, (size - index) * entry_size);
+  memcpy(entry, src, KeyWidth());
+  memcpy(entry + KeyWidth(), &value, sizeof(page_id_t));
+  return Pack(buf.data(), size + 1);
+}
 
-void InternalPage::PairCopy(void *dest, void *src, int pair_num) {
-  memcpy(dest, src, pair_num * (GetKeySize() + sizeof(page_id_t)));
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Adopt(page_id_t child, BufferPoolManager *buffer_pool_manager) {
+  Page *page = buffer_pool_manager->FetchPage(child);
+  if (page != nullptr) {
+    reinterpret_cast<BPlusTreePage *>(page->GetData())->SetParentPageId(GetPageId());
+    buffer_pool_manager->UnpinPage(child, true);
+  }
 }
+
 /*****************************************************************************
  * LOOKUP
  *****************************************************************************/
@@ -67,58 +250,44 @@ void InternalPage::PairCopy(void *dest, void *src, int pair_num) {
  * Start the search from the second key(the first key should always be invalid)
  * 用了二分查找
  */
-page_id_t InternalPage::Lookup(const GenericKey *key, const KeyManager &KM) {
-  // int left = 1;  // The first key is invalid
-  // //TODO:left=1? right? ValueAt?
-  // int right = GetSize() - 1;
-  // while (left <= right) {
-  //   int mid = (left + right) / 2;
-  //   if (KM.CompareKeys(KeyAt(mid), key) == 0) {
-  //     return ValueAt(mid);
-  //   }
-  //   if (KM.CompareKeys(KeyAt(mid), key) < 0) {
-  //     left = mid + 1;
-  //   } else {
-  //     right = mid - 1;
-  //   }
-  // }
-  // return ValueAt(left - 1);
-
-  // the case that key is at the most left child
-  if (KM.CompareKeys(KeyAt(1), key) > 0) {
-    return ValueAt(0);
-  }
-  // the case that key is at the most right child
-  if (KM.CompareKeys(KeyAt(GetSize() - 1), key) <= 0) {
-    return ValueAt(GetSize() - 1);
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const GenericKey *key, const KeyComparator &KM) const {
+  // 找最后一个 KeyAt(i) <= key 的 i (i >= 1)，找不到时走最左的孩子
+  if constexpr (kIntKeys) {
+    // 连续存放的 int key 用 SIMD 比较，数出不大于 key 的个数
+    int32_t k;
+    memcpy(&k, key, sizeof(k));
+    return ValueAt(SearchIntKeys(KeySlot(1), GetSize() - 1, k, true));
   }
-  // the case that key is in the middle
   int left = 1;
-  int right = GetSize() - 2;
+  int right = GetSize() - 1;
+  if (!IsCompressed()) {
+    while (left <= right) {
+      int mid = (left + right) / 2;
+      if (KM.CompareKeys(reinterpret_cast<const GenericKey *>(SlotAt(mid)), key) <= 0) {
+        left = mid + 1;
+      } else {
+        right = mid - 1;
+      }
+    }
+    return ValueAt(left - 1);
+  }
+  // 压缩页先和公共前缀比较，前缀相同时只需比较槽中的字节，槽之后分隔 key 都是 0
+  auto *src = reinterpret_cast<const char *>(key);
+  int prefix_size = GetPrefixSize();
+  int cmp = memcmp(src, data_, prefix_size);
+  if (cmp != 0) {
+    return ValueAt(cmp < 0 ? 0 : GetSize() - 1);
+  }
   while (left <= right) {
     int mid = (left + right) / 2;
-    if (KM.CompareKeys(KeyAt(mid), key) <= 0 && KM.CompareKeys(KeyAt(mid + 1), key) > 0) {
-      return ValueAt(mid);
-    } else if (KM.CompareKeys(KeyAt(mid), key) > 0) {
-      right = mid - 1;
-    } else {
+    if (memcmp(SlotAt(mid), src + prefix_size, GetSlotWidth()) <= 0) {
       left = mid + 1;
+    } else {
+      right = mid - 1;
     }
   }
-
-  return ValueAt(left);
-
-  // if (KM.CompareKeys(KeyAt(1), key) > 0) {
-  //   return ValueAt(0);
-  // }
-  // if (KM.CompareKeys(KeyAt(GetSize() - 1), key) <= 0) {
-  //   return ValueAt(GetSize() - 1);
-  // }
-  // for (int i = 1; i < GetSize() - 1; i++) {
-  //   if (KM.CompareKeys(KeyAt(i), key) <= 0 && KM.CompareKeys(KeyAt(i + 1), key) > 0) {
-  //     return ValueAt(i);
-  //   }
-  // }
+  return ValueAt(left - 1);
 }
 
 /*****************************************************************************
@@ -130,28 +299,35 @@ page_id_t InternalPage::Lookup(const GenericKey *key, const KeyManager &KM) {
  * page, you should create a new root page and populate its elements.
  * NOTE: This method is only called within InsertIntoParent()(b_plus_tree.cpp)
  */
-void InternalPage::PopulateNewRoot(const page_id_t &old_value, GenericKey *new_key, const page_id_t &new_value) {
-  SetSize(2);
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(const page_id_t &old_value, GenericKey *new_key,
+                                                     const page_id_t &new_value) {
+  SetSize(1);
   SetValueAt(0, old_value);
-  SetKeyAt(1, new_key);
-  SetValueAt(1, new_value);
+  bool inserted = InsertAt(1, new_key, new_value);
+  ASSERT(inserted, "New root overflows.");
 }
 
 /*
  * Insert new_key & new_value pair right after the pair with its value ==
  * old_value
- * @return:  new size after insertion
+ * @return:  new size after insertion, -1 if the page has no room for new_key
  */
-int InternalPage::InsertNodeAfter(const page_id_t &old_value, GenericKey *new_key, const page_id_t &new_value) {
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(const page_id_t &old_value, GenericKey *new_key,
+                                                    const page_id_t &new_value) {
   int index = ValueIndex(old_value) + 1;
-  int size = GetSize();
-  for (int i = size; i > index; i--) {
-    memcpy(PairPtrAt(i), PairPtrAt(i - 1), pair_size);
+  return InsertAt(index, new_key, new_value) ? GetSize() : -1;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::Append(const GenericKey *key, page_id_t value) {
+  if (GetSize() == 0) {
+    SetSize(1);
+    SetValueAt(0, value);
+    return true;
   }
-  SetKeyAt(index, new_key);
-  SetValueAt(index, new_value);
-  IncreaseSize(1);
-  return GetSize();
+  return InsertAt(GetSize(), key, value);
 }
 
 /*****************************************************************************
@@ -159,32 +335,23 @@ int InternalPage::InsertNodeAfter(const page_id_t &old_value, GenericKey *new_ke
  *****************************************************************************/
 /*
  * Remove half of key & value pairs from this page to "recipient" page
- * buffer_pool_manager 是干嘛的？传给CopyNFrom()用于Fetch数据页
+ * buffer_pool_manager 是干嘛的？用于Fetch移走的孩子，更新它们的父节点
+ * 两半各自重新选择布局，移走的第一个key存入middle_key
  */
-void InternalPage::MoveHalfTo(InternalPage *recipient, BufferPoolManager *buffer_pool_manager) {
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient, GenericKey *middle_key,
+                                                BufferPoolManager *buffer_pool_manager) {
   int size = GetSize();
   int move_size = size / 2;
-  recipient->CopyNFrom(PairPtrAt(size - move_size), move_size, buffer_pool_manager);
-  SetSize(size - move_size);
-}
-
-/* Copy entries into me, starting from {items} and copy {size} entries.
- * Since it is an internal page, for all entries (pages) moved, their parents page now changes to me.
- * So I need to 'adopt' them by changing their parent page id, which needs to be persisted with BufferPoolManger
- *
- */
-void InternalPage::CopyNFrom(void *src, int size, BufferPoolManager *buffer_pool_manager) {
-  memcpy(PairPtrAt(GetSize()), src, size * pair_size);
-  IncreaseSize(size);
+  int keep_size = size - move_size;
+  std::vector<char> buf(size * entry_size);
+  Unpack(buf.data());
+  memcpy(middle_key, buf.data() + keep_size * entry_size, KeyWidth());
+  bool packed = recipient->Pack(buf.data() + keep_size * entry_size, move_size) && Pack(buf.data(), keep_size);
+  ASSERT(packed, "Split page overflows.");
   // Update parent page id for all child pages
-  for (int i = 0; i < size; i++) {
-    page_id_t child_page_id = *reinterpret_cast<page_id_t *>(reinterpret_cast<char *>(src) + i * pair_size + val_off);
-    Page *page = buffer_pool_manager->FetchPage(child_page_id);
-    if (page != nullptr) {
-      BPlusTreePage *child_page = reinterpret_cast<BPlusTreePage *>(page->GetData());
-      child_page->SetParentPageId(GetPageId());
-      buffer_pool_manager->UnpinPage(child_page_id, true);
-    }
+  for (int i = 0; i < move_size; i++) {
+    recipient->Adopt(recipient->ValueAt(i), buffer_pool_manager);
   }
 }
 
@@ -195,13 +362,12 @@ void InternalPage::CopyNFrom(void *src, int size, BufferPoolManager *buffer_pool
  * Remove the key & value pair in internal page according to input index(a.k.a
  * array offset)
  * NOTE: store key&value pair continuously after deletion
+ * 剩下的key仍符合原来的布局，不用重新选择
  */
-void InternalPage::Remove(int index) {
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {
   int size = GetSize();
-
-  for (int i = index + 1; i < size - 1; ++i) {
-    memcpy(PairPtrAt(i), PairPtrAt(i + 1), pair_size);
-  }
+  MoveSlots(index, index + 1, size - index - 1);
   IncreaseSize(-1);
 }
 
@@ -209,7 +375,8 @@ void InternalPage::Remove(int index) {
  * Remove the only key & value pair in internal page and return the value
  * NOTE: only call this method within AdjustRoot()(in b_plus_tree.cpp)
  */
-page_id_t InternalPage::RemoveAndReturnOnlyChild() {
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() {
   page_id_t value = ValueAt(0);
   SetSize(0);
   return value;
@@ -218,16 +385,56 @@ page_id_t InternalPage::RemoveAndReturnOnlyChild() {
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
+/*
+ * The keys of the merged page are the keys of this page, middle_key and the keys of right. The longest key is
+ * bounded by the layouts of both pages.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_INTERNAL_PAGE_TYPE::CanMerge(const BPlusTreeInternalPage *right, const GenericKey *middle_key) const {
+  int size = GetSize() + right->GetSize();
+  if (!IsCompressed()) {
+    return size < GetMaxSize();
+  }
+  int width = KeyWidth();
+  std::vector<char> first(width);
+  std::vector<char> last(width);
+  memcpy(first.data(), middle_key, width);
+  memcpy(last.data(), middle_key, width);
+  int max_length = KeyLength(first.data(), width);
+  if (GetSize() > 1) {
+    KeyAt(1, reinterpret_cast<GenericKey *>(first.data()));
+    max_length = std::max(max_length, GetPrefixSize() + GetSlotWidth());
+  }
+  if (right->GetSize() > 1) {
+    right->KeyAt(right->GetSize() - 1, reinterpret_cast<GenericKey *>(last.data()));
+    max_length = std::max(max_length, right->GetPrefixSize() + right->GetSlotWidth());
+  }
+  int prefix_size = std::min(CommonPrefix(first.data(), last.data(), width), max_length);
+  return size < MaxSizeFor(prefix_size, max_length - prefix_size);
+}
+
 /*
  * Remove all of key & value pairs from this page to "recipient" page.
  * The middle_key is the separation key you should get from the parent. You need
  * to make sure the middle key is added to the recipient to maintain the invariant.
  * You also need to use BufferPoolManager to persist changes to the parent page id for those
  * pages that are moved to the recipient
+ * 调用前需用 CanMerge 确认放得下
  */
-void InternalPage::MoveAllTo(InternalPage *recipient, GenericKey *middle_key, BufferPoolManager *buffer_pool_manager) {
-  // recipient->SetKeyAt(recipient->GetSize(), middle_key);
-  recipient->CopyNFrom(PairPtrAt(0), GetSize(), buffer_pool_manager);
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient, GenericKey *middle_key,
+                                               BufferPoolManager *buffer_pool_manager) {
+  int recipient_size = recipient->GetSize();
+  std::vector<char> buf((recipient_size + GetSize()) * entry_size);
+  recipient->Unpack(buf.data());
+  Unpack(buf.data() + recipient_size * entry_size);
+  // 原先的第一个key无效，用父节点中的分隔key补上
+  memcpy(buf.data() + recipient_size * entry_size, middle_key, KeyWidth());
+  bool packed = recipient->Pack(buf.data(), recipient_size + GetSize());
+  ASSERT(packed, "Merged page overflows.");
+  for (int i = 0; i < GetSize(); i++) {
+    recipient->Adopt(ValueAt(i), buffer_pool_manager);
+  }
   SetSize(0);
 }
 
@@ -241,29 +448,16 @@ void InternalPage::MoveAllTo(InternalPage *recipient, GenericKey *middle_key, Bu
  * to make sure the middle key is added to the recipient to maintain the invariant.
  * You also need to use BufferPoolManager to persist changes to the parent page id for those
  * pages that are moved to the recipient
+ * recipient 不足半满，定长布局下也放得下新的 key
  */
-void InternalPage::MoveFirstToEndOf(InternalPage *recipient, GenericKey *middle_key,
-                                    BufferPoolManager *buffer_pool_manager) {
-  recipient->CopyLastFrom(middle_key, ValueAt(0), buffer_pool_manager);
-  Remove(-1);
-}
-
-/* Append an entry at the end.
- * Since it is an internal page, the moved entry(page)'s parent needs to be updated.
- * So I need to 'adopt' it by changing its parent page id, which needs to be persisted with BufferPoolManger
- */
-void InternalPage::CopyLastFrom(GenericKey *key, const page_id_t value, BufferPoolManager *buffer_pool_manager) {
-  IncreaseSize(1);
-  SetKeyAt(GetSize() - 1, key);
-  SetValueAt(GetSize() - 1, value);
-
-  // update the parent_page_id for the child page
-  Page *page = buffer_pool_manager->FetchPage(value);
-  if (page != nullptr) {
-    BPlusTreePage *child_page = reinterpret_cast<BPlusTreePage *>(page->GetData());
-    child_page->SetParentPageId(GetPageId());
-    buffer_pool_manager->UnpinPage(value, true);
-  }
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *recipient, GenericKey *middle_key,
+                                                      BufferPoolManager *buffer_pool_manager) {
+  page_id_t child = ValueAt(0);
+  bool inserted = recipient->InsertAt(recipient->GetSize(), middle_key, child);
+  ASSERT(inserted, "Redistributed page overflows.");
+  recipient->Adopt(child, buffer_pool_manager);
+  Remove(0);
 }
 
 /*
@@ -273,29 +467,26 @@ void InternalPage::CopyLastFrom(GenericKey *key, const page_id_t value, BufferPo
  * You also need to use BufferPoolManager to persist changes to the parent page id for those pages that are
  * moved to the recipient
  */
-void InternalPage::MoveLastToFrontOf(InternalPage *recipient, GenericKey *middle_key,
-                                     BufferPoolManager *buffer_pool_manager) {
-  recipient->CopyFirstFrom(ValueAt(GetSize() - 1), buffer_pool_manager);
-  recipient->SetKeyAt(0, KeyAt(GetSize() - 1));
-  Remove(GetSize() - 2);
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *recipient, GenericKey *middle_key,
+                                                       BufferPoolManager *buffer_pool_manager) {
+  int recipient_size = recipient->GetSize();
+  std::vector<char> buf((recipient_size + 1) * entry_size);
+  recipient->Unpack(buf.data() + entry_size);
+  // recipient 原先的第一个孩子移到位置1，它的key就是父节点中的分隔key
+  memcpy(buf.data() + entry_size, middle_key, KeyWidth());
+  page_id_t child = ValueAt(GetSize() - 1);
+  memcpy(buf.data() + KeyWidth(), &child, sizeof(page_id_t));
+  bool packed = recipient->Pack(buf.data(), recipient_size + 1);
+  ASSERT(packed, "Redistributed page overflows.");
+  recipient->Adopt(child, buffer_pool_manager);
+  IncreaseSize(-1);
 }
 
-/* Append an entry at the beginning.
- * Since it is an internal page, the moved entry(page)'s parent needs to be updated.
- * So I need to 'adopt' it by changing its parent page id, which needs to be persisted with BufferPoolManger
- */
-void InternalPage::CopyFirstFrom(const page_id_t value, BufferPoolManager *buffer_pool_manager) {
-  IncreaseSize(1);
-  for (int i = GetSize() - 1; i > 0; i--) {
-    memcpy(PairPtrAt(i), PairPtrAt(i - 1), pair_size);
-  }
-  SetValueAt(0, value);
-
-  Page *page = buffer_pool_manager->FetchPage(value);
-  // update the parent page id for the child page
-  if (page != nullptr) {
-    BPlusTreePage *child_page = reinterpret_cast<BPlusTreePage *>(page->GetData());
-    child_page->SetParentPageId(GetPageId());
-    buffer_pool_manager->UnpinPage(value, true);
-  }
-}
+template class BPlusTreeInternalPage<0, KeyManager>;
+template class BPlusTreeInternalPage<4, IntKeyComparator>;
+template class BPlusTreeInternalPage<16, FixedKeyComparator<16>>;
+template class BPlusTreeInternalPage<32, FixedKeyComparator<32>>;
+template class BPlusTreeInternalPage<64, FixedKeyComparator<64>>;
+template class BPlusTreeInternalPage<128, FixedKeyComparator<128>>;
+template class BPlusTreeInternalPage<256, FixedKeyComparator<256>>;
@@ -4,10 +4,8 @@
 
 #include "index/generic_key.h"
 
-#define pairs_off (data_)
-#define pair_size (GetKeySize() + sizeof(RowId))
-#define key_off 0
-#define val_off GetKeySize()
+// an entry with a full width key, the form used to move entries between layouts
+#define entry_size (KeyWidth() + sizeof(RowId))
 /*****************************************************************************
  * HELPER METHODS AND UTILITIES
  *****************************************************************************/
@@ -21,11 +19,17 @@
  * next page id and set max size
  * 未初始化next_page_id
  */
-void LeafPage::Init(page_id_t page_id, page_id_t parent_id, int key_size, int max_size) {
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int key_size, int max_size,
+                                      bool compressed) {
   SetPageId(page_id);
   SetParentPageId(parent_id);
   SetKeySize(key_size);
-  SetMaxSize(max_size);
+  SetFixedMaxSize(max_size);
+  ASSERT(!kIntKeys || (!compressed && max_size < kIntCapacity), "Int page overflows.");
+  SetCompressed(compressed);
+  SetLayout(0, compressed ? 0 : KeyWidth());
+  SetMaxSize(MaxSizeFor(GetPrefixSize(), GetSlotWidth()));
   SetSize(0);
   SetPageType(IndexPageType::LEAF_PAGE);
   SetNextPageId(INVALID_PAGE_ID);
@@ -34,15 +38,34 @@ void LeafPage::Init(page_id_t page_id, page_id_t parent_id, int key_size, int ma
 /**
  * Helper methods to set/get next page id
  */
-page_id_t LeafPage::GetNextPageId() const { return next_page_id_; }
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t B_PLUS_TREE_LEAF_PAGE_TYPE::GetNextPageId() const { return next_page_id_; }
 
-void LeafPage::SetNextPageId(page_id_t next_page_id) {
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) {
   next_page_id_ = next_page_id;
   if (next_page_id == 0) {
     LOG(INFO) << "Fatal error";
   }
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::Capacity(int prefix_size, int slot_width) const {
+  if (kIntKeys) {
+    return kIntCapacity;
+  }
+  return (static_cast<int>(sizeof(data_)) - prefix_size) / (slot_width + static_cast<int>(sizeof(RowId)));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::MaxSizeFor(int prefix_size, int slot_width) const {
+  if (!IsCompressed()) {
+    return GetFixedMaxSize();
+  }
+  // 同内部页，留一个溢出的位置，且不超过定长时的两倍减二
+  return std::max(GetFixedMaxSize(), std::min(Capacity(prefix_size, slot_width) - 1, 2 * GetFixedMaxSize() - 2));
+}
+
 /**
  * TODO: Student Implement
  */
@@ -51,17 +74,58 @@ void LeafPage::SetNextPageId(page_id_t next_page_id) {
  * NOTE: This method is only used when generating index iterator
  * 二分查找
  */
-int LeafPage::KeyIndex(const GenericKey *key, const KeyManager &KM) {
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const GenericKey *key, const KeyComparator &KM) const {
+  bool found;
+  return Search(key, KM, &found);
+}
+
+/*
+ * Int keys are searched with SIMD compares. A compressed page compares key with its prefix once, then only the slot bytes. A slot equal to the bytes of key
+ * is still below key if key goes on past the slot width, the stored key being zero there.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::Search(const GenericKey *key, const KeyComparator &KM, bool *found) const {
+  if constexpr (kIntKeys) {
+    int32_t k;
+    memcpy(&k, key, sizeof(k));
+    int index = SearchIntKeys(KeySlot(0), GetSize(), k, false);
+    *found = index < GetSize() && memcmp(KeySlot(index), &k, sizeof(k)) == 0;
+    return index;
+  }
   int left = 0;
   int right = GetSize();  // 指向的是最后一个元素的后面
+  if (!IsCompressed()) {
+    while (left < right) {
+      int mid = (left + right) / 2;
+      if (KM.CompareKeys(reinterpret_cast<const GenericKey *>(SlotAt(mid)), key) < 0) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    *found = right < GetSize() && KM.CompareKeys(reinterpret_cast<const GenericKey *>(SlotAt(right)), key) == 0;
+    return right;
+  }
+  auto *src = reinterpret_cast<const char *>(key);
+  int prefix_size = GetPrefixSize();
+  int slot_width = GetSlotWidth();
+  *found = false;
+  int cmp = memcmp(src, data_, prefix_size);
+  if (cmp != 0) {
+    return cmp < 0 ? 0 : GetSize();
+  }
+  bool longer = KeyLength(src, KeyWidth()) > prefix_size + slot_width;
   while (left < right) {
     int mid = (left + right) / 2;
-    if (KM.CompareKeys(KeyAt(mid), key) < 0) {
+    int slot_cmp = memcmp(SlotAt(mid), src + prefix_size, slot_width);
+    if (slot_cmp < 0 || (slot_cmp == 0 && longer)) {
       left = mid + 1;
     } else {
       right = mid;
     }
   }
+  *found = !longer && right < GetSize() && memcmp(SlotAt(right), src + prefix_size, slot_width) == 0;
   return right;
 }
 
@@ -69,50 +133,172 @@ int LeafPage::KeyIndex(const GenericKey *key, const KeyManager &KM) {
  * Helper method to find and return the key associated with input "index"(a.k.a
  * array offset)
  */
-GenericKey *LeafPage::KeyAt(int index) {
-  return reinterpret_cast<GenericKey *>(pairs_off + index * pair_size + key_off);
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index, GenericKey *key) const {
+  auto *dest = reinterpret_cast<char *>(key);
+  int prefix_size = GetPrefixSize();
+  int slot_width = GetSlotWidth();
+  memcpy(dest, data_, prefix_size);
+  memcpy(dest + prefix_size, KeySlot(index), slot_width);
+  memset(dest + prefix_size + slot_width, 0, KeyWidth() - prefix_size - slot_width);
 }
 
-void LeafPage::SetKeyAt(int index, GenericKey *key) {
-  memcpy(pairs_off + index * pair_size + key_off, key, GetKeySize());
+INDEX_TEMPLATE_ARGUMENTS
+RowId B_PLUS_TREE_LEAF_PAGE_TYPE::ValueAt(int index) const {
+  RowId value;
+  memcpy(&value, ValueSlot(index), sizeof(RowId));
+  return value;
 }
 
-RowId LeafPage::ValueAt(int index) const {
-  return *reinterpret_cast<const RowId *>(pairs_off + index * pair_size + val_off);
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetValueAt(int index, RowId value) {
+  memcpy(ValueSlot(index), &value, sizeof(RowId));
 }
 
-void LeafPage::SetValueAt(int index, RowId value) {
-  *reinterpret_cast<RowId *>(pairs_off + index * pair_size + val_off) = value;
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveSlots(int to, int from, int count) {
+  if (count <= 0) {
+    return;
+  }
+  if (kIntKeys) {
+    memmove(KeySlot(to), KeySlot(from), count * sizeof(int32_t));
+    memmove(ValueSlot(to), ValueSlot(from), count * sizeof(RowId));
+  } else {
+    memmove(SlotAt(to), SlotAt(from), count * SlotSize());
+  }
 }
 
-void *LeafPage::PairPtrAt(int index) { return KeyAt(index); }
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::LayoutFits(const char *key) const {
+  if (!IsCompressed()) {
+    return true;
+  }
+  int prefix_size = GetPrefixSize();
+  return memcmp(key, data_, prefix_size) == 0 && KeyLength(key, KeyWidth()) <= prefix_size + GetSlotWidth();
+}
 
-void LeafPage::PairCopy(void *dest, void *src, int pair_num) {
-  memcpy(dest, src, pair_num * (GetKeySize() + sizeof(RowId)));
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::CommonPrefixAt(int index, const char *key) const {
+  int prefix_size = GetPrefixSize();
+  int length = CommonPrefix(data_, key, prefix_size);
+  if (length < prefix_size) {
+    return length;
+  }
+  length += CommonPrefix(KeySlot(index), key + prefix_size, GetSlotWidth());
+  if (length < prefix_size + GetSlotWidth()) {
+    return length;
+  }
+  // 槽之后的字节都是 0
+  while (length < KeyWidth() && key[length] == 0) length++;
+  return length;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::MaxSizeWith(const GenericKey *key) const {
+  if (!IsCompressed()) {
+    return GetMaxSize();
+  }
+  auto *src = reinterpret_cast<const char *>(key);
+  int max_length = KeyLength(src, KeyWidth());
+  if (GetSize() == 0) {
+    return MaxSizeFor(max_length, 0);
+  }
+  max_length = std::max(max_length, GetPrefixSize() + GetSlotWidth());
+  int prefix_size = std::min(CommonPrefixAt(0, src), max_length);
+  return MaxSizeFor(prefix_size, max_length - prefix_size);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Unpack(char *buf) const {
+  if (!IsCompressed() && !kIntKeys) {
+    memcpy(buf, data_, GetSize() * entry_size);
+    return;
+  }
+  for (int i = 0; i < GetSize(); i++) {
+    char *entry = buf + i * entry_size;
+    KeyAt(i, reinterpret_cast<GenericKey *>(entry));
+    memcpy(entry + KeyWidth(), ValueSlot(i), sizeof(RowId));
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::Pack(const char *buf, int size) {
+  int width = KeyWidth();
+  int prefix_size = 0;
+  int slot_width = width;
+  if (IsCompressed()) {
+    // key 有序，公共前缀就是第一个和最后一个 key 的公共前缀
+    int max_length = 0;
+    for (int i = 0; i < size; i++) {
+      max_length = std::max(max_length, KeyLength(buf + i * entry_size, width));
+    }
+    if (size > 0) {
+      prefix_size = std::min(CommonPrefix(buf, buf + (size - 1) * entry_size, width), max_length);
+    }
+    slot_width = max_length - prefix_size;
+  }
+  if (size > Capacity(prefix_size, slot_width)) {
+    return false;
+  }
+  SetLayout(prefix_size, slot_width);
+  if (size > 0) {
+    memcpy(data_, buf, prefix_size);
+  }
+  for (int i = 0; i < size; i++) {
+    const char *entry = buf + i * entry_size;
+    char *slot = KeySlot(i);
+    memcpy(slot, entry + prefix_size, slot_width);
+    memcpy(ValueSlot(i), entry + width, sizeof(RowId));
+  }
+  SetSize(size);
+  SetMaxSize(MaxSizeFor(prefix_size, slot_width));
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::InsertAt(int index, const GenericKey *key, const RowId &value) {
+  auto *src = reinterpret_cast<const char *>(key);
+  int size = GetSize();
+  if (LayoutFits(src) && size < Capacity(GetPrefixSize(), GetSlotWidth())) {
+    MoveSlots(index + 1, index, size - index);
+    memcpy(KeySlot(index), src + GetPrefixSize(), GetSlotWidth());
+    SetValueAt(index, value);
+    IncreaseSize(1);
+    return true;
+  }
+  // 布局放不下这个 key，展开成定长的项后重新选择布局
+  std::vector<char> buf((size + 1) * entry_size);
+  Unpack(buf.data());
+  char *entry = buf.data() + index * entry_size;
+  memmove(entry + entry_size, entry, (size - index) * entry_size);
+  memcpy(entry, src, KeyWidth());
+  memcpy(entry + KeyWidth(), &value, sizeof(RowId));
+  return Pack(buf.data(), size + 1);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAt(int index) {
+  int size = GetSize();
+  MoveSlots(index, index + 1, size - index - 1);
+  IncreaseSize(-1);
 }
-/*
- * Helper method to find and return the key & value pair associated with input
- * "index"(a.k.a. array offset)
- */
-std::pair<GenericKey *, RowId> LeafPage::GetItem(int index) { return {KeyAt(index), ValueAt(index)}; }
 
 /*****************************************************************************
  * INSERTION
  *****************************************************************************/
 /*
  * Insert key & value pair into leaf page ordered by key
- * @return page size after insertion
+ * @return page size after insertion, -1 if the page has no room for key
  */
-int LeafPage::Insert(GenericKey *key, const RowId &value, const KeyManager &KM) {
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(GenericKey *key, const RowId &value, const KeyComparator &KM) {
   int index = KeyIndex(key, KM);
-  int size = GetSize();
-  for (int i = size; i > index; i--) {
-    memcpy(PairPtrAt(i), PairPtrAt(i - 1), pair_size);
-  }
-  SetKeyAt(index, key);
-  SetValueAt(index, value);
-  IncreaseSize(1);
-  return GetSize();
+  return InsertAt(index, key, value) ? GetSize() : -1;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::Append(const GenericKey *key, const RowId &value) {
+  return InsertAt(GetSize(), key, value);
 }
 
 /*****************************************************************************
@@ -120,21 +306,18 @@ int LeafPage::Insert(GenericKey *key, const RowId &value, const KeyManager &KM)
  *****************************************************************************/
 /*
  * Remove half of key & value pairs from this page to "recipient" page
+ * 两半各自重新选择布局
  */
 // move the later half of this to recipient
-void LeafPage::MoveHalfTo(LeafPage *recipient) {
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(BPlusTreeLeafPage *recipient) {
   int size = GetSize();
   int move_size = size / 2;
-  recipient->CopyNFrom(PairPtrAt(size - move_size), move_size);
-  SetSize(size - move_size);
-}
-
-/*
- * Copy starting from items, and copy {size} number of elements into me.
- */
-void LeafPage::CopyNFrom(void *src, int size) {
-  memcpy(PairPtrAt(GetSize()), src, size * pair_size);
-  IncreaseSize(size);
+  int keep_size = size - move_size;
+  std::vector<char> buf(size * entry_size);
+  Unpack(buf.data());
+  bool packed = recipient->Pack(buf.data() + keep_size * entry_size, move_size) && Pack(buf.data(), keep_size);
+  ASSERT(packed, "Split page overflows.");
 }
 
 /*****************************************************************************
@@ -145,24 +328,14 @@ void LeafPage::CopyNFrom(void *src, int size) {
  * does, then store its corresponding value in input "value" and return true.
  * If the key does not exist, then return false
  */
-bool LeafPage::Lookup(const GenericKey *key, RowId &value, const KeyManager &KM) {
-  // use binary search to find the index of the key
-  int left = 0;
-  int right = GetSize() - 1;
-  int index = (left + right) / 2;
-  while (left <= right) {
-    index = (left + right) / 2;
-    if (KM.CompareKeys(KeyAt(index), key) == 0) {
-      value = ValueAt(index);
-      return true;
-    } else if (KM.CompareKeys(KeyAt(index), key) < 0) {
-      left = index + 1;
-    } else {
-      right = index - 1;
-    }
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const GenericKey *key, RowId &value, const KeyComparator &KM) const {
+  bool found;
+  int index = Search(key, KM, &found);
+  if (found) {
+    value = ValueAt(index);
   }
-
-  return false;
+  return found;
 }
 
 /*****************************************************************************
@@ -174,36 +347,59 @@ bool LeafPage::Lookup(const GenericKey *key, RowId &value, const KeyManager &KM)
  * NOTE: store key&value pair continuously after deletion
  * @return  page size after deletion
  */
-int LeafPage::RemoveAndDeleteRecord(const GenericKey *key, const KeyManager &KM) {
-  int index = KeyIndex(key, KM);
-  if (index < GetSize() && KM.CompareKeys(KeyAt(index), key) == 0) {
-    for (int i = index; i < GetSize() - 1; i++) {
-      memcpy(PairPtrAt(i), PairPtrAt(i + 1), pair_size);
-    }
-    IncreaseSize(-1);
-    return GetSize();
+INDEX_TEMPLATE_ARGUMENTS
+int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const GenericKey *key, const KeyComparator &KM) {
+  bool found;
+  int index = Search(key, KM, &found);
+  if (!found) {
+    return -1;
   }
-  return -1;
+  RemoveAt(index);
+  return GetSize();
 }
 
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
+/*
+ * The longest key of the merged page is bounded by the layouts of both pages.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool B_PLUS_TREE_LEAF_PAGE_TYPE::CanMerge(const BPlusTreeLeafPage *right) const {
+  int size = GetSize() + right->GetSize();
+  if (!IsCompressed()) {
+    return size < GetMaxSize();
+  }
+  if (GetSize() == 0 || right->GetSize() == 0) {
+    const BPlusTreeLeafPage *page = GetSize() == 0 ? right : this;
+    return size < page->GetMaxSize() || size == 0;
+  }
+  int width = KeyWidth();
+  std::vector<char> first(width);
+  std::vector<char> last(width);
+  KeyAt(0, reinterpret_cast<GenericKey *>(first.data()));
+  right->KeyAt(right->GetSize() - 1, reinterpret_cast<GenericKey *>(last.data()));
+  int max_length = std::max(GetPrefixSize() + GetSlotWidth(), right->GetPrefixSize() + right->GetSlotWidth());
+  int prefix_size = std::min(CommonPrefix(first.data(), last.data(), width), max_length);
+  return size < MaxSizeFor(prefix_size, max_length - prefix_size);
+}
+
 /*
  * Remove all key & value pairs from this page to "recipient" page. Don't forget
  * to update the next_page id in the sibling page
+ * 调用前需用 CanMerge 确认放得下
  */
-void LeafPage::MoveAllTo(LeafPage *recipient) {
-  // if (this->next_page_id_ == recipient->GetPageId()) {
-  // this->CopyNFrom(recipient->PairPtrAt(0), recipient->GetSize());
-  // recipient->SetSize(0);
-  // this->SetNextPageId(recipient->GetNextPageId());
-  // this->IncreaseSize(recipient->GetSize());
-  // }
-  recipient->CopyNFrom(PairPtrAt(0), GetSize());
+// next_page_id_ is kept so that an iterator already pinning this page can still move past it
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {
+  int recipient_size = recipient->GetSize();
+  std::vector<char> buf((recipient_size + GetSize()) * entry_size);
+  recipient->Unpack(buf.data());
+  Unpack(buf.data() + recipient_size * entry_size);
+  bool packed = recipient->Pack(buf.data(), recipient_size + GetSize());
+  ASSERT(packed, "Merged page overflows.");
   SetSize(0);
   recipient->SetNextPageId(GetNextPageId());
-  recipient->IncreaseSize(GetSize());
 }
 
 /*****************************************************************************
@@ -211,42 +407,33 @@ void LeafPage::MoveAllTo(LeafPage *recipient) {
  *****************************************************************************/
 /*
  * Remove the first key & value pair from this page to tail of "recipient" page.
- *
+ * recipient 不足半满，定长布局下也放得下新的 key
  */
-void LeafPage::MoveFirstToEndOf(LeafPage *recipient) {
-  recipient->CopyLastFrom(KeyAt(0), ValueAt(0));
-  for (int i = 0; i < GetSize() - 1; i++) {
-    memcpy(PairPtrAt(i), PairPtrAt(i + 1), pair_size);
-  }
-  IncreaseSize(-1);
-}
-
-/*
- * Copy the item into the end of my item list. (Append item to my array)
- */
-void LeafPage::CopyLastFrom(GenericKey *key, const RowId value) {
-  SetKeyAt(GetSize(), key);
-  SetValueAt(GetSize(), value);
-  IncreaseSize(1);
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient) {
+  std::vector<char> key(KeyWidth());
+  KeyAt(0, reinterpret_cast<GenericKey *>(key.data()));
+  bool inserted = recipient->InsertAt(recipient->GetSize(), reinterpret_cast<GenericKey *>(key.data()), ValueAt(0));
+  ASSERT(inserted, "Redistributed page overflows.");
+  RemoveAt(0);
 }
 
 /*
  * Remove the last key & value pair from this page to "recipient" page.
  */
-void LeafPage::MoveLastToFrontOf(LeafPage *recipient) {
-  recipient->CopyFirstFrom(KeyAt(GetSize() - 1), ValueAt(GetSize() - 1));
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient) {
+  std::vector<char> key(KeyWidth());
+  KeyAt(GetSize() - 1, reinterpret_cast<GenericKey *>(key.data()));
+  bool inserted = recipient->InsertAt(0, reinterpret_cast<GenericKey *>(key.data()), ValueAt(GetSize() - 1));
+  ASSERT(inserted, "Redistributed page overflows.");
   IncreaseSize(-1);
 }
 
-/*
- * Insert item at the front of my items. Move items accordingly.
- *
- */
-void LeafPage::CopyFirstFrom(GenericKey *key, const RowId value) {
-  for (int i = GetSize(); i > 0; i--) {
-    memcpy(PairPtrAt(i), PairPtrAt(i - 1), pair_size);
-  }
-  SetKeyAt(0, key);
-  SetValueAt(0, value);
-  IncreaseSize(1);
-}
+template class BPlusTreeLeafPage<0, KeyManager>;
+template class BPlusTreeLeafPage<4, IntKeyComparator>;
+template class BPlusTreeLeafPage<16, FixedKeyComparator<16>>;
+template class BPlusTreeLeafPage<32, FixedKeyComparator<32>>;
+template class BPlusTreeLeafPage<64, FixedKeyComparator<64>>;
+template class BPlusTreeLeafPage<128, FixedKeyComparator<128>>;
+template class BPlusTreeLeafPage<256, FixedKeyComparator<256>>;
@@ -1,5 +1,13 @@
 #include "page/b_plus_tree_page.h"
 
+#include <algorithm>
+#include <cstring>
+
+#if defined(USE_SIMD_KEY_SEARCH) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIMD_KEY_SEARCH_X86
+#endif
+
 /*
  * Helper methods to get/set page type
  * Page type enum class is defined in b_plus_tree_page.h
@@ -49,11 +57,32 @@ void BPlusTreePage::SetMaxSize(int size) { max_size_ = size; }
 /*
  * Helper method to get min page size
  * Generally, min page size == max page size / 2
+ * 压缩页的 max size 随布局变化，min size 按定长布局算，与不压缩时相同
  */
 /**
  * TODO: Student Implement
  */
-int BPlusTreePage::GetMinSize() const { return max_size_ / 2; }
+int BPlusTreePage::GetMinSize() const { return fixed_max_size_ / 2; }
+
+int BPlusTreePage::GetFixedMaxSize() const { return fixed_max_size_; }
+
+void BPlusTreePage::SetFixedMaxSize(int max_size) { fixed_max_size_ = max_size; }
+
+/*
+ * Helper methods to get/set the key layout, see the header format
+ */
+bool BPlusTreePage::IsCompressed() const { return compressed_ != 0; }
+
+void BPlusTreePage::SetCompressed(bool compressed) { compressed_ = compressed ? 1 : 0; }
+
+int BPlusTreePage::GetPrefixSize() const { return prefix_size_; }
+
+int BPlusTreePage::GetSlotWidth() const { return slot_width_; }
+
+void BPlusTreePage::SetLayout(int prefix_size, int slot_width) {
+  prefix_size_ = static_cast<uint16_t>(prefix_size);
+  slot_width_ = static_cast<uint16_t>(slot_width);
+}
 
 /*
  * Helper methods to get/set parent page id
@@ -76,3 +105,106 @@ void BPlusTreePage::SetPageId(page_id_t page_id) { page_id_ = page_id; }
  * Helper methods to set lsn
  */
 void BPlusTreePage::SetLSN(lsn_t lsn) { lsn_ = lsn; }
+
+int BPlusTreePage::CommonPrefix(const char *lhs, const char *rhs, int size) {
+  int i = 0;
+  while (i < size && lhs[i] == rhs[i]) i++;
+  return i;
+}
+
+int BPlusTreePage::KeyLength(const char *key, int key_size) {
+  while (key_size > 0 && key[key_size - 1] == 0) key_size--;
+  return key_size;
+}
+
+/*
+ * right cut after the first byte where it differs from left, which is enough to stay above left
+ */
+void BPlusTreePage::ShortestSeparator(const GenericKey *left, const GenericKey *right, int key_size,
+                                      GenericKey *separator) {
+  auto *l = reinterpret_cast<const char *>(left);
+  auto *r = reinterpret_cast<const char *>(right);
+  int length = std::min(CommonPrefix(l, r, key_size) + 1, key_size);
+  auto *s = reinterpret_cast<char *>(separator);
+  memcpy(s, r, length);
+  memset(s + length, 0, key_size - length);
+}
+
+namespace {
+// number of keys less than key, the keys being sorted this is also the index of the first one not less
+int CountLessScalar(const char *keys, int size, int32_t key) {
+  int count = 0;
+  for (int i = 0; i < size; i++) {
+    int32_t k;
+    memcpy(&k, keys + i * sizeof(int32_t), sizeof(int32_t));
+    count += k < key;
+  }
+  return count;
+}
+
+#ifdef SIMD_KEY_SEARCH_X86
+__attribute__((target("sse2"))) int CountLessSse2(const char *keys, int size, int32_t key) {
+  __m128i pivot = _mm_set1_epi32(key);
+  int count = 0;
+  int i = 0;
+  for (; i + 4 <= size; i += 4) {
+    __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i * sizeof(int32_t)));
+    count += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(pivot, k))));
+  }
+  return count + CountLessScalar(keys + i * sizeof(int32_t), size - i, key);
+}
+
+__attribute__((target("avx2,popcnt"))) int CountLessAvx2(const char *keys, int size, int32_t key) {
+  __m256i pivot = _mm256_set1_epi32(key);
+  int count = 0;
+  int i = 0;
+  for (; i + 8 <= size; i += 8) {
+    __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i * sizeof(int32_t)));
+    count += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(pivot, k))));
+  }
+  return count + CountLessScalar(keys + i * sizeof(int32_t), size - i, key);
+}
+#endif
+
+using CountLessFunc = int (*)(const char *, int, int32_t);
+
+CountLessFunc ChooseCountLess() {
+#ifdef SIMD_KEY_SEARCH_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+    return CountLessAvx2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return CountLessSse2;
+  }
+#endif
+  return CountLessScalar;
+}
+}  // namespace
+
+/*
+ * 二分查找缩小到 INDEX_SIMD_SEARCH_WIDTH 个 key 以内，再一次比较一个向量的 key，数出比 key 小的个数
+ */
+int BPlusTreePage::SearchIntKeys(const char *keys, int size, int32_t key, bool upper) {
+  static const CountLessFunc count_less = ChooseCountLess();
+  if (upper) {
+    // 第一个大于 key 的就是第一个不小于 key + 1 的
+    if (key == INT32_MAX) {
+      return size;
+    }
+    key++;
+  }
+  int left = 0;
+  int right = size;
+  while (right - left > INDEX_SIMD_SEARCH_WIDTH) {
+    int mid = (left + right) / 2;
+    int32_t k;
+    memcpy(&k, keys + mid * sizeof(int32_t), sizeof(int32_t));
+    if (k < key) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return left + count_less(keys + left * sizeof(int32_t), right - left, key);
+}
@@ -0,0 +1,17 @@
+#include "page/heap_directory_page.h"
+
+void HeapDirectoryPage::Init(page_id_t page_id, [[maybe_unused]] LogManager *log_mgr, [[maybe_unused]] Txn *txn) {
+  memcpy(GetData(), &page_id, sizeof(page_id));
+  SetNextPageId(INVALID_PAGE_ID);
+  SetEntryCount(0);
+}
+
+bool HeapDirectoryPage::Append(page_id_t page_id) {
+  auto entry_count = GetEntryCount();
+  if (entry_count >= SIZE_MAX_ENTRY) {
+    return false;
+  }
+  SetEntry(entry_count, page_id);
+  SetEntryCount(entry_count + 1);
+  return true;
+}
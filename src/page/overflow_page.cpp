@@ -0,0 +1,7 @@
+#include "page/overflow_page.h"
+
+void OverflowPage::Init(page_id_t page_id, [[maybe_unused]] LogManager *log_mgr, [[maybe_unused]] Txn *txn) {
+  memcpy(GetData(), &page_id, sizeof(page_id));
+  SetNextPageId(INVALID_PAGE_ID);
+  SetDataSize(0);
+}
@@ -1,5 +1,8 @@
 #include "page/table_page.h"
 
+#include <algorithm>
+#include <vector>
+
 // TODO: Update interface implementation if apply recovery
 
 void TablePage::Init(page_id_t page_id, page_id_t prev_id, LogManager *log_mgr, Txn *txn) {
@@ -10,14 +13,305 @@ void TablePage::Init(page_id_t page_id, page_id_t prev_id, LogManager *log_mgr,
   SetTupleCount(0);
 }
 
+void TablePage::InitPax(page_id_t page_id, page_id_t prev_id, Schema *schema, LogManager *log_mgr, Txn *txn,
+                        bool encoded) {
+  Init(page_id, prev_id, log_mgr, txn);
+  uint32_t capacity = GetPaxCapacity(schema, encoded);
+  ASSERT(capacity > 0, "Row of the schema does not fit in a PAX page.");
+  uint32_t row_size = schema->GetRowHeaderSize();  // of the serialized row
+  for (auto column : schema->GetColumns()) {
+    row_size += GetPaxStride(column);
+  }
+  SetFreeSpacePointer(PAX_LAYOUT_FLAG | (encoded ? PAX_ENCODED_FLAG : 0) | row_size << 16 | capacity);
+  if (encoded) {
+    MACH_WRITE_UINT32(GetPaxDirectory() + sizeof(uint32_t), schema->GetColumnCount());
+    ResetPaxDirectory();
+  }
+}
+
+uint32_t TablePage::GetPaxStride(const Column *column) {
+  if (column->GetType() == TypeId::kTypeChar) {
+    return sizeof(uint32_t) + column->GetLength();
+  }
+  return Type::GetTypeSize(column->GetType());
+}
+
+uint32_t TablePage::GetPaxEncodedStride(const Column *column) {
+  if (column->GetType() == TypeId::kTypeInt) {
+    return sizeof(int16_t);
+  }
+  if (IsDictionaryColumn(column)) {
+    return sizeof(uint8_t);
+  }
+  return GetPaxStride(column);
+}
+
+uint32_t TablePage::GetPaxCapacity(Schema *schema, bool encoded) {
+  if (schema->GetColumnCount() > RowView::MAX_FIELD_COUNT) {
+    return 0;
+  }
+  uint32_t width = SIZE_TUPLE;
+  uint32_t space = PAGE_SIZE - SIZE_TABLE_PAGE_HEADER;
+  if (encoded) {
+    uint32_t fixed = SIZE_PAX_DIRECTORY_HEADER + sizeof(uint32_t) * 2 * schema->GetColumnCount();
+    for (auto column : schema->GetColumns()) {
+      width += GetPaxEncodedStride(column);
+      if (IsDictionaryColumn(column)) {
+        fixed += GetPaxStride(column) * PAX_DICTIONARY_SIZE;
+      }
+    }
+    if (fixed >= space) {
+      return 0;
+    }
+    space -= fixed;
+  } else {
+    for (auto column : schema->GetColumns()) {
+      width += GetPaxStride(column);
+    }
+  }
+  return std::min<uint32_t>(space / width, 0xFFFF);
+}
+
+bool TablePage::FitsPaxLayout(const Row &row, Schema *schema) {
+  for (uint32_t i = 0; i < schema->GetColumnCount(); i++) {
+    const Field *field = row.GetField(i);
+    if (!field->IsNull() && field->GetTypeId() == TypeId::kTypeChar &&
+        field->GetLength() > schema->GetColumn(i)->GetLength()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t TablePage::GetPaxFreeSpace() {
+  // 字典或基准值已无法容纳新值的页不再接收插入
+  if (IsEncodedPaxPage() && IsPaxPageSealed()) {
+    return 0;
+  }
+  uint32_t free_slots = GetPaxSlotCapacity() - GetTupleCount();
+  for (uint32_t i = 0; i < GetTupleCount(); i++) {
+    if (GetTupleSize(i) == 0) {
+      free_slots++;
+    }
+  }
+  return free_slots * (GetPaxRowSize() + SIZE_TUPLE);
+}
+
+void TablePage::GetPaxColumnOffsets(Schema *schema, uint32_t *offsets, uint32_t *dictionaries) {
+  uint32_t capacity = GetPaxSlotCapacity();
+  uint32_t offset = SIZE_TABLE_PAGE_HEADER + SIZE_TUPLE * capacity;
+  if (IsEncodedPaxPage()) {
+    offset += SIZE_PAX_DIRECTORY_HEADER + sizeof(uint32_t) * 2 * schema->GetColumnCount();
+  }
+  for (uint32_t i = 0; i < schema->GetColumnCount(); i++) {
+    offsets[i] = offset;
+    offset += GetPaxColumnStride(schema->GetColumn(i)) * capacity;
+  }
+  if (dictionaries == nullptr || !IsEncodedPaxPage()) {
+    return;
+  }
+  // 字典放在所有列的minipage之后
+  for (uint32_t i = 0; i < schema->GetColumnCount(); i++) {
+    const Column *column = schema->GetColumn(i);
+    if (IsDictionaryColumn(column)) {
+      dictionaries[i] = offset;
+      offset += GetPaxStride(column) * PAX_DICTIONARY_SIZE;
+    }
+  }
+}
+
+void TablePage::ResetPaxDirectory() {
+  char *directory = GetPaxDirectory();
+  uint32_t column_count = MACH_READ_UINT32(directory + sizeof(uint32_t));
+  MACH_WRITE_UINT32(directory, 0);
+  memset(directory + SIZE_PAX_DIRECTORY_HEADER, 0, sizeof(uint32_t) * 2 * column_count);
+}
+
+int32_t TablePage::FindDictionaryCode(const char *dictionary, uint32_t count, uint32_t stride, const Field &value) {
+  for (uint32_t code = 0; code < count; code++) {
+    const char *entry = dictionary + stride * code;
+    if (MACH_READ_UINT32(entry) == value.GetLength() &&
+        memcmp(entry + sizeof(uint32_t), value.GetData(), value.GetLength()) == 0) {
+      return static_cast<int32_t>(code);
+    }
+  }
+  return -1;
+}
+
+bool TablePage::CanEncodePaxTuple(const Row &row, Schema *schema) {
+  uint32_t offsets[RowView::MAX_FIELD_COUNT];
+  uint32_t dictionaries[RowView::MAX_FIELD_COUNT];
+  GetPaxColumnOffsets(schema, offsets, dictionaries);
+  for (uint32_t i = 0; i < schema->GetColumnCount(); i++) {
+    const Column *column = schema->GetColumn(i);
+    const Field *field = row.GetField(i);
+    if (field->IsNull()) {
+      continue;
+    }
+    uint32_t state = GetPaxColumnState(i);
+    if (column->GetType() == TypeId::kTypeInt && state != 0) {
+      int64_t base = MACH_READ_INT32(GetPaxColumnBases() + sizeof(int32_t) * i);
+      int64_t delta = static_cast<int64_t>(field->value_.integer_) - base;
+      if (delta < INT16_MIN || delta > INT16_MAX) {
+        return false;
+      }
+    } else if (IsDictionaryColumn(column) && state == PAX_DICTIONARY_SIZE &&
+               FindDictionaryCode(GetData() + dictionaries[i], state, GetPaxStride(column), *field) < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TablePage::FindDictionaryEntry(Schema *schema, uint32_t column_id, const Field &value, const char **entry) {
+  if (!IsEncodedPaxPage() || !IsDictionaryColumn(schema->GetColumn(column_id))) {
+    return false;
+  }
+  uint32_t offsets[RowView::MAX_FIELD_COUNT];
+  uint32_t dictionaries[RowView::MAX_FIELD_COUNT];
+  GetPaxColumnOffsets(schema, offsets, dictionaries);
+  uint32_t stride = GetPaxStride(schema->GetColumn(column_id));
+  int32_t code = value.IsNull() ? -1
+                                : FindDictionaryCode(GetData() + dictionaries[column_id], GetPaxColumnState(column_id),
+                                                     stride, value);
+  *entry = code < 0 ? nullptr : GetData() + dictionaries[column_id] + stride * code;
+  return true;
+}
+
+bool TablePage::InsertPaxTuple(Row &row, Schema *schema) {
+  uint32_t i;
+  for (i = 0; i < GetTupleCount(); i++) {
+    if (GetTupleSize(i) == 0) {
+      break;
+    }
+  }
+  if (i == GetPaxSlotCapacity() || !FitsPaxLayout(row, schema)) {
+    return false;
+  }
+  if (IsEncodedPaxPage() && !CanEncodePaxTuple(row, schema)) {
+    // 封存本页，freespace map随后会把它记为已满
+    MACH_WRITE_UINT32(GetPaxDirectory(), MACH_READ_UINT32(GetPaxDirectory()) | PAX_SEALED_FLAG);
+    return false;
+  }
+  WritePaxTuple(i, row, schema);
+  SetTupleSize(i, GetPaxRowSize());
+  row.SetRowId(RowId(GetTablePageId(), i));
+  if (i == GetTupleCount()) {
+    SetTupleCount(GetTupleCount() + 1);
+  }
+  return true;
+}
+
+bool TablePage::UpdatePaxTuple(Row &new_row, Row *old_row, Schema *schema) {
+  uint32_t slot_num = old_row->GetRowId().GetSlotNum();
+  if (slot_num >= GetTupleCount() || IsDeleted(GetTupleSize(slot_num)) || !FitsPaxLayout(new_row, schema)) {
+    return false;
+  }
+  if (IsEncodedPaxPage() && !CanEncodePaxTuple(new_row, schema)) {
+    return false;
+  }
+  // 每个元组的位置是固定的，原地覆盖
+  ReadPaxTuple(slot_num, schema, old_row);
+  WritePaxTuple(slot_num, new_row, schema);
+  return true;
+}
+
+void TablePage::ReadPaxTuple(uint32_t slot_num, Schema *schema, Row *row) {
+  RowView view;
+  uint32_t offsets[RowView::MAX_FIELD_COUNT];
+  uint32_t dictionaries[RowView::MAX_FIELD_COUNT];
+  GetPaxColumnOffsets(schema, offsets, dictionaries);
+  ResetPaxView(slot_num, schema, offsets, dictionaries, &view);
+  RowId rid = row->GetRowId();
+  view.ToRow(row);
+  row->SetRowId(rid);
+}
+
+void TablePage::WritePaxTuple(uint32_t slot_num, const Row &row, Schema *schema) {
+  uint32_t offsets[RowView::MAX_FIELD_COUNT];
+  uint32_t dictionaries[RowView::MAX_FIELD_COUNT];
+  GetPaxColumnOffsets(schema, offsets, dictionaries);
+  bool encoded = IsEncodedPaxPage();
+  uint32_t null_bitmap = 0;
+  for (uint32_t i = 0; i < schema->GetColumnCount(); i++) {
+    const Column *column = schema->GetColumn(i);
+    const Field *field = row.GetField(i);
+    if (field->IsNull()) {
+      null_bitmap |= 1u << i;
+      continue;
+    }
+    char *buf = GetData() + offsets[i] + GetPaxColumnStride(column) * slot_num;
+    if (!encoded || GetPaxEncodedStride(column) == GetPaxStride(column)) {
+      field->SerializeTo(buf);
+    } else if (column->GetType() == TypeId::kTypeInt) {
+      // 第一个写入的值作为本页的基准值，调用者已检查差值的范围
+      char *base = GetPaxColumnBases() + sizeof(int32_t) * i;
+      if (GetPaxColumnState(i) == 0) {
+        MACH_WRITE_INT32(base, field->value_.integer_);
+        SetPaxColumnState(i, 1);
+      }
+      MACH_WRITE_TO(int16_t, buf, static_cast<int16_t>(field->value_.integer_ - MACH_READ_INT32(base)));
+    } else {
+      uint32_t count = GetPaxColumnState(i);
+      uint32_t stride = GetPaxStride(column);
+      int32_t code = FindDictionaryCode(GetData() + dictionaries[i], count, stride, *field);
+      if (code < 0) {
+        code = static_cast<int32_t>(count);
+        field->SerializeTo(GetData() + dictionaries[i] + stride * code);
+        SetPaxColumnState(i, count + 1);
+      }
+      MACH_WRITE_TO(uint8_t, buf, static_cast<uint8_t>(code));
+    }
+  }
+  SetTupleOffsetAtSlot(slot_num, null_bitmap);
+}
+
+void TablePage::ResetPaxView(uint32_t slot_num, Schema *schema, const uint32_t *offsets,
+                             const uint32_t *dictionaries, RowView *view) {
+  const char *fields[RowView::MAX_FIELD_COUNT];
+  uint32_t null_bitmap = GetTupleOffsetAtSlot(slot_num);
+  if (!IsEncodedPaxPage()) {
+    for (uint32_t i = 0; i < schema->GetColumnCount(); i++) {
+      fields[i] = GetData() + offsets[i] + GetPaxStride(schema->GetColumn(i)) * slot_num;
+    }
+    view->Reset(GetData() + OFFSET_TUPLE_OFFSET + SIZE_TUPLE * slot_num, schema, RowId(GetTablePageId(), slot_num),
+                null_bitmap, fields);
+    return;
+  }
+  // INT列由视图在读取时加上基准值，CHAR列直接指向字典中的值
+  uint32_t packed_bitmap = 0;
+  for (uint32_t i = 0; i < schema->GetColumnCount(); i++) {
+    const Column *column = schema->GetColumn(i);
+    fields[i] = GetData() + offsets[i] + GetPaxEncodedStride(column) * slot_num;
+    if (column->GetType() == TypeId::kTypeInt) {
+      packed_bitmap |= 1u << i;
+    } else if (IsDictionaryColumn(column) && (null_bitmap & (1u << i)) == 0) {
+      fields[i] = GetData() + dictionaries[i] + GetPaxStride(column) * MACH_READ_FROM(uint8_t, fields[i]);
+    }
+  }
+  view->Reset(GetData() + OFFSET_TUPLE_OFFSET + SIZE_TUPLE * slot_num, schema, RowId(GetTablePageId(), slot_num),
+              null_bitmap, fields, packed_bitmap, GetPaxColumnBases());
+}
+
 bool TablePage::InsertTuple(Row &row, Schema *schema, Txn *txn, LockManager *lock_manager, LogManager *log_manager) {
-  uint32_t serialized_size = row.GetSerializedSize(schema);
-  ASSERT(serialized_size > 0, "Can not have empty row.");
-  if (GetFreeSpaceRemaining() < serialized_size + SIZE_TUPLE) {
+  if (IsPaxPage()) {
+    return InsertPaxTuple(row, schema);
+  }
+  return InsertRowTuple(row, schema, nullptr);
+}
+
+bool TablePage::InsertRelocatedTuple(Row &row, const RowId &home_rid, Schema *schema) {
+  if (IsPaxPage()) {
     return false;
   }
+  return InsertRowTuple(row, schema, &home_rid);
+}
+
+bool TablePage::InsertRowTuple(Row &row, Schema *schema, const RowId *home_rid) {
+  uint32_t header_size = home_rid == nullptr ? 0 : SIZE_RELOCATED_HEADER;
+  uint32_t serialized_size = row.GetSerializedSize(schema) + header_size;
+  ASSERT(serialized_size > header_size, "Can not have empty row.");
   // Try to find a free slot to reuse.
-  // todo:record the max free space of deleted slot.
   uint32_t i;
   for (i = 0; i < GetTupleCount(); i++) {
     // If the slot is empty, i.e. its tuple has size 0,
@@ -26,13 +320,24 @@ bool TablePage::InsertTuple(Row &row, Schema *schema, Txn *txn, LockManager *loc
       break;
     }
   }
-  if (i == GetTupleCount() && GetFreeSpaceRemaining() < serialized_size + SIZE_TUPLE) {
-    return false;
+  // A reused slot needs no new slot entry.
+  uint32_t need_space = serialized_size + (i == GetTupleCount() ? SIZE_TUPLE : 0);
+  if (GetFreeSpaceRemaining() < need_space) {
+    // Not enough contiguous space, compact the page if the holes make up for it.
+    if (GetFreeSpaceRemaining() + GetFragmentedSpace() < need_space) {
+      return false;
+    }
+    Compact();
   }
   // Otherwise we claim available free space..
   SetFreeSpacePointer(GetFreeSpacePointer() - serialized_size);
-  uint32_t __attribute__((unused)) write_bytes = row.SerializeTo(GetData() + GetFreeSpacePointer(), schema);
-  ASSERT(write_bytes == serialized_size, "Unexpected behavior in row serialize.");
+  char *buf = GetData() + GetFreeSpacePointer();
+  if (home_rid != nullptr) {
+    MACH_WRITE_UINT32(buf, RELOCATED_MAGIC_NUM);
+    MACH_WRITE_TO(int64_t, buf + sizeof(uint32_t), home_rid->Get());
+  }
+  uint32_t __attribute__((unused)) write_bytes = row.SerializeTo(buf + header_size, schema);
+  ASSERT(write_bytes + header_size == serialized_size, "Unexpected behavior in row serialize.");
 
   // Set the tuple.
   SetTupleOffsetAtSlot(i, GetFreeSpacePointer());
@@ -66,6 +371,9 @@ bool TablePage::MarkDelete(const RowId &rid, Txn *txn, LockManager *lock_manager
 bool TablePage::UpdateTuple(Row &new_row, Row *old_row, Schema *schema, Txn *txn, LockManager *lock_manager,
                             LogManager *log_manager) {
   ASSERT(old_row != nullptr && old_row->GetRowId().Get() != INVALID_ROWID.Get(), "invalid old row.");
+  if (IsPaxPage()) {
+    return UpdatePaxTuple(new_row, old_row, schema);
+  }
   uint32_t serialized_size = new_row.GetSerializedSize(schema);
   ASSERT(serialized_size > 0, "Can not have empty row.");
   uint32_t slot_num = old_row->GetRowId().GetSlotNum();
@@ -74,36 +382,95 @@ bool TablePage::UpdateTuple(Row &new_row, Row *old_row, Schema *schema, Txn *txn
     return false;
   }
   uint32_t tuple_size = GetTupleSize(slot_num);
-  // If the tuple is deleted, abort.
-  if (IsDeleted(tuple_size)) {
+  // If the tuple is deleted or has moved to another page, abort.
+  if (IsDeleted(tuple_size) || IsForward(slot_num)) {
     return false;
   }
+  // Copy out the old value.
+  uint32_t tuple_offset = GetTupleOffsetAtSlot(slot_num);
+  uint32_t header_size = GetRowOffsetAtSlot(slot_num) - tuple_offset;
+  uint32_t __attribute__((unused)) read_bytes = old_row->DeserializeFrom(GetData() + tuple_offset + header_size, schema);
+  ASSERT(tuple_size == read_bytes + header_size, "Unexpected behavior in tuple deserialize.");
+  // A relocated tuple keeps its home row id.
+  char header[SIZE_RELOCATED_HEADER];
+  memcpy(header, GetData() + tuple_offset, header_size);
   // If there is not enough space to update, we need to update via delete followed by an insert (not enough space).
-  if (GetFreeSpaceRemaining() + tuple_size < serialized_size) {
+  if (!ResizeTuple(slot_num, header_size + serialized_size)) {
     return false;
   }
-  // Copy out the old value.
+  tuple_offset = GetTupleOffsetAtSlot(slot_num);
+  memcpy(GetData() + tuple_offset, header, header_size);
+  new_row.SerializeTo(GetData() + tuple_offset + header_size, schema);
+  return true;
+}
+
+bool TablePage::ResizeTuple(uint32_t slot_num, uint32_t new_size) {
+  uint32_t tuple_size = GetTupleSize(slot_num);
+  ASSERT(!IsDeleted(tuple_size), "Can not resize a deleted tuple.");
+  if (GetFreeSpaceRemaining() + tuple_size < new_size) {
+    if (GetFreeSpaceRemaining() + GetFragmentedSpace() + tuple_size < new_size) {
+      return false;
+    }
+    Compact();
+  }
   uint32_t tuple_offset = GetTupleOffsetAtSlot(slot_num);
-  uint32_t __attribute__((unused)) read_bytes = old_row->DeserializeFrom(GetData() + tuple_offset, schema);
-  ASSERT(tuple_size == read_bytes, "Unexpected behavior in tuple deserialize.");
   uint32_t free_space_pointer = GetFreeSpacePointer();
   ASSERT(tuple_offset >= free_space_pointer, "Offset should appear after current free space position.");
-  memmove(GetData() + free_space_pointer + tuple_size - serialized_size, GetData() + free_space_pointer,
+  // Shift the tuples before this one, the end of this tuple stays in place.
+  memmove(GetData() + free_space_pointer + tuple_size - new_size, GetData() + free_space_pointer,
           tuple_offset - free_space_pointer);
-  SetFreeSpacePointer(free_space_pointer + tuple_size - serialized_size);
-  new_row.SerializeTo(GetData() + tuple_offset + tuple_size - serialized_size, schema);
-  SetTupleSize(slot_num, serialized_size);
+  SetFreeSpacePointer(free_space_pointer + tuple_size - new_size);
+  SetTupleSize(slot_num, new_size);
 
   // Update all tuple offsets.
   for (uint32_t i = 0; i < GetTupleCount(); ++i) {
     uint32_t tuple_offset_i = GetTupleOffsetAtSlot(i);
     if (GetTupleSize(i) > 0 && tuple_offset_i < tuple_offset + tuple_size) {
-      SetTupleOffsetAtSlot(i, tuple_offset_i + tuple_size - new_row.GetSerializedSize(schema));
+      SetTupleOffsetAtSlot(i, tuple_offset_i + tuple_size - new_size);
     }
   }
   return true;
 }
 
+bool TablePage::SetForward(uint32_t slot_num, const RowId &target) {
+  if (IsPaxPage() || slot_num >= GetTupleCount() || IsDeleted(GetTupleSize(slot_num))) {
+    return false;
+  }
+  // 转发记录不大于任何元组，原地缩小总能成功
+  if (!ResizeTuple(slot_num, SIZE_FORWARD)) {
+    return false;
+  }
+  char *buf = GetData() + GetTupleOffsetAtSlot(slot_num);
+  MACH_WRITE_UINT32(buf, FORWARD_MAGIC_NUM);
+  MACH_WRITE_TO(int64_t, buf + sizeof(uint32_t), target.Get());
+  return true;
+}
+
+bool TablePage::GetForward(uint32_t slot_num, RowId *target) {
+  if (slot_num >= GetTupleCount() || !IsForward(slot_num)) {
+    return false;
+  }
+  *target = RowId(MACH_READ_FROM(int64_t, GetData() + GetTupleOffsetAtSlot(slot_num) + sizeof(uint32_t)));
+  return true;
+}
+
+bool TablePage::GetHomeRowId(uint32_t slot_num, RowId *home_rid) {
+  if (IsPaxPage() || slot_num >= GetTupleCount() || GetTupleSize(slot_num) == 0 ||
+      GetTupleMagic(slot_num) != RELOCATED_MAGIC_NUM) {
+    return false;
+  }
+  *home_rid = RowId(MACH_READ_FROM(int64_t, GetData() + GetTupleOffsetAtSlot(slot_num) + sizeof(uint32_t)));
+  return true;
+}
+
+void TablePage::ClearHomeRowId(uint32_t slot_num) {
+  RowId home_rid;
+  if (GetHomeRowId(slot_num, &home_rid)) {
+    // 行位于元组末尾，去掉头部只需移动它之前的元组
+    ResizeTuple(slot_num, GetTupleSize(slot_num) - SIZE_RELOCATED_HEADER);
+  }
+}
+
 void TablePage::ApplyDelete(const RowId &rid, Txn *txn, LogManager *log_manager) {
   uint32_t slot_num = rid.GetSlotNum();
   ASSERT(slot_num < GetTupleCount(), "Cannot have more slots than tuples.");
@@ -115,22 +482,62 @@ void TablePage::ApplyDelete(const RowId &rid, Txn *txn, LogManager *log_manager)
     tuple_size = UnsetDeletedFlag(tuple_size);
   }
 
-  uint32_t free_space_pointer = GetFreeSpacePointer();
-  ASSERT(tuple_offset >= free_space_pointer, "Free space appears before tuples.");
+  // A PAX tuple only gives its slot back.
+  if (!IsPaxPage()) {
+    uint32_t free_space_pointer = GetFreeSpacePointer();
+    ASSERT(tuple_offset >= free_space_pointer, "Free space appears before tuples.");
 
-  memmove(GetData() + free_space_pointer + tuple_size, GetData() + free_space_pointer,
-          tuple_offset - free_space_pointer);
-  SetFreeSpacePointer(free_space_pointer + tuple_size);
+    // The tuple next to the free space is given back directly, any other one leaves a hole that is
+    // reclaimed by Compact() once an insert or update runs short of contiguous space.
+    if (tuple_size != 0 && tuple_offset == free_space_pointer) {
+      SetFreeSpacePointer(free_space_pointer + tuple_size);
+    }
+  }
   SetTupleSize(slot_num, 0);
   SetTupleOffsetAtSlot(slot_num, 0);
 
-  // Update all tuple offsets.
-  for (uint32_t i = 0; i < GetTupleCount(); ++i) {
-    uint32_t tuple_offset_i = GetTupleOffsetAtSlot(i);
-    if (GetTupleSize(i) != 0 && tuple_offset_i < tuple_offset) {
-      SetTupleOffsetAtSlot(i, tuple_offset_i + tuple_size);
+  // Empty slots at the end of the slot array are dropped.
+  uint32_t tuple_count = GetTupleCount();
+  while (tuple_count > 0 && GetTupleSize(tuple_count - 1) == 0) {
+    tuple_count--;
+  }
+  SetTupleCount(tuple_count);
+  // 空的压缩页重新开始编码
+  if (tuple_count == 0 && IsEncodedPaxPage()) {
+    ResetPaxDirectory();
+  }
+}
+
+uint32_t TablePage::GetFragmentedSpace() {
+  uint32_t used_space = 0;
+  for (uint32_t i = 0; i < GetTupleCount(); i++) {
+    used_space += UnsetDeletedFlag(GetTupleSize(i));
+  }
+  return PAGE_SIZE - GetFreeSpacePointer() - used_space;
+}
+
+void TablePage::Compact() {
+  if (IsPaxPage()) {
+    return;
+  }
+  // Move tuples from the page end downwards, so every tuple only moves towards the page end.
+  std::vector<std::pair<uint32_t, uint32_t>> tuples;  // (offset, slot_num)
+  for (uint32_t i = 0; i < GetTupleCount(); i++) {
+    if (GetTupleSize(i) != 0) {
+      tuples.emplace_back(GetTupleOffsetAtSlot(i), i);
+    }
+  }
+  std::sort(tuples.begin(), tuples.end(), std::greater<>());
+  uint32_t free_space_pointer = PAGE_SIZE;
+  for (auto &tuple : tuples) {
+    uint32_t tuple_size = UnsetDeletedFlag(GetTupleSize(tuple.second));
+    free_space_pointer -= tuple_size;
+    if (free_space_pointer != tuple.first) {
+      memmove(GetData() + free_space_pointer, GetData() + tuple.first, tuple_size);
+      SetTupleOffsetAtSlot(tuple.second, free_space_pointer);
     }
   }
+  SetFreeSpacePointer(free_space_pointer);
 }
 
 void TablePage::RollbackDelete(const RowId &rid, Txn *txn, LogManager *log_manager) {
@@ -158,17 +565,99 @@ bool TablePage::GetTuple(Row *row, Schema *schema, Txn *txn, LockManager *lock_m
   if (IsDeleted(tuple_size)) {
     return false;
   }
+  if (IsPaxPage()) {
+    ReadPaxTuple(slot_num, schema, row);
+    return true;
+  }
+  // A forwarding record is followed by the caller.
+  if (IsForward(slot_num)) {
+    return false;
+  }
   // At this point, we have at least a shared lock on the RID. Copy the tuple data into our result.
-  uint32_t tuple_offset = GetTupleOffsetAtSlot(slot_num);
+  uint32_t tuple_offset = GetRowOffsetAtSlot(slot_num);
   uint32_t __attribute__((unused)) read_bytes = row->DeserializeFrom(GetData() + tuple_offset, schema);
-  ASSERT(tuple_size == read_bytes, "Unexpected behavior in tuple deserialize.");
+  ASSERT(tuple_size == read_bytes + tuple_offset - GetTupleOffsetAtSlot(slot_num),
+         "Unexpected behavior in tuple deserialize.");
   return true;
 }
 
+bool TablePage::GetTupleIgnoreMark(Row *row, Schema *schema) {
+  uint32_t slot_num = row->GetRowId().GetSlotNum();
+  if (slot_num >= GetTupleCount() || GetTupleSize(slot_num) == 0) {
+    return false;
+  }
+  if (IsPaxPage()) {
+    ReadPaxTuple(slot_num, schema, row);
+    return true;
+  }
+  if (IsForward(slot_num)) {
+    return false;
+  }
+  row->DeserializeFrom(GetData() + GetRowOffsetAtSlot(slot_num), schema);
+  return true;
+}
+
+bool TablePage::GetTupleView(uint32_t slot_num, Schema *schema, RowView *view, const ToastStore *toast_store) {
+  if (slot_num >= GetTupleCount() || IsDeleted(GetTupleSize(slot_num))) {
+    return false;
+  }
+  if (IsPaxPage()) {
+    uint32_t offsets[RowView::MAX_FIELD_COUNT];
+    uint32_t dictionaries[RowView::MAX_FIELD_COUNT];
+    GetPaxColumnOffsets(schema, offsets, dictionaries);
+    ResetPaxView(slot_num, schema, offsets, dictionaries, view);
+    return true;
+  }
+  if (IsForward(slot_num)) {
+    return false;
+  }
+  ResetRowView(slot_num, schema, view, toast_store);
+  return true;
+}
+
+uint32_t TablePage::GetTupleViews(Schema *schema, std::vector<RowView> *views, uint32_t begin_slot,
+                                  const ToastStore *toast_store) {
+  views->clear();
+  uint32_t tuple_count = GetTupleCount();
+  if (IsPaxPage()) {
+    // 只计算各列的位置，列值在被访问时才解码
+    uint32_t offsets[RowView::MAX_FIELD_COUNT];
+    uint32_t dictionaries[RowView::MAX_FIELD_COUNT];
+    GetPaxColumnOffsets(schema, offsets, dictionaries);
+    for (uint32_t i = begin_slot; i < tuple_count; i++) {
+      if (!IsDeleted(GetTupleSize(i))) {
+        views->emplace_back();
+        ResetPaxView(i, schema, offsets, dictionaries, &views->back());
+      }
+    }
+    return views->size();
+  }
+  for (uint32_t i = begin_slot; i < tuple_count; i++) {
+    // 转发记录跳过，迁移来的元组以原row id出现
+    if (IsDeleted(GetTupleSize(i)) || IsForward(i)) {
+      continue;
+    }
+    views->emplace_back();
+    ResetRowView(i, schema, &views->back(), toast_store);
+  }
+  return views->size();
+}
+
+void TablePage::ResetRowView(uint32_t slot_num, Schema *schema, RowView *view, const ToastStore *toast_store) {
+  uint32_t tuple_offset = GetRowOffsetAtSlot(slot_num);
+  view->Reset(GetData() + tuple_offset, schema, RowId(GetTablePageId(), slot_num), toast_store);
+  ASSERT(GetTupleSize(slot_num) == view->GetSerializedSize() + tuple_offset - GetTupleOffsetAtSlot(slot_num),
+         "Unexpected behavior in tuple view.");
+  RowId home_rid;
+  if (GetHomeRowId(slot_num, &home_rid)) {
+    view->SetRowId(home_rid);
+  }
+}
+
 bool TablePage::GetFirstTupleRid(RowId *first_rid) {
   // Find and return the first valid tuple.
   for (uint32_t i = 0; i < GetTupleCount(); i++) {
-    if (!IsDeleted(GetTupleSize(i))) {
+    if (!IsDeleted(GetTupleSize(i)) && !IsForward(i)) {
       first_rid->Set(GetTablePageId(), i);
       return true;
     }
@@ -181,7 +670,7 @@ bool TablePage::GetNextTupleRid(const RowId &cur_rid, RowId *next_rid) {
   ASSERT(cur_rid.GetPageId() == GetTablePageId(), "Wrong table!");
   // Find and return the first valid tuple after our current slot number.
   for (auto i = cur_rid.GetSlotNum() + 1; i < GetTupleCount(); i++) {
-    if (!IsDeleted(GetTupleSize(i))) {
+    if (!IsDeleted(GetTupleSize(i)) && !IsForward(i)) {
       next_rid->Set(GetTablePageId(), i);
       return true;
     }
@@ -0,0 +1,46 @@
+#include "record/compare_kernel.h"
+
+#include <stdexcept>
+
+CompareOp CompareKernels::ParseOp(const std::string &comp_type) {
+  if (comp_type == "=")
+    return CompareOp::kEqual;
+  else if (comp_type == "<>")
+    return CompareOp::kNotEqual;
+  else if (comp_type == "<")
+    return CompareOp::kLessThan;
+  else if (comp_type == "<=")
+    return CompareOp::kLessThanEquals;
+  else if (comp_type == ">")
+    return CompareOp::kGreaterThan;
+  else if (comp_type == ">=")
+    return CompareOp::kGreaterThanEquals;
+  else if (comp_type == "is")
+    return CompareOp::kIsNull;
+  else if (comp_type == "not")
+    return CompareOp::kIsNotNull;
+  else
+    throw std::logic_error("Unsupported comparison type");
+}
+
+CompareKernel CompareKernels::Get(TypeId type_id, CompareOp op) {
+  switch (op) {
+    case CompareOp::kEqual:
+      return GetForType<std::equal_to>(type_id);
+    case CompareOp::kNotEqual:
+      return GetForType<std::not_equal_to>(type_id);
+    case CompareOp::kLessThan:
+      return GetForType<std::less>(type_id);
+    case CompareOp::kLessThanEquals:
+      return GetForType<std::less_equal>(type_id);
+    case CompareOp::kGreaterThan:
+      return GetForType<std::greater>(type_id);
+    case CompareOp::kGreaterThanEquals:
+      return GetForType<std::greater_equal>(type_id);
+    case CompareOp::kIsNull:
+      return &IsNull;
+    case CompareOp::kIsNotNull:
+      return &IsNotNull;
+  }
+  return nullptr;
+}
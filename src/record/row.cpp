@@ -8,49 +8,126 @@ uint32_t Row::SerializeTo(char *buf, Schema *schema) const {
     ASSERT(schema != nullptr, "Invalid schema before serialize.");
     ASSERT(schema->GetColumnCount() == fields_.size(), "Fields size do not match schema's column size.");
 
-    char *start = buf;
-    MACH_WRITE_UINT32(buf, Row::ROW_MAGIC_NUM);
-    buf += sizeof(uint32_t);
-
     uint32_t field_count = fields_.size();
-    MACH_WRITE_UINT32(buf, field_count);
-    buf += sizeof(uint32_t);
-
-    uint32_t null_bitmap = 0;
-    for (uint32_t i = 0; i < field_count; ++i) {
-        if (fields_[i]->IsNull()) {
-            null_bitmap |= (1 << i);
-        }
-    }
-    MACH_WRITE_UINT32(buf, null_bitmap);
-    buf += sizeof(uint32_t);
+    MACH_WRITE_UINT32(buf, Row::ROW_MAGIC_NUM);
+    MACH_WRITE_TO(uint8_t, buf + sizeof(uint32_t), Row::ROW_FORMAT_V2);
+    MACH_WRITE_TO(uint16_t, buf + sizeof(uint32_t) + sizeof(uint8_t), static_cast<uint16_t>(field_count));
+    char *null_bitmap = buf + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint16_t);
+    memset(null_bitmap, 0, schema->GetRowHeaderSize() - (null_bitmap - buf));
 
+    uint32_t var_offset = schema->GetRowVarDataOffset();
     for (uint32_t i = 0; i < field_count; i++) {
-        buf += fields_[i]->SerializeTo(buf);
+        const Field &field = fields_[i];
+        TypeId type = schema->GetColumn(i)->GetType();
+        char *slot = buf + schema->GetRowOffset(i);
+        if (field.IsNull()) {
+            null_bitmap[i / 8] |= static_cast<char>(1 << (i % 8));
+        }
+        if (type != TypeId::kTypeChar) {
+            // NULL的定长值也占位，保证偏移固定
+            if (field.IsNull()) {
+                memset(slot, 0, Type::GetTypeSize(type));
+            } else {
+                field.SerializeTo(slot);
+            }
+            continue;
+        }
+        if (!field.IsNull()) {
+            memcpy(buf + var_offset, field.GetData(), field.GetLength());
+            var_offset += field.GetLength();
+        }
+        // 溢出值的指针在偏移表项中做标记
+        MACH_WRITE_UINT32(slot, IsExternal(i) ? (var_offset | EXTERNAL_FLAG) : var_offset);
     }
 
-    return buf - start;
+    return var_offset;
 }
 
 uint32_t Row::DeserializeFrom(char *buf, Schema *schema) {
     ASSERT(schema != nullptr, "Invalid schema before deserialize.");
-//    ASSERT(fields_.empty(), "Non empty field in row.");
-
-    char *start = buf;
     uint32_t magic_num = MACH_READ_UINT32(buf);
     ASSERT(magic_num == Row::ROW_MAGIC_NUM, "Magic number mismatch in Row::DeserializeFrom");
+    if (!IsFormatV2(buf)) {
+        return DeserializeFromV1(buf, schema);
+    }
+
+    uint32_t field_count = MACH_READ_FROM(uint16_t, buf + sizeof(uint32_t) + sizeof(uint8_t));
+    ASSERT(field_count == schema->GetColumnCount(), "Fields size do not match schema's column size.");
+    const char *null_bitmap = buf + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint16_t);
+
+    fields_.clear();
+    fields_.reserve(field_count);
+    external_.clear();
+    uint32_t var_offset = schema->GetRowVarDataOffset();
+    for (uint32_t i = 0; i < field_count; ++i) {
+        TypeId type = schema->GetColumn(i)->GetType();
+        char *slot = buf + schema->GetRowOffset(i);
+        bool is_null = (null_bitmap[i / 8] & (1 << (i % 8))) != 0;
+        if (type == TypeId::kTypeChar) {
+            uint32_t end = MACH_READ_UINT32(slot);
+            if (end & EXTERNAL_FLAG) {
+                end &= ~EXTERNAL_FLAG;
+                SetExternal(i, true);
+            }
+            if (is_null) {
+                fields_.emplace_back(type);
+            } else {
+                fields_.emplace_back(type, buf + var_offset, end - var_offset, true);
+            }
+            var_offset = end;
+            continue;
+        }
+        if (is_null) {
+            fields_.emplace_back(type);
+        } else if (type == TypeId::kTypeInt) {
+            // 定长的值直接存在字段中
+            fields_.emplace_back(type, MACH_READ_INT32(slot));
+        } else {
+            fields_.emplace_back(type, MACH_READ_FROM(float, slot));
+        }
+    }
+
+    return var_offset;
+}
+
+uint32_t Row::DeserializeFromV1(char *buf, Schema *schema) {
+    char *start = buf;
     buf += sizeof(uint32_t);
 
     uint32_t field_count = MACH_READ_UINT32(buf);
+    ASSERT(field_count <= MAX_FIELD_COUNT_V1, "Unexpected field count.");
     buf += sizeof(uint32_t);
 
     uint32_t null_bitmap = MACH_READ_UINT32(buf);
     buf += sizeof(uint32_t);
 
-    fields_.resize(field_count);
+    fields_.clear();
+    fields_.reserve(field_count);
+    external_.clear();
     for (uint32_t i = 0; i < field_count; ++i) {
-        fields_[i] = nullptr;
-        buf += Field::DeserializeFrom(buf, schema->GetColumn(i)->GetType(), &fields_[i], (null_bitmap & (1 << i)) != 0);
+        TypeId type = schema->GetColumn(i)->GetType();
+        if ((null_bitmap & (1 << i)) != 0) {
+            fields_.emplace_back(type);
+            continue;
+        }
+        if (type == TypeId::kTypeInt) {
+            fields_.emplace_back(type, MACH_READ_INT32(buf));
+            buf += sizeof(int32_t);
+            continue;
+        }
+        if (type == TypeId::kTypeFloat) {
+            fields_.emplace_back(type, MACH_READ_FROM(float, buf));
+            buf += sizeof(float);
+            continue;
+        }
+        // 溢出值的指针，长度字段带有EXTERNAL_FLAG
+        uint32_t len = MACH_READ_UINT32(buf);
+        if (len & EXTERNAL_FLAG) {
+            len = SIZE_EXTERNAL_POINTER;
+            SetExternal(i, true);
+        }
+        fields_.emplace_back(type, buf + sizeof(uint32_t), len, true);
+        buf += sizeof(uint32_t) + len;
     }
 
     return buf - start;
@@ -60,9 +137,12 @@ uint32_t Row::GetSerializedSize(Schema *schema) const {
     ASSERT(schema != nullptr, "Invalid schema before calculate size.");
     ASSERT(schema->GetColumnCount() == fields_.size(), "Fields size do not match schema's column size.");
 
-    uint32_t size = sizeof(uint32_t) * 3;  // magic_num + field_count + null_bitmap
-    for (const auto &field : fields_) {
-        size += field->GetSerializedSize();
+    // header + fixed-width values + CHAR offset table
+    uint32_t size = schema->GetRowVarDataOffset();
+    for (uint32_t i = 0; i < fields_.size(); i++) {
+        if (schema->GetColumn(i)->GetType() == TypeId::kTypeChar && !fields_[i].IsNull()) {
+            size += fields_[i].GetLength();
+        }
     }
     return size;
 }
@@ -70,10 +150,20 @@ uint32_t Row::GetSerializedSize(Schema *schema) const {
 void Row::GetKeyFromRow(const Schema *schema, const Schema *key_schema, Row &key_row) {
     auto columns = key_schema->GetColumns();
     std::vector<Field> fields;
+    fields.reserve(columns.size());
     uint32_t idx;
     for (auto column : columns) {
         schema->GetColumnIndex(column->GetName(), idx);
         fields.emplace_back(*this->GetField(idx));
     }
-    key_row = Row(fields);
+    key_row = Row(std::move(fields));
+}
+
+void Row::CopyCharsInto(Arena *arena) {
+    for (auto &field : fields_) {
+        if (field.GetTypeId() == TypeId::kTypeChar && !field.IsNull()) {
+            Field copy(TypeId::kTypeChar, field.GetData(), field.GetLength(), arena);
+            field = std::move(copy);
+        }
+    }
 }
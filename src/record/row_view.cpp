@@ -0,0 +1,157 @@
+#include "record/row_view.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "glog/logging.h"
+#include "storage/toast_store.h"
+
+void RowView::Reset(const char *data, Schema *schema, RowId rid, const ToastStore *toast_store) {
+  ASSERT(schema != nullptr, "Invalid schema for row view.");
+  data_ = data;
+  schema_ = schema;
+  rid_ = rid;
+  slot_num_ = rid.GetSlotNum();
+  toast_store_ = toast_store;
+  external_bitmap_ = 0;
+  packed_bitmap_ = 0;
+  if (Row::IsFormatV2(data)) {
+    field_count_ = MACH_READ_FROM(uint16_t, data + sizeof(uint32_t) + sizeof(uint8_t));
+    ASSERT(field_count_ == schema->GetColumnCount(), "Unexpected field count.");
+    null_bytes_ = reinterpret_cast<const uint8_t *>(data + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint16_t));
+    // 最后一个CHAR值的结尾就是行的结尾
+    size_ = schema->GetRowVarDataOffset();
+    if (size_ > schema->GetRowVarTableOffset()) {
+      size_ = MACH_READ_UINT32(data + size_ - sizeof(uint32_t)) & ~Row::EXTERNAL_FLAG;
+    }
+    return;
+  }
+  null_bytes_ = nullptr;
+  // magic num, field count, null bitmap
+  field_count_ = MACH_READ_UINT32(data + sizeof(uint32_t));
+  null_bitmap_ = MACH_READ_UINT32(data + sizeof(uint32_t) * 2);
+  ASSERT(field_count_ <= MAX_FIELD_COUNT && field_count_ == schema->GetColumnCount(), "Unexpected field count.");
+  uint32_t offset = SIZE_ROW_HEADER;
+  for (uint32_t i = 0; i < field_count_; i++) {
+    fields_[i] = data + offset;
+    if (IsNull(i)) {
+      continue;
+    }
+    if (schema->GetColumn(i)->GetType() == TypeId::kTypeChar) {
+      uint32_t len = MACH_READ_UINT32(data + offset);
+      if (len & Row::EXTERNAL_FLAG) {
+        external_bitmap_ |= 1u << i;
+        len = Row::SIZE_EXTERNAL_POINTER;
+      }
+      offset += sizeof(uint32_t) + len;
+    } else {
+      offset += Type::GetTypeSize(schema->GetColumn(i)->GetType());
+    }
+  }
+  size_ = offset;
+}
+
+void RowView::Reset(const char *data, Schema *schema, RowId rid, uint32_t null_bitmap, const char *const *fields,
+                    uint32_t packed_bitmap, const char *bases) {
+  ASSERT(schema != nullptr && schema->GetColumnCount() <= MAX_FIELD_COUNT, "Invalid schema for row view.");
+  data_ = data;
+  schema_ = schema;
+  rid_ = rid;
+  slot_num_ = rid.GetSlotNum();
+  field_count_ = schema->GetColumnCount();
+  null_bytes_ = nullptr;
+  null_bitmap_ = null_bitmap;
+  external_bitmap_ = 0;
+  toast_store_ = nullptr;
+  size_ = 0;
+  packed_bitmap_ = packed_bitmap;
+  bases_ = bases;
+  std::copy(fields, fields + field_count_, fields_);
+}
+
+Field RowView::GetField(uint32_t idx) const {
+  ASSERT(idx < field_count_, "Failed to access field");
+  TypeId type = schema_->GetColumn(idx)->GetType();
+  if (IsNull(idx)) {
+    return Field(type);
+  }
+  switch (type) {
+    case TypeId::kTypeInt:
+      return Field(type, ReadInt(idx));
+    case TypeId::kTypeFloat:
+      return Field(type, MACH_READ_FROM(float, GetFieldData(idx)));
+    default:
+      uint32_t len;
+      if (IsExternal(idx)) {
+        std::unique_ptr<char[]> value(FetchExternal(idx, &len));
+        return Field(type, value.get(), len, true);
+      }
+      const char *data = GetCharData(idx, &len);
+      return Field(type, const_cast<char *>(data), len, false);
+  }
+}
+
+char *RowView::FetchExternal(uint32_t idx, uint32_t *len) const {
+  ASSERT(toast_store_ != nullptr, "No toast store to read an external value from.");
+  uint32_t pointer_len;
+  const char *pointer = GetCharData(idx, &pointer_len);
+  page_id_t first_page_id = MACH_READ_FROM(page_id_t, pointer);
+  *len = MACH_READ_UINT32(pointer + sizeof(page_id_t));
+  char *value = new char[*len];
+  if (!toast_store_->Fetch(first_page_id, *len, value)) {
+    LOG(ERROR) << "Failed to read external value of " << rid_.GetPageId() << ":" << rid_.GetSlotNum() << std::endl;
+    memset(value, 0, *len);
+  }
+  return value;
+}
+
+void RowView::AppendField(uint32_t idx, bool copy_data, Arena *arena, std::vector<Field> *fields) const {
+  ASSERT(idx < field_count_, "Failed to access field");
+  TypeId type = schema_->GetColumn(idx)->GetType();
+  if (IsNull(idx)) {
+    fields->emplace_back(type);
+    return;
+  }
+  switch (type) {
+    case TypeId::kTypeInt:
+      fields->emplace_back(type, ReadInt(idx));
+      return;
+    case TypeId::kTypeFloat:
+      fields->emplace_back(type, MACH_READ_FROM(float, GetFieldData(idx)));
+      return;
+    default:
+      uint32_t len;
+      const char *data = GetCharData(idx, &len);
+      std::unique_ptr<char[]> value;
+      if (IsExternal(idx)) {
+        value.reset(FetchExternal(idx, &len));
+        data = value.get();
+        copy_data = true;
+      }
+      if (copy_data && arena != nullptr) {
+        fields->emplace_back(type, data, len, arena);
+      } else {
+        fields->emplace_back(type, const_cast<char *>(data), len, copy_data);
+      }
+  }
+}
+
+void RowView::ToRow(Row *row, Arena *arena) const {
+  row->destroy();
+  row->SetRowId(rid_);
+  auto &fields = row->GetFields();
+  fields.reserve(field_count_);
+  for (uint32_t i = 0; i < field_count_; i++) {
+    AppendField(i, true, arena, &fields);
+  }
+}
+
+void RowView::ToRow(const std::vector<uint32_t> &column_ids, Row *row, bool copy_data, Arena *arena) const {
+  row->destroy();
+  row->SetRowId(rid_);
+  auto &fields = row->GetFields();
+  fields.reserve(column_ids.size());
+  for (auto idx : column_ids) {
+    AppendField(idx, copy_data, arena, &fields);
+  }
+}
@@ -1,5 +1,29 @@
 #include "record/schema.h"
 
+#include "record/types.h"
+
+void Schema::InitRowLayout() {
+    // magic_num + version + field_count + null bitmap of one bit per column, aligned to 4 bytes
+    uint32_t column_count = columns_.size();
+    row_header_size_ = (sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint16_t) + (column_count + 7) / 8 + 3) & ~3u;
+    row_offsets_.resize(column_count);
+    uint32_t offset = row_header_size_;
+    for (uint32_t i = 0; i < column_count; i++) {
+        if (columns_[i]->GetType() != TypeId::kTypeChar) {
+            row_offsets_[i] = offset;
+            offset += Type::GetTypeSize(columns_[i]->GetType());
+        }
+    }
+    row_var_table_offset_ = offset;
+    for (uint32_t i = 0; i < column_count; i++) {
+        if (columns_[i]->GetType() == TypeId::kTypeChar) {
+            row_offsets_[i] = offset;
+            offset += sizeof(uint32_t);
+        }
+    }
+    row_var_data_offset_ = offset;
+}
+
 /**
  * TODO: Student Implement
  */
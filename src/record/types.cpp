@@ -3,18 +3,6 @@
 #include "common/macros.h"
 #include "record/field.h"
 
-inline int CompareStrings(const char *str1, int len1, const char *str2, int len2) {
-  assert(str1 != nullptr);
-  assert(len1 >= 0);
-  assert(str2 != nullptr);
-  assert(len2 >= 0);
-  int ret = memcmp(str1, str2, static_cast<size_t>(std::min(len1, len2)));
-  if (ret == 0 && len1 != len2) {
-    ret = len1 - len2;
-  }
-  return ret;
-}
-
 // ==============================Type=============================
 
 Type *Type::type_singletons_[] = {new Type(TypeId::kTypeInvalid), new TypeInt(), new TypeFloat(), new TypeChar()};
@@ -2,6 +2,7 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <filesystem>
 #include <stdexcept>
 
@@ -108,6 +109,33 @@ void DiskManager::DeAllocatePage(page_id_t logical_page_id) {
   delete[] bitmapPage_meta;
 }
 
+void DiskManager::DeAllocatePages(std::vector<page_id_t> logical_page_ids) {
+  auto* metaPage = reinterpret_cast<DiskFileMetaPage*>(meta_data_);
+  // 按extent分组，每个位图页只读写一次
+  std::sort(logical_page_ids.begin(), logical_page_ids.end());
+  char* bitmapPage_meta = new char[PAGE_SIZE];
+  auto* bitmapPage = reinterpret_cast<BitmapPage<PAGE_SIZE>*>(bitmapPage_meta);
+  size_t i = 0;
+  while (i < logical_page_ids.size()) {
+    page_id_t logical_page_id = logical_page_ids[i];
+    if (logical_page_id < 0 || logical_page_id >= MAX_VALID_PAGE_ID) {
+      LOG(WARNING)<<"invalid logical_id: "<<logical_page_id<<std::endl;
+      i++;
+      continue;
+    }
+    size_t bitmap_id = logical_page_id / BITMAP_SIZE;
+    ReadPhysicalPage(bitmap_id*(BITMAP_SIZE+1)+1,bitmapPage_meta);
+    for (; i < logical_page_ids.size() && logical_page_ids[i] / BITMAP_SIZE == bitmap_id; i++) {
+      if (bitmapPage->DeAllocatePage(logical_page_ids[i] % BITMAP_SIZE)) {
+        metaPage->extent_used_page_[bitmap_id]--;
+        metaPage->num_allocated_pages_--;
+      }
+    }
+    WritePhysicalPage(bitmap_id*(BITMAP_SIZE+1)+1,bitmapPage_meta);
+  }
+  delete[] bitmapPage_meta;
+}
+
 /**
  * TODO: Student Implement
  */
@@ -121,8 +149,9 @@ bool DiskManager::IsPageFree(page_id_t logical_page_id) {
   char* bitmapPage_meta = new char[PAGE_SIZE];
   ReadPhysicalPage(bitmap_id*(BITMAP_SIZE+1)+1,bitmapPage_meta);
   auto* bitmapPage = reinterpret_cast<BitmapPage<PAGE_SIZE>*>(bitmapPage_meta);
+  bool is_free = bitmapPage->IsPageFree(inner_index);
   delete[] bitmapPage_meta;
-  return bitmapPage->IsPageFree(inner_index);
+  return is_free;
 }
 
 /**
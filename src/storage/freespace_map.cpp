@@ -171,4 +171,96 @@ page_id_t FreeSpaceMap::SetFreeSpace(page_id_t page_id,uint32_t free_space){
   freespace_map_page->SetFreeSpace(internal_id,free_space);
   buffer_pool_manager_->UnpinPage(freespace_map_page_id,true);
   return freespace_map_page_id;
-}
\ No newline at end of file
+}
+
+page_id_t FreeSpaceMap::Claim(uint32_t need_space) {
+  page_id_t map_page_id = first_page_id;
+  while(map_page_id != INVALID_PAGE_ID){
+    Page* page = buffer_pool_manager_->FetchPage(map_page_id);
+    if(page == nullptr){
+      LOG(ERROR)<<"out of memory"<<std::endl;
+      return INVALID_PAGE_ID;
+    }
+    auto freespace_map_page = reinterpret_cast<FreeSpaceMapPage*>(page);
+    auto pair_count = freespace_map_page->GetPairCount();
+    for(uint32_t i = 0;i<pair_count;i++){
+      page_id_t space_page_id = freespace_map_page->GetSpacePageId(i);
+      if(freespace_map_page->GetFreeSpace(i)>=need_space && claimed_pages_.count(space_page_id) == 0){
+        buffer_pool_manager_->UnpinPage(map_page_id,false);
+        claimed_pages_.insert(space_page_id);
+        return space_page_id;
+      }
+    }
+    page_id_t next_page_id = freespace_map_page->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(map_page_id,false);
+    map_page_id = next_page_id;
+  }
+  return INVALID_PAGE_ID;
+}
+
+bool FreeSpaceMap::RemovePair(page_id_t page_id){
+  // find the pair of page_id and the last pair of the map
+  page_id_t target_map_page_id = INVALID_PAGE_ID;
+  freespace_map_id_t target_index = 0;
+  page_id_t last_map_page_id = INVALID_PAGE_ID;
+  page_id_t map_page_id = first_page_id;
+  while(map_page_id != INVALID_PAGE_ID){
+    auto freespace_map_page = reinterpret_cast<FreeSpaceMapPage*>(buffer_pool_manager_->FetchPage(map_page_id));
+    if(freespace_map_page == nullptr){
+      LOG(ERROR)<<"out of memory"<<std::endl;
+      return false;
+    }
+    auto pair_count = freespace_map_page->GetPairCount();
+    for(uint32_t i = 0;i<pair_count && target_map_page_id == INVALID_PAGE_ID;i++){
+      if(freespace_map_page->GetSpacePageId(i) == page_id){
+        target_map_page_id = map_page_id;
+        target_index = i;
+      }
+    }
+    if(pair_count > 0) last_map_page_id = map_page_id;
+    page_id_t next_page_id = freespace_map_page->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(map_page_id,false);
+    map_page_id = next_page_id;
+  }
+  if(target_map_page_id == INVALID_PAGE_ID) return false;
+  auto last_map_page = reinterpret_cast<FreeSpaceMapPage*>(buffer_pool_manager_->FetchPage(last_map_page_id));
+  auto target_map_page = reinterpret_cast<FreeSpaceMapPage*>(buffer_pool_manager_->FetchPage(target_map_page_id));
+  auto last_index = last_map_page->GetPairCount() - 1;
+  target_map_page->SetSpacePageId(target_index, last_map_page->GetSpacePageId(last_index));
+  target_map_page->SetFreeSpace(target_index, last_map_page->GetFreeSpace(last_index));
+  last_map_page->SetPairCount(last_index);
+  buffer_pool_manager_->UnpinPage(target_map_page_id,true);
+  buffer_pool_manager_->UnpinPage(last_map_page_id,true);
+  claimed_pages_.erase(page_id);
+  if(last_page_id == page_id) last_page_id = INVALID_PAGE_ID;
+  return true;
+}
+void FreeSpaceMap::GetMapPageIds(std::vector<page_id_t> *map_page_ids){
+  page_id_t map_page_id = first_page_id;
+  while(map_page_id != INVALID_PAGE_ID){
+    auto freespace_map_page = reinterpret_cast<FreeSpaceMapPage*>(buffer_pool_manager_->FetchPage(map_page_id));
+    if(freespace_map_page == nullptr){
+      LOG(ERROR)<<"out of memory"<<std::endl;
+      return;
+    }
+    map_page_ids->push_back(map_page_id);
+    page_id_t next_page_id = freespace_map_page->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(map_page_id,false);
+    map_page_id = next_page_id;
+  }
+}
+
+void FreeSpaceMap::Reset(std::vector<page_id_t> *freed_page_ids){
+  std::vector<page_id_t> map_page_ids;
+  GetMapPageIds(&map_page_ids);
+  if(!map_page_ids.empty()) freed_page_ids->insert(freed_page_ids->end(), map_page_ids.begin() + 1, map_page_ids.end());
+  auto freespace_map_page = reinterpret_cast<FreeSpaceMapPage*>(buffer_pool_manager_->FetchPage(first_page_id));
+  if(freespace_map_page == nullptr){
+    LOG(ERROR)<<"out of memory"<<std::endl;
+    return;
+  }
+  freespace_map_page->Init(first_page_id, nullptr, nullptr);
+  buffer_pool_manager_->UnpinPage(first_page_id,true);
+  claimed_pages_.clear();
+  last_page_id = INVALID_PAGE_ID;
+}
@@ -0,0 +1,153 @@
+#include "storage/heap_directory.h"
+
+#include <algorithm>
+
+#include "glog/logging.h"
+
+HeapDirectory::HeapDirectory(page_id_t first_page_id, BufferPoolManager *buffer_pool_manager)
+    : buffer_pool_manager_(buffer_pool_manager) {
+  if (first_page_id == INVALID_PAGE_ID) {
+    auto dir_page = reinterpret_cast<HeapDirectoryPage *>(buffer_pool_manager_->NewPage(first_page_id));
+    ASSERT(dir_page != nullptr, "Failed to allocate heap directory page.");
+    dir_page->Init(first_page_id, nullptr, nullptr);
+    buffer_pool_manager_->UnpinPage(first_page_id, true);
+    dir_page_ids_.push_back(first_page_id);
+    return;
+  }
+  // 加载已有目录，记下每个目录页
+  page_id_t dir_page_id = first_page_id;
+  while (dir_page_id != INVALID_PAGE_ID) {
+    auto dir_page = reinterpret_cast<HeapDirectoryPage *>(buffer_pool_manager_->FetchPage(dir_page_id));
+    ASSERT(dir_page != nullptr, "Failed to fetch heap directory page.");
+    dir_page_ids_.push_back(dir_page_id);
+    page_count_ += dir_page->GetEntryCount();
+    page_id_t next_page_id = dir_page->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(dir_page_id, false);
+    dir_page_id = next_page_id;
+  }
+}
+
+bool HeapDirectory::Append(page_id_t page_id) {
+  page_id_t last_dir_page_id = dir_page_ids_.back();
+  auto dir_page = reinterpret_cast<HeapDirectoryPage *>(buffer_pool_manager_->FetchPage(last_dir_page_id));
+  if (dir_page == nullptr) {
+    LOG(ERROR) << "out of memory" << std::endl;
+    return false;
+  }
+  if (!dir_page->Append(page_id)) {
+    // 最后一个目录页已满，链接一个新的目录页
+    page_id_t new_dir_page_id;
+    auto new_dir_page = reinterpret_cast<HeapDirectoryPage *>(buffer_pool_manager_->NewPage(new_dir_page_id));
+    if (new_dir_page == nullptr) {
+      buffer_pool_manager_->UnpinPage(last_dir_page_id, false);
+      LOG(ERROR) << "out of memory" << std::endl;
+      return false;
+    }
+    new_dir_page->Init(new_dir_page_id, nullptr, nullptr);
+    new_dir_page->Append(page_id);
+    dir_page->SetNextPageId(new_dir_page_id);
+    buffer_pool_manager_->UnpinPage(new_dir_page_id, true);
+    dir_page_ids_.push_back(new_dir_page_id);
+  }
+  buffer_pool_manager_->UnpinPage(last_dir_page_id, true);
+  page_count_++;
+  return true;
+}
+
+bool HeapDirectory::RemovePages(const std::unordered_set<page_id_t> &page_ids) {
+  if (page_ids.empty()) {
+    return true;
+  }
+  // 一趟压缩：读指针跳过被删除的页，写指针紧跟其后，保持剩余页的顺序
+  uint32_t write_index = 0;
+  HeapDirectoryPage *write_page = nullptr;
+  size_t write_dir = 0;
+  for (size_t read_dir = 0; read_dir < dir_page_ids_.size(); read_dir++) {
+    auto read_page = reinterpret_cast<HeapDirectoryPage *>(buffer_pool_manager_->FetchPage(dir_page_ids_[read_dir]));
+    if (read_page == nullptr) {
+      LOG(ERROR) << "out of memory" << std::endl;
+      return false;
+    }
+    for (uint32_t i = 0; i < read_page->GetEntryCount(); i++) {
+      page_id_t page_id = read_page->GetEntry(i);
+      if (page_ids.count(page_id) != 0) {
+        continue;
+      }
+      if (write_index / HeapDirectoryPage::SIZE_MAX_ENTRY != write_dir || write_page == nullptr) {
+        if (write_page != nullptr) {
+          write_page->SetEntryCount(HeapDirectoryPage::SIZE_MAX_ENTRY);
+          buffer_pool_manager_->UnpinPage(dir_page_ids_[write_dir], true);
+        }
+        write_dir = write_index / HeapDirectoryPage::SIZE_MAX_ENTRY;
+        write_page = reinterpret_cast<HeapDirectoryPage *>(buffer_pool_manager_->FetchPage(dir_page_ids_[write_dir]));
+      }
+      write_page->SetEntry(write_index % HeapDirectoryPage::SIZE_MAX_ENTRY, page_id);
+      write_index++;
+    }
+    buffer_pool_manager_->UnpinPage(dir_page_ids_[read_dir], false);
+  }
+  if (write_page != nullptr) {
+    buffer_pool_manager_->UnpinPage(dir_page_ids_[write_dir], true);
+  }
+  page_count_ = write_index;
+  // 修正最后一个目录页的计数，释放多余的目录页
+  size_t keep_dirs = page_count_ == 0 ? 1 : (page_count_ - 1) / HeapDirectoryPage::SIZE_MAX_ENTRY + 1;
+  auto last_page = reinterpret_cast<HeapDirectoryPage *>(buffer_pool_manager_->FetchPage(dir_page_ids_[keep_dirs - 1]));
+  if (last_page == nullptr) {
+    LOG(ERROR) << "out of memory" << std::endl;
+    return false;
+  }
+  last_page->SetEntryCount(page_count_ - (keep_dirs - 1) * HeapDirectoryPage::SIZE_MAX_ENTRY);
+  last_page->SetNextPageId(INVALID_PAGE_ID);
+  buffer_pool_manager_->UnpinPage(dir_page_ids_[keep_dirs - 1], true);
+  while (dir_page_ids_.size() > keep_dirs) {
+    buffer_pool_manager_->DeletePage(dir_page_ids_.back());
+    dir_page_ids_.pop_back();
+  }
+  return true;
+}
+
+page_id_t HeapDirectory::GetPageId(uint32_t index) {
+  if (index >= page_count_) {
+    return INVALID_PAGE_ID;
+  }
+  page_id_t dir_page_id = dir_page_ids_[index / HeapDirectoryPage::SIZE_MAX_ENTRY];
+  auto dir_page = reinterpret_cast<HeapDirectoryPage *>(buffer_pool_manager_->FetchPage(dir_page_id));
+  if (dir_page == nullptr) {
+    LOG(ERROR) << "out of memory" << std::endl;
+    return INVALID_PAGE_ID;
+  }
+  page_id_t page_id = dir_page->GetEntry(index % HeapDirectoryPage::SIZE_MAX_ENTRY);
+  buffer_pool_manager_->UnpinPage(dir_page_id, false);
+  return page_id;
+}
+
+void HeapDirectory::GetPageIds(uint32_t begin, uint32_t end, std::vector<page_id_t> *page_ids) {
+  if (end > page_count_) {
+    end = page_count_;
+  }
+  // 每个目录页只fetch一次
+  while (begin < end) {
+    size_t dir = begin / HeapDirectoryPage::SIZE_MAX_ENTRY;
+    auto dir_page = reinterpret_cast<HeapDirectoryPage *>(buffer_pool_manager_->FetchPage(dir_page_ids_[dir]));
+    if (dir_page == nullptr) {
+      LOG(ERROR) << "out of memory" << std::endl;
+      return;
+    }
+    uint32_t dir_end = std::min<uint32_t>(end, (dir + 1) * HeapDirectoryPage::SIZE_MAX_ENTRY);
+    for (; begin < dir_end; begin++) {
+      page_ids->push_back(dir_page->GetEntry(begin % HeapDirectoryPage::SIZE_MAX_ENTRY));
+    }
+    buffer_pool_manager_->UnpinPage(dir_page_ids_[dir], false);
+  }
+}
+
+void HeapDirectory::Reset(std::vector<page_id_t> *freed_page_ids) {
+  auto dir_page = reinterpret_cast<HeapDirectoryPage *>(buffer_pool_manager_->FetchPage(dir_page_ids_.front()));
+  ASSERT(dir_page != nullptr, "Failed to fetch heap directory page.");
+  dir_page->Init(dir_page_ids_.front(), nullptr, nullptr);
+  buffer_pool_manager_->UnpinPage(dir_page_ids_.front(), true);
+  freed_page_ids->insert(freed_page_ids->end(), dir_page_ids_.begin() + 1, dir_page_ids_.end());
+  dir_page_ids_.resize(1);
+  page_count_ = 0;
+}
@@ -1,75 +1,599 @@
 #include "storage/table_heap.h"
 
+#include <memory>
+#include <unordered_set>
+
 /**
  * TODO: Student Implement
  */
 bool TableHeap::InsertTuple(Row &row, Txn *txn) {
-    // 获取row对应的TablePage最大支持大小
-    size_t max_size_row = TablePage::SIZE_MAX_ROW;
-    auto need_space = row.GetSerializedSize(schema_);
-    // 如果单行数据超过此大小，返回false
-    if (need_space > max_size_row) {
+    // 长字符串先移到溢出页，页面中存的是指向它们的副本
+    Row stored;
+    bool toasted = ToastRow(row, &stored);
+    Row &target = toasted ? stored : row;
+    // 如果单行数据放不进一个空页，返回false
+    if (!RowFits(target)) {
+        if (toasted) {
+            FreeExternalValues(stored);
+        }
         return false;
     }
+    auto need_space = target.GetSerializedSize(schema_);
 
-    // 从Table中第一逻辑页开始遍历获得free page用于填入该row
+    // 优先插入当前会话占有的数据页，页满时换一个其他会话没有占用的页
+    page_id_t page_id = GetInsertPage(need_space, txn);
+    while (page_id != INVALID_PAGE_ID) {
+        TablePage* true_page = FetchPage(page_id);
+        if (true_page == nullptr) {
+            break;
+        }
+        true_page->WLatch();
+#ifdef USE_ZONE_MAP
+        // 先扩大页面摘要再写入，扫描不会因摘要过期而跳过这一行
+        zone_map_->AddRow(page_id, row);
+#endif
+        bool inserted = true_page->InsertTuple(target, schema_, txn, lock_manager_, log_manager_);
+        uint32_t free_space = true_page->GetFreeSpace();
+        true_page->WUnlatch();
+        UnpinPage(page_id, inserted);
+        // 插入失败时也要更新，避免freespace map中过期的记录让同一页被反复选中
 #ifdef USE_FREESPACE_MAP
-    page_id_t next_page_id = freespace_map_->GetBegin(need_space);
-#else
-    page_id_t next_page_id = GetFirstPageId();
+        UpdateFreeSpace(page_id, free_space);
 #endif
-    TablePage* true_page = nullptr;
+        if (inserted) {
+            row.SetRowId(target.GetRowId());
+            return true;
+        }
+        // 当前页空间不足
+        page_id = SwitchInsertPage(page_id, need_space, txn);
+    }
+    if (toasted) {
+        FreeExternalValues(stored);
+    }
+    return false;
+}
 
-    while (true) {
-        // 无效页ID处理
-        if (next_page_id == INVALID_PAGE_ID) {
-            // 分配新页
-            TablePage* new_page = reinterpret_cast<TablePage*>(buffer_pool_manager_->NewPage(next_page_id));
-            if (new_page == nullptr) {
-                return false;
+bool TableHeap::InsertTuples(std::vector<Row> &rows, Txn *txn) {
+    // 长字符串先移到溢出页，targets[i]是实际写入页面的行
+    std::vector<Row> stored_rows(may_toast_ ? rows.size() : 0);
+    std::vector<Row *> targets;
+    targets.reserve(rows.size());
+    for (size_t i = 0; i < rows.size(); i++) {
+        targets.push_back(may_toast_ && ToastRow(rows[i], &stored_rows[i]) ? &stored_rows[i] : &rows[i]);
+    }
+    // 没有写入页面的行，它们的溢出页不会再被引用
+    auto free_stored_rows = [&](size_t from) {
+        for (size_t i = from; i < stored_rows.size(); i++) {
+            FreeExternalValues(stored_rows[i]);
+        }
+    };
+    // 先检查所有row的大小，避免插入一半后才失败
+    for (auto target : targets) {
+        if (!RowFits(*target)) {
+            free_stored_rows(0);
+            return false;
+        }
+    }
+    if (rows.empty()) {
+        return true;
+    }
+
+    // 依次填满数据页，每个页面只pin一次、只更新一次freespace map
+    size_t cur = 0;
+    page_id_t page_id = GetInsertPage(targets[cur]->GetSerializedSize(schema_), txn);
+    while (page_id != INVALID_PAGE_ID) {
+        TablePage* true_page = FetchPage(page_id);
+        if (true_page == nullptr) {
+            free_stored_rows(cur);
+            return false;
+        }
+        size_t begin = cur;
+        true_page->WLatch();
+        while (cur < rows.size()) {
+#ifdef USE_ZONE_MAP
+            zone_map_->AddRow(page_id, rows[cur]);
+#endif
+            if (!true_page->InsertTuple(*targets[cur], schema_, txn, lock_manager_, log_manager_)) {
+                break;
             }
-            // 初始化新页
-            new_page->Init(next_page_id, true_page ? true_page->GetPageId() : INVALID_PAGE_ID, log_manager_, txn);
-            new_page->InsertTuple(row, schema_, txn, lock_manager_, log_manager_);
+            rows[cur].SetRowId(targets[cur]->GetRowId());
+            cur++;
+        }
+        uint32_t free_space = true_page->GetFreeSpace();
+        true_page->WUnlatch();
+        UnpinPage(page_id, cur != begin);
 #ifdef USE_FREESPACE_MAP
-            freespace_map_->SetNewPair(next_page_id,new_page->GetFreeSpace());
+        UpdateFreeSpace(page_id, free_space);
 #endif
-            buffer_pool_manager_->UnpinPage(next_page_id, true);
+        if (cur == rows.size()) {
+            return true;
+        }
+        // 新追加的页至少能放下一行(行大小已检查)，不会死循环
+        page_id = SwitchInsertPage(page_id, targets[cur]->GetSerializedSize(schema_), txn);
+    }
+    free_stored_rows(cur);
+    return false;
+}
+
+bool TableHeap::ToastRow(const Row &row, Row *stored) {
+    if (!may_toast_) {
+        return false;
+    }
+    bool toasted = false;
+    for (uint32_t i = 0; i < row.GetFieldCount(); i++) {
+        const Field *field = row.GetField(i);
+        if (field->IsNull() || field->GetTypeId() != TypeId::kTypeChar || field->GetLength() <= TOAST_THRESHOLD) {
+            continue;
+        }
+        page_id_t first_page_id = toast_store_->Store(field->GetData(), field->GetLength());
+        if (first_page_id == INVALID_PAGE_ID) {
+            // 溢出页分配失败时保留原值，由行大小检查决定能否插入
+            continue;
+        }
+        if (!toasted) {
+            *stored = row;
+            toasted = true;
+        }
+        char pointer[Row::SIZE_EXTERNAL_POINTER];
+        MACH_WRITE_TO(page_id_t, pointer, first_page_id);
+        MACH_WRITE_UINT32(pointer + sizeof(page_id_t), field->GetLength());
+        stored->GetFields()[i] = Field(TypeId::kTypeChar, pointer, Row::SIZE_EXTERNAL_POINTER, true);
+        stored->SetExternal(i, true);
+    }
+    return toasted;
+}
+
+void TableHeap::DetoastRow(Row *row) const {
+    for (uint32_t i = 0; i < row->GetFieldCount(); i++) {
+        if (!row->IsExternal(i)) {
+            continue;
+        }
+        const char *pointer = row->GetField(i)->GetData();
+        page_id_t first_page_id = MACH_READ_FROM(page_id_t, pointer);
+        uint32_t len = MACH_READ_UINT32(pointer + sizeof(page_id_t));
+        std::unique_ptr<char[]> value(new char[len]);
+        if (!toast_store_->Fetch(first_page_id, len, value.get())) {
+            LOG(ERROR) << "Failed to read external value from page " << first_page_id << std::endl;
+            memset(value.get(), 0, len);
+        }
+        row->GetFields()[i] = Field(TypeId::kTypeChar, value.get(), len, true);
+        row->SetExternal(i, false);
+    }
+}
+
+void TableHeap::FreeExternalValues(const Row &row) {
+    for (uint32_t i = 0; i < row.GetFieldCount(); i++) {
+        if (row.IsExternal(i)) {
+            toast_store_->Free(MACH_READ_FROM(page_id_t, row.GetField(i)->GetData()));
+        }
+    }
+}
+
+void TableHeap::BuildZoneMap() {
+    std::lock_guard<std::mutex> guard(zone_map_latch_);
+    if (zone_map_built_) {
+        return;
+    }
+    std::vector<page_id_t> page_ids;
+    GetPageIds(0, GetPageCount(), &page_ids);
+    std::vector<RowView> views;
+    Arena arena;
+    Row row;
+    for (auto page_id : page_ids) {
+        TablePage *page = FetchPage(page_id);
+        if (page == nullptr) {
+            LOG(ERROR) << "out of memory" << std::endl;
+            return;
+        }
+        // 持有读锁，插入要等摘要建好后再扩大它，不会漏掉行
+        page->RLatch();
+        zone_map_->AddPage(page_id);
+        page->GetTupleViews(schema_, &views, 0, toast_store_);
+        for (auto &view : views) {
+            view.ToRow(&row, &arena);
+            zone_map_->AddRow(page_id, row);
+        }
+        page->RUnlatch();
+        UnpinPage(page_id, false);
+        arena.Rewind();
+    }
+    zone_map_built_ = true;
+}
 
-            // 更新原数据页的next_page_id并unpin写回
-            if (true_page) {
-                true_page->SetNextPageId(next_page_id);
-                buffer_pool_manager_->UnpinPage(true_page->GetPageId(), true);
+void TableHeap::RebuildHeapDirectory() {
+    page_id_t page_id = first_page_id_;
+    while (page_id != INVALID_PAGE_ID) {
+        TablePage *page = FetchPage(page_id);
+        if (page == nullptr) {
+            LOG(ERROR) << "Failed to fetch page " << page_id << " while rebuilding the heap directory" << std::endl;
+            return;
+        }
+        heap_directory_->Append(page_id);
+        page_id_t next_page_id = page->GetNextPageId();
+        UnpinPage(page_id, false);
+        page_id = next_page_id;
+    }
+}
+
+void TableHeap::CollectExternalPages(const std::vector<page_id_t> &page_ids, std::vector<page_id_t> *external_page_ids) {
+    if (!may_toast_) {
+        return;
+    }
+    for (auto page_id : page_ids) {
+        TablePage *page = FetchPage(page_id);
+        if (page == nullptr) {
+            continue;
+        }
+        // 包括已标记删除的元组，它们的溢出页还没有释放
+        for (uint32_t slot = 0; slot < page->GetTupleCount(); slot++) {
+            Row row(RowId(page_id, slot));
+            if (!page->GetTupleIgnoreMark(&row, schema_)) {
+                continue;
+            }
+            for (uint32_t i = 0; i < row.GetFieldCount(); i++) {
+                if (row.IsExternal(i)) {
+                    toast_store_->GetPageIds(MACH_READ_FROM(page_id_t, row.GetField(i)->GetData()), external_page_ids);
+                }
             }
-            return true;
         }
+        UnpinPage(page_id, false);
+    }
+}
+
+void TableHeap::ReleaseInsertPage() {
+    std::lock_guard<std::mutex> guard(latch_);
+    auto iter = insert_pages_.find(std::this_thread::get_id());
+    if (iter == insert_pages_.end()) {
+        return;
+    }
+#ifdef USE_FREESPACE_MAP
+    freespace_map_->Release(iter->second);
+#endif
+    insert_pages_.erase(iter);
+}
+
+page_id_t TableHeap::GetInsertPage(uint32_t need_space, Txn *txn) {
+    std::lock_guard<std::mutex> guard(latch_);
+    auto iter = insert_pages_.find(std::this_thread::get_id());
+    if (iter != insert_pages_.end()) {
+        return iter->second;
+    }
+    return ClaimInsertPage(need_space, txn);
+}
+
+page_id_t TableHeap::SwitchInsertPage(page_id_t full_page_id, uint32_t need_space, Txn *txn) {
+    std::lock_guard<std::mutex> guard(latch_);
+#ifdef USE_FREESPACE_MAP
+    freespace_map_->Release(full_page_id);
+#endif
+    insert_pages_.erase(std::this_thread::get_id());
+    return ClaimInsertPage(need_space, txn);
+}
 
-        // 获取当前页
-        true_page = reinterpret_cast<TablePage*>(buffer_pool_manager_->FetchPage(next_page_id));
+page_id_t TableHeap::ClaimInsertPage(uint32_t need_space, Txn *txn) {
+    page_id_t page_id = INVALID_PAGE_ID;
+#ifdef USE_FREESPACE_MAP
+    page_id = freespace_map_->Claim(need_space);
+#else
+    // 沿着页链表找一个空间足够且没有被其他会话占用的页
+    std::unordered_set<page_id_t> claimed_pages;
+    for (auto &insert_page : insert_pages_) {
+        claimed_pages.insert(insert_page.second);
+    }
+    page_id_t next_page_id = first_page_id_;
+    while (next_page_id != INVALID_PAGE_ID && page_id == INVALID_PAGE_ID) {
+        TablePage* true_page = FetchPage(next_page_id);
         if (true_page == nullptr) {
-            return false;
+            return INVALID_PAGE_ID;
+        }
+        true_page->RLatch();
+        if (true_page->GetFreeSpace() >= need_space && claimed_pages.count(next_page_id) == 0) {
+            page_id = next_page_id;
         }
+        page_id_t cur_page_id = next_page_id;
+        next_page_id = true_page->GetNextPageId();
+        true_page->RUnlatch();
+        UnpinPage(cur_page_id, false);
+    }
+#endif
+    if (page_id == INVALID_PAGE_ID) {
+        page_id = AppendPage(txn);
+        if (page_id == INVALID_PAGE_ID) {
+            return INVALID_PAGE_ID;
+        }
+#ifdef USE_FREESPACE_MAP
+        freespace_map_->ClaimPage(page_id);
+#endif
+    }
+    insert_pages_[std::this_thread::get_id()] = page_id;
+    return page_id;
+}
 
-        // 尝试在当前页插入row
-        if (true_page->InsertTuple(row, schema_, txn, lock_manager_, log_manager_)) {
+page_id_t TableHeap::AppendPage(Txn *txn) {
+    page_id_t last_page_id = GetLastPageId();
+    page_id_t new_page_id;
+    TablePage* new_page = reinterpret_cast<TablePage*>(buffer_pool_manager_->NewPage(new_page_id));
+    if (new_page == nullptr) {
+        return INVALID_PAGE_ID;
+    }
+    InitPage(new_page, new_page_id, last_page_id, txn);
+    // 链接到原来的最后一页之后
+    TablePage* last_page = FetchPage(last_page_id);
+    if (last_page != nullptr) {
+        last_page->WLatch();
+        last_page->SetNextPageId(new_page_id);
+        last_page->WUnlatch();
+        UnpinPage(last_page_id, true);
+    }
 #ifdef USE_FREESPACE_MAP
-          freespace_map_->SetFreeSpace(next_page_id,true_page->GetFreeSpace());
+    freespace_map_->SetNewPair(new_page_id, new_page->GetFreeSpace());
 #endif
-            buffer_pool_manager_->UnpinPage(next_page_id, true);
-            return true;
+    heap_directory_->Append(new_page_id);
+#ifdef USE_ZONE_MAP
+    zone_map_->AddPage(new_page_id);
+#endif
+    UnpinPage(new_page_id, true);
+    last_page_id_ = new_page_id;
+    return new_page_id;
+}
+
+page_id_t TableHeap::GetLastPageId() {
+    if (last_page_id_ != INVALID_PAGE_ID) {
+        return last_page_id_;
+    }
+    // 从磁盘加载的表没有记录最后一页，沿着页链表找到它
+    page_id_t page_id = first_page_id_;
+    while (true) {
+        TablePage* page = FetchPage(page_id);
+        if (page == nullptr) {
+            return INVALID_PAGE_ID;
+        }
+        page_id_t next_page_id = page->GetNextPageId();
+        UnpinPage(page_id, false);
+        if (next_page_id == INVALID_PAGE_ID) {
+            last_page_id_ = page_id;
+            return page_id;
+        }
+        page_id = next_page_id;
+    }
+}
+
+void TableHeap::UpdateFreeSpace(page_id_t page_id, uint32_t free_space) {
+    std::lock_guard<std::mutex> guard(latch_);
+    freespace_map_->SetFreeSpace(page_id, free_space);
+}
+
+uint32_t TableHeap::Vacuum(bool merge_pages, std::vector<std::pair<RowId, RowId>> *moved_rows, Txn *txn) {
+    std::lock_guard<std::mutex> guard(latch_);
+    std::unordered_set<page_id_t> claimed_pages;
+    for (auto &insert_page : insert_pages_) {
+        claimed_pages.insert(insert_page.second);
+    }
+    // 索引改为指向迁移后的位置，转发记录随之删除；folded_rows记录这些行在moved_rows中的下标
+    std::unordered_map<int64_t, size_t> folded_rows;
+    if (moved_rows != nullptr) {
+        FoldForwards(moved_rows, &folded_rows, txn);
+    }
+    uint32_t freed_pages = 0;
+    std::unordered_set<page_id_t> freed_page_ids;
+    page_id_t prev_page_id = first_page_id_;
+    TablePage* prev_page = FetchPage(prev_page_id);
+    if (prev_page == nullptr) {
+        return 0;
+    }
+    prev_page->WLatch();
+    bool prev_dirty = false;
+    page_id_t cur_page_id = prev_page->GetNextPageId();
+    while (cur_page_id != INVALID_PAGE_ID) {
+        TablePage* cur_page = FetchPage(cur_page_id);
+        if (cur_page == nullptr) {
+            break;
+        }
+        cur_page->WLatch();
+        bool cur_claimed = claimed_pages.count(cur_page_id) != 0;
+        // 统计当前页中存活元组占用的空间，未提交的删除标记不能被移动
+        // 转发记录和迁移来的元组也不能移动，否则两者互相找不到
+        uint32_t live_space = 0;
+        bool has_marked_tuple = false;
+        for (uint32_t i = 0; i < cur_page->GetTupleCount(); i++) {
+            uint32_t tuple_size = cur_page->GetTupleSize(i);
+            if (tuple_size == 0) {
+                continue;
+            }
+            RowId linked_rid;
+            if (TablePage::IsDeleted(tuple_size) || cur_page->GetForward(i, &linked_rid) ||
+                cur_page->GetHomeRowId(i, &linked_rid)) {
+                has_marked_tuple = true;
+            } else {
+                live_space += tuple_size + sizeof(uint32_t) * 2;
+            }
+        }
+        // 所有元组都能放进前一页时，把它们移过去
+        if (merge_pages && !cur_claimed && claimed_pages.count(prev_page_id) == 0 && !has_marked_tuple &&
+            live_space > 0 && live_space <= prev_page->GetFreeSpace()) {
+            for (uint32_t i = 0; i < cur_page->GetTupleCount(); i++) {
+                if (TablePage::IsDeleted(cur_page->GetTupleSize(i))) {
+                    continue;
+                }
+                RowId old_rid(cur_page_id, i);
+                Row row(old_rid);
+                cur_page->GetTuple(&row, schema_, txn, lock_manager_);
+#ifdef USE_ZONE_MAP
+                zone_map_->AddRow(prev_page_id, row);
+#endif
+                if (!prev_page->InsertTuple(row, schema_, txn, lock_manager_, log_manager_)) {
+                    break;
+                }
+                cur_page->MarkDelete(old_rid, txn, lock_manager_, log_manager_);
+                cur_page->ApplyDelete(old_rid, txn, log_manager_);
+                if (moved_rows != nullptr) {
+                    auto folded_row = folded_rows.find(old_rid.Get());
+                    if (folded_row != folded_rows.end()) {
+                        (*moved_rows)[folded_row->second].second = row.GetRowId();
+                    } else {
+                        moved_rows->emplace_back(old_rid, row.GetRowId());
+                    }
+                }
+                prev_dirty = true;
+            }
+        }
+        page_id_t next_page_id = cur_page->GetNextPageId();
+        if (!cur_claimed && cur_page->GetTupleCount() == 0) {
+            // 空页从链表中摘除并释放
+            prev_page->SetNextPageId(next_page_id);
+            prev_dirty = true;
+            if (next_page_id != INVALID_PAGE_ID) {
+                TablePage* next_page = FetchPage(next_page_id);
+                if (next_page != nullptr) {
+                    next_page->WLatch();
+                    next_page->SetPrevPageId(prev_page_id);
+                    next_page->WUnlatch();
+                    UnpinPage(next_page_id, true);
+                }
+            }
+            cur_page->WUnlatch();
+            UnpinPage(cur_page_id, false);
+#ifdef USE_FREESPACE_MAP
+            freespace_map_->RemovePair(cur_page_id);
+#endif
+#ifdef USE_ZONE_MAP
+            zone_map_->RemovePage(cur_page_id);
+#endif
+            if (!buffer_pool_manager_->DeletePage(cur_page_id)) {
+                LOG(WARNING) << "Page " << cur_page_id << " is still pinned and cannot be deleted" << std::endl;
+            }
+            if (last_page_id_ == cur_page_id) {
+                last_page_id_ = prev_page_id;
+            }
+            freed_pages++;
+            freed_page_ids.insert(cur_page_id);
+            cur_page_id = next_page_id;
+            continue;
+        }
+        // 前一页处理完毕，向后移动
+#ifdef USE_FREESPACE_MAP
+        if (prev_dirty) {
+            freespace_map_->SetFreeSpace(prev_page_id, prev_page->GetFreeSpace());
         }
+#endif
+        prev_page->WUnlatch();
+        UnpinPage(prev_page_id, prev_dirty);
+        prev_page = cur_page;
+        prev_page_id = cur_page_id;
+        prev_dirty = false;
+        cur_page_id = next_page_id;
+    }
+#ifdef USE_FREESPACE_MAP
+    if (prev_dirty) {
+        freespace_map_->SetFreeSpace(prev_page_id, prev_page->GetFreeSpace());
+    }
+#endif
+    prev_page->WUnlatch();
+    UnpinPage(prev_page_id, prev_dirty);
+    heap_directory_->RemovePages(freed_page_ids);
+    return freed_pages;
+}
 
-        // 当前页空间不足，移动到下一页
-        buffer_pool_manager_->UnpinPage(next_page_id, false);
+void TableHeap::FoldForwards(std::vector<std::pair<RowId, RowId>> *moved_rows,
+                             std::unordered_map<int64_t, size_t> *folded_rows, Txn *txn) {
+    std::vector<page_id_t> page_ids;
+    heap_directory_->GetPageIds(0, heap_directory_->GetPageCount(), &page_ids);
+    for (auto page_id : page_ids) {
+        TablePage* page = FetchPage(page_id);
+        if (page == nullptr) {
+            continue;
+        }
+        page->WLatch();
+        bool dirty = false;
+        for (uint32_t slot = 0; slot < page->GetTupleCount(); slot++) {
+            RowId home_rid;
+            if (TablePage::IsDeleted(page->GetTupleSize(slot)) || !page->GetHomeRowId(slot, &home_rid)) {
+                continue;
+            }
+            // 元组可能迁移回了原来的页
+            RowId rid(page_id, slot);
+            TablePage* home_page = home_rid.GetPageId() == page_id ? page : FetchPage(home_rid.GetPageId());
+            if (home_page == nullptr) {
+                continue;
+            }
+            if (home_page != page) {
+                home_page->WLatch();
+            }
+            // 未提交的删除还要通过转发记录找到元组，这样的行保留
+            RowId target;
+            bool folded = home_page->GetForward(home_rid.GetSlotNum(), &target) && target == rid &&
+                          !TablePage::IsDeleted(home_page->GetTupleSize(home_rid.GetSlotNum()));
+            if (folded) {
+                home_page->ApplyDelete(home_rid, txn, log_manager_);
+                page->ClearHomeRowId(slot);
+                folded_rows->emplace(rid.Get(), moved_rows->size());
+                moved_rows->emplace_back(home_rid, rid);
+                dirty = true;
+            }
+            if (home_page != page) {
 #ifdef USE_FREESPACE_MAP
-        next_page_id = freespace_map_->GetNext(need_space);
-#else
-        next_page_id = true_page->GetNextPageId();
+                if (folded) {
+                    freespace_map_->SetFreeSpace(home_rid.GetPageId(), home_page->GetFreeSpace());
+                }
 #endif
+                home_page->WUnlatch();
+                UnpinPage(home_rid.GetPageId(), folded);
+            }
+        }
+#ifdef USE_FREESPACE_MAP
+        if (dirty) {
+            freespace_map_->SetFreeSpace(page_id, page->GetFreeSpace());
+        }
+#endif
+        page->WUnlatch();
+        UnpinPage(page_id, dirty);
     }
 }
 
+uint32_t TableHeap::GetPageCount() {
+    std::lock_guard<std::mutex> guard(latch_);
+    return heap_directory_->GetPageCount();
+}
+
+page_id_t TableHeap::GetPageId(uint32_t index) {
+    std::lock_guard<std::mutex> guard(latch_);
+    return heap_directory_->GetPageId(index);
+}
 
+void TableHeap::GetPageIds(uint32_t begin, uint32_t end, std::vector<page_id_t> *page_ids) {
+    std::lock_guard<std::mutex> guard(latch_);
+    heap_directory_->GetPageIds(begin, end, page_ids);
+}
+
+uint32_t TableHeap::EstimateTupleCount(uint32_t sample_pages) {
+    uint32_t page_count = GetPageCount();
+    if (page_count == 0 || sample_pages == 0) {
+        return 0;
+    }
+    if (sample_pages > page_count) {
+        sample_pages = page_count;
+    }
+    // 均匀抽取若干页，统计其中存活的元组数后按页数放大
+    uint64_t live_tuples = 0;
+    for (uint32_t i = 0; i < sample_pages; i++) {
+        page_id_t page_id = GetPageId(static_cast<uint64_t>(i) * page_count / sample_pages);
+        TablePage* page = FetchPage(page_id);
+        if (page == nullptr) {
+            return 0;
+        }
+        page->RLatch();
+        for (uint32_t slot = 0; slot < page->GetTupleCount(); slot++) {
+            uint32_t tuple_size = page->GetTupleSize(slot);
+            RowId target;
+            if (!TablePage::IsDeleted(tuple_size) && !page->GetForward(slot, &target)) {
+                live_tuples++;
+            }
+        }
+        page->RUnlatch();
+        UnpinPage(page_id, false);
+    }
+    return static_cast<uint32_t>(live_tuples * page_count / sample_pages);
+}
 
 bool TableHeap::MarkDelete(const RowId &rid, Txn *txn) {
     // Find the page which contains the tuple.
@@ -79,20 +603,29 @@ bool TableHeap::MarkDelete(const RowId &rid, Txn *txn) {
         return false;
     }
     // Otherwise, mark the tuple as deleted.
+    RowId target;
     page->WLatch();
     page->MarkDelete(rid, txn, lock_manager_, log_manager_);
+    bool forwarded = page->GetForward(rid.GetSlotNum(), &target);
     page->WUnlatch();
 #ifdef USE_FREESPACE_MAP
-    freespace_map_->SetFreeSpace(page->GetPageId(),page->GetFreeSpace());
+    UpdateFreeSpace(page->GetPageId(),page->GetFreeSpace());
 #endif
     buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
+    // 迁移走的元组和它的转发记录一起标记
+    if (forwarded) {
+        return MarkDelete(target, txn);
+    }
     return true;
 }
 
 /**
  * TODO: Student Implement
  */
-bool TableHeap::UpdateTuple(Row &row, const RowId &rid, Txn *txn) {
+bool TableHeap::UpdateTuple(Row &row, const RowId &rid, Txn *txn, bool *relocated) {
+    if (relocated != nullptr) {
+        *relocated = false;
+    }
     // 检查rid是否非法
     if (rid == INVALID_ROWID) {
         return false;
@@ -103,40 +636,116 @@ bool TableHeap::UpdateTuple(Row &row, const RowId &rid, Txn *txn) {
     if (true_page == nullptr) {
         return false;
     }
+    // 元组已迁移时在它当前所在的页更新，rid保持不变
+    RowId cur_rid = rid;
+    true_page->RLatch();
+    bool forwarded = true_page->GetForward(rid.GetSlotNum(), &cur_rid);
+    true_page->RUnlatch();
+    if (forwarded) {
+        buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+        true_page = FetchPage(cur_rid.GetPageId());
+        if (true_page == nullptr) {
+            return false;
+        }
+    }
 
-    // 通过rowid唯一标识建立row对象
-    Row ori_row = Row(rid);
-
-    // 获取原始元组
-    bool get_tuple_result = GetTuple(&ori_row, txn);
+    // 通过rowid唯一标识建立row对象，获取原始元组
+    Row ori_row = Row(cur_rid);
+    true_page->RLatch();
+    bool get_tuple_result = true_page->GetTuple(&ori_row, schema_, txn, lock_manager_);
+    true_page->RUnlatch();
     if (!get_tuple_result) {
-        buffer_pool_manager_->UnpinPage(true_page->GetTablePageId(), false);
+        buffer_pool_manager_->UnpinPage(cur_rid.GetPageId(), false);
         return false;
     }
 
-    // 更新数据页中的元组
+    // 更新数据页中的元组，新的长字符串先移到溢出页
+    Row stored;
+    bool toasted = ToastRow(row, &stored);
+    Row &target = toasted ? stored : row;
     true_page->WLatch();
-    int update_tuple_result = true_page->UpdateTuple(row, &ori_row, schema_, txn, lock_manager_, log_manager_);
+#ifdef USE_ZONE_MAP
+    zone_map_->AddRow(cur_rid.GetPageId(), row);
+#endif
+    bool update_tuple_result = true_page->UpdateTuple(target, &ori_row, schema_, txn, lock_manager_, log_manager_);
+    bool row_page = !true_page->IsPaxPage();
     true_page->WUnlatch();
-
-    // 根据更新结果进行处理
 #ifdef USE_FREESPACE_MAP
-    freespace_map_->SetFreeSpace(true_page->GetPageId(), true_page->GetFreeSpace());
+    UpdateFreeSpace(cur_rid.GetPageId(), true_page->GetFreeSpace());
 #endif
-    buffer_pool_manager_->UnpinPage(true_page->GetTablePageId(), update_tuple_result == 0);
+    buffer_pool_manager_->UnpinPage(cur_rid.GetPageId(), update_tuple_result);
+    // 元组存在时更新失败说明页内空间不足，把它迁移到有空间的页
+    if (!update_tuple_result && row_page) {
+        update_tuple_result = RelocateTuple(target, row, rid, cur_rid, txn);
+        if (relocated != nullptr) {
+            *relocated = update_tuple_result;
+        }
+    }
+    // 更新成功时ori_row是页面中的旧元组，它的溢出页不再被引用；否则新值的溢出页作废
+    if (update_tuple_result) {
+        FreeExternalValues(ori_row);
+    } else if (toasted) {
+        FreeExternalValues(stored);
+    }
+    return update_tuple_result;
+}
 
-    switch (update_tuple_result) {
-        case 0: // 更新成功
-            return true;
-        case -1: // 元组已被删除或slot_num越界
-        case 1:  // 其他错误
-            return false;
-        case 2: // 因为位置不足而更新失败
-            // 可以添加特殊处理逻辑
-            return false;
-        default: // 处理其他未预见的返回值
+bool TableHeap::RelocateTuple(Row &stored, const Row &row, const RowId &home_rid, const RowId &cur_rid, Txn *txn) {
+    auto need_space = stored.GetSerializedSize(schema_) + TablePage::SIZE_RELOCATED_HEADER;
+    if (need_space > TablePage::SIZE_MAX_ROW) {
+        return false;
+    }
+    // 和插入一样在当前会话占有的页中找空间
+    bool inserted = false;
+    page_id_t page_id = GetInsertPage(need_space, txn);
+    while (page_id != INVALID_PAGE_ID && !inserted) {
+        TablePage* new_page = FetchPage(page_id);
+        if (new_page == nullptr) {
             return false;
+        }
+        new_page->WLatch();
+#ifdef USE_ZONE_MAP
+        zone_map_->AddRow(page_id, row);
+#endif
+        inserted = new_page->InsertRelocatedTuple(stored, home_rid, schema_);
+        uint32_t free_space = new_page->GetFreeSpace();
+        new_page->WUnlatch();
+        UnpinPage(page_id, inserted);
+#ifdef USE_FREESPACE_MAP
+        UpdateFreeSpace(page_id, free_space);
+#endif
+        if (!inserted) {
+            page_id = SwitchInsertPage(page_id, need_space, txn);
+        }
     }
+    if (!inserted) {
+        return false;
+    }
+    // 原位置留下指向新元组的转发记录，已迁移过的元组只需修改转发记录并删除旧的副本
+    TablePage* home_page = FetchPage(home_rid.GetPageId());
+    if (home_page == nullptr) {
+        return false;
+    }
+    home_page->WLatch();
+    home_page->SetForward(home_rid.GetSlotNum(), stored.GetRowId());
+    home_page->WUnlatch();
+#ifdef USE_FREESPACE_MAP
+    UpdateFreeSpace(home_rid.GetPageId(), home_page->GetFreeSpace());
+#endif
+    UnpinPage(home_rid.GetPageId(), true);
+    if (!(cur_rid == home_rid)) {
+        TablePage* old_page = FetchPage(cur_rid.GetPageId());
+        if (old_page != nullptr) {
+            old_page->WLatch();
+            old_page->ApplyDelete(cur_rid, txn, log_manager_);
+            old_page->WUnlatch();
+#ifdef USE_FREESPACE_MAP
+            UpdateFreeSpace(cur_rid.GetPageId(), old_page->GetFreeSpace());
+#endif
+            UnpinPage(cur_rid.GetPageId(), true);
+        }
+    }
+    return true;
 }
 
 
@@ -148,12 +757,30 @@ void TableHeap::ApplyDelete(const RowId &rid, Txn *txn) {
     TablePage *page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
     if (page != nullptr) {
         page->WLatch(); // 获取写锁
+        // 元组指向的溢出页随它一起释放
+        Row raw_row(rid);
+        bool has_raw_row = may_toast_ && page->GetTupleIgnoreMark(&raw_row, schema_);
+        RowId target;
+        bool forwarded = page->GetForward(rid.GetSlotNum(), &target);
         page->ApplyDelete(rid, txn, log_manager_);
+#ifdef USE_ZONE_MAP
+        // 页面被删空时摘要重新开始，持有写锁避免与插入交错
+        if (page->GetTupleCount() == 0) {
+            zone_map_->ResetPage(rid.GetPageId());
+        }
+#endif
         page->WUnlatch(); // 释放写锁
 #ifdef USE_FREESPACE_MAP
-        freespace_map_->SetFreeSpace(rid.GetPageId(), page->GetFreeSpace());
+        UpdateFreeSpace(rid.GetPageId(), page->GetFreeSpace());
 #endif
         buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
+        if (has_raw_row) {
+            FreeExternalValues(raw_row);
+        }
+        // 转发记录指向的元组一起删除
+        if (forwarded) {
+            ApplyDelete(target, txn);
+        }
     }
 }
 
@@ -163,13 +790,18 @@ void TableHeap::RollbackDelete(const RowId &rid, Txn *txn) {
     auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
     assert(page != nullptr);
     // Rollback to delete.
+    RowId target;
     page->WLatch();
     page->RollbackDelete(rid, txn, log_manager_);
+    bool forwarded = page->GetForward(rid.GetSlotNum(), &target);
     page->WUnlatch();
 #ifdef USE_FREESPACE_MAP
-    freespace_map_->SetFreeSpace(rid.GetPageId(), page->GetFreeSpace());
+    UpdateFreeSpace(rid.GetPageId(), page->GetFreeSpace());
 #endif
     buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
+    if (forwarded) {
+        RollbackDelete(target, txn);
+    }
 }
 
 /**
@@ -184,50 +816,107 @@ bool TableHeap::GetTuple(Row *row, Txn *txn) {
     //true_page->RLatch();
     //读取对映数据并返回判断结果
     bool gettuple_result = true_page->GetTuple(row,schema_,txn,lock_manager_);
+    RowId target;
+    bool forwarded = !gettuple_result && true_page->GetForward(row->GetRowId().GetSlotNum(), &target);
     //true_page->RUnlatch();
     //unpin对映数据页
     buffer_pool_manager_->UnpinPage(true_page->GetTablePageId(),false);
-    if(gettuple_result)
-        //读取成功unpin后返回true
+    if (forwarded) {
+        // 元组已迁移，沿转发记录读取一次，row id保持不变
+        RowId rid = row->GetRowId();
+        true_page = FetchPage(target.GetPageId());
+        if (true_page == nullptr) {
+            return false;
+        }
+        row->SetRowId(target);
+        gettuple_result = true_page->GetTuple(row, schema_, txn, lock_manager_);
+        row->SetRowId(rid);
+        UnpinPage(target.GetPageId(), false);
+    }
+    if(gettuple_result) {
+        //读取成功unpin后读回溢出的值，返回true
+        DetoastRow(row);
         return true;
-        //其余返回false
-    else
-        return false;
+    }
+    //其余返回false
+    return false;
 }
 
-void TableHeap::DeleteTable(page_id_t page_id) {
-    if (page_id != INVALID_PAGE_ID) {
-        auto temp_table_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));  // 删除table_heap
-        if (temp_table_page->GetNextPageId() != INVALID_PAGE_ID)
-            DeleteTable(temp_table_page->GetNextPageId());
-        buffer_pool_manager_->UnpinPage(page_id, false);
-        buffer_pool_manager_->DeletePage(page_id);
-    } else {
-#ifdef USE_FREESPACE_MAP
-      delete freespace_map_;
+void TableHeap::DeleteTable() {
+    std::lock_guard<std::mutex> guard(latch_);
+    // 先收集表的所有页，再一次性释放，位图页按extent批量更新，缓冲池中的页直接作废不写回
+    std::vector<page_id_t> page_ids;
+    heap_directory_->GetPageIds(0, heap_directory_->GetPageCount(), &page_ids);
+    // 溢出页另外收集，不能边遍历 page_ids 边往里追加
+    std::vector<page_id_t> external_page_ids;
+    CollectExternalPages(page_ids, &external_page_ids);
+    page_ids.insert(page_ids.end(), external_page_ids.begin(), external_page_ids.end());
+    auto &dir_page_ids = heap_directory_->GetDirectoryPageIds();
+    page_ids.insert(page_ids.end(), dir_page_ids.begin(), dir_page_ids.end());
+    freespace_map_->GetMapPageIds(&page_ids);
+    if (!buffer_pool_manager_->DeletePages(page_ids)) {
+        LOG(WARNING) << "Some pages of the dropped table are still pinned" << std::endl;
+    }
+    insert_pages_.clear();
+}
+
+bool TableHeap::Truncate(Txn *txn) {
+    std::lock_guard<std::mutex> guard(latch_);
+    // 保留第一页，使表的元数据不变
+    std::vector<page_id_t> page_ids;
+    heap_directory_->GetPageIds(0, heap_directory_->GetPageCount(), &page_ids);
+    std::vector<page_id_t> freed_page_ids;
+    CollectExternalPages(page_ids, &freed_page_ids);
+    for (auto page_id : page_ids) {
+        if (page_id != first_page_id_) {
+            freed_page_ids.push_back(page_id);
+        }
+#ifdef USE_ZONE_MAP
+        zone_map_->RemovePage(page_id);
 #endif
-        DeleteTable(first_page_id_);
     }
+    TablePage *first_page = FetchPage(first_page_id_);
+    if (first_page == nullptr) {
+        LOG(ERROR) << "out of memory" << std::endl;
+        return false;
+    }
+    first_page->WLatch();
+    InitPage(first_page, first_page_id_, INVALID_PAGE_ID, txn);
+    uint32_t free_space = first_page->GetFreeSpace();
+    first_page->WUnlatch();
+    UnpinPage(first_page_id_, true);
+    heap_directory_->Reset(&freed_page_ids);
+    heap_directory_->Append(first_page_id_);
+    freespace_map_->Reset(&freed_page_ids);
+    freespace_map_->SetNewPair(first_page_id_, free_space);
+#ifdef USE_ZONE_MAP
+    zone_map_->AddPage(first_page_id_);
+#endif
+    insert_pages_.clear();
+    last_page_id_ = first_page_id_;
+    if (!buffer_pool_manager_->DeletePages(freed_page_ids)) {
+        LOG(WARNING) << "Some pages of the truncated table are still pinned" << std::endl;
+    }
+    return true;
 }
 
 /**
  * TODO: Student Implement
  */
 TableIterator TableHeap::Begin(Txn *txn) {
-    RowId rid;
-    TablePage *page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
-    if (page != nullptr) {
-        page->RLatch();
-        if (page->GetFirstTupleRid(&rid)) {
-            page->RUnlatch();
-            buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
-            return TableIterator(this, rid, txn);
-        }
-        page->RUnlatch();
-        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
-    }
-    return End();
+    // 迭代器从第一页开始解码，跳过空页和只有转发记录的页
+    return TableIterator(this, RowId(first_page_id_, 0), txn);
+}
+TableIterator TableHeap::Begin(Txn *txn, PageFilter page_filter) {
+#ifdef USE_ZONE_MAP
+    BuildZoneMap();
+#endif
+    return TableIterator(this, 0, txn, std::move(page_filter));
+}
+TableIterator TableHeap::Begin(Txn *txn, uint32_t begin_page, uint32_t end_page) {
+    return TableIterator(this, begin_page, txn, nullptr, end_page);
 }
+
 /**
  * TODO: Student Implement
  */
@@ -2,21 +2,60 @@
 #include "common/macros.h"
 #include "storage/table_heap.h"
 
-/**
- * TODO: Student Implement
- */
-
 TableIterator::TableIterator(TableHeap *table_heap, RowId rid, Txn *txn)
     : rid_(rid), table_heap_(table_heap), txn_(txn), page_(nullptr), row_(new Row(rid)) {
-  // 如果 RowId 有效，获取对应的 TablePage
+  // 如果 RowId 有效，获取对应的 TablePage，迭代器持有该页的一个pin
   if (rid.GetPageId() != INVALID_PAGE_ID) {
-    table_heap_->GetTuple(row_, txn_);
     page_ = table_heap_->FetchPage(rid.GetPageId());
+    if (page_ == nullptr) {
+      SetEnd();
+      return;
+    }
+    LoadPage(rid.GetSlotNum());
   }
 }
 
+TableIterator::TableIterator(TableHeap *table_heap, uint32_t page_index, Txn *txn, PageFilter page_filter,
+                             uint32_t page_end)
+    : rid_(INVALID_PAGE_ID, 0),
+      table_heap_(table_heap),
+      txn_(txn),
+      page_(nullptr),
+      row_(new Row(rid_)),
+      page_filter_(std::move(page_filter)),
+      use_directory_(true),
+      page_index_(page_index),
+      page_end_(page_end) {
+  page_id_t page_id = page_index_ < page_end_ ? table_heap_->GetPageId(page_index_) : INVALID_PAGE_ID;
+  while (page_id != INVALID_PAGE_ID && page_filter_ != nullptr && !page_filter_(page_id)) {
+    page_id = ++page_index_ < page_end_ ? table_heap_->GetPageId(page_index_) : INVALID_PAGE_ID;
+  }
+  page_ = page_id == INVALID_PAGE_ID ? nullptr : table_heap_->FetchPage(page_id);
+  if (page_ == nullptr) {
+    SetEnd();
+    return;
+  }
+  LoadPage(0);
+}
+
 TableIterator::TableIterator(const TableIterator &other)
-    : rid_(other.rid_), table_heap_(other.table_heap_), txn_(other.txn_), page_(other.page_), row_(new Row(*other.row_)) {}
+    : rid_(other.rid_),
+      table_heap_(other.table_heap_),
+      txn_(other.txn_),
+      page_(nullptr),
+      row_(new Row(*other.row_)),
+      views_(other.views_),
+      cursor_(other.cursor_),
+      row_valid_(other.row_valid_),
+      page_filter_(other.page_filter_),
+      use_directory_(other.use_directory_),
+      page_index_(other.page_index_),
+      page_end_(other.page_end_) {
+  // 副本持有自己的pin，视图才能在原迭代器移动后继续有效
+  if (other.page_ != nullptr) {
+    page_ = table_heap_->FetchPage(other.page_->GetPageId());
+  }
+}
 
 TableIterator::~TableIterator() {
   delete row_;
@@ -26,7 +65,7 @@ TableIterator::~TableIterator() {
 }
 
 bool TableIterator::operator==(const TableIterator &itr) const {
-  return (row_->GetRowId() == itr.row_->GetRowId());
+  return rid_ == itr.rid_;
 }
 
 bool TableIterator::operator!=(const TableIterator &itr) const {
@@ -37,20 +76,40 @@ bool TableIterator::operator!=(const TableIterator &itr) const {
 }
 
 const Row &TableIterator::operator*() {
+  if (!row_valid_) {
+    GetRowView().ToRow(row_);
+    row_valid_ = true;
+  }
   return *row_;
 }
 
 Row *TableIterator::operator->() {
-  return this->row_;
+  if (!row_valid_) {
+    GetRowView().ToRow(row_);
+    row_valid_ = true;
+  }
+  return row_;
 }
 
 TableIterator &TableIterator::operator=(const TableIterator &itr) noexcept {
   if (this != &itr) {
+    // 先pin新页再释放旧页，两者是同一页时不会被换出
+    TablePage *page = itr.page_ == nullptr ? nullptr : itr.table_heap_->FetchPage(itr.page_->GetPageId());
+    if (page_ != nullptr) {
+      table_heap_->UnpinPage(page_->GetPageId(), false);
+    }
+    page_ = page;
     table_heap_ = itr.table_heap_;
-    row_ = new Row(*itr.row_);
+    *row_ = *itr.row_;
     txn_ = itr.txn_;
     rid_ = itr.rid_;
-    page_ = itr.page_;
+    views_ = itr.views_;
+    cursor_ = itr.cursor_;
+    row_valid_ = itr.row_valid_;
+    page_filter_ = itr.page_filter_;
+    use_directory_ = itr.use_directory_;
+    page_index_ = itr.page_index_;
+    page_end_ = itr.page_end_;
   }
   return *this;
 }
@@ -68,45 +127,102 @@ TableIterator TableIterator::operator++(int) {
   return temp;
 }
 
-void TableIterator::MoveToNextTuple() {
+TableIterator &TableIterator::NextPage() {
+  if (page_ != nullptr) {
+    cursor_ = views_.size() - 1;
+    MoveToNextTuple();
+  }
+  return *this;
+}
+
+bool TableIterator::FindDictionaryEntry(uint32_t column_id, const Field &value, const char **entry) {
   if (page_ == nullptr) {
-    return;
+    return false;
   }
-  bool first_slot=false;
+  page_->RLatch();
+  bool encoded = page_->FindDictionaryEntry(table_heap_->schema_, column_id, value, entry);
+  page_->RUnlatch();
+  return encoded;
+}
+
+void TableIterator::LoadPage(uint32_t begin_slot) {
   while (true) {
-    // 移动到当前页面中的下一条记录
-    if(!first_slot)rid_ = RowId(rid_.GetPageId(), rid_.GetSlotNum() + 1);
-    first_slot = false;
-    // 检查是否到达页面中的记录末尾
-    if (rid_.GetSlotNum() < page_->GetTupleCount()) {
-      // 如果槽位不是空闲的，则找到下一条有效记录
-      if (!page_->IsDeleted(page_->GetTupleSize(rid_.GetSlotNum()))) {
+    // 一次解码页面中所有可见元组
+    page_->RLatch();
+    page_->GetTupleViews(table_heap_->schema_, &views_, begin_slot, table_heap_->toast_store_);
+    page_->RUnlatch();
+    if (!views_.empty()) {
+      break;
+    }
+    page_id_t next_page_id = GetNextPageId();
 #ifdef ENABLE_TABLEHEAP_ITER_DEBUG
-        LOG(INFO)<<"GET "<<rid_.GetPageId()<<' '<<rid_.GetSlotNum()<<endl;
+    LOG(INFO)<<"COME TO NEXT PAGE"<<endl;
 #endif
-        row_->SetRowId(rid_);
-        table_heap_->GetTuple(row_, txn_);
-        table_heap_->UnpinPage(page_->GetPageId(),false);//forget unpin
-        break;
-      }
-    } else {
-      // 移动到下一页
-      page_id_t next_page_id = page_->GetNextPageId();
+    // 释放当前页面，并获取下一页
+    table_heap_->UnpinPage(page_->GetPageId(), false);
+    page_ = next_page_id == INVALID_PAGE_ID ? nullptr : table_heap_->FetchPage(next_page_id);
+    if (page_ == nullptr) {
+      // 没有更多页面，迭代器到达末尾
+      SetEnd();
+      return;
+    }
+    begin_slot = 0;
+  }
+  cursor_ = 0;
+  rid_ = views_[cursor_].GetRowId();
+  row_->SetRowId(rid_);
+  row_valid_ = false;
+}
+
+void TableIterator::MoveToNextTuple() {
+  if (page_ == nullptr) {
+    return;
+  }
+  cursor_++;
+  if (cursor_ >= views_.size()) {
+    page_id_t next_page_id = GetNextPageId();
+    table_heap_->UnpinPage(page_->GetPageId(), false);
+    page_ = next_page_id == INVALID_PAGE_ID ? nullptr : table_heap_->FetchPage(next_page_id);
+    if (page_ == nullptr) {
+      SetEnd();
+      return;
+    }
+    LoadPage(0);
+    return;
+  }
+  // 迭代期间上层算子可能修改了这一页(如更新后压缩页面)，视图失效时从当前槽位重新解码
+  if (!page_->IsViewCurrent(views_[cursor_])) {
+    LoadPage(views_[cursor_].GetSlotNum());
+    return;
+  }
 #ifdef ENABLE_TABLEHEAP_ITER_DEBUG
-      LOG(INFO)<<"COME TO NEXT PAGE"<<endl;
+  LOG(INFO)<<"GET "<<rid_.GetPageId()<<' '<<rid_.GetSlotNum()<<endl;
 #endif
-      if (next_page_id == INVALID_PAGE_ID) {
-        // 没有更多页面，迭代器到达末尾
-        page_ = nullptr;
-        rid_ = RowId(INVALID_PAGE_ID, 0);
-        return;
-      }
-      // 释放当前页面，并获取下一页
-      table_heap_->UnpinPage(page_->GetPageId(), false);
-      page_ = table_heap_->FetchPage(next_page_id);
-      rid_ = RowId(next_page_id, 0);
-      first_slot = true;
-    }
+  rid_ = views_[cursor_].GetRowId();
+  row_->SetRowId(rid_);
+  row_valid_ = false;
+}
+
+page_id_t TableIterator::GetNextPageId() {
+  if (!use_directory_) {
+    page_->RLatch();
+    page_id_t next_page_id = page_->GetNextPageId();
+    page_->RUnlatch();
+    return next_page_id;
   }
+  // 按heap directory的顺序取下一页，被过滤的页不需要fetch
+  page_id_t next_page_id;
+  do {
+    next_page_id = ++page_index_ < page_end_ ? table_heap_->GetPageId(page_index_) : INVALID_PAGE_ID;
+  } while (next_page_id != INVALID_PAGE_ID && page_filter_ != nullptr && !page_filter_(next_page_id));
+  return next_page_id;
 }
 
+void TableIterator::SetEnd() {
+  page_ = nullptr;
+  views_.clear();
+  cursor_ = 0;
+  rid_ = RowId(INVALID_PAGE_ID, 0);
+  row_->SetRowId(rid_);
+  row_valid_ = false;
+}
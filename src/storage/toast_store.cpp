@@ -0,0 +1,76 @@
+#include "storage/toast_store.h"
+
+#include <algorithm>
+
+#include "glog/logging.h"
+
+page_id_t ToastStore::Store(const char *data, uint32_t len) {
+  page_id_t first_page_id = INVALID_PAGE_ID;
+  OverflowPage *prev_page = nullptr;
+  uint32_t offset = 0;
+  // 从前往后写，每页写满后链接下一页
+  do {
+    page_id_t page_id;
+    auto page = reinterpret_cast<OverflowPage *>(buffer_pool_manager_->NewPage(page_id));
+    if (page == nullptr) {
+      LOG(ERROR) << "Out of pages for an overflow value" << std::endl;
+      if (prev_page != nullptr) {
+        buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), true);
+      }
+      Free(first_page_id);
+      return INVALID_PAGE_ID;
+    }
+    page->Init(page_id, nullptr, nullptr);
+    uint32_t size = std::min<uint32_t>(len - offset, OverflowPage::SIZE_MAX_DATA);
+    memcpy(page->GetPayload(), data + offset, size);
+    page->SetDataSize(size);
+    offset += size;
+    if (prev_page == nullptr) {
+      first_page_id = page_id;
+    } else {
+      prev_page->SetNextPageId(page_id);
+      buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), true);
+    }
+    prev_page = page;
+  } while (offset < len);
+  buffer_pool_manager_->UnpinPage(prev_page->GetPageId(), true);
+  return first_page_id;
+}
+
+bool ToastStore::Fetch(page_id_t first_page_id, uint32_t len, char *data) const {
+  uint32_t offset = 0;
+  page_id_t page_id = first_page_id;
+  while (page_id != INVALID_PAGE_ID && offset < len) {
+    auto page = reinterpret_cast<OverflowPage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr) {
+      return false;
+    }
+    uint32_t size = std::min(page->GetDataSize(), len - offset);
+    memcpy(data + offset, page->GetPayload(), size);
+    offset += size;
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+  return offset == len;
+}
+
+void ToastStore::Free(page_id_t first_page_id) {
+  std::vector<page_id_t> page_ids;
+  GetPageIds(first_page_id, &page_ids);
+  buffer_pool_manager_->DeletePages(page_ids);
+}
+
+void ToastStore::GetPageIds(page_id_t first_page_id, std::vector<page_id_t> *page_ids) const {
+  page_id_t page_id = first_page_id;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page = reinterpret_cast<OverflowPage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr) {
+      return;
+    }
+    page_ids->push_back(page_id);
+    page_id_t next_page_id = page->GetNextPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+}
@@ -0,0 +1,94 @@
+#include "storage/zone_map.h"
+
+#include <algorithm>
+
+void ZoneMap::AddPage(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  zones_[page_id].columns_.assign(schema_->GetColumnCount(), ColumnZone());
+}
+
+void ZoneMap::RemovePage(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  zones_.erase(page_id);
+}
+
+void ZoneMap::ResetPage(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto iter = zones_.find(page_id);
+  if (iter != zones_.end()) {
+    iter->second.row_count_ = 0;
+    iter->second.columns_.assign(schema_->GetColumnCount(), ColumnZone());
+  }
+}
+
+double ZoneMap::GetValue(const Field &field) {
+  return field.GetTypeId() == TypeId::kTypeInt ? field.value_.integer_ : field.value_.float_;
+}
+
+void ZoneMap::AddRow(page_id_t page_id, const Row &row) {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto iter = zones_.find(page_id);
+  if (iter == zones_.end()) {
+    return;
+  }
+  auto &zone = iter->second;
+  for (uint32_t i = 0; i < zone.columns_.size(); i++) {
+    auto field = row.GetField(i);
+    auto &column = zone.columns_[i];
+    if (field->IsNull()) {
+      column.null_count_++;
+      continue;
+    }
+    if (!HasRange(field->GetTypeId())) {
+      continue;
+    }
+    double value = GetValue(*field);
+    // 第一个非空值直接作为范围
+    if (zone.row_count_ == column.null_count_) {
+      column.min_ = column.max_ = value;
+    } else {
+      column.min_ = std::min(column.min_, value);
+      column.max_ = std::max(column.max_, value);
+    }
+  }
+  zone.row_count_++;
+}
+
+bool ZoneMap::MayMatch(page_id_t page_id, uint32_t column, const std::string &comp_type, const Field &value) const {
+  std::lock_guard<std::mutex> guard(latch_);
+  auto iter = zones_.find(page_id);
+  if (iter == zones_.end() || column >= iter->second.columns_.size()) {
+    return true;
+  }
+  auto &zone = iter->second;
+  auto &column_zone = zone.columns_[column];
+  if (comp_type == "is") {
+    return column_zone.null_count_ > 0;
+  }
+  bool has_value = column_zone.null_count_ < zone.row_count_;
+  if (comp_type == "not") {
+    return has_value;
+  }
+  // 与空值比较的结果不为真，只有非空值可能满足条件
+  if (!has_value) {
+    return false;
+  }
+  if (value.IsNull() || !HasRange(value.GetTypeId()) || schema_->GetColumn(column)->GetType() != value.GetTypeId()) {
+    return true;
+  }
+  double v = GetValue(value);
+  if (comp_type == "=") {
+    return column_zone.min_ <= v && v <= column_zone.max_;
+  } else if (comp_type == "<>") {
+    return column_zone.min_ != v || column_zone.max_ != v;
+  } else if (comp_type == "<") {
+    return column_zone.min_ < v;
+  } else if (comp_type == "<=") {
+    return column_zone.min_ <= v;
+  } else if (comp_type == ">") {
+    return column_zone.max_ > v;
+  } else if (comp_type == ">=") {
+    return column_zone.max_ >= v;
+  }
+  return true;
+}
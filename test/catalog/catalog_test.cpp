@@ -1,5 +1,7 @@
 #include "catalog/catalog.h"
 
+#include <chrono>
+
 #include "common/instance.h"
 #include "gtest/gtest.h"
 #include "utils/utils.h"
@@ -39,6 +41,83 @@ TEST(CatalogTest, CatalogMetaTest) {
   delete other;
 }
 
+TEST(CatalogTest, CatalogLegacyTableMetaTest) {
+  char *buf = new char[PAGE_SIZE];
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 64, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  // a record of the format before it had a version: magic, id, name, root, free space map, schema
+  std::string table_name = "table-1";
+  char *p = buf;
+  MACH_WRITE_UINT32(p, 344528);
+  p += 4;
+  MACH_WRITE_TO(table_id_t, p, 3);
+  p += 4;
+  MACH_WRITE_UINT32(p, table_name.length());
+  p += 4;
+  MACH_WRITE_STRING(p, table_name);
+  p += table_name.length();
+  MACH_WRITE_TO(page_id_t, p, 7);
+  p += 4;
+  MACH_WRITE_TO(page_id_t, p, 8);
+  p += 4;
+  p += schema->SerializeTo(p);
+  TableMetadata *table_meta = nullptr;
+  ASSERT_EQ(static_cast<uint32_t>(p - buf), TableMetadata::DeserializeFrom(buf, table_meta));
+  ASSERT_EQ(3, table_meta->GetTableId());
+  ASSERT_EQ(table_name, table_meta->GetTableName());
+  ASSERT_EQ(7, table_meta->GetFirstPageId());
+  ASSERT_EQ(8, table_meta->GetFreeSpaceMapPageId());
+  ASSERT_EQ(INVALID_PAGE_ID, table_meta->GetHeapDirectoryPageId());
+  ASSERT_EQ(TableLayout::kRow, table_meta->GetLayout());
+  ASSERT_EQ(2, table_meta->GetSchema()->GetColumnCount());
+  // written back in the current format once the directory is rebuilt
+  table_meta->SetHeapDirectoryPageId(9);
+  table_meta->SerializeTo(buf);
+  TableMetadata *other = nullptr;
+  TableMetadata::DeserializeFrom(buf, other);
+  ASSERT_EQ(9, other->GetHeapDirectoryPageId());
+  ASSERT_EQ(7, other->GetFirstPageId());
+  delete table_meta;
+  delete other;
+  // version 1 has the heap directory but no layout yet
+  p = buf;
+  MACH_WRITE_UINT32(p, 344529);
+  p += 4;
+  MACH_WRITE_UINT32(p, 1);
+  p += 4;
+  MACH_WRITE_TO(table_id_t, p, 3);
+  p += 4;
+  MACH_WRITE_UINT32(p, table_name.length());
+  p += 4;
+  MACH_WRITE_STRING(p, table_name);
+  p += table_name.length();
+  MACH_WRITE_TO(page_id_t, p, 7);
+  p += 4;
+  MACH_WRITE_TO(page_id_t, p, 8);
+  p += 4;
+  MACH_WRITE_TO(page_id_t, p, 9);
+  p += 4;
+  p += schema->SerializeTo(p);
+  table_meta = nullptr;
+  ASSERT_EQ(static_cast<uint32_t>(p - buf), TableMetadata::DeserializeFrom(buf, table_meta));
+  ASSERT_EQ(9, table_meta->GetHeapDirectoryPageId());
+  ASSERT_EQ(TableLayout::kRow, table_meta->GetLayout());
+  ASSERT_EQ(2, table_meta->GetSchema()->GetColumnCount());
+  // the current version keeps the layout
+  TableMetadata *pax_meta = TableMetadata::Create(4, table_name, 7, 8, 9, Schema::DeepCopySchema(schema.get()),
+                                                   TableLayout::kPax);
+  pax_meta->SerializeTo(buf);
+  other = nullptr;
+  TableMetadata::DeserializeFrom(buf, other);
+  ASSERT_EQ(TableLayout::kPax, other->GetLayout());
+  ASSERT_EQ(9, other->GetHeapDirectoryPageId());
+  delete table_meta;
+  delete pax_meta;
+  delete other;
+  delete[] buf;
+}
+
 TEST(CatalogTest, CatalogTableTest) {
   /** Stage 2: Testing simple operation */
   auto db_01 = new DBStorageEngine(db_file_name, true);
@@ -68,6 +147,46 @@ TEST(CatalogTest, CatalogTableTest) {
   delete db_02;
 }
 
+TEST(CatalogTest, CatalogPaxTableTest) {
+  auto db_01 = new DBStorageEngine(db_file_name, true);
+  auto &catalog_01 = db_01->catalog_mgr_;
+  TableInfo *table_info = nullptr;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 64, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  Txn txn;
+  ASSERT_EQ(DB_SUCCESS, catalog_01->CreateTable("table-1", schema.get(), &txn, table_info, TableLayout::kPax));
+  std::vector<Column *> wide_columns = {new Column("text", TypeId::kTypeChar, PAGE_SIZE, 0, true, false)};
+  auto wide_schema = std::make_shared<Schema>(wide_columns);
+  TableInfo *wide_info = nullptr;
+  ASSERT_EQ(DB_FAILED, catalog_01->CreateTable("table-2", wide_schema.get(), &txn, wide_info, TableLayout::kPax));
+  for (int i = 0; i < 100; i++) {
+    std::vector<Field> fields{Field(TypeId::kTypeInt, i),
+                              Field(TypeId::kTypeChar, const_cast<char *>("minisql"), 7, true)};
+    Row row(fields);
+    ASSERT_TRUE(table_info->GetTableHeap()->InsertTuple(row, &txn));
+  }
+  delete db_01;
+  // the layout is kept in the table metadata, pages appended after loading are PAX pages too
+  auto db_02 = new DBStorageEngine(db_file_name, false);
+  auto &catalog_02 = db_02->catalog_mgr_;
+  ASSERT_EQ(DB_SUCCESS, catalog_02->GetTable("table-1", table_info));
+  ASSERT_EQ(TableLayout::kPax, table_info->GetTableHeap()->GetLayout());
+  ASSERT_EQ(DB_TABLE_NOT_EXIST, catalog_02->GetTable("table-2", wide_info));
+  for (int i = 100; i < 500; i++) {
+    std::vector<Field> fields{Field(TypeId::kTypeInt, i),
+                              Field(TypeId::kTypeChar, const_cast<char *>("minisql"), 7, true)};
+    Row row(fields);
+    ASSERT_TRUE(table_info->GetTableHeap()->InsertTuple(row, &txn));
+  }
+  int count = 0;
+  for (auto iter = table_info->GetTableHeap()->Begin(&txn); iter != table_info->GetTableHeap()->End(); ++iter) {
+    ASSERT_EQ(count++, std::stoi(iter->GetField(0)->toString()));
+  }
+  ASSERT_EQ(500, count);
+  delete db_02;
+}
+
 TEST(CatalogTest, CatalogIndexTest) {
   /** Stage 1: Testing simple operation */
   auto db_01 = new DBStorageEngine(db_file_name, true);
@@ -127,4 +246,126 @@ TEST(CatalogTest, CatalogIndexTest) {
     ASSERT_EQ(rid.Get(), ret_02[i].Get());
   }
   delete db_02;
-}
\ No newline at end of file
+}
+TEST(CatalogTest, CatalogIndexBackfillTest) {
+  auto db_01 = new DBStorageEngine(db_file_name, true);
+  auto &catalog_01 = db_01->catalog_mgr_;
+  TableInfo *table_info = nullptr;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 16, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  Txn txn;
+  ASSERT_EQ(DB_SUCCESS, catalog_01->CreateTable("table-1", schema.get(), &txn, table_info));
+  const int n = 5000;
+  std::vector<int> ids;
+  for (int i = 0; i < n; i++) {
+    ids.push_back(i);
+  }
+  ShuffleArray(ids);
+  std::vector<RowId> rids(n);
+  for (int id : ids) {
+    std::string name = "name-" + std::to_string(id % 10);
+    std::vector<Field> fields{Field(TypeId::kTypeInt, id),
+                              Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true)};
+    Row row(fields);
+    ASSERT_TRUE(table_info->GetTableHeap()->InsertTuple(row, &txn));
+    rids[id] = row.GetRowId();
+  }
+  // an index created on a populated table holds its rows
+  IndexInfo *index_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, catalog_01->CreateIndex("table-1", "index-id", {"id"}, &txn, index_info, "bptree"));
+  for (int i = 0; i < n; i++) {
+    std::vector<Field> fields{Field(TypeId::kTypeInt, i)};
+    std::vector<RowId> result;
+    ASSERT_EQ(DB_SUCCESS, index_info->GetIndex()->ScanKey(Row(fields), result, &txn));
+    ASSERT_EQ(rids[i].Get(), result[0].Get());
+  }
+  std::vector<Field> fields{Field(TypeId::kTypeInt, n)};
+  ASSERT_EQ(DB_SUCCESS, index_info->GetIndex()->InsertEntry(Row(fields), RowId(1000, 0), &txn));
+  // the keys of an index are unique, a duplicated key keeps the first row of the table
+  IndexInfo *name_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, catalog_01->CreateIndex("table-1", "index-name", {"name"}, &txn, name_info, "bptree"));
+  std::map<std::string, RowId> first_rids;
+  for (auto iter = table_info->GetTableHeap()->Begin(&txn); iter != table_info->GetTableHeap()->End(); iter++) {
+    first_rids.emplace("name-" + std::to_string(std::stoi(iter->GetField(0)->toString()) % 10), iter->GetRowId());
+  }
+  ASSERT_EQ(10, first_rids.size());
+  for (auto &entry : first_rids) {
+    std::string name = entry.first;
+    std::vector<Field> name_fields{Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true)};
+    std::vector<RowId> result;
+    ASSERT_EQ(DB_SUCCESS, name_info->GetIndex()->ScanKey(Row(name_fields), result, &txn));
+    ASSERT_EQ(entry.second.Get(), result[0].Get());
+  }
+  delete db_01;
+}
+
+TEST(CatalogTest, CatalogParallelIndexBuildTest) {
+  auto db_01 = new DBStorageEngine(db_file_name, true);
+  auto &catalog_01 = db_01->catalog_mgr_;
+  TableInfo *table_info = nullptr;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 16, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  Txn txn;
+  ASSERT_EQ(DB_SUCCESS, catalog_01->CreateTable("table-1", schema.get(), &txn, table_info));
+  const int n = 60000;
+  std::vector<int> ids;
+  for (int i = 0; i < n; i++) {
+    ids.push_back(i);
+  }
+  ShuffleArray(ids);
+  std::vector<RowId> rids(n);
+  for (int id : ids) {
+    std::string name = "name-" + std::to_string(id % 100);
+    std::vector<Field> fields{Field(TypeId::kTypeInt, id),
+                              Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true)};
+    Row row(fields);
+    ASSERT_TRUE(table_info->GetTableHeap()->InsertTuple(row, &txn));
+    rids[id] = row.GetRowId();
+  }
+  ASSERT_GE(table_info->GetTableHeap()->GetPageCount(), 4 * INDEX_BUILD_PAGES_PER_THREAD);
+  // the same index built by 1, 2 and 4 workers holds every row
+  for (uint32_t threads : {1u, 2u, 4u}) {
+    IndexInfo *index_info = IndexInfo::Create();
+    index_info->Init(IndexMetadata::Create(threads, "index-id", table_info->GetTableId(), {0}), table_info,
+                     db_01->bpm_);
+    IndexBuildProgress progress;
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_EQ(DB_SUCCESS, index_info->Backfill(&txn, &progress, threads));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ASSERT_EQ(IndexBuildProgress::Phase::kDone, progress.phase);
+    ASSERT_EQ(n, progress.rows_scanned);
+    ASSERT_EQ(n, progress.entries_total);
+    ASSERT_EQ(n, progress.entries_loaded);
+    ASSERT_EQ(threads, progress.workers.size());
+    std::cout << "threads=" << threads << " build " << static_cast<uint64_t>(n / seconds) << " rows/s, scan";
+    for (auto &worker : progress.workers) {
+      std::cout << " " << static_cast<uint64_t>(worker.rows / worker.seconds);
+    }
+    std::cout << " rows/s per thread" << std::endl;
+    for (int i = 0; i < n; i++) {
+      std::vector<Field> fields{Field(TypeId::kTypeInt, i)};
+      std::vector<RowId> result;
+      ASSERT_EQ(DB_SUCCESS, index_info->GetIndex()->ScanKey(Row(fields), result, &txn));
+      ASSERT_EQ(rids[i].Get(), result[0].Get());
+    }
+    index_info->GetIndex()->Destroy();
+    delete index_info;
+  }
+  // the partitions are merged in table order, a duplicated key keeps the first row of the table
+  IndexInfo *name_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, catalog_01->CreateIndex("table-1", "index-name", {"name"}, &txn, name_info, "bptree"));
+  std::map<std::string, RowId> first_rids;
+  for (auto iter = table_info->GetTableHeap()->Begin(&txn); iter != table_info->GetTableHeap()->End(); iter++) {
+    first_rids.emplace("name-" + std::to_string(std::stoi(iter->GetField(0)->toString()) % 100), iter->GetRowId());
+  }
+  for (auto &entry : first_rids) {
+    std::string name = entry.first;
+    std::vector<Field> name_fields{Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), name.size(), true)};
+    std::vector<RowId> result;
+    ASSERT_EQ(DB_SUCCESS, name_info->GetIndex()->ScanKey(Row(name_fields), result, &txn));
+    ASSERT_EQ(entry.second.Get(), result[0].Get());
+  }
+  delete db_01;
+}
@@ -1,6 +1,9 @@
 //
 // Created by njz on 2023/1/26.
 //
+#include <thread>
+
+#include "executor/executors/seq_scan_executor.h"
 #include "executor/plans/delete_plan.h"
 #include "executor/plans/insert_plan.h"
 #include "executor/plans/seq_scan_plan.h"
@@ -157,3 +160,278 @@ TEST_F(ExecutorTest, SimpleUpdateTest) {
     ASSERT_TRUE(row.GetField(1)->CompareEquals(Field(kTypeChar, const_cast<char *>("minisql"), 7, false)));
   }
 }
+
+// UPDATE table-1 SET account = 1.5, the scanned rows are not kept in the arena of the query
+TEST_F(ExecutorTest, UpdateArenaTest) {
+  TableInfo *table_info;
+  GetExecutorContext()->GetCatalog()->GetTable("table-1", table_info);
+  const Schema *schema = table_info->GetSchema();
+  auto scan_plan = make_shared<SeqScanPlanNode>(schema, table_info->GetTableName(), nullptr);
+  std::unordered_map<uint32_t, AbstractExpressionRef> update_attrs{};
+  update_attrs.emplace(static_cast<uint32_t>(2), MakeConstantValueExpression(Field(kTypeFloat, 1.5f)));
+  auto update_plan = std::make_shared<UpdatePlanNode>(schema, scan_plan, "table-1", update_attrs);
+  std::vector<Row> result_set{};
+  GetExecutionEngine()->ExecutePlan(update_plan, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(1000, result_set.size());
+  ASSERT_EQ(0, GetExecutorContext()->GetArena()->GetMemoryUsage());
+  // rows of a SELECT outlive its scan
+  result_set.clear();
+  GetExecutionEngine()->ExecutePlan(scan_plan, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(1000, result_set.size());
+  ASSERT_GT(GetExecutorContext()->GetArena()->GetMemoryUsage(), 0);
+  std::vector<Row> rows;
+  for (auto iter = table_info->GetTableHeap()->Begin(nullptr); iter != table_info->GetTableHeap()->End(); ++iter) {
+    rows.emplace_back(*iter);
+  }
+  ASSERT_EQ(rows.size(), result_set.size());
+  for (size_t i = 0; i < rows.size(); i++) {
+    ASSERT_TRUE(result_set[i].GetField(1)->CompareEquals(*rows[i].GetField(1)));
+    ASSERT_TRUE(result_set[i].GetField(2)->CompareEquals(Field(kTypeFloat, 1.5f)));
+  }
+}
+
+// UPDATE table-1 SET account = 1.5 WHERE id < 100, then UPDATE table-1 SET id = 5000 WHERE id = 7
+TEST_F(ExecutorTest, IndexedUpdateTest) {
+  TableInfo *table_info;
+  GetExecutorContext()->GetCatalog()->GetTable("table-1", table_info);
+  const Schema *schema = table_info->GetSchema();
+  IndexInfo *id_index = nullptr;
+  IndexInfo *name_index = nullptr;
+  std::vector<std::string> id_keys{"id"};
+  std::vector<std::string> name_keys{"name"};
+  ASSERT_EQ(DB_SUCCESS,
+            GetExecutorContext()->GetCatalog()->CreateIndex("table-1", "index-id", id_keys, GetTxn(), id_index, "bptree"));
+  ASSERT_EQ(DB_SUCCESS, GetExecutorContext()->GetCatalog()->CreateIndex("table-1", "index-name", name_keys, GetTxn(),
+                                                                        name_index, "bptree"));
+  auto lookup = [&](IndexInfo *index, const Field &key, std::vector<RowId> &rids) {
+    Fields key_fields;
+    key_fields.emplace_back(key);
+    Row key_row(key_fields);
+    rids.clear();
+    index->GetIndex()->ScanKey(key_row, rids, GetTxn());
+  };
+
+  // the account column is not indexed, so the index entries stay as they are
+  auto col_id = MakeColumnValueExpression(*schema, 0, "id");
+  auto predicate = MakeComparisonExpression(col_id, MakeConstantValueExpression(Field(kTypeInt, 100)), "<");
+  auto scan_plan = make_shared<SeqScanPlanNode>(schema, table_info->GetTableName(), predicate);
+  std::unordered_map<uint32_t, AbstractExpressionRef> update_attrs{};
+  update_attrs.emplace(static_cast<uint32_t>(2), MakeConstantValueExpression(Field(kTypeFloat, 1.5f)));
+  auto update_plan = std::make_shared<UpdatePlanNode>(schema, scan_plan, "table-1", update_attrs);
+  std::vector<Row> result_set{};
+  GetExecutionEngine()->ExecutePlan(update_plan, &result_set, GetTxn(), GetExecutorContext());
+  result_set.clear();
+  GetExecutionEngine()->ExecutePlan(scan_plan, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(100, result_set.size());
+  std::vector<RowId> rids{};
+  for (const auto &row : result_set) {
+    ASSERT_TRUE(row.GetField(2)->CompareEquals(Field(kTypeFloat, 1.5f)));
+    lookup(id_index, *row.GetField(0), rids);
+    ASSERT_EQ(1, rids.size());
+    ASSERT_EQ(row.GetRowId().Get(), rids[0].Get());
+  }
+
+  // an assigned key column moves the entry of the row in that index only
+  auto id_predicate = MakeComparisonExpression(col_id, MakeConstantValueExpression(Field(kTypeInt, 7)), "=");
+  auto id_scan_plan = make_shared<SeqScanPlanNode>(schema, table_info->GetTableName(), id_predicate);
+  result_set.clear();
+  GetExecutionEngine()->ExecutePlan(id_scan_plan, &result_set, GetTxn(), GetExecutorContext());
+  ASSERT_EQ(1, result_set.size());
+  RowId rid = result_set[0].GetRowId();
+  Field name(*result_set[0].GetField(1));
+  std::vector<RowId> name_rids{};
+  lookup(name_index, name, name_rids);
+  std::unordered_map<uint32_t, AbstractExpressionRef> id_attrs{};
+  id_attrs.emplace(static_cast<uint32_t>(0), MakeConstantValueExpression(Field(kTypeInt, 5000)));
+  auto id_plan = std::make_shared<UpdatePlanNode>(schema, id_scan_plan, "table-1", id_attrs);
+  GetExecutionEngine()->ExecutePlan(id_plan, &result_set, GetTxn(), GetExecutorContext());
+  lookup(id_index, Field(kTypeInt, 7), rids);
+  ASSERT_TRUE(rids.empty());
+  lookup(id_index, Field(kTypeInt, 5000), rids);
+  ASSERT_EQ(1, rids.size());
+  ASSERT_EQ(rid.Get(), rids[0].Get());
+  lookup(name_index, name, rids);
+  ASSERT_EQ(name_rids.size(), rids.size());
+  for (size_t i = 0; i < rids.size(); i++) {
+    ASSERT_EQ(name_rids[i].Get(), rids[i].Get());
+  }
+}
+
+// INSERT of a batch that runs out of buffer pool frames midway leaves no rows behind
+TEST(InsertExecutorTest, BatchInsertFailureTest) {
+  auto db = new DBStorageEngine("executor_insert_test.db", true, 64);
+  auto &catalog = db->catalog_mgr_;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 64, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  TableInfo *table_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, catalog->CreateTable("table-1", schema.get(), nullptr, table_info));
+  auto table_heap = table_info->GetTableHeap();
+  std::string name(60, 'n');
+  for (int i = 0; i < 100; i++) {
+    Fields fields{Field(kTypeInt, i), Field(kTypeChar, const_cast<char *>(name.c_str()), 60, true)};
+    Row row(fields);
+    ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+  }
+  auto exec_ctx = db->MakeExecuteContext(nullptr);
+  auto execution_engine = std::make_unique<ExecuteEngine>();
+  std::vector<std::vector<AbstractExpressionRef>> raw_values;
+  for (int i = 100; i < 300; i++) {
+    raw_values.push_back({std::make_shared<ConstantValueExpression>(Field(kTypeInt, i)),
+                          std::make_shared<ConstantValueExpression>(
+                              Field(kTypeChar, const_cast<char *>(name.c_str()), 60, true))});
+  }
+  auto value_plan = std::make_shared<ValuesPlanNode>(nullptr, raw_values);
+  auto insert_plan = std::make_shared<InsertPlanNode>(nullptr, value_plan, "table-1");
+  // the page being filled and the free space map stay resident, every other frame is taken, so the batch fills
+  // the current page and then fails to get the next one
+  auto bpm = db->bpm_;
+  page_id_t last_page_id = table_heap->GetPageId(table_heap->GetPageCount() - 1);
+  ASSERT_NE(nullptr, bpm->FetchPage(last_page_id));
+  ASSERT_NE(nullptr, bpm->FetchPage(table_heap->GetFreeSpaceMapPageId()));
+  std::vector<page_id_t> pinned_page_ids;
+  page_id_t page_id;
+  while (bpm->NewPage(page_id) != nullptr) {
+    pinned_page_ids.push_back(page_id);
+  }
+  std::vector<Row> result_set{};
+  execution_engine->ExecutePlan(insert_plan, &result_set, nullptr, exec_ctx.get());
+  ASSERT_TRUE(result_set.empty());
+  for (auto pinned_page_id : pinned_page_ids) {
+    bpm->UnpinPage(pinned_page_id, false);
+  }
+  bpm->UnpinPage(table_heap->GetFreeSpaceMapPageId(), false);
+  bpm->UnpinPage(last_page_id, false);
+  int count = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); ++iter) {
+    ASSERT_LT(std::stoi(iter->GetField(0)->toString()), 100);
+    count++;
+  }
+  ASSERT_EQ(100, count);
+  // with the frames back the same statement goes through, none of its rows was left behind to clash with it
+  IndexInfo *index_info = nullptr;
+  std::vector<std::string> id_keys{"id"};
+  ASSERT_EQ(DB_SUCCESS, catalog->CreateIndex("table-1", "index-id", id_keys, nullptr, index_info, "bptree"));
+  execution_engine->ExecutePlan(insert_plan, &result_set, nullptr, exec_ctx.get());
+  ASSERT_EQ(200, result_set.size());
+  for (int i = 0; i < 300; i++) {
+    Fields key_fields{Field(kTypeInt, i)};
+    Row key_row(key_fields);
+    std::vector<RowId> rids;
+    ASSERT_EQ(DB_SUCCESS, index_info->GetIndex()->ScanKey(key_row, rids, nullptr));
+    ASSERT_EQ(1, rids.size());
+  }
+  delete db;
+}
+
+// an INSERT statement gives its insert page back when it ends, the next session fills the same page
+TEST(InsertExecutorTest, ReleaseInsertPageTest) {
+  auto db = new DBStorageEngine("executor_insert_test.db", true);
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  TableInfo *table_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, db->catalog_mgr_->CreateTable("table-1", schema.get(), nullptr, table_info));
+  auto exec_ctx = db->MakeExecuteContext(nullptr);
+  auto execution_engine = std::make_unique<ExecuteEngine>();
+  auto insert = [&](int begin, int end) {
+    std::vector<std::vector<AbstractExpressionRef>> raw_values;
+    for (int i = begin; i < end; i++) {
+      raw_values.push_back({std::make_shared<ConstantValueExpression>(Field(kTypeInt, i))});
+    }
+    auto value_plan = std::make_shared<ValuesPlanNode>(nullptr, raw_values);
+    auto insert_plan = std::make_shared<InsertPlanNode>(nullptr, value_plan, "table-1");
+    std::vector<Row> result_set{};
+    execution_engine->ExecutePlan(insert_plan, &result_set, nullptr, exec_ctx.get());
+    return result_set.size();
+  };
+  ASSERT_EQ(20, insert(0, 20));
+  ASSERT_EQ(1, insert(20, 21));
+  size_t inserted = 0;
+  std::thread session([&]() { inserted = insert(21, 41) + insert(41, 42); });
+  session.join();
+  ASSERT_EQ(21, inserted);
+  ASSERT_EQ(1, table_info->GetTableHeap()->GetPageCount());
+  delete db;
+}
+
+// SELECT * FROM table-1, the first row scanned has an empty CHAR value
+TEST(SeqScanExecutorTest, EmptyCharTest) {
+  auto db = new DBStorageEngine("executor_scan_test.db", true);
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 64, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  TableInfo *table_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, db->catalog_mgr_->CreateTable("table-1", schema.get(), nullptr, table_info));
+  std::vector<std::string> names{"", "minisql", ""};
+  for (size_t i = 0; i < names.size(); i++) {
+    Fields fields{Field(kTypeInt, static_cast<int32_t>(i)),
+                  Field(kTypeChar, const_cast<char *>(names[i].c_str()), names[i].size(), true)};
+    Row row(fields);
+    ASSERT_TRUE(table_info->GetTableHeap()->InsertTuple(row, nullptr));
+  }
+  auto exec_ctx = db->MakeExecuteContext(nullptr);
+  auto execution_engine = std::make_unique<ExecuteEngine>();
+  auto scan_plan = make_shared<SeqScanPlanNode>(table_info->GetSchema(), table_info->GetTableName(), nullptr);
+  std::vector<Row> result_set{};
+  ASSERT_EQ(DB_SUCCESS, execution_engine->ExecutePlan(scan_plan, &result_set, nullptr, exec_ctx.get()));
+  ASSERT_EQ(names.size(), result_set.size());
+  for (size_t i = 0; i < names.size(); i++) {
+    ASSERT_FALSE(result_set[i].GetField(1)->IsNull());
+    ASSERT_EQ(names[i], result_set[i].GetField(1)->toString());
+  }
+  delete db;
+}
+
+// SELECT * FROM table-1 WHERE 7 <> id, a constant on the left is compared against the zones like one on the right
+TEST(SeqScanExecutorTest, ConstantOnLeftTest) {
+  auto db = new DBStorageEngine("executor_scan_test.db", true);
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  TableInfo *table_info = nullptr;
+  ASSERT_EQ(DB_SUCCESS, db->catalog_mgr_->CreateTable("table-1", schema.get(), nullptr, table_info));
+  auto table_heap = table_info->GetTableHeap();
+  // every page but the last one only holds id 7, the last one also holds id 8
+  while (table_heap->GetPageCount() < 3) {
+    Fields fields{Field(kTypeInt, 7)};
+    Row row(fields);
+    ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+  }
+  Fields fields{Field(kTypeInt, 8)};
+  Row row(fields);
+  ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+  page_id_t first_page_id = table_heap->GetPageId(0);
+  page_id_t last_page_id = table_heap->GetPageId(table_heap->GetPageCount() - 1);
+  auto exec_ctx = db->MakeExecuteContext(nullptr);
+  auto col_id = std::make_shared<ColumnValueExpression>(0, 0, kTypeInt);
+  auto const7 = std::make_shared<ConstantValueExpression>(Field(kTypeInt, 7));
+  auto const8 = std::make_shared<ConstantValueExpression>(Field(kTypeInt, 8));
+  auto may_match = [&](const AbstractExpressionRef &predicate, page_id_t page_id) {
+    auto scan_plan = make_shared<SeqScanPlanNode>(table_info->GetSchema(), table_info->GetTableName(), predicate);
+    SeqScanExecutor executor(exec_ctx.get(), scan_plan.get());
+    executor.Init();
+    return executor.PageMayMatch(page_id, predicate.get());
+  };
+  auto compare = [](const AbstractExpressionRef &lhs, const AbstractExpressionRef &rhs, const std::string &comp_type) {
+    return std::make_shared<ComparisonExpression>(lhs, rhs, comp_type);
+  };
+  ASSERT_FALSE(may_match(compare(const7, col_id, "<>"), first_page_id));
+  ASSERT_TRUE(may_match(compare(const7, col_id, "<>"), last_page_id));
+  ASSERT_TRUE(may_match(compare(const7, col_id, "="), first_page_id));
+  ASSERT_FALSE(may_match(compare(const8, col_id, "="), first_page_id));
+  ASSERT_FALSE(may_match(compare(const7, col_id, "<"), first_page_id));
+  ASSERT_TRUE(may_match(compare(const7, col_id, "<"), last_page_id));
+  ASSERT_TRUE(may_match(compare(const7, col_id, "<="), first_page_id));
+  ASSERT_FALSE(may_match(compare(const8, col_id, "<="), first_page_id));
+  ASSERT_FALSE(may_match(compare(const7, col_id, ">"), first_page_id));
+  ASSERT_TRUE(may_match(compare(const8, col_id, ">"), first_page_id));
+  ASSERT_TRUE(may_match(compare(const7, col_id, ">="), first_page_id));
+  // the pruned scan still finds the only row that differs
+  auto exec_engine = std::make_unique<ExecuteEngine>();
+  auto scan_plan =
+      make_shared<SeqScanPlanNode>(table_info->GetSchema(), table_info->GetTableName(), compare(const7, col_id, "<>"));
+  std::vector<Row> result_set{};
+  ASSERT_EQ(DB_SUCCESS, exec_engine->ExecutePlan(scan_plan, &result_set, nullptr, exec_ctx.get()));
+  ASSERT_EQ(1, result_set.size());
+  ASSERT_TRUE(result_set[0].GetField(0)->CompareEquals(Field(kTypeInt, 8)));
+  delete db;
+}
@@ -1,5 +1,10 @@
 #include "index/b_plus_tree.h"
 
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+
 #include "common/instance.h"
 #include "gtest/gtest.h"
 #include "index/comparator.h"
@@ -101,4 +106,638 @@ TEST(BPlusTreeTests, SampleTest) {
     ASSERT_TRUE(tree.GetValue(delete_seq[i], ans));
     ASSERT_EQ(kv_map[delete_seq[i]], ans[ans.size() - 1]);
   }
-}
\ No newline at end of file
+}
+
+static GenericKey *MakeIntKey(const KeyManager &KP, Schema *schema, int value) {
+  GenericKey *key = KP.InitKey();
+  std::vector<Field> fields{Field(TypeId::kTypeInt, value)};
+  KP.SerializeFromKey(key, Row(fields), schema);
+  return key;
+}
+
+TEST(BPlusTreeTests, NormalizedKeyTest) {
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, true, false),
+                                   new Column("name", TypeId::kTypeChar, 8, 1, true, false),
+                                   new Column("account", TypeId::kTypeFloat, 2, true, false)};
+  Schema *key_schema = new Schema(columns);
+  ASSERT_EQ(5 + 9 + 5, KeyManager::GetNormalizedSize(key_schema));
+  KeyManager KP(key_schema, 32);
+  std::vector<int32_t> ints{INT32_MIN, -70000, -1, 0, 1, 255, 256, 70000, INT32_MAX};
+  std::vector<float> floats{-1e30f, -2.5f, -1.0f, -0.0f, 0.0f, 1e-30f, 1.0f, 2.5f, 1e30f};
+  std::vector<std::string> chars{"", "a", "ab", "abc", "abd", "b", "zzzzzzzz"};
+  // keys on each column alone, with NULL first, must sort like the values
+  auto make_key = [&](Field id, Field name, Field account) {
+    std::vector<Field> fields;
+    fields.emplace_back(std::move(id));
+    fields.emplace_back(std::move(name));
+    fields.emplace_back(std::move(account));
+    GenericKey *key = KP.InitKey();
+    KP.SerializeFromKey(key, Row(std::move(fields)), key_schema);
+    return key;
+  };
+  Field null_char(TypeId::kTypeChar);
+  std::vector<GenericKey *> keys;
+  keys.push_back(make_key(Field(TypeId::kTypeInt), Field(null_char), Field(TypeId::kTypeFloat)));
+  for (auto i : ints) {
+    keys.push_back(make_key(Field(TypeId::kTypeInt, i), Field(null_char), Field(TypeId::kTypeFloat)));
+  }
+  for (size_t j = 1; j < keys.size(); j++) {
+    ASSERT_LT(KP.CompareKeys(keys[j - 1], keys[j]), 0);
+    ASSERT_GT(KP.CompareKeys(keys[j], keys[j - 1]), 0);
+  }
+  // the float column decides between keys with the same id, -0.0 and 0.0 are equal
+  for (auto i : ints) {
+    GenericKey *last = nullptr;
+    for (size_t j = 0; j < floats.size(); j++) {
+      GenericKey *key = make_key(Field(TypeId::kTypeInt, i), Field(null_char), Field(TypeId::kTypeFloat, floats[j]));
+      if (last != nullptr) {
+        ASSERT_EQ(floats[j - 1] == floats[j] ? 0 : -1, KP.CompareKeys(last, key));
+      }
+      keys.push_back(key);
+      last = key;
+    }
+  }
+  GenericKey *prev = nullptr;
+  for (auto &str : chars) {
+    GenericKey *key = make_key(Field(TypeId::kTypeInt, 7), Field(TypeId::kTypeChar, const_cast<char *>(str.c_str()),
+                                                                static_cast<uint32_t>(str.size()), true),
+                               Field(TypeId::kTypeFloat, 1.5f));
+    if (prev != nullptr) {
+      ASSERT_LT(KP.CompareKeys(prev, key), 0);
+    }
+    // decoding gives the fields back
+    Row row;
+    KP.DeserializeToKey(key, row, key_schema);
+    ASSERT_EQ(CmpBool::kTrue, row.GetField(0)->CompareEquals(Field(TypeId::kTypeInt, 7)));
+    ASSERT_EQ(str.size(), row.GetField(1)->GetLength());
+    ASSERT_EQ(0, memcmp(str.c_str(), row.GetField(1)->GetData(), str.size()));
+    ASSERT_EQ(CmpBool::kTrue, row.GetField(2)->CompareEquals(Field(TypeId::kTypeFloat, 1.5f)));
+    keys.push_back(key);
+    prev = key;
+  }
+  Row row;
+  KP.DeserializeToKey(keys[0], row, key_schema);
+  ASSERT_TRUE(row.GetField(0)->IsNull());
+  ASSERT_TRUE(row.GetField(1)->IsNull());
+  ASSERT_TRUE(row.GetField(2)->IsNull());
+  KP.DeserializeToKey(keys[1], row, key_schema);
+  ASSERT_EQ(CmpBool::kTrue, row.GetField(0)->CompareEquals(Field(TypeId::kTypeInt, INT32_MIN)));
+  for (auto key : keys) {
+    free(key);
+  }
+  delete key_schema;
+}
+
+// insert, look up, scan and remove on one instantiation of the tree, keys range over negative and positive ints
+template <int KeySize, typename KeyComparator>
+static void CheckSpecializedTree(DBStorageEngine &engine, index_id_t index_id, Schema *schema) {
+  KeyManager KP(schema, KeySize > 0 ? KeySize : 32);
+  BPlusTree<KeySize, KeyComparator> tree(index_id, engine.bpm_, KP, 8, 8);
+  const int n = 2000;
+  std::vector<int> values;
+  for (int i = 0; i < n; i++) {
+    values.push_back(i - n / 2);
+  }
+  ShuffleArray(values);
+  for (int v : values) {
+    GenericKey *key = MakeIntKey(KP, schema, v);
+    ASSERT_TRUE(tree.Insert(key, RowId(v + n, 0)));
+    free(key);
+  }
+  // the scan returns the keys in order
+  int expected = -n / 2;
+  for (auto iter = tree.Begin(); iter != tree.End(); ++iter) {
+    Row row;
+    KP.DeserializeToKey((*iter).first, row, schema);
+    ASSERT_EQ(CmpBool::kTrue, row.GetField(0)->CompareEquals(Field(TypeId::kTypeInt, expected)));
+    ASSERT_EQ(RowId(expected + n, 0), (*iter).second);
+    expected++;
+  }
+  ASSERT_EQ(n / 2, expected);
+  for (int i = 0; i < n; i += 2) {
+    GenericKey *key = MakeIntKey(KP, schema, values[i]);
+    tree.Remove(key);
+    free(key);
+  }
+  for (int i = 0; i < n; i++) {
+    GenericKey *key = MakeIntKey(KP, schema, values[i]);
+    std::vector<RowId> result;
+    ASSERT_EQ(i % 2 == 1, tree.GetValue(key, result));
+    if (i % 2 == 1) {
+      ASSERT_EQ(RowId(values[i] + n, 0), result[0]);
+    }
+    free(key);
+  }
+  ASSERT_TRUE(tree.Check());
+  tree.Destroy();
+}
+
+TEST(BPlusTreeTests, SpecializedKeyTest) {
+  DBStorageEngine engine("bp_tree_specialized_test.db");
+  std::vector<Column *> columns = {
+      new Column("int", TypeId::kTypeInt, 0, false, false),
+  };
+  Schema *schema = new Schema(columns);
+  CheckSpecializedTree<4, IntKeyComparator>(engine, 0, schema);
+  CheckSpecializedTree<16, FixedKeyComparator<16>>(engine, 1, schema);
+  CheckSpecializedTree<256, FixedKeyComparator<256>>(engine, 2, schema);
+  CheckSpecializedTree<0, KeyManager>(engine, 3, schema);
+  delete schema;
+}
+
+TEST(BPlusTreeTests, BulkLoadTest) {
+  DBStorageEngine engine("bp_tree_bulk_load_test.db");
+  std::vector<Column *> columns = {
+      new Column("int", TypeId::kTypeInt, 0, false, false),
+  };
+  Schema *table_schema = new Schema(columns);
+  KeyManager KP(table_schema, 16);
+  const int n = 30000;
+  std::vector<int> values;
+  for (int i = 0; i < n; i++) {
+    values.push_back(i);
+  }
+  ShuffleArray(values);
+  // one page of memory, so the entries are spilled to more runs than are merged at once
+  ExternalSorter sorter(engine.bpm_, KP, PAGE_SIZE);
+  for (int v : values) {
+    GenericKey *key = MakeIntKey(KP, table_schema, v);
+    sorter.Add(key, RowId(v, 0));
+    free(key);
+  }
+  sorter.Finish();
+  ASSERT_GT(sorter.GetSpilledRuns(), static_cast<size_t>(BULK_LOAD_MERGE_FAN_IN));
+  BPlusTree tree(0, engine.bpm_, KP, 16, 16);
+  ASSERT_TRUE(tree.BulkLoad(sorter, 0.7));
+  ASSERT_TRUE(tree.Check());
+  int expected = 0;
+  for (auto iter = tree.Begin(); iter != tree.End(); ++iter) {
+    ASSERT_EQ(RowId(expected, 0), (*iter).second);
+    expected++;
+  }
+  ASSERT_EQ(n, expected);
+  // the loaded tree keeps working under inserts and removes
+  for (int i = n; i < n + 1000; i++) {
+    GenericKey *key = MakeIntKey(KP, table_schema, i);
+    ASSERT_TRUE(tree.Insert(key, RowId(i, 0)));
+    free(key);
+  }
+  for (int i = 0; i < n; i += 2) {
+    GenericKey *key = MakeIntKey(KP, table_schema, values[i]);
+    tree.Remove(key);
+    free(key);
+  }
+  for (int i = 0; i < n; i++) {
+    GenericKey *key = MakeIntKey(KP, table_schema, values[i]);
+    std::vector<RowId> result;
+    ASSERT_EQ(i % 2 == 1, tree.GetValue(key, result));
+    free(key);
+  }
+  ASSERT_TRUE(tree.Check());
+  tree.Destroy();
+  // sorters filled by separate workers are absorbed in order, a duplicated key keeps the entry added first
+  const int distinct = 500;
+  ExternalSorter first(engine.bpm_, KP, PAGE_SIZE);
+  ExternalSorter second(engine.bpm_, KP, PAGE_SIZE);
+  ExternalSorter third(engine.bpm_, KP);
+  for (int i = 0; i < 4 * distinct; i++) {
+    GenericKey *key = MakeIntKey(KP, table_schema, i % distinct);
+    (i < 2 * distinct ? first : (i < 3 * distinct ? second : third)).Add(key, RowId(i % distinct, i / distinct));
+    free(key);
+  }
+  ExternalSorter dup_sorter(engine.bpm_, KP);
+  for (auto worker : {&first, &second, &third}) {
+    worker->Seal();
+    dup_sorter.Absorb(*worker);
+    ASSERT_EQ(0, worker->GetSize());
+  }
+  dup_sorter.Finish();
+  ASSERT_GT(dup_sorter.GetSpilledRuns(), 1);
+  ASSERT_EQ(distinct, dup_sorter.GetSize());
+  ASSERT_TRUE(tree.BulkLoad(dup_sorter));
+  expected = 0;
+  for (auto iter = tree.Begin(); iter != tree.End(); ++iter) {
+    ASSERT_EQ(RowId(expected, 0), (*iter).second);
+    expected++;
+  }
+  ASSERT_EQ(distinct, expected);
+  ASSERT_TRUE(tree.Check());
+  delete table_schema;
+}
+
+static int CountUsedPages(BufferPoolManager *bpm, page_id_t limit) {
+  int count = 0;
+  for (page_id_t page_id = 0; page_id < limit; page_id++) {
+    count += bpm->IsPageFree(page_id) ? 0 : 1;
+  }
+  return count;
+}
+
+TEST(BPlusTreeTests, CompressedKeyTest) {
+  using CharTree = BPlusTree<64, FixedKeyComparator<64>>;
+  DBStorageEngine engine("bp_tree_compressed_test.db");
+  std::vector<Column *> columns = {
+      new Column("url", TypeId::kTypeChar, 60, 0, false, false),
+  };
+  Schema *table_schema = new Schema(columns);
+  KeyManager KP(table_schema, 64);
+  // long keys sharing most of their bytes, the case compression is for
+  auto make_key = [&](int value) {
+    char url[64];
+    int len = snprintf(url, sizeof(url), "https://www.example.com/catalog/items/%08d", value);
+    std::vector<Field> fields{Field(TypeId::kTypeChar, url, static_cast<uint32_t>(len), true)};
+    GenericKey *key = KP.InitKey();
+    KP.SerializeFromKey(key, Row(fields), table_schema);
+    return key;
+  };
+  const int n = 20000;
+  const page_id_t page_limit = 4000;
+  std::vector<int> values;
+  for (int i = 0; i < n; i++) {
+    values.push_back(i);
+  }
+  ShuffleArray(values);
+  int pages[2];
+  for (int compress = 0; compress < 2; compress++) {
+    int used = CountUsedPages(engine.bpm_, page_limit);
+    CharTree tree(compress, engine.bpm_, KP, UNDEFINED_SIZE, UNDEFINED_SIZE, compress == 1, compress == 1);
+    for (int v : values) {
+      GenericKey *key = make_key(v);
+      ASSERT_TRUE(tree.Insert(key, RowId(v, 0)));
+      free(key);
+    }
+    pages[compress] = CountUsedPages(engine.bpm_, page_limit) - used;
+    for (int i = 0; i < n; i++) {
+      GenericKey *key = make_key(i);
+      std::vector<RowId> result;
+      ASSERT_TRUE(tree.GetValue(key, result));
+      ASSERT_EQ(RowId(i, 0), result[0]);
+      free(key);
+    }
+    int expected = 0;
+    for (auto iter = tree.Begin(); iter != tree.End(); ++iter) {
+      ASSERT_EQ(RowId(expected, 0), (*iter).second);
+      expected++;
+    }
+    ASSERT_EQ(n, expected);
+    for (int i = 0; i < n; i += 2) {
+      GenericKey *key = make_key(values[i]);
+      tree.Remove(key);
+      free(key);
+    }
+    for (int i = 0; i < n; i++) {
+      GenericKey *key = make_key(values[i]);
+      std::vector<RowId> result;
+      ASSERT_EQ(i % 2 == 1, tree.GetValue(key, result));
+      free(key);
+    }
+    ASSERT_TRUE(tree.Check());
+    tree.Destroy();
+  }
+  // suffixes of a few bytes pack twice the entries of full width slots into a page
+  ASSERT_LT(2 * pages[1], pages[0] + pages[0] / 4);
+  // a bulk load fills the compressed pages by the bytes they have left
+  ExternalSorter<64, FixedKeyComparator<64>> sorter(engine.bpm_, KP);
+  for (int v : values) {
+    GenericKey *key = make_key(v);
+    sorter.Add(key, RowId(v, 0));
+    free(key);
+  }
+  sorter.Finish();
+  int used = CountUsedPages(engine.bpm_, page_limit);
+  CharTree tree(2, engine.bpm_, KP, UNDEFINED_SIZE, UNDEFINED_SIZE, true, true);
+  ASSERT_TRUE(tree.BulkLoad(sorter, 1.0));
+  ASSERT_LT(CountUsedPages(engine.bpm_, page_limit) - used, pages[1]);
+  int expected = 0;
+  for (auto iter = tree.Begin(); iter != tree.End(); ++iter) {
+    ASSERT_EQ(RowId(expected, 0), (*iter).second);
+    expected++;
+  }
+  ASSERT_EQ(n, expected);
+  for (int i = n; i < n + 1000; i++) {
+    GenericKey *key = make_key(i);
+    ASSERT_TRUE(tree.Insert(key, RowId(i, 0)));
+    free(key);
+  }
+  for (int i = 0; i < n + 1000; i += 3) {
+    GenericKey *key = make_key(i);
+    tree.Remove(key);
+    free(key);
+  }
+  for (int i = 0; i < n + 1000; i++) {
+    GenericKey *key = make_key(i);
+    std::vector<RowId> result;
+    ASSERT_EQ(i % 3 != 0, tree.GetValue(key, result));
+    free(key);
+  }
+  ASSERT_TRUE(tree.Check());
+  tree.Destroy();
+  delete table_schema;
+}
+
+TEST(BPlusTreeTests, ConcurrentInsertLookupTest) {
+  DBStorageEngine engine("bp_tree_concurrent_test.db");
+  std::vector<Column *> columns = {
+      new Column("int", TypeId::kTypeInt, 0, false, false),
+  };
+  Schema *table_schema = new Schema(columns);
+  KeyManager KP(table_schema, 16);
+  // small nodes so that splits and merges happen all the time
+  BPlusTree tree(0, engine.bpm_, KP, 8, 8);
+  const int n = 20000;
+  const int thread_nums = 8;
+  std::vector<GenericKey *> keys;
+  for (int i = 0; i < n; i++) {
+    keys.push_back(MakeIntKey(KP, table_schema, i));
+  }
+  // each thread inserts its own keys in random order, and looks up what it has inserted so far
+  std::vector<std::thread> threads;
+  std::atomic<int> errors{0};
+  for (int t = 0; t < thread_nums; t++) {
+    threads.emplace_back([&, t]() {
+      std::vector<int> mine;
+      for (int i = t; i < n; i += thread_nums) mine.push_back(i);
+      ShuffleArray(mine);
+      for (size_t j = 0; j < mine.size(); j++) {
+        if (!tree.Insert(keys[mine[j]], RowId(mine[j]))) errors++;
+        std::vector<RowId> result;
+        int probe = mine[j / 2];
+        if (!tree.GetValue(keys[probe], result) || !(result[0] == RowId(probe))) errors++;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+  ASSERT_EQ(0, errors.load());
+  ASSERT_TRUE(tree.Check());
+  int expected = 0;
+  for (auto iter = tree.Begin(); iter != tree.End(); ++iter) {
+    ASSERT_EQ(RowId(expected), (*iter).second);
+    expected++;
+  }
+  ASSERT_EQ(n, expected);
+  // remove the even keys concurrently, while the odd keys stay visible
+  for (int t = 0; t < thread_nums; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = t * 2; i < n; i += thread_nums * 2) {
+        tree.Remove(keys[i]);
+        std::vector<RowId> result;
+        if (tree.GetValue(keys[i], result)) errors++;
+        if (!tree.GetValue(keys[i + 1], result) || !(result[0] == RowId(i + 1))) errors++;
+      }
+    });
+  }
+  // a concurrent scan sees the keys in order
+  threads.emplace_back([&]() {
+    int last = -1;
+    for (auto iter = tree.Begin(); iter != tree.End(); ++iter) {
+      int value = static_cast<int>((*iter).second.Get());
+      if (value <= last) errors++;
+      last = value;
+    }
+  });
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(0, errors.load());
+  ASSERT_TRUE(tree.Check());
+  expected = 1;
+  for (auto iter = tree.Begin(); iter != tree.End(); ++iter) {
+    ASSERT_EQ(RowId(expected), (*iter).second);
+    expected += 2;
+  }
+  ASSERT_EQ(n + 1, expected);
+  for (auto key : keys) {
+    free(key);
+  }
+}
+
+TEST(BPlusTreeTests, OptimisticLookupTest) {
+  DBStorageEngine engine("bp_tree_optimistic_test.db");
+  std::vector<Column *> columns = {
+      new Column("int", TypeId::kTypeInt, 0, false, false),
+  };
+  Schema *table_schema = new Schema(columns);
+  KeyManager KP(table_schema, 16);
+  BPlusTree tree(0, engine.bpm_, KP, 8, 8);
+  const int n = 8000;
+  std::vector<GenericKey *> keys;
+  for (int i = 0; i < n; i++) {
+    keys.push_back(MakeIntKey(KP, table_schema, i));
+  }
+  // the even keys stay in the tree, writers keep splitting and merging pages around them with the odd keys
+  for (int i = 0; i < n; i += 2) {
+    ASSERT_TRUE(tree.Insert(keys[i], RowId(i)));
+  }
+  std::atomic<bool> stop{false};
+  std::atomic<int> errors{0};
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 2; t++) {
+    writers.emplace_back([&, t]() {
+      for (int round = 0; round < 3; round++) {
+        for (int i = 1 + t * 2; i < n; i += 4) tree.Insert(keys[i], RowId(i));
+        for (int i = 1 + t * 2; i < n; i += 4) tree.Remove(keys[i]);
+      }
+    });
+  }
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&, t]() {
+      while (!stop) {
+        for (int i = t * 2; i < n; i += 8) {
+          std::vector<RowId> result;
+          if (!tree.GetValue(keys[i], result) || !(result[0] == RowId(i))) errors++;
+          // Begin(key) lands on the key itself, or on the next even key for an odd key that was removed
+          auto iter = tree.Begin(keys[i]);
+          if (iter == tree.End() || !((*iter).second == RowId(i))) errors++;
+        }
+      }
+    });
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  stop = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  ASSERT_EQ(0, errors.load());
+  ASSERT_TRUE(tree.Check());
+  int expected = 0;
+  for (auto iter = tree.Begin(); iter != tree.End(); ++iter) {
+    ASSERT_EQ(RowId(expected), (*iter).second);
+    expected += 2;
+  }
+  ASSERT_EQ(n, expected);
+  for (auto key : keys) {
+    free(key);
+  }
+}
+
+TEST(BPlusTreeTests, ConcurrentScalingBenchmark) {
+  DBStorageEngine engine("bp_tree_scaling_test.db");
+  std::vector<Column *> columns = {
+      new Column("int", TypeId::kTypeInt, 0, false, false),
+  };
+  Schema *table_schema = new Schema(columns);
+  KeyManager KP(table_schema, 16);
+  const int n = 40000;
+  std::vector<GenericKey *> keys;
+  for (int i = 0; i < n; i++) {
+    keys.push_back(MakeIntKey(KP, table_schema, i));
+  }
+  std::vector<int> order(n);
+  for (int i = 0; i < n; i++) order[i] = i;
+  ShuffleArray(order);
+  for (int thread_nums : {1, 2, 4, 8}) {
+    BPlusTree tree(thread_nums, engine.bpm_, KP);
+    auto run = [&](bool insert) {
+      auto start = std::chrono::steady_clock::now();
+      std::vector<std::thread> threads;
+      for (int t = 0; t < thread_nums; t++) {
+        threads.emplace_back([&, t]() {
+          std::vector<RowId> result;
+          for (int i = t; i < n; i += thread_nums) {
+            if (insert) {
+              tree.Insert(keys[order[i]], RowId(order[i]));
+            } else {
+              tree.GetValue(keys[order[i]], result);
+            }
+          }
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    double insert_time = run(true);
+    double lookup_time = run(false);
+    std::cout << "threads=" << thread_nums << " insert " << static_cast<int>(n / insert_time) << " ops/s, lookup "
+              << static_cast<int>(n / lookup_time) << " ops/s" << std::endl;
+    int count = 0;
+    for (auto iter = tree.Begin(); iter != tree.End(); ++iter) count++;
+    ASSERT_EQ(n, count);
+    tree.Destroy();
+  }
+  for (auto key : keys) {
+    free(key);
+  }
+}
+
+// int keys are searched in their own array with SIMD compares, the other key types by a binary search over the
+// interleaved entries. Times both in one page, then point lookups on whole trees of the two layouts
+TEST(BPlusTreeTests, IntKeySearchBenchmark) {
+  using IntLeaf = BPlusTreeLeafPage<4, IntKeyComparator>;
+  DBStorageEngine engine("bp_tree_int_search_test.db");
+  std::vector<Column *> columns = {
+      new Column("int", TypeId::kTypeInt, 0, false, false),
+  };
+  Schema *table_schema = new Schema(columns);
+  KeyManager KP(table_schema, 4);
+  // the search agrees with std::lower_bound and std::upper_bound, at any alignment and at the ends of the int range
+  std::vector<char> buf((IntLeaf::kIntCapacity + 1) * sizeof(int32_t));
+  for (int size : {0, 1, 2, 7, 8, 9, 31, 32, 33, 64, 100, IntLeaf::kIntCapacity}) {
+    std::vector<int32_t> sorted;
+    for (int i = 0; i < size; i++) {
+      sorted.push_back(i == 0 ? INT32_MIN : (i == size - 1 && size > 1 ? INT32_MAX : 3 * i - 100));
+    }
+    std::vector<int32_t> probes{INT32_MIN, INT32_MIN + 1, INT32_MAX - 1, INT32_MAX};
+    for (int32_t v : sorted) {
+      if (v != INT32_MIN && v != INT32_MAX) {
+        probes.insert(probes.end(), {v - 1, v, v + 1});
+      }
+    }
+    for (int offset = 0; offset < 4; offset++) {
+      memcpy(buf.data() + offset, sorted.data(), size * sizeof(int32_t));
+      for (int32_t probe : probes) {
+        ASSERT_EQ(std::lower_bound(sorted.begin(), sorted.end(), probe) - sorted.begin(),
+                  BPlusTreePage::SearchIntKeys(buf.data() + offset, size, probe, false));
+        ASSERT_EQ(std::upper_bound(sorted.begin(), sorted.end(), probe) - sorted.begin(),
+                  BPlusTreePage::SearchIntKeys(buf.data() + offset, size, probe, true));
+      }
+    }
+  }
+  // one full leaf of each layout
+  const int size = IntLeaf::kIntCapacity - 1;
+  const int searches = 2000000;
+  const int entry = sizeof(int32_t) + sizeof(RowId);
+  std::vector<char> keys(size * sizeof(int32_t));
+  std::vector<char> entries(size * entry);
+  for (int i = 0; i < size; i++) {
+    int32_t v = 2 * i;
+    memcpy(keys.data() + i * sizeof(int32_t), &v, sizeof(v));
+    memcpy(entries.data() + i * entry, &v, sizeof(v));
+  }
+  std::mt19937 rng(0);
+  std::vector<int32_t> probes(4096);
+  for (auto &probe : probes) {
+    probe = static_cast<int32_t>(rng() % (2 * size));
+  }
+  IntKeyComparator comparator(KP);
+  auto time = [&](auto &&search) {
+    int64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < searches; i++) {
+      checksum += search(probes[i % probes.size()]);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return std::make_pair(seconds * 1e9 / searches, checksum);
+  };
+  auto simd = time([&](int32_t probe) { return BPlusTreePage::SearchIntKeys(keys.data(), size, probe, false); });
+  auto binary = time([&](int32_t probe) {
+    int left = 0;
+    int right = size;
+    while (left < right) {
+      int mid = (left + right) / 2;
+      if (comparator.CompareKeys(reinterpret_cast<const GenericKey *>(entries.data() + mid * entry),
+                                 reinterpret_cast<const GenericKey *>(&probe)) < 0) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    return left;
+  });
+  ASSERT_EQ(binary.second, simd.second);
+  std::cout << "in-page search of " << size << " int keys: simd " << simd.first << " ns, binary " << binary.first
+            << " ns" << std::endl;
+  // point lookups, the generic tree keeps int keys interleaved with their values
+  const int n = 100000;
+  std::vector<int> values;
+  for (int i = 0; i < n; i++) {
+    values.push_back(i);
+  }
+  ShuffleArray(values);
+  std::vector<GenericKey *> tree_keys;
+  for (int v : values) {
+    tree_keys.push_back(MakeIntKey(KP, table_schema, v));
+  }
+  auto lookups = [&](auto &tree) {
+    for (int i = 0; i < n; i++) {
+      tree.Insert(tree_keys[i], RowId(values[i], 0));
+    }
+    std::vector<RowId> result;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < n; i++) {
+      result.clear();
+      EXPECT_TRUE(tree.GetValue(tree_keys[(i * 7919) % n], result));
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_TRUE(tree.Check());
+    tree.Destroy();
+    return static_cast<int>(n / seconds);
+  };
+  BPlusTree<4, IntKeyComparator> int_tree(0, engine.bpm_, KP);
+  BPlusTree<0, KeyManager> generic_tree(1, engine.bpm_, KP);
+  int int_ops = lookups(int_tree);
+  int generic_ops = lookups(generic_tree);
+  std::cout << "lookup " << n << " int keys: simd " << int_ops << " ops/s, binary " << generic_ops << " ops/s"
+            << std::endl;
+  for (auto key : tree_keys) {
+    free(key);
+  }
+  delete table_schema;
+}
@@ -3,8 +3,10 @@
 #include "common/instance.h"
 #include "gtest/gtest.h"
 #include "page/table_page.h"
+#include "record/compare_kernel.h"
 #include "record/field.h"
 #include "record/row.h"
+#include "record/row_view.h"
 #include "record/schema.h"
 
 char *chars[] = {const_cast<char *>(""), const_cast<char *>("hello"), const_cast<char *>("world!"),
@@ -93,11 +95,283 @@ TEST(TupleTest, RowTest) {
   ASSERT_EQ(row.GetRowId(), first_tuple_rid);
   Row row2(row.GetRowId());
   ASSERT_TRUE(table_page.GetTuple(&row2, schema.get(), nullptr, nullptr));
-  std::vector<Field *> &row2_fields = row2.GetFields();
+  std::vector<Field> &row2_fields = row2.GetFields();
   ASSERT_EQ(3, row2_fields.size());
   for (size_t i = 0; i < row2_fields.size(); i++) {
-    ASSERT_EQ(CmpBool::kTrue, row2_fields[i]->CompareEquals(fields[i]));
+    ASSERT_EQ(CmpBool::kTrue, row2_fields[i].CompareEquals(fields[i]));
   }
   ASSERT_TRUE(table_page.MarkDelete(row.GetRowId(), nullptr, nullptr, nullptr));
   table_page.ApplyDelete(row.GetRowId(), nullptr, nullptr);
-}
\ No newline at end of file
+}
+
+TEST(TupleTest, RowFormatTest) {
+  // more columns than a 32-bit null bitmap covers, CHAR and fixed-width columns interleaved
+  const uint32_t column_count = 40;
+  std::vector<Column *> columns;
+  std::vector<Field> fields;
+  char name[16];
+  for (uint32_t i = 0; i < column_count; i++) {
+    std::string column_name = "c" + std::to_string(i);
+    if (i % 3 == 1) {
+      columns.push_back(new Column(column_name, TypeId::kTypeChar, 16, i, true, false));
+      snprintf(name, sizeof(name), "value%u", i);
+      fields.emplace_back(TypeId::kTypeChar, name, strlen(name), true);
+    } else if (i % 3 == 2) {
+      columns.push_back(new Column(column_name, TypeId::kTypeFloat, i, true, false));
+      fields.emplace_back(TypeId::kTypeFloat, static_cast<float>(i) / 2);
+    } else {
+      columns.push_back(new Column(column_name, TypeId::kTypeInt, i, true, false));
+      fields.emplace_back(TypeId::kTypeInt, static_cast<int32_t>(i) * 7);
+    }
+  }
+  fields[34] = Field(TypeId::kTypeChar);
+  fields[36] = Field(TypeId::kTypeInt);
+  auto schema = std::make_shared<Schema>(columns);
+  Row row(fields);
+  char buffer[PAGE_SIZE];
+  uint32_t size = row.SerializeTo(buffer, schema.get());
+  ASSERT_EQ(row.GetSerializedSize(schema.get()), size);
+  Row read_row;
+  ASSERT_EQ(size, read_row.DeserializeFrom(buffer, schema.get()));
+  RowView view;
+  view.Reset(buffer, schema.get(), RowId(0, 0));
+  ASSERT_EQ(size, view.GetSerializedSize());
+  for (uint32_t i = 0; i < column_count; i++) {
+    ASSERT_EQ(fields[i].IsNull(), read_row.GetField(i)->IsNull());
+    ASSERT_EQ(fields[i].IsNull(), view.IsNull(i));
+    if (!fields[i].IsNull()) {
+      ASSERT_EQ(CmpBool::kTrue, read_row.GetField(i)->CompareEquals(fields[i]));
+      ASSERT_EQ(CmpBool::kTrue, view.GetField(i).CompareEquals(fields[i]));
+    }
+  }
+  // fixed-width values are found at the offsets of the schema
+  ASSERT_EQ(21 * 7, MACH_READ_INT32(buffer + schema->GetRowOffset(21)));
+  // a row of format v1 is still read
+  std::vector<Column *> v1_columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                      new Column("name", TypeId::kTypeChar, 64, 1, true, false),
+                                      new Column("account", TypeId::kTypeFloat, 2, true, false)};
+  auto v1_schema = std::make_shared<Schema>(v1_columns);
+  char *p = buffer;
+  MACH_WRITE_UINT32(p, 0x12345678);
+  MACH_WRITE_UINT32(p + 4, 3);
+  MACH_WRITE_UINT32(p + 8, 1u << 2);
+  MACH_WRITE_INT32(p + 12, 188);
+  MACH_WRITE_UINT32(p + 16, 5);
+  memcpy(p + 20, "hello", 5);
+  Row v1_row;
+  ASSERT_EQ(25, v1_row.DeserializeFrom(buffer, v1_schema.get()));
+  view.Reset(buffer, v1_schema.get(), RowId(0, 0));
+  ASSERT_EQ(25, view.GetSerializedSize());
+  Field expected[] = {Field(TypeId::kTypeInt, 188), Field(TypeId::kTypeChar, const_cast<char *>("hello"), 5, false)};
+  for (uint32_t i = 0; i < 2; i++) {
+    ASSERT_EQ(CmpBool::kTrue, v1_row.GetField(i)->CompareEquals(expected[i]));
+    ASSERT_EQ(CmpBool::kTrue, view.GetField(i).CompareEquals(expected[i]));
+  }
+  ASSERT_TRUE(v1_row.GetField(2)->IsNull());
+  ASSERT_TRUE(view.IsNull(2));
+  // external values keep their mark in the offset table
+  char pointer[Row::SIZE_EXTERNAL_POINTER] = {};
+  std::vector<Field> external_fields = {Field(TypeId::kTypeInt, 1),
+                                        Field(TypeId::kTypeChar, pointer, Row::SIZE_EXTERNAL_POINTER, true),
+                                        Field(TypeId::kTypeFloat, 1.5f)};
+  Row external_row(external_fields);
+  external_row.SetExternal(1, true);
+  external_row.SerializeTo(buffer, v1_schema.get());
+  Row read_external;
+  read_external.DeserializeFrom(buffer, v1_schema.get());
+  ASSERT_TRUE(read_external.IsExternal(1));
+  ASSERT_FALSE(read_external.IsExternal(0));
+  view.Reset(buffer, v1_schema.get(), RowId(0, 0));
+  ASSERT_TRUE(view.IsExternal(1));
+  ASSERT_EQ(CmpBool::kTrue, view.GetField(2).CompareEquals(external_fields[2]));
+}
+
+TEST(TupleTest, CompareKernelTest) {
+  // every kernel agrees with the generic Field comparison, NULL included
+  auto check = [](Field *fields, int n, const Field &null_field) {
+    const char *ops[] = {"=", "<>", "<", "<=", ">", ">="};
+    for (auto op : ops) {
+      CompareKernel kernel = CompareKernels::Get(fields[0].GetTypeId(), CompareKernels::ParseOp(op));
+      ASSERT_NE(nullptr, kernel);
+      for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+          CmpBool expected;
+          switch (CompareKernels::ParseOp(op)) {
+            case CompareOp::kEqual:
+              expected = fields[i].CompareEquals(fields[j]);
+              break;
+            case CompareOp::kNotEqual:
+              expected = fields[i].CompareNotEquals(fields[j]);
+              break;
+            case CompareOp::kLessThan:
+              expected = fields[i].CompareLessThan(fields[j]);
+              break;
+            case CompareOp::kLessThanEquals:
+              expected = fields[i].CompareLessThanEquals(fields[j]);
+              break;
+            case CompareOp::kGreaterThan:
+              expected = fields[i].CompareGreaterThan(fields[j]);
+              break;
+            default:
+              expected = fields[i].CompareGreaterThanEquals(fields[j]);
+              break;
+          }
+          ASSERT_EQ(expected, kernel(fields[i], fields[j]));
+        }
+        ASSERT_EQ(CmpBool::kNull, kernel(fields[i], null_field));
+        ASSERT_EQ(CmpBool::kNull, kernel(null_field, fields[i]));
+      }
+    }
+    ASSERT_EQ(CmpBool::kTrue, CompareKernels::Get(fields[0].GetTypeId(), CompareOp::kIsNull)(null_field, null_field));
+    ASSERT_EQ(CmpBool::kFalse, CompareKernels::Get(fields[0].GetTypeId(), CompareOp::kIsNull)(fields[0], null_field));
+    ASSERT_EQ(CmpBool::kTrue, CompareKernels::Get(fields[0].GetTypeId(), CompareOp::kIsNotNull)(fields[0], null_field));
+  };
+  check(int_fields, 5, null_fields[0]);
+  check(float_fields, 4, null_fields[1]);
+  check(char_fields, 4, null_fields[2]);
+  ASSERT_THROW(CompareKernels::ParseOp("=="), std::logic_error);
+  ASSERT_TRUE(CompareKernels::IsTrue(Field(kTypeInt, 1)));
+  ASSERT_FALSE(CompareKernels::IsTrue(Field(kTypeInt, 0)));
+  ASSERT_FALSE(CompareKernels::IsTrue(Field(kTypeInt)));
+  ASSERT_FALSE(CompareKernels::IsTrue(CompareKernels::ToField(CmpBool::kNull)));
+  ASSERT_EQ(CmpBool::kNull, CompareKernels::ToCmpBool(CompareKernels::ToField(CmpBool::kNull)));
+}
+
+TEST(TupleTest, RowViewTest) {
+  TablePage table_page;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 64, 1, true, false),
+                                   new Column("account", TypeId::kTypeFloat, 2, true, false)};
+  std::vector<Field> fields = {Field(TypeId::kTypeInt, 188), Field(TypeId::kTypeChar),
+                               Field(TypeId::kTypeFloat, 19.99f)};
+  std::vector<Field> fields2 = {Field(TypeId::kTypeInt, -7),
+                                Field(TypeId::kTypeChar, const_cast<char *>("minisql"), strlen("minisql"), false),
+                                Field(TypeId::kTypeFloat, 0.5f)};
+  auto schema = std::make_shared<Schema>(columns);
+  Row row(fields);
+  Row row2(fields2);
+  table_page.Init(0, INVALID_PAGE_ID, nullptr, nullptr);
+  ASSERT_TRUE(table_page.InsertTuple(row, schema.get(), nullptr, nullptr, nullptr));
+  ASSERT_TRUE(table_page.InsertTuple(row2, schema.get(), nullptr, nullptr, nullptr));
+  RowView view;
+  ASSERT_TRUE(table_page.GetTupleView(1, schema.get(), &view));
+  ASSERT_EQ(row2.GetRowId(), view.GetRowId());
+  ASSERT_EQ(row2.GetSerializedSize(schema.get()), view.GetSerializedSize());
+  for (uint32_t i = 0; i < 3; i++) {
+    ASSERT_EQ(CmpBool::kTrue, view.GetField(i).CompareEquals(fields2[i]));
+  }
+  // CHAR fields of a view point into the page instead of being copied
+  Field name = view.GetField(1);
+  ASSERT_TRUE(name.GetData() > table_page.GetData() && name.GetData() < table_page.GetData() + PAGE_SIZE);
+  // null fields survive the view, and projection keeps the requested columns only
+  ASSERT_TRUE(table_page.GetTupleView(0, schema.get(), &view));
+  ASSERT_TRUE(view.IsNull(1));
+  ASSERT_TRUE(view.GetField(1).IsNull());
+  Row projected;
+  view.ToRow({2, 0}, &projected);
+  ASSERT_EQ(2, projected.GetFieldCount());
+  ASSERT_EQ(CmpBool::kTrue, projected.GetField(0)->CompareEquals(fields[2]));
+  ASSERT_EQ(CmpBool::kTrue, projected.GetField(1)->CompareEquals(fields[0]));
+  Row materialized;
+  view.ToRow(&materialized);
+  ASSERT_EQ(row.GetRowId(), materialized.GetRowId());
+  ASSERT_EQ(3, materialized.GetFieldCount());
+  ASSERT_TRUE(materialized.GetField(1)->IsNull());
+  ASSERT_FALSE(table_page.GetTupleView(2, schema.get(), &view));
+}
+
+TEST(TupleTest, ArenaRowTest) {
+  TablePage table_page;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 64, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  std::vector<Field> fields = {Field(TypeId::kTypeInt, 42),
+                               Field(TypeId::kTypeChar, const_cast<char *>("minisql"), strlen("minisql"), false)};
+  Row row(fields);
+  table_page.Init(0, INVALID_PAGE_ID, nullptr, nullptr);
+  ASSERT_TRUE(table_page.InsertTuple(row, schema.get(), nullptr, nullptr, nullptr));
+  RowView view;
+  ASSERT_TRUE(table_page.GetTupleView(0, schema.get(), &view));
+  // CHAR data is copied into the arena, INT stays inline in the field
+  Arena arena;
+  // an empty value taken first still gets a valid pointer
+  ASSERT_NE(nullptr, Arena().Allocate(0));
+  Row materialized;
+  view.ToRow(&materialized, &arena);
+  ASSERT_GT(arena.GetMemoryUsage(), 0);
+  const char *name_data = materialized.GetField(1)->GetData();
+  ASSERT_FALSE(name_data >= table_page.GetData() && name_data < table_page.GetData() + PAGE_SIZE);
+  for (uint32_t i = 0; i < 2; i++) {
+    ASSERT_EQ(CmpBool::kTrue, materialized.GetField(i)->CompareEquals(fields[i]));
+  }
+  // moving a row hands over its fields without copying the arena data
+  std::vector<Row> rows;
+  rows.push_back(std::move(materialized));
+  ASSERT_EQ(0, materialized.GetFieldCount());
+  ASSERT_EQ(2, rows[0].GetFieldCount());
+  ASSERT_EQ(name_data, rows[0].GetField(1)->GetData());
+  ASSERT_EQ(row.GetRowId(), rows[0].GetRowId());
+  // large allocations get their own block
+  char *large = arena.Allocate(ARENA_BLOCK_SIZE);
+  ASSERT_NE(nullptr, large);
+  ASSERT_GE(arena.GetMemoryUsage(), ARENA_BLOCK_SIZE);
+  arena.Reset();
+  ASSERT_EQ(0, arena.GetMemoryUsage());
+  // rewinding keeps one block and fills it again from its start, a row copied into another arena is not affected
+  view.ToRow(&materialized, &arena);
+  name_data = materialized.GetField(1)->GetData();
+  Arena kept;
+  Row copied(materialized);
+  copied.CopyCharsInto(&kept);
+  ASSERT_NE(name_data, copied.GetField(1)->GetData());
+  arena.Allocate(ARENA_BLOCK_SIZE);
+  arena.Rewind();
+  ASSERT_EQ(ARENA_BLOCK_SIZE, arena.GetMemoryUsage());
+  char *reused = arena.Allocate(strlen("minisql"));
+  ASSERT_EQ(name_data, reused);
+  memset(reused, 0, strlen("minisql"));
+  ASSERT_EQ(CmpBool::kTrue, copied.GetField(1)->CompareEquals(fields[1]));
+}
+
+TEST(TupleTest, TablePageCompactTest) {
+  TablePage table_page;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 256, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  char name[200];
+  memset(name, 'a', sizeof(name));
+  table_page.Init(0, INVALID_PAGE_ID, nullptr, nullptr);
+  // fill the page
+  std::vector<RowId> rids;
+  while (true) {
+    std::vector<Field> fields = {Field(TypeId::kTypeInt, static_cast<int32_t>(rids.size())),
+                                 Field(TypeId::kTypeChar, name, sizeof(name), false)};
+    Row row(fields);
+    if (!table_page.InsertTuple(row, schema.get(), nullptr, nullptr, nullptr)) {
+      break;
+    }
+    rids.push_back(row.GetRowId());
+  }
+  ASSERT_GT(rids.size(), 4);
+  // delete every other tuple, the holes are only usable after compaction
+  for (size_t i = 0; i + 1 < rids.size(); i += 2) {
+    ASSERT_TRUE(table_page.MarkDelete(rids[i], nullptr, nullptr, nullptr));
+    table_page.ApplyDelete(rids[i], nullptr, nullptr);
+  }
+  // a tuple twice as large only fits after the page is compacted, and reuses the first deleted slot
+  char long_name[250];
+  memset(long_name, 'b', sizeof(long_name));
+  std::vector<Field> fields = {Field(TypeId::kTypeInt, -1), Field(TypeId::kTypeChar, long_name, sizeof(long_name), false)};
+  Row row(fields);
+  ASSERT_TRUE(table_page.InsertTuple(row, schema.get(), nullptr, nullptr, nullptr));
+  ASSERT_EQ(rids[0], row.GetRowId());
+  // surviving tuples keep their row ids and contents
+  for (size_t i = 1; i < rids.size(); i += 2) {
+    Row read_row(rids[i]);
+    ASSERT_TRUE(table_page.GetTuple(&read_row, schema.get(), nullptr, nullptr));
+    ASSERT_EQ(CmpBool::kTrue, read_row.GetField(0)->CompareEquals(Field(TypeId::kTypeInt, static_cast<int32_t>(i))));
+  }
+  Row read_row(row.GetRowId());
+  ASSERT_TRUE(table_page.GetTuple(&read_row, schema.get(), nullptr, nullptr));
+  ASSERT_EQ(CmpBool::kTrue, read_row.GetField(1)->CompareEquals(fields[1]));
+}
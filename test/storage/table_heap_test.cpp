@@ -1,6 +1,9 @@
 #include "storage/table_heap.h"
 
+#include <algorithm>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "common/instance.h"
@@ -95,3 +98,752 @@ TEST(TableHeapTest, TableHeapSampleTest) {
   ASSERT_EQ(tot_size, 0);
   ASSERT_TRUE(bpm_->CheckAllUnpinned());
 }
+
+TEST(TableHeapTest, BatchInsertTest) {
+  auto disk_mgr_ = new DiskManager("table_heap_batch_test.db");
+  auto bpm_ = new BufferPoolManager(DEFAULT_BUFFER_POOL_SIZE, disk_mgr_);
+  const int row_nums = 10000;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 64, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  TableHeap *table_heap = TableHeap::Create(bpm_, schema.get(), nullptr, nullptr, nullptr);
+  // a few single inserts first so that the batch starts on a partly filled page
+  for (int i = 0; i < 10; i++) {
+    Fields fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeChar, const_cast<char *>("single"), 6, true)};
+    Row row(fields);
+    ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+  }
+  std::vector<Row> rows;
+  for (int i = 10; i < row_nums; i++) {
+    Fields fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeChar, const_cast<char *>("batch"), 5, true)};
+    rows.emplace_back(fields);
+  }
+  ASSERT_TRUE(table_heap->InsertTuples(rows, nullptr));
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  for (auto &row : rows) {
+    Row fetched(row.GetRowId());
+    ASSERT_TRUE(table_heap->GetTuple(&fetched, nullptr));
+    ASSERT_EQ(CmpBool::kTrue, fetched.GetField(0)->CompareEquals(*row.GetField(0)));
+  }
+  int count = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); iter++) {
+    ASSERT_EQ(CmpBool::kTrue, iter->GetField(0)->CompareEquals(Field(TypeId::kTypeInt, count)));
+    count++;
+  }
+  ASSERT_EQ(row_nums, count);
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+}
+
+TEST(TableHeapTest, ConcurrentInsertTest) {
+  auto disk_mgr_ = new DiskManager("table_heap_concurrent_test.db");
+  auto bpm_ = new BufferPoolManager(DEFAULT_BUFFER_POOL_SIZE, disk_mgr_);
+  const int thread_nums = 4;
+  const int row_nums = 5000;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 64, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  TableHeap *table_heap = TableHeap::Create(bpm_, schema.get(), nullptr, nullptr, nullptr);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_nums; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < row_nums; i++) {
+        Fields fields{Field(TypeId::kTypeInt, t * row_nums + i),
+                      Field(TypeId::kTypeChar, const_cast<char *>("concurrent"), 10, true)};
+        Row row(fields);
+        ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  // every row is visible exactly once, and every page was filled by a single session
+  std::unordered_set<int> ids;
+  std::unordered_map<page_id_t, int> page_owner;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); iter++) {
+    int id = std::stoi(iter->GetField(0)->toString());
+    ASSERT_TRUE(ids.insert(id).second);
+    auto owner = page_owner.emplace(iter->GetRowId().GetPageId(), id / row_nums).first;
+    ASSERT_EQ(id / row_nums, owner->second);
+  }
+  ASSERT_EQ(thread_nums * row_nums, ids.size());
+}
+
+TEST(TableHeapTest, VacuumTest) {
+  auto disk_mgr_ = new DiskManager("table_heap_vacuum_test.db");
+  auto bpm_ = new BufferPoolManager(DEFAULT_BUFFER_POOL_SIZE, disk_mgr_);
+  const int row_nums = 2000;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 64, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  TableHeap *table_heap = TableHeap::Create(bpm_, schema.get(), nullptr, nullptr, nullptr);
+  std::vector<Row> rows;
+  for (int i = 0; i < row_nums; i++) {
+    Fields fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeChar, const_cast<char *>("vacuum"), 6, true)};
+    rows.emplace_back(fields);
+  }
+  ASSERT_TRUE(table_heap->InsertTuples(rows, nullptr));
+  auto count_pages = [&]() {
+    int pages = 0;
+    for (page_id_t page_id = table_heap->GetFirstPageId(); page_id != INVALID_PAGE_ID; pages++) {
+      auto page = reinterpret_cast<TablePage *>(bpm_->FetchPage(page_id));
+      page_id_t next_page_id = page->GetNextPageId();
+      bpm_->UnpinPage(page_id, false);
+      page_id = next_page_id;
+    }
+    return pages;
+  };
+  int pages_before = count_pages();
+  // keep one row out of ten, the rows of whole pages vanish and the others are sparse
+  std::unordered_map<int64_t, int> survivors;
+  for (int i = 0; i < row_nums; i++) {
+    if (i % 10 == 0) {
+      survivors.emplace(rows[i].GetRowId().Get(), i);
+      continue;
+    }
+    ASSERT_TRUE(table_heap->MarkDelete(rows[i].GetRowId(), nullptr));
+    table_heap->ApplyDelete(rows[i].GetRowId(), nullptr);
+  }
+  table_heap->ReleaseInsertPage();
+  std::vector<std::pair<RowId, RowId>> moved_rows;
+  uint32_t freed_pages = table_heap->Vacuum(true, &moved_rows, nullptr);
+  ASSERT_GT(freed_pages, 0);
+  ASSERT_EQ(pages_before - static_cast<int>(freed_pages), count_pages());
+  ASSERT_EQ(count_pages(), static_cast<int>(table_heap->GetPageCount()));
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  for (auto &moved_row : moved_rows) {
+    auto iter = survivors.find(moved_row.first.Get());
+    ASSERT_TRUE(iter != survivors.end());
+    int id = iter->second;
+    survivors.erase(iter);
+    survivors.emplace(moved_row.second.Get(), id);
+  }
+  // every surviving row is found at its (possibly new) row id, and nothing else is left
+  for (auto &survivor : survivors) {
+    Row row{RowId(survivor.first)};
+    ASSERT_TRUE(table_heap->GetTuple(&row, nullptr));
+    ASSERT_EQ(CmpBool::kTrue, row.GetField(0)->CompareEquals(Field(TypeId::kTypeInt, survivor.second)));
+  }
+  size_t count = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); iter++) {
+    count++;
+  }
+  ASSERT_EQ(survivors.size(), count);
+}
+
+TEST(TableHeapTest, PageDirectoryTest) {
+  auto disk_mgr_ = new DiskManager("table_heap_directory_test.db");
+  auto bpm_ = new BufferPoolManager(DEFAULT_BUFFER_POOL_SIZE, disk_mgr_);
+  // large rows, so that the table spans more pages than one directory page holds
+  const int row_nums = 6000;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 900, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  TableHeap *table_heap = TableHeap::Create(bpm_, schema.get(), nullptr, nullptr, nullptr);
+  std::string name(900, 'd');
+  std::vector<Row> rows;
+  for (int i = 0; i < row_nums; i++) {
+    Fields fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), 900, true)};
+    rows.emplace_back(fields);
+  }
+  ASSERT_TRUE(table_heap->InsertTuples(rows, nullptr));
+  // the directory lists the pages in page chain order
+  uint32_t page_count = table_heap->GetPageCount();
+  ASSERT_GT(page_count, HeapDirectoryPage::SIZE_MAX_ENTRY);
+  uint32_t index = 0;
+  for (page_id_t page_id = table_heap->GetFirstPageId(); page_id != INVALID_PAGE_ID; index++) {
+    ASSERT_EQ(page_id, table_heap->GetPageId(index));
+    auto page = reinterpret_cast<TablePage *>(bpm_->FetchPage(page_id));
+    page_id_t next_page_id = page->GetNextPageId();
+    bpm_->UnpinPage(page_id, false);
+    page_id = next_page_id;
+  }
+  ASSERT_EQ(page_count, index);
+  ASSERT_EQ(INVALID_PAGE_ID, table_heap->GetPageId(page_count));
+  // a table stored without a directory gets it rebuilt from the page chain
+  TableHeap *rebuilt_heap = TableHeap::Create(bpm_, table_heap->GetFirstPageId(), table_heap->GetFreeSpaceMapPageId(),
+                                              INVALID_PAGE_ID, schema.get(), nullptr, nullptr);
+  ASSERT_NE(INVALID_PAGE_ID, rebuilt_heap->GetHeapDirectoryPageId());
+  ASSERT_EQ(page_count, rebuilt_heap->GetPageCount());
+  for (uint32_t i = 0; i < page_count; i++) {
+    ASSERT_EQ(table_heap->GetPageId(i), rebuilt_heap->GetPageId(i));
+  }
+  delete rebuilt_heap;
+  // partitioned parallel scan, each thread scans its own range of pages
+  const int thread_nums = 4;
+  std::vector<std::vector<int>> scanned(thread_nums);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_nums; t++) {
+    threads.emplace_back([&, t]() {
+      std::vector<page_id_t> page_ids;
+      table_heap->GetPageIds(page_count * t / thread_nums, page_count * (t + 1) / thread_nums, &page_ids);
+      for (auto page_id : page_ids) {
+        auto page = reinterpret_cast<TablePage *>(bpm_->FetchPage(page_id));
+        page->RLatch();
+        RowId rid;
+        for (bool found = page->GetFirstTupleRid(&rid); found; found = page->GetNextTupleRid(rid, &rid)) {
+          Row row(rid);
+          page->GetTuple(&row, schema.get(), nullptr, nullptr);
+          scanned[t].push_back(std::stoi(row.GetField(0)->toString()));
+        }
+        page->RUnlatch();
+        bpm_->UnpinPage(page_id, false);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::vector<bool> seen(row_nums, false);
+  for (auto &ids : scanned) {
+    for (auto id : ids) {
+      ASSERT_FALSE(seen[id]);
+      seen[id] = true;
+    }
+  }
+  ASSERT_EQ(std::count(seen.begin(), seen.end(), true), row_nums);
+  ASSERT_EQ(static_cast<uint32_t>(row_nums), table_heap->EstimateTupleCount(page_count));
+  // after deleting the second half of the rows, vacuum drops their pages from the directory as well
+  for (int i = row_nums / 2; i < row_nums; i++) {
+    ASSERT_TRUE(table_heap->MarkDelete(rows[i].GetRowId(), nullptr));
+    table_heap->ApplyDelete(rows[i].GetRowId(), nullptr);
+  }
+  table_heap->ReleaseInsertPage();
+  uint32_t freed_pages = table_heap->Vacuum(false, nullptr, nullptr);
+  ASSERT_EQ(page_count - freed_pages, table_heap->GetPageCount());
+  ASSERT_LE(table_heap->GetPageCount(), HeapDirectoryPage::SIZE_MAX_ENTRY);
+  std::vector<page_id_t> page_ids;
+  table_heap->GetPageIds(0, table_heap->GetPageCount(), &page_ids);
+  ASSERT_EQ(table_heap->GetFirstPageId(), page_ids.front());
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+}
+
+TEST(TableHeapTest, PageIteratorTest) {
+  auto disk_mgr_ = new DiskManager("table_heap_iterator_test.db");
+  auto bpm_ = new BufferPoolManager(DEFAULT_BUFFER_POOL_SIZE, disk_mgr_);
+  const int row_nums = 3000;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 64, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  TableHeap *table_heap = TableHeap::Create(bpm_, schema.get(), nullptr, nullptr, nullptr);
+  std::vector<Row> rows;
+  for (int i = 0; i < row_nums; i++) {
+    Fields fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeChar, const_cast<char *>("iter"), 4, true)};
+    rows.emplace_back(fields);
+  }
+  ASSERT_TRUE(table_heap->InsertTuples(rows, nullptr));
+  table_heap->ReleaseInsertPage();
+  auto end = table_heap->End();
+  // an iterator owns one pin, copies and assigned iterators own their own
+  {
+    auto iter = table_heap->Begin(nullptr);
+    page_id_t first_page_id = iter->GetRowId().GetPageId();
+    auto page = bpm_->FetchPage(first_page_id);
+    ASSERT_EQ(2, page->GetPinCount());
+    auto copy = iter;
+    auto assigned = table_heap->End();
+    assigned = copy;
+    ASSERT_EQ(4, page->GetPinCount());
+    iter.NextPage();
+    ASSERT_NE(first_page_id, iter->GetRowId().GetPageId());
+    ASSERT_EQ(3, page->GetPinCount());
+    ASSERT_EQ(0, std::stoi(copy->GetField(0)->toString()));
+    bpm_->UnpinPage(first_page_id, false);
+  }
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  // batch scan, page by page
+  int count = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != end; iter.NextPage()) {
+    for (auto &view : iter.GetPageRows()) {
+      ASSERT_EQ(CmpBool::kTrue, view.GetField(0).CompareEquals(Field(TypeId::kTypeInt, count)));
+      count++;
+    }
+  }
+  ASSERT_EQ(row_nums, count);
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  // tuples moved by an update in the current page are decoded again
+  count = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != end; ++iter) {
+    int id = std::stoi(iter->GetField(0)->toString());
+    ASSERT_EQ(count, id);
+    if (id % 7 == 0) {
+      Fields fields{Field(TypeId::kTypeInt, id), Field(TypeId::kTypeChar, const_cast<char *>("i"), 1, true)};
+      Row new_row(fields);
+      Row old_row(iter->GetRowId());
+      auto page = reinterpret_cast<TablePage *>(bpm_->FetchPage(iter->GetRowId().GetPageId()));
+      ASSERT_TRUE(page->UpdateTuple(new_row, &old_row, schema.get(), nullptr, nullptr, nullptr));
+      bpm_->UnpinPage(page->GetTablePageId(), true);
+    }
+    count++;
+  }
+  ASSERT_EQ(row_nums, count);
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+}
+
+TEST(TableHeapTest, ZoneMapTest) {
+  auto disk_mgr_ = new DiskManager("table_heap_zone_map_test.db");
+  auto bpm_ = new BufferPoolManager(DEFAULT_BUFFER_POOL_SIZE, disk_mgr_);
+  const int row_nums = 3000;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 64, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  TableHeap *table_heap = TableHeap::Create(bpm_, schema.get(), nullptr, nullptr, nullptr);
+  std::vector<Row> rows;
+  for (int i = 0; i < row_nums; i++) {
+    Fields fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeChar, const_cast<char *>("zone"), 4, true)};
+    rows.emplace_back(fields);
+  }
+  ASSERT_TRUE(table_heap->InsertTuples(rows, nullptr));
+  table_heap->ReleaseInsertPage();
+  auto zone_map = table_heap->GetZoneMap();
+  uint32_t page_count = table_heap->GetPageCount();
+  ASSERT_GT(page_count, 2);
+  Field bound(TypeId::kTypeInt, row_nums - 10);
+  // ids are appended in order, so only the last page can hold id > row_nums - 10
+  uint32_t may_match = 0;
+  for (uint32_t i = 0; i < page_count; i++) {
+    if (zone_map->MayMatch(table_heap->GetPageId(i), 0, ">", bound)) may_match++;
+  }
+  ASSERT_EQ(1, may_match);
+  ASSERT_TRUE(zone_map->MayMatch(table_heap->GetPageId(0), 0, "<", bound));
+  ASSERT_FALSE(zone_map->MayMatch(table_heap->GetPageId(0), 0, "is", bound));
+  ASSERT_TRUE(zone_map->MayMatch(table_heap->GetPageId(0), 1, "=", bound));
+  // a filtered scan only visits pages accepted by the filter
+  int count = 0;
+  auto filter = [&](page_id_t page_id) { return zone_map->MayMatch(page_id, 0, ">=", bound); };
+  for (auto iter = table_heap->Begin(nullptr, filter); iter != table_heap->End(); ++iter) {
+    if (std::stoi(iter->GetField(0)->toString()) >= row_nums - 10) count++;
+  }
+  ASSERT_EQ(10, count);
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  // a page emptied by deletes drops its zone
+  page_id_t first_page_id = table_heap->GetPageId(0);
+  std::vector<RowId> rids;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); ++iter) {
+    if (iter->GetRowId().GetPageId() != first_page_id) break;
+    rids.push_back(iter->GetRowId());
+  }
+  for (auto &rid : rids) {
+    table_heap->ApplyDelete(rid, nullptr);
+  }
+  ASSERT_FALSE(zone_map->MayMatch(first_page_id, 0, "<", bound));
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  // a heap opened from disk has no zones until the first filtered scan builds them
+  TableHeap *opened_heap =
+      TableHeap::Create(bpm_, table_heap->GetFirstPageId(), table_heap->GetFreeSpaceMapPageId(),
+                        table_heap->GetHeapDirectoryPageId(), schema.get(), nullptr, nullptr);
+  auto opened_zone_map = opened_heap->GetZoneMap();
+  ASSERT_TRUE(opened_zone_map->MayMatch(table_heap->GetPageId(1), 0, ">=", bound));
+  count = 0;
+  uint32_t visited_pages = 0;
+  auto opened_filter = [&](page_id_t page_id) {
+    bool may_match = opened_zone_map->MayMatch(page_id, 0, ">=", bound);
+    visited_pages += may_match;
+    return may_match;
+  };
+  for (auto iter = opened_heap->Begin(nullptr, opened_filter); iter != opened_heap->End(); ++iter) {
+    if (std::stoi(iter->GetField(0)->toString()) >= row_nums - 10) count++;
+  }
+  ASSERT_EQ(10, count);
+  ASSERT_EQ(1, visited_pages);
+  ASSERT_FALSE(opened_zone_map->MayMatch(first_page_id, 0, "<", bound));
+  ASSERT_FALSE(opened_zone_map->MayMatch(table_heap->GetPageId(1), 0, ">=", bound));
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  delete opened_heap;
+  delete table_heap;
+  delete bpm_;
+  delete disk_mgr_;
+}
+
+TEST(TableHeapTest, PaxLayoutTest) {
+  auto disk_mgr_ = new DiskManager("table_heap_pax_test.db");
+  auto bpm_ = new BufferPoolManager(DEFAULT_BUFFER_POOL_SIZE, disk_mgr_);
+  const int row_nums = 2000;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 16, 1, true, false),
+                                   new Column("account", TypeId::kTypeFloat, 2, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  uint32_t capacity = TablePage::GetPaxCapacity(schema.get());
+  ASSERT_EQ((PAGE_SIZE - 24) / (8 + 4 + 20 + 4), capacity);
+  TableHeap *table_heap =
+      TableHeap::Create(bpm_, schema.get(), nullptr, nullptr, nullptr, TableLayout::kPax);
+  std::vector<Row> rows;
+  for (int i = 0; i < row_nums; i++) {
+    Fields fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeChar, const_cast<char *>("pax"), 3, true),
+                  i % 3 == 0 ? Field(TypeId::kTypeFloat) : Field(TypeId::kTypeFloat, 0.5f * i)};
+    rows.emplace_back(fields);
+  }
+  ASSERT_TRUE(table_heap->InsertTuples(rows, nullptr));
+  table_heap->ReleaseInsertPage();
+  // pages are filled up to their capacity
+  ASSERT_EQ((row_nums + capacity - 1) / capacity, table_heap->GetPageCount());
+  // a CHAR value longer than its column cannot be stored
+  Fields long_fields{Field(TypeId::kTypeInt, -1),
+                     Field(TypeId::kTypeChar, const_cast<char *>("longer than sixteen"), 19, true),
+                     Field(TypeId::kTypeFloat, 0.0f)};
+  Row long_row(long_fields);
+  ASSERT_FALSE(table_heap->InsertTuple(long_row, nullptr));
+  // views decode the fields from the column minipages
+  int count = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); iter.NextPage()) {
+    for (auto &view : iter.GetPageRows()) {
+      ASSERT_EQ(CmpBool::kTrue, view.GetField(0).CompareEquals(Field(TypeId::kTypeInt, count)));
+      ASSERT_EQ(count % 3 == 0, view.IsNull(2));
+      count++;
+    }
+  }
+  ASSERT_EQ(row_nums, count);
+  // get, update in place, delete and reuse the slot
+  Row row(rows[7].GetRowId());
+  ASSERT_TRUE(table_heap->GetTuple(&row, nullptr));
+  ASSERT_EQ(CmpBool::kTrue, row.GetField(2)->CompareEquals(Field(TypeId::kTypeFloat, 3.5f)));
+  Fields new_fields{Field(TypeId::kTypeInt, 7), Field(TypeId::kTypeChar, const_cast<char *>("updated"), 7, true),
+                    Field(TypeId::kTypeFloat)};
+  Row new_row(new_fields);
+  auto page = reinterpret_cast<TablePage *>(bpm_->FetchPage(rows[7].GetRowId().GetPageId()));
+  ASSERT_TRUE(page->IsPaxPage());
+  ASSERT_EQ(0, page->GetFreeSpace());
+  Row old_row(rows[7].GetRowId());
+  ASSERT_TRUE(page->UpdateTuple(new_row, &old_row, schema.get(), nullptr, nullptr, nullptr));
+  ASSERT_EQ(CmpBool::kTrue, old_row.GetField(2)->CompareEquals(Field(TypeId::kTypeFloat, 3.5f)));
+  bpm_->UnpinPage(page->GetTablePageId(), true);
+  ASSERT_TRUE(table_heap->GetTuple(&row, nullptr));
+  ASSERT_EQ("updated", row.GetField(1)->toString());
+  ASSERT_TRUE(row.GetField(2)->IsNull());
+  ASSERT_TRUE(table_heap->MarkDelete(rows[7].GetRowId(), nullptr));
+  table_heap->ApplyDelete(rows[7].GetRowId(), nullptr);
+  ASSERT_FALSE(table_heap->GetTuple(&row, nullptr));
+  page = reinterpret_cast<TablePage *>(bpm_->FetchPage(rows[7].GetRowId().GetPageId()));
+  ASSERT_LT(0, page->GetFreeSpace());
+  Row reused(new_fields);
+  ASSERT_TRUE(page->InsertTuple(reused, schema.get(), nullptr, nullptr, nullptr));
+  ASSERT_EQ(rows[7].GetRowId(), reused.GetRowId());
+  bpm_->UnpinPage(page->GetTablePageId(), true);
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+}
+
+TEST(TableHeapTest, ToastTest) {
+  auto disk_mgr_ = new DiskManager("table_heap_toast_test.db");
+  auto bpm_ = new BufferPoolManager(DEFAULT_BUFFER_POOL_SIZE, disk_mgr_);
+  auto meta_page = reinterpret_cast<DiskFileMetaPage *>(disk_mgr_->GetMetaData());
+  const int row_nums = 200;
+  const uint32_t long_len = PAGE_SIZE + 100;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("body", TypeId::kTypeChar, 2 * PAGE_SIZE, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  uint32_t empty_pages = meta_page->GetAllocatedPages();
+  TableHeap *table_heap = TableHeap::Create(bpm_, schema.get(), nullptr, nullptr, nullptr);
+  uint32_t allocated_pages = meta_page->GetAllocatedPages();
+  std::string long_value(long_len, 'x');
+  std::vector<RowId> rids;
+  for (int i = 0; i < row_nums; i++) {
+    long_value[0] = static_cast<char>('a' + i % 26);
+    Fields fields{Field(TypeId::kTypeInt, i), i % 2 == 0
+                                                   ? Field(TypeId::kTypeChar, long_value.data(), long_len, true)
+                                                   : Field(TypeId::kTypeChar, const_cast<char *>("short"), 5, true)};
+    Row row(fields);
+    ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+    rids.push_back(row.GetRowId());
+  }
+  table_heap->ReleaseInsertPage();
+  // only pointers are kept in the tuples, so the heap stays a couple of pages long
+  ASSERT_GE(2u, table_heap->GetPageCount());
+  // each long value takes two overflow pages
+  allocated_pages += table_heap->GetPageCount() - 1;
+  ASSERT_EQ(allocated_pages + row_nums, meta_page->GetAllocatedPages());
+  for (int i = 0; i < row_nums; i++) {
+    Row row(rids[i]);
+    ASSERT_TRUE(table_heap->GetTuple(&row, nullptr));
+    ASSERT_FALSE(row.HasExternal());
+    if (i % 2 == 0) {
+      ASSERT_EQ(long_len, row.GetField(1)->GetLength());
+      ASSERT_EQ('a' + i % 26, row.GetField(1)->GetData()[0]);
+    } else {
+      ASSERT_EQ("short", row.GetField(1)->toString());
+    }
+  }
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  // a scan that does not read the long column does not touch the overflow pages
+  int count = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); iter.NextPage()) {
+    for (auto &view : iter.GetPageRows()) {
+      ASSERT_EQ(count % 2 == 0, view.IsExternal(1));
+      ASSERT_EQ(CmpBool::kTrue, view.GetField(0).CompareEquals(Field(TypeId::kTypeInt, count)));
+      if (count == 10) {
+        ASSERT_EQ(long_len, view.GetField(1).GetLength());
+      }
+      count++;
+    }
+  }
+  ASSERT_EQ(row_nums, count);
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  // updating or deleting a tuple gives its overflow pages back
+  Fields short_fields{Field(TypeId::kTypeInt, 0), Field(TypeId::kTypeChar, const_cast<char *>("now short"), 9, true)};
+  Row short_row(short_fields);
+  table_heap->UpdateTuple(short_row, rids[0], nullptr);
+  Row row(rids[0]);
+  ASSERT_TRUE(table_heap->GetTuple(&row, nullptr));
+  ASSERT_EQ("now short", row.GetField(1)->toString());
+  ASSERT_EQ(allocated_pages + row_nums - 2, meta_page->GetAllocatedPages());
+  for (int i = 2; i < row_nums; i += 2) {
+    ASSERT_TRUE(table_heap->MarkDelete(rids[i], nullptr));
+    table_heap->ApplyDelete(rids[i], nullptr);
+  }
+  ASSERT_EQ(allocated_pages, meta_page->GetAllocatedPages());
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  // dropping the table frees many more overflow pages than it has table pages
+  for (int i = 0; i < row_nums; i++) {
+    Fields fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeChar, long_value.data(), long_len, true)};
+    Row long_row(fields);
+    ASSERT_TRUE(table_heap->InsertTuple(long_row, nullptr));
+  }
+  table_heap->ReleaseInsertPage();
+  ASSERT_LT(allocated_pages + 2 * row_nums - 1, meta_page->GetAllocatedPages());
+  table_heap->DeleteTable();
+  ASSERT_EQ(empty_pages, meta_page->GetAllocatedPages());
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  delete table_heap;
+}
+
+TEST(TableHeapTest, CompressedLayoutTest) {
+  auto disk_mgr_ = new DiskManager("table_heap_compressed_test.db");
+  auto bpm_ = new BufferPoolManager(DEFAULT_BUFFER_POOL_SIZE, disk_mgr_);
+  const int row_nums = 3000;
+  const char *statuses[] = {"new", "paid", "shipped", "returned"};
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("status", TypeId::kTypeChar, 16, 1, true, false),
+                                   new Column("country", TypeId::kTypeChar, 24, 2, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  ASSERT_LT(2 * TablePage::GetPaxCapacity(schema.get()), TablePage::GetPaxCapacity(schema.get(), true));
+  auto make_row = [&](int i) {
+    std::string country = "country" + std::to_string(i % 10);
+    Fields fields{Field(TypeId::kTypeInt, 1000 + i),
+                  Field(TypeId::kTypeChar, const_cast<char *>(statuses[i % 4]), strlen(statuses[i % 4]), true),
+                  i % 7 == 0 ? Field(TypeId::kTypeChar)
+                             : Field(TypeId::kTypeChar, const_cast<char *>(country.c_str()), country.size(), true)};
+    return Row(fields);
+  };
+  TableHeap *pax_heap = TableHeap::Create(bpm_, schema.get(), nullptr, nullptr, nullptr, TableLayout::kPax);
+  TableHeap *table_heap = TableHeap::Create(bpm_, schema.get(), nullptr, nullptr, nullptr, TableLayout::kCompressed);
+  std::vector<Row> pax_rows;
+  std::vector<Row> rows;
+  for (int i = 0; i < row_nums; i++) {
+    pax_rows.push_back(make_row(i));
+    rows.push_back(make_row(i));
+  }
+  ASSERT_TRUE(pax_heap->InsertTuples(pax_rows, nullptr));
+  ASSERT_TRUE(table_heap->InsertTuples(rows, nullptr));
+  pax_heap->ReleaseInsertPage();
+  table_heap->ReleaseInsertPage();
+  // low-cardinality values take a code and small integers a 2-byte delta
+  ASSERT_LE(2 * table_heap->GetPageCount(), pax_heap->GetPageCount());
+  for (int i = 0; i < row_nums; i += 97) {
+    Row row(rows[i].GetRowId());
+    ASSERT_TRUE(table_heap->GetTuple(&row, nullptr));
+    ASSERT_EQ(CmpBool::kTrue, row.GetField(0)->CompareEquals(Field(TypeId::kTypeInt, 1000 + i)));
+    ASSERT_EQ(statuses[i % 4], row.GetField(1)->toString());
+    ASSERT_EQ(i % 7 == 0, row.GetField(2)->IsNull());
+  }
+  // views decode lazily, equal dictionary values share their entry
+  Field paid(TypeId::kTypeChar, const_cast<char *>("paid"), 4, false);
+  Field missing(TypeId::kTypeChar, const_cast<char *>("lost"), 4, false);
+  int count = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); iter.NextPage()) {
+    const char *entry;
+    ASSERT_TRUE(iter.FindDictionaryEntry(1, missing, &entry));
+    ASSERT_EQ(nullptr, entry);
+    ASSERT_FALSE(iter.FindDictionaryEntry(0, Field(TypeId::kTypeInt, 1000), &entry));
+    ASSERT_TRUE(iter.FindDictionaryEntry(1, paid, &entry));
+    for (auto &view : iter.GetPageRows()) {
+      ASSERT_EQ(CmpBool::kTrue, view.GetField(0).CompareEquals(Field(TypeId::kTypeInt, 1000 + count)));
+      ASSERT_EQ(count % 4 == 1, view.GetFieldData(1) == entry);
+      ASSERT_EQ(count % 7 == 0, view.IsNull(2));
+      count++;
+    }
+  }
+  ASSERT_EQ(row_nums, count);
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  // values that do not fit the page encoding go to another page
+  uint32_t page_count = table_heap->GetPageCount();
+  std::vector<RowId> rids;
+  for (uint32_t i = 0; i < 3 * PAX_DICTIONARY_SIZE; i++) {
+    std::string status = "status" + std::to_string(i);
+    Fields fields{Field(TypeId::kTypeInt, static_cast<int32_t>(i % 2 == 0 ? i : 1000000 + i)),
+                  Field(TypeId::kTypeChar, const_cast<char *>(status.c_str()), status.size(), true),
+                  Field(TypeId::kTypeChar)};
+    Row row(fields);
+    ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+    rids.push_back(row.GetRowId());
+  }
+  table_heap->ReleaseInsertPage();
+  ASSERT_LT(page_count + 2, table_heap->GetPageCount());
+  for (uint32_t i = 0; i < 3 * PAX_DICTIONARY_SIZE; i++) {
+    Row row(rids[i]);
+    ASSERT_TRUE(table_heap->GetTuple(&row, nullptr));
+    ASSERT_EQ(CmpBool::kTrue, row.GetField(0)->CompareEquals(
+                                  Field(TypeId::kTypeInt, static_cast<int32_t>(i % 2 == 0 ? i : 1000000 + i))));
+    ASSERT_EQ("status" + std::to_string(i), row.GetField(1)->toString());
+  }
+  // update in place, an emptied page starts its dictionaries over
+  RowId first_rid = rows[0].GetRowId();
+  Row updated = make_row(2);
+  Row old_row(first_rid);
+  auto page = reinterpret_cast<TablePage *>(bpm_->FetchPage(first_rid.GetPageId()));
+  ASSERT_TRUE(page->UpdateTuple(updated, &old_row, schema.get(), nullptr, nullptr, nullptr));
+  bpm_->UnpinPage(first_rid.GetPageId(), true);
+  ASSERT_EQ("new", old_row.GetField(1)->toString());
+  Row row(first_rid);
+  ASSERT_TRUE(table_heap->GetTuple(&row, nullptr));
+  ASSERT_EQ("shipped", row.GetField(1)->toString());
+  for (auto &inserted : rows) {
+    if (inserted.GetRowId().GetPageId() == first_rid.GetPageId()) {
+      ASSERT_TRUE(table_heap->MarkDelete(inserted.GetRowId(), nullptr));
+      table_heap->ApplyDelete(inserted.GetRowId(), nullptr);
+    }
+  }
+  page = reinterpret_cast<TablePage *>(bpm_->FetchPage(first_rid.GetPageId()));
+  ASSERT_EQ(0, page->GetTupleCount());
+  const char *entry;
+  ASSERT_TRUE(page->FindDictionaryEntry(schema.get(), 1, paid, &entry));
+  ASSERT_EQ(nullptr, entry);
+  bpm_->UnpinPage(first_rid.GetPageId(), false);
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+}
+
+TEST(TableHeapTest, TruncateTest) {
+  auto disk_mgr_ = new DiskManager("table_heap_truncate_test.db");
+  auto bpm_ = new BufferPoolManager(DEFAULT_BUFFER_POOL_SIZE, disk_mgr_);
+  auto meta_page = reinterpret_cast<DiskFileMetaPage *>(disk_mgr_->GetMetaData());
+  const int row_nums = 5000;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("body", TypeId::kTypeChar, 2 * PAGE_SIZE, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  uint32_t empty_pages = meta_page->GetAllocatedPages();
+  TableHeap *table_heap = TableHeap::Create(bpm_, schema.get(), nullptr, nullptr, nullptr);
+  uint32_t table_pages = meta_page->GetAllocatedPages();
+  std::string long_value(PAGE_SIZE, 'x');
+  auto insert_rows = [&]() {
+    for (int i = 0; i < row_nums; i++) {
+      Fields fields{Field(TypeId::kTypeInt, i),
+                    i % 100 == 0 ? Field(TypeId::kTypeChar, long_value.data(), long_value.size(), true)
+                                 : Field(TypeId::kTypeChar, const_cast<char *>("short value"), 11, true)};
+      Row row(fields);
+      ASSERT_TRUE(table_heap->InsertTuple(row, nullptr));
+    }
+    table_heap->ReleaseInsertPage();
+  };
+  insert_rows();
+  ASSERT_LT(10u, table_heap->GetPageCount());
+  ASSERT_LT(table_pages + table_heap->GetPageCount(), meta_page->GetAllocatedPages());
+  // the table pages, the overflow pages, the directory and the freespace map go back together
+  ASSERT_TRUE(table_heap->Truncate(nullptr));
+  ASSERT_EQ(1u, table_heap->GetPageCount());
+  ASSERT_EQ(table_pages, meta_page->GetAllocatedPages());
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  ASSERT_TRUE(table_heap->Begin(nullptr) == table_heap->End());
+  // the table is usable again
+  insert_rows();
+  int count = 0;
+  for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); iter++) {
+    count++;
+  }
+  ASSERT_EQ(row_nums, count);
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  table_heap->DeleteTable();
+  ASSERT_EQ(empty_pages, meta_page->GetAllocatedPages());
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  delete table_heap;
+}
+
+TEST(TableHeapTest, RelocationTest) {
+  auto disk_mgr_ = new DiskManager("table_heap_relocation_test.db");
+  auto bpm_ = new BufferPoolManager(DEFAULT_BUFFER_POOL_SIZE, disk_mgr_);
+  const int row_nums = 2000;
+  std::vector<Column *> columns = {new Column("id", TypeId::kTypeInt, 0, false, false),
+                                   new Column("name", TypeId::kTypeChar, 200, 1, true, false)};
+  auto schema = std::make_shared<Schema>(columns);
+  TableHeap *table_heap = TableHeap::Create(bpm_, schema.get(), nullptr, nullptr, nullptr);
+  std::vector<Row> rows;
+  for (int i = 0; i < row_nums; i++) {
+    Fields fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeChar, const_cast<char *>("short"), 5, true)};
+    rows.emplace_back(fields);
+  }
+  ASSERT_TRUE(table_heap->InsertTuples(rows, nullptr));
+  table_heap->ReleaseInsertPage();
+  // growing every third row overflows the full pages, the rows move but keep their row ids
+  auto grow = [&](int i, size_t len) {
+    std::string name(len, static_cast<char>('a' + i % 26));
+    Fields fields{Field(TypeId::kTypeInt, i), Field(TypeId::kTypeChar, const_cast<char *>(name.c_str()), len, true)};
+    Row row(fields);
+    bool relocated = false;
+    EXPECT_TRUE(table_heap->UpdateTuple(row, rows[i].GetRowId(), nullptr, &relocated));
+    return relocated;
+  };
+  std::unordered_set<int> relocated_ids;
+  for (int i = 0; i < row_nums; i += 3) {
+    if (grow(i, 150)) {
+      relocated_ids.insert(i);
+    }
+  }
+  ASSERT_LT(100u, relocated_ids.size());
+  auto check_row = [&](const RowId &rid, int i) {
+    Row row(rid);
+    ASSERT_TRUE(table_heap->GetTuple(&row, nullptr));
+    ASSERT_EQ(rid.Get(), row.GetRowId().Get());
+    ASSERT_EQ(CmpBool::kTrue, row.GetField(0)->CompareEquals(Field(TypeId::kTypeInt, i)));
+    ASSERT_EQ(i % 3 == 0 ? 150u : 5u, row.GetField(1)->GetLength());
+  };
+  for (int i = 0; i < row_nums; i++) {
+    check_row(rows[i].GetRowId(), i);
+  }
+  // a relocated row grows again at its new place or moves once more
+  int moved_id = *relocated_ids.begin();
+  grow(moved_id, 190);
+  Row moved_row(rows[moved_id].GetRowId());
+  ASSERT_TRUE(table_heap->GetTuple(&moved_row, nullptr));
+  ASSERT_EQ(190u, moved_row.GetField(1)->GetLength());
+  grow(moved_id, 150);
+  // scans skip forwarding records and report relocated rows under their row ids
+  auto check_scan = [&](const std::unordered_map<int64_t, int> &expected) {
+    size_t count = 0;
+    for (auto iter = table_heap->Begin(nullptr); iter != table_heap->End(); iter++) {
+      auto found = expected.find(iter->GetRowId().Get());
+      ASSERT_TRUE(found != expected.end());
+      ASSERT_EQ(CmpBool::kTrue, iter->GetField(0)->CompareEquals(Field(TypeId::kTypeInt, found->second)));
+      count++;
+    }
+    ASSERT_EQ(expected.size(), count);
+  };
+  std::unordered_map<int64_t, int> expected;
+  for (int i = 0; i < row_nums; i++) {
+    expected.emplace(rows[i].GetRowId().Get(), i);
+  }
+  check_scan(expected);
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  // deleting through the forwarding record removes the relocated tuple too
+  int deleted_id = *std::next(relocated_ids.begin());
+  ASSERT_TRUE(table_heap->MarkDelete(rows[deleted_id].GetRowId(), nullptr));
+  table_heap->ApplyDelete(rows[deleted_id].GetRowId(), nullptr);
+  Row deleted_row(rows[deleted_id].GetRowId());
+  ASSERT_FALSE(table_heap->GetTuple(&deleted_row, nullptr));
+  expected.erase(rows[deleted_id].GetRowId().Get());
+  relocated_ids.erase(deleted_id);
+  check_scan(expected);
+  // vacuum folds the forwards, the relocated rows are reached by their new row ids afterwards
+  std::vector<std::pair<RowId, RowId>> moved_rows;
+  table_heap->Vacuum(false, &moved_rows, nullptr);
+  ASSERT_EQ(relocated_ids.size(), moved_rows.size());
+  for (auto &moved : moved_rows) {
+    int id = expected.at(moved.first.Get());
+    ASSERT_EQ(1u, relocated_ids.count(id));
+    Row row(moved.first);
+    ASSERT_FALSE(table_heap->GetTuple(&row, nullptr));
+    check_row(moved.second, id);
+    expected.erase(moved.first.Get());
+    expected.emplace(moved.second.Get(), id);
+  }
+  check_scan(expected);
+  ASSERT_TRUE(bpm_->CheckAllUnpinned());
+  delete table_heap;
+}